@@ -0,0 +1,106 @@
+#include "AftrImGui_BoidBackend.h"
+#include "AftrImGuiIncludes.h"
+#include "BoidBackend.h"
+
+void Aftr::AftrImGui_BoidBackend::draw( const BoidBackendReport& report, const BoidSimThreadStats& simThread, bool ensembleActive )
+{
+   if( ImGui::Begin( "Boid Backend" ) )
+   {
+      ImGui::Text( "Renderer: %s%s", report.renderer.c_str(), report.softwareRenderer ? " (software)" : "" );
+      ImGui::Text( "CPU threads: %u", report.cpuThreads );
+      if( ensembleActive )
+         ImGui::TextDisabled( "Ensembles follow their own CPU Batch switch" );
+
+      if( ImGui::BeginTable( "backends", 3 ) )
+      {
+         ImGui::TableSetupColumn( "Backend" );
+         ImGui::TableSetupColumn( "ms / step" );
+         ImGui::TableSetupColumn( "Status" );
+         ImGui::TableHeadersRow();
+         for( int i = 0; i < BoidBackendReport::NUM_BACKENDS; ++i )
+         {
+            const BoidBackendType type = static_cast< BoidBackendType >( i );
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if( ImGui::RadioButton( BoidBackend::getName( type ), report.active == type ) && report.available[i] && report.active != type )
+               this->switchRequested = i;
+            ImGui::TableNextColumn();
+            if( report.benchMsPerStep[i] >= 0.0f )
+               ImGui::Text( "%.3f", report.benchMsPerStep[i] );
+            else
+               ImGui::Text( "-" );
+            ImGui::TableNextColumn();
+            if( !report.available[i] )
+               ImGui::TextColored( ImVec4( 1.0f, 0.5f, 0.2f, 1.0f ), "%s", report.unavailableReason[i].c_str() );
+            else if( report.active == type )
+               ImGui::Text( "active" );
+         }
+         ImGui::EndTable();
+      }
+      if( report.benchEntities > 0 )
+         ImGui::Text( "Benchmarked on %d entities", report.benchEntities );
+      if( ImGui::Button( "Re-run Benchmark" ) )
+         this->benchmarkRequested = true;
+
+      ImGui::Separator();
+      const BoidTuningConfig& t = report.tuning;
+      if( report.tuningKey.backend.empty() )
+         ImGui::TextDisabled( "Auto-tuning off (boidAutoTune=0)" );
+      else
+      {
+         ImGui::Text( "Tuned for %s, 2^%d entities (%s)", report.tuningKey.backend.c_str(), report.tuningKey.sizeBucket,
+                      report.tuningFromCache ? "cached" : "measured" );
+         if( report.active == BoidBackendType::GpuCompute )
+            ImGui::Text( "Workgroup %d, %s", t.workgroupSize, t.neighborLists ? "neighbor lists" : "all pairs" );
+         else
+            ImGui::Text( "Chunk %d, %s", t.cpuGrain, t.neighborLists ? "neighbor lists" : "all pairs" );
+         if( t.neighborLists )
+            ImGui::Text( "List grid cells: %.1f list radii", t.cellScale );
+         if( t.msPerStep >= 0.0f )
+            ImGui::Text( "%.3f ms/step when tuned", t.msPerStep );
+         if( !report.tuningFromCache && report.tuningCandidates > 0 )
+            ImGui::Text( "Best of %d configurations", report.tuningCandidates );
+      }
+      if( ImGui::Button( "Re-tune" ) )
+         this->retuneRequested = true;
+
+      ImGui::Separator();
+      ImGui::SliderInt( "Drift Steps", &this->driftSteps, 20, 1000 );
+      if( ImGui::Button( "Check Drift" ) && report.available[static_cast< int >( BoidBackendType::GpuCompute )] )
+         this->driftRequested = true;
+      if( !report.driftVariant.empty() )
+      {
+         ImGui::Text( "GPU %s vs CPU reference", report.driftVariant.c_str() );
+         ImGui::TextWrapped( "%s", report.driftSummary.c_str() );
+         if( report.driftFailure.empty() )
+            ImGui::Text( "Within tolerance" );
+         else
+            ImGui::TextColored( ImVec4( 1.0f, 0.5f, 0.2f, 1.0f ), "Out of tolerance: %s", report.driftFailure.c_str() );
+      }
+
+      ImGui::Separator();
+      if( report.active != BoidBackendType::GpuCompute )
+      {
+         ImGui::Checkbox( "Simulation Thread", &this->useSimThread );
+         if( simThread.running )
+         {
+            if( simThread.targetRate > 0.0f )
+               ImGui::Text( "Sim %.1f of %.1f steps/s, render %.1f fps", simThread.simRate, simThread.targetRate, simThread.renderRate );
+            else
+               ImGui::Text( "Sim %.1f steps/s (free running), render %.1f fps", simThread.simRate, simThread.renderRate );
+            ImGui::Text( "Steps per drawn frame: %.2f", simThread.stepsPerFrame );
+            ImGui::Text( "Step: %.3f ms", simThread.stepMs );
+            ImGui::Text( "Handoff latency: %.2f ms (max %.2f)", simThread.latencyMs, simThread.maxLatencyMs );
+            ImGui::Text( "States drawn %llu, dropped %llu", (unsigned long long)simThread.picked, (unsigned long long)simThread.dropped );
+            ImGui::Text( "Behind schedule: %llu", (unsigned long long)simThread.overruns );
+            ImGui::Text( "Parameters v%llu (%llu updates)", (unsigned long long)simThread.paramVersion, (unsigned long long)simThread.paramUpdates );
+         }
+         else
+            ImGui::Text( "Step + upload: %.3f ms", report.cpuStepMs );
+         ImGui::Text( "Streamed to GPU: %.1f MB", report.uploadedBytes / ( 1024.0 * 1024.0 ) );
+         ImGui::TextDisabled( "Far field and simulation LOD run on the GPU backend only" );
+      }
+      ImGui::Text( "Switches: %llu", (unsigned long long)report.switches );
+      ImGui::End();
+   }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+
+namespace Aftr
+{
+struct BoidBackendReport;
+struct BoidSimThreadStats;
+
+class AftrImGui_BoidBackend
+{
+public:
+   void draw( const BoidBackendReport& report, const BoidSimThreadStats& simThread, bool ensembleActive );
+
+   int switchRequested = -1;       // BoidBackendType to switch to on the next frame, -1 = none
+   bool benchmarkRequested = false; // re-measure every backend on the current swarm
+   bool retuneRequested = false;    // re-run the auto-tuner for the current key, replacing its cache entry
+   bool driftRequested = false;     // compare the GPU kernel in use with the CPU reference
+   int driftSteps = 200;
+   bool useSimThread = false;       // CPU backends step on a dedicated thread at Steps / Second (see BoidSimThread)
+};
+
+}
+
+#endif
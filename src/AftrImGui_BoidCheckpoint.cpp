@@ -0,0 +1,37 @@
+#include "AftrImGui_BoidCheckpoint.h"
+#include "AftrImGuiIncludes.h"
+#include "BoidCheckpoint.h"
+
+#include <algorithm>
+
+void Aftr::AftrImGui_BoidCheckpoint::draw( const BoidCheckpointStats& stats, bool writing, bool ensembleActive )
+{
+   if( ImGui::Begin( "Boid Checkpoints" ) )
+   {
+      if( ensembleActive )
+         ImGui::TextDisabled( "Single swarm only: not available in ensemble mode" );
+      ImGui::InputText( "File", this->path, sizeof( this->path ) );
+      if( ImGui::Button( "Save Checkpoint" ) )
+         this->saveRequested = true;
+      ImGui::SameLine();
+      if( ImGui::Button( "Restore" ) )
+         this->restoreRequested = true;
+      ImGui::SliderFloat( "Autosave (s)", &this->autosaveSeconds, 0.0f, 600.0f, this->autosaveSeconds > 0.0f ? "%.0f" : "off" );
+      this->autosaveSeconds = std::max( this->autosaveSeconds, 0.0f );
+
+      ImGui::Separator();
+      if( writing || this->saveRequested )
+         ImGui::Text( "Writing..." );
+      ImGui::Text( "%llu written, %llu failed", (unsigned long long)stats.writes, (unsigned long long)stats.failures );
+      if( stats.writes > 0 )
+         ImGui::Text( "Last: %.1f MiB, capture %.1f ms, write %.1f ms (background)", stats.lastBytes / ( 1024.0 * 1024.0 ),
+                      stats.lastCaptureMs, stats.lastWriteMs );
+      if( stats.lastRestoreMs > 0.0 )
+         ImGui::Text( "Last restore: %.1f ms", stats.lastRestoreMs );
+      if( !stats.lastError.empty() )
+         ImGui::TextWrapped( "%s", stats.lastError.c_str() );
+      if( !this->status.empty() )
+         ImGui::TextWrapped( "%s", this->status.c_str() );
+      ImGui::End();
+   }
+}
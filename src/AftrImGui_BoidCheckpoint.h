@@ -0,0 +1,25 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+
+#include <string>
+
+namespace Aftr
+{
+struct BoidCheckpointStats;
+
+class AftrImGui_BoidCheckpoint
+{
+public:
+   void draw( const BoidCheckpointStats& stats, bool writing, bool ensembleActive );
+
+   char path[256] = "./boid_checkpoint.bin"; // boidCheckpoint in aftr.conf
+   float autosaveSeconds = 0.0f;  // periodic checkpoint while running, 0 = off (boidCheckpointInterval)
+   bool saveRequested = false;    // capture the newest published step on the next frame
+   bool restoreRequested = false; // replace the swarm and settings with the file on the next frame
+   std::string status;            // result of the last restore or refused save
+};
+
+}
+
+#endif
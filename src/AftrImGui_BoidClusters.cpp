@@ -0,0 +1,55 @@
+#include "AftrImGui_BoidClusters.h"
+#include "AftrImGuiIncludes.h"
+
+void Aftr::AftrImGui_BoidClusters::draw( const BoidClusterResult& result, int numBoids )
+{
+   if( ImGui::Begin( "Boid Clusters" ) )
+   {
+      ImGui::Checkbox( "Analyze Clusters", &this->isEnabled );
+      ImGui::SameLine();
+      ImGui::Checkbox( "Color By Cluster", &this->colorByCluster );
+      ImGui::SliderInt( "Interval (frames)", &this->intervalFrames, 1, 60 );
+      ImGui::SliderInt( "Min Cluster Size", &this->minClusterSize, 1, 100 );
+      ImGui::SliderInt( "Clusters Listed", &this->numListed, 1, 50 );
+
+      if( this->isEnabled )
+         this->draw_cluster_stats( result, numBoids );
+
+      ImGui::End();
+   }
+}
+
+void Aftr::AftrImGui_BoidClusters::draw_cluster_stats( const BoidClusterResult& result, int numBoids )
+{
+   ImGui::Separator();
+   if( result.labels.empty() )
+   {
+      ImGui::Text( "Waiting for first snapshot..." );
+      return;
+   }
+
+   int numFlocks = 0;
+   int stragglers = 0;
+   for( const auto& c : result.clusters )
+   {
+      if( static_cast< int >( c.size ) >= this->minClusterSize )
+         ++numFlocks;
+      else
+         stragglers += c.size;
+   }
+
+   ImGui::Text( "Frame %llu: %d sub-flocks, %d stragglers (%d boids)", (unsigned long long)result.frame,
+                numFlocks, stragglers, numBoids );
+   ImGui::Text( "Splits: %u  Merges: %u  Analysis: %.2f ms", result.numSplits, result.numMerges, result.elapsedMs );
+
+   ImGui::Separator();
+   int listed = 0;
+   for( const auto& c : result.clusters )
+   {
+      if( listed >= this->numListed || static_cast< int >( c.size ) < this->minClusterSize )
+         break;
+      ImGui::Text( "#%-5u %6u boids  c=(%.1f, %.1f, %.1f)  v=(%.2f, %.2f, %.2f)", c.id, c.size,
+                   c.centroid.x, c.centroid.y, c.centroid.z, c.velocity.x, c.velocity.y, c.velocity.z );
+      ++listed;
+   }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+
+#include "BoidClusterAnalysis.h"
+
+namespace Aftr
+{
+
+class AftrImGui_BoidClusters
+{
+public:
+   void draw( const BoidClusterResult& result, int numBoids );
+
+   bool isEnabled = false;
+   bool colorByCluster = true;
+   int intervalFrames = 6;   // frames between snapshot requests
+   int minClusterSize = 5;   // smaller components are counted as stragglers
+   int numListed = 10;
+
+private:
+   void draw_cluster_stats( const BoidClusterResult& result, int numBoids );
+};
+
+}
+
+#endif
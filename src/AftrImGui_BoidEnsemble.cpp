@@ -0,0 +1,72 @@
+#include "AftrImGui_BoidEnsemble.h"
+#include "AftrImGuiIncludes.h"
+
+void Aftr::AftrImGui_BoidEnsemble::draw( const std::vector< BoidSwarmParams >& instances,
+                                         const std::vector< BoidSwarmMetrics >& metrics, uint64_t metricsFrame )
+{
+   if( ImGui::Begin( "Boid Ensemble" ) )
+   {
+      this->draw_ensemble_settings();
+      if( this->isEnabled )
+         this->draw_instance_metrics( instances, metrics, metricsFrame );
+      ImGui::End();
+   }
+}
+
+void Aftr::AftrImGui_BoidEnsemble::draw_ensemble_settings()
+{
+   if( ImGui::Checkbox( "Ensemble Mode", &this->isEnabled ) )
+      this->resetRequested = true;
+   ImGui::SameLine();
+   if( ImGui::Checkbox( "CPU Batch", &this->useCpuBatch ) )
+      this->resetRequested = true;
+
+   if( ImGui::SliderInt( "Instances", &this->numInstances, 1, 64 ) )
+      this->resetRequested = true;
+   if( ImGui::Checkbox( "Same Initial Swarm", &this->sameInitialSwarm ) )
+      this->resetRequested = true;
+
+   // Swept parameter: instance i gets min + (max - min) * i / (M - 1); the rest follow Boid Controls
+   const char* names[static_cast< int >( BoidSweepParam::Count )];
+   for( int i = 0; i < static_cast< int >( BoidSweepParam::Count ); ++i )
+      names[i] = BoidEnsemble::getSweepParamName( static_cast< BoidSweepParam >( i ) );
+   ImGui::Combo( "Swept Parameter", &this->sweptParam, names, static_cast< int >( BoidSweepParam::Count ) );
+   ImGui::InputFloat( "Sweep Min", &this->sweepMin );
+   ImGui::InputFloat( "Sweep Max", &this->sweepMax );
+
+   ImGui::SliderInt( "Viewed Instance", &this->viewedInstance, 0, this->numInstances - 1 );
+   ImGui::SliderInt( "Metrics Interval (frames)", &this->metricsIntervalFrames, 1, 120 );
+}
+
+void Aftr::AftrImGui_BoidEnsemble::draw_instance_metrics( const std::vector< BoidSwarmParams >& instances,
+                                                          const std::vector< BoidSwarmMetrics >& metrics, uint64_t metricsFrame )
+{
+   ImGui::Separator();
+   if( metrics.size() != instances.size() )
+   {
+      ImGui::Text( "Waiting for first snapshot..." );
+      return;
+   }
+
+   ImGui::Text( "Frame %llu, %d instances", (unsigned long long)metricsFrame, static_cast< int >( instances.size() ) );
+   BoidSweepParam param = static_cast< BoidSweepParam >( this->sweptParam );
+   if( ImGui::BeginTable( "instances", 5 ) )
+   {
+      ImGui::TableSetupColumn( "#" );
+      ImGui::TableSetupColumn( BoidEnsemble::getSweepParamName( param ) );
+      ImGui::TableSetupColumn( "Polarization" );
+      ImGui::TableSetupColumn( "Mean Speed" );
+      ImGui::TableSetupColumn( "Gyration Radius" );
+      ImGui::TableHeadersRow();
+      for( int i = 0; i < static_cast< int >( instances.size() ); ++i )
+      {
+         ImGui::TableNextRow();
+         ImGui::TableNextColumn(); ImGui::Text( i == this->viewedInstance ? "%d *" : "%d", i );
+         ImGui::TableNextColumn(); ImGui::Text( "%.3f", BoidEnsemble::getSweepParam( instances[i], param ) );
+         ImGui::TableNextColumn(); ImGui::Text( "%.3f", metrics[i].polarization );
+         ImGui::TableNextColumn(); ImGui::Text( "%.3f", metrics[i].meanSpeed );
+         ImGui::TableNextColumn(); ImGui::Text( "%.2f", metrics[i].gyrationRadius );
+      }
+      ImGui::EndTable();
+   }
+}
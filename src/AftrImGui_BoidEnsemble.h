@@ -0,0 +1,37 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+
+#include "BoidEnsemble.h"
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+
+class AftrImGui_BoidEnsemble
+{
+public:
+   void draw( const std::vector< BoidSwarmParams >& instances, const std::vector< BoidSwarmMetrics >& metrics,
+              uint64_t metricsFrame );
+
+   bool isEnabled = false;
+   bool useCpuBatch = false;      // step every instance on the thread pool instead of one dispatch
+   bool sameInitialSwarm = true;  // all instances start from the same swarm (only the swept parameter differs)
+   int numInstances = 8;
+   int viewedInstance = 0;        // instance drawn in the scene
+   int sweptParam = static_cast< int >( BoidSweepParam::Cohesion );
+   float sweepMin = 0.2f;
+   float sweepMax = 3.0f;
+   int metricsIntervalFrames = 10;
+   bool resetRequested = false;   // layout changed; the ensemble is rebuilt on the next frame
+
+private:
+   void draw_ensemble_settings();
+   void draw_instance_metrics( const std::vector< BoidSwarmParams >& instances, const std::vector< BoidSwarmMetrics >& metrics,
+                               uint64_t metricsFrame );
+};
+
+}
+
+#endif
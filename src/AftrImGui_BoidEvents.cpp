@@ -0,0 +1,77 @@
+#include "AftrImGui_BoidEvents.h"
+#include "AftrImGuiIncludes.h"
+#include "BoidEventStream.h"
+
+#include <algorithm>
+#include <string>
+
+void Aftr::AftrImGui_BoidEvents::draw( const BoidEventStream& stream, uint32_t capacity, int pendingBatches, bool available )
+{
+   static const char* typeNames[] = { "eat", "respawn", "retarget" };
+   if( ImGui::Begin( "Boid Events" ) )
+   {
+      if( !available )
+         ImGui::TextDisabled( "Recorded by the GPU backend only, not in ensemble mode" );
+      ImGui::Checkbox( "Record Events", &this->isEnabled );
+      ImGui::InputInt( "Events per Frame", &this->capacity );
+      this->capacity = std::clamp( this->capacity, 64, 1 << 20 );
+
+      const BoidEventStats& stats = stream.getStats();
+      ImGui::Text( "%llu events: %llu eats, %llu respawns, %llu retargets", static_cast< unsigned long long >( stats.total ),
+                   static_cast< unsigned long long >( stats.byType[0] ), static_cast< unsigned long long >( stats.byType[1] ),
+                   static_cast< unsigned long long >( stats.byType[2] ) );
+      ImGui::Text( "Last frame %u, peak %u of %u; %d batch(es) in flight", stats.lastBatch, stats.peakBatch, capacity, pendingBatches );
+      if( stats.dropped > 0 )
+         ImGui::TextColored( ImVec4( 1.0f, 0.4f, 0.3f, 1.0f ), "%llu dropped: raise Events per Frame",
+                             static_cast< unsigned long long >( stats.dropped ) );
+      else
+         ImGui::Text( "None dropped" );
+
+      ImGui::Separator();
+      for( int t = 0; t < 3; ++t )
+      {
+         if( t > 0 )
+            ImGui::SameLine();
+         ImGui::Checkbox( typeNames[t], &this->showType[t] );
+      }
+      ImGui::InputInt( "Entity (-1 = all)", &this->entityFilter );
+      this->entityFilter = std::max( this->entityFilter, -1 );
+      ImGui::SliderInt( "Rows", &this->maxRows, 10, 1000 );
+
+      if( ImGui::BeginTable( "events", 5, ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg, ImVec2( 0.0f, 300.0f ) ) )
+      {
+         ImGui::TableSetupColumn( "Frame" );
+         ImGui::TableSetupColumn( "Event" );
+         ImGui::TableSetupColumn( "Entity" );
+         ImGui::TableSetupColumn( "Other" );
+         ImGui::TableSetupColumn( "Position" );
+         ImGui::TableHeadersRow();
+         int rows = 0;
+         for( uint64_t seq = stream.getHead(); seq > stream.getTail() && rows < this->maxRows; --seq )
+         {
+            const BoidEvent& e = stream.at( seq - 1 );
+            if( e.type >= 3 || !this->showType[e.type] )
+               continue;
+            if( this->entityFilter >= 0 && static_cast< int >( e.entity ) != this->entityFilter && e.other != this->entityFilter )
+               continue;
+            ++rows;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text( "%u", e.frame );
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted( typeNames[e.type] );
+            ImGui::TableNextColumn();
+            ImGui::PushID( static_cast< int >( seq ) );
+            if( ImGui::Selectable( std::to_string( e.entity ).c_str(), false ) )
+               this->selectRequested = static_cast< int >( e.entity );
+            ImGui::PopID();
+            ImGui::TableNextColumn();
+            ImGui::Text( "%d", e.other );
+            ImGui::TableNextColumn();
+            ImGui::Text( "(%.1f, %.1f, %.1f)", e.x, e.y, e.z );
+         }
+         ImGui::EndTable();
+      }
+      ImGui::End();
+   }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+#include <cstdint>
+
+namespace Aftr
+{
+class BoidEventStream;
+
+/// Eats, respawns and predator retargets recorded by the GPU kernel, newest first
+class AftrImGui_BoidEvents
+{
+public:
+   void draw( const BoidEventStream& stream, uint32_t capacity, int pendingBatches, bool available );
+
+   bool isEnabled = false;        // run the events kernel variant and drain its log every frame
+   int capacity = 4096;           // events per frame the GPU log holds before it drops
+   bool showType[3] = { true, true, true }; // by BoidEventType
+   int entityFilter = -1;         // only events involving this entity, -1 for all
+   int maxRows = 200;
+   int selectRequested = -1;      // entity clicked in the log, for Boids > Selection
+};
+
+}
+
+#endif
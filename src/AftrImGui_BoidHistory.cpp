@@ -0,0 +1,38 @@
+#include "AftrImGui_BoidHistory.h"
+#include "AftrImGuiIncludes.h"
+#include "BoidSwarmTypes.h"
+#include "BoidGpuHistory.h"
+
+#include <algorithm>
+
+void Aftr::AftrImGui_BoidHistory::draw( const BoidHistoryStats& stats, bool ensembleActive )
+{
+   if( ImGui::Begin( "Boid History" ) )
+   {
+      if( ensembleActive )
+         ImGui::TextDisabled( "Not recorded in ensemble mode" );
+      ImGui::Checkbox( "Record History", &this->isEnabled );
+      ImGui::InputInt( "Frames (K)", &this->historyFrames );
+      this->historyFrames = std::clamp( this->historyFrames, 2, 3600 );
+      ImGui::Text( "%d / %d frames of %d entities: %.1f MiB on the GPU", stats.filled, stats.numSlots, stats.numEntities,
+                   stats.bytes / ( 1024.0 * 1024.0 ) );
+
+      ImGui::Separator();
+      ImGui::Checkbox( "Trails", &this->showTrails );
+      ImGui::SliderInt( "Trail Length", &this->trailLength, 2, std::min( this->historyFrames, BoidGpuHistory::MAX_TRAIL + 1 ) );
+      ImGui::SliderFloat( "Trail Opacity", &this->trailOpacity, 0.05f, 1.0f );
+
+      ImGui::Separator();
+      if( ImGui::SliderInt( "Frames Back", &this->framesBack, 0, std::max( stats.filled - 1, 0 ) ) && stats.filled > 0 )
+         this->rewindRequested = true;
+      if( this->isRewound )
+      {
+         ImGui::Text( "Rewound to step %d", stats.viewedStep );
+         if( ImGui::Button( "Resume From Here" ) )
+            this->resumeRequested = true;
+      }
+      else if( ImGui::Button( "Rewind" ) && stats.filled > 0 )
+         this->rewindRequested = true;
+      ImGui::End();
+   }
+}
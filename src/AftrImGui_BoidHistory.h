@@ -0,0 +1,29 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+
+namespace Aftr
+{
+struct BoidHistoryStats;
+
+class AftrImGui_BoidHistory
+{
+public:
+   void draw( const BoidHistoryStats& stats, bool ensembleActive );
+
+   bool isEnabled = false;        // record the GPU history ring every frame
+   int historyFrames = 120;       // K
+   bool showTrails = true;
+   int trailLength = 60;
+   float trailOpacity = 0.6f;
+
+   // Rewind: the swarm is paused on the frame 'framesBack' before the newest until resumed
+   int framesBack = 0;
+   bool isRewound = false;
+   bool rewindRequested = false;  // restore 'framesBack' on the next frame
+   bool resumeRequested = false;  // continue from the shown frame, dropping the newer ones
+};
+
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include "AftrImGui_BoidProfiler.h"
+#include "AftrImGuiIncludes.h"
+#include "BoidProfiler.h"
+
+void Aftr::AftrImGui_BoidProfiler::draw( BoidProfiler& profiler )
+{
+   if( ImGui::Begin( "Boid Profiler" ) )
+   {
+      bool busy = BoidProfiler::isCapturing() || profiler.isWriting() || this->captureRequested;
+      ImGui::InputInt( "Frames", &this->captureFrames );
+      if( this->captureFrames < 1 )
+         this->captureFrames = 1;
+      if( ImGui::Button( "Capture Trace" ) && !busy )
+         this->captureRequested = true;
+
+      if( BoidProfiler::isCapturing() )
+         ImGui::Text( "Capturing... %d frames left", profiler.getFramesRemaining() );
+      else if( profiler.isWriting() )
+         ImGui::Text( "Writing %s...", profiler.getLastFile().c_str() );
+      else if( !profiler.getLastFile().empty() )
+      {
+         ImGui::Text( "Last trace: %s", profiler.getLastFile().c_str() );
+         ImGui::Text( "%d events (open in ui.perfetto.dev or chrome://tracing)", static_cast< int >( profiler.getLastEventCount() ) );
+      }
+      ImGui::End();
+   }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+
+namespace Aftr
+{
+class BoidProfiler;
+
+class AftrImGui_BoidProfiler
+{
+public:
+   void draw( BoidProfiler& profiler );
+
+   int captureFrames = 120;
+   bool captureRequested = false; // picked up at the start of the next frame
+};
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+#include "AftrImGui_BoidScenario.h"
+#include "AftrImGuiIncludes.h"
+#include "BoidScenario.h"
+
+#include <algorithm>
+#include <filesystem>
+
+void Aftr::AftrImGui_BoidScenario::draw( const BoidScenario& current, int stepsRun )
+{
+   if( ImGui::Begin( "Boid Scenarios" ) )
+   {
+      if( !this->catalogListed )
+         this->refreshCatalog();
+
+      ImGui::Text( "Current: %s (seed %llu)", current.name.c_str(), (unsigned long long)current.seed );
+      ImGui::Text( "Step %d / %d", stepsRun, current.steps );
+      ImGui::Checkbox( "Stop At Scenario End", &this->stopAtEnd );
+
+      ImGui::Separator();
+      std::vector< std::string > names;
+      for( const std::string& path : this->catalog )
+         names.push_back( std::filesystem::path( path ).stem().string() );
+      std::vector< const char* > items;
+      for( const std::string& n : names )
+         items.push_back( n.c_str() );
+      ImGui::Combo( "Catalog", &this->selected, items.data(), static_cast< int >( items.size() ) );
+      if( ImGui::Button( "Load" ) && this->selected >= 0 && this->selected < static_cast< int >( this->catalog.size() ) )
+         this->loadRequested = this->catalog[this->selected];
+      ImGui::SameLine();
+      if( ImGui::Button( "Refresh" ) )
+         this->refreshCatalog();
+
+      ImGui::InputText( "Name", this->saveName, sizeof( this->saveName ) );
+      if( ImGui::Button( "Save Current Settings" ) && this->saveName[0] )
+      {
+         this->saveRequested = ( std::filesystem::path( this->scenarioDir ) / ( std::string( this->saveName ) + ".boidscene" ) ).string();
+         this->catalogListed = false;
+      }
+
+      if( !this->status.empty() )
+         ImGui::TextWrapped( "%s", this->status.c_str() );
+      ImGui::End();
+   }
+}
+
+void Aftr::AftrImGui_BoidScenario::refreshCatalog()
+{
+   this->catalog = BoidScenario::listCatalog( this->scenarioDir );
+   this->selected = std::min( this->selected, static_cast< int >( this->catalog.size() ) - 1 );
+   this->catalogListed = true;
+}
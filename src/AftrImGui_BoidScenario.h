@@ -0,0 +1,34 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+struct BoidScenario;
+
+class AftrImGui_BoidScenario
+{
+public:
+   void draw( const BoidScenario& current, int stepsRun );
+
+   std::string scenarioDir;       // catalog directory (boidScenarioDir in aftr.conf)
+   bool stopAtEnd = false;        // pause once the scenario's duration has been simulated
+   std::string loadRequested;     // scenario file to apply on the next frame
+   std::string saveRequested;     // file the current settings are written to on the next frame
+   std::string status;            // result of the last load/save
+
+private:
+   void refreshCatalog();
+
+   std::vector< std::string > catalog;
+   int selected = 0;
+   bool catalogListed = false;
+   char saveName[64] = "my_scenario";
+};
+
+}
+
+#endif
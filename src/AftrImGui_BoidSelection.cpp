@@ -0,0 +1,74 @@
+#include "AftrImGui_BoidSelection.h"
+#include "AftrImGuiIncludes.h"
+#include "BoidSpatialQuery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+void Aftr::AftrImGui_BoidSelection::draw( const BoidSpatialIndex* index, const BoidSpatialQueryStats& stats, bool ensembleActive )
+{
+   if( ImGui::Begin( "Boid Selection" ) )
+   {
+      if( ensembleActive )
+         ImGui::TextDisabled( "Not available in ensemble mode" );
+      ImGui::Checkbox( "Enable Picking (Shift + Left Click)", &this->isEnabled );
+      ImGui::SliderFloat( "Pick Radius", &this->pickRadius, 0.1f, 5.0f );
+      ImGui::SliderInt( "Nearest (k)", &this->k, 1, 32 );
+      ImGui::SliderFloat( "Neighborhood Radius", &this->radius, 0.5f, 25.0f );
+
+      ImGui::Separator();
+      if( index && this->selected >= 0 && static_cast< uint32_t >( this->selected ) < index->size() )
+      {
+         const BoidSnapshot& snap = index->getSnapshot();
+         const BoidGPU& b = snap.boids[this->selected];
+         ImGui::Text( "%s %d (snapshot frame %llu)", this->selected < snap.numBoids ? "Boid" : "Predator", this->selected,
+                      static_cast< unsigned long long >( snap.frame ) );
+         ImGui::Text( "Position (%.2f, %.2f, %.2f)", b.px, b.py, b.pz );
+         ImGui::Text( "Velocity (%.3f, %.3f, %.3f)", b.vx, b.vy, b.vz );
+
+         const BoidQuery q{ b.px, b.py, b.pz, static_cast< uint32_t >( this->selected ) };
+         std::vector< uint32_t > hits;
+         index->queryRadius( q, this->radius, hits );
+         ImGui::Text( "%zu entities within %.1f", hits.size(), this->radius );
+
+         hits.clear();
+         std::vector< float > distSq;
+         index->queryNearest( q, static_cast< uint32_t >( this->k ), hits, &distSq );
+         if( ImGui::BeginTable( "nearest", 3 ) )
+         {
+            ImGui::TableSetupColumn( "Entity" );
+            ImGui::TableSetupColumn( "Type" );
+            ImGui::TableSetupColumn( "Distance" );
+            ImGui::TableHeadersRow();
+            for( size_t i = 0; i < hits.size(); ++i )
+            {
+               ImGui::TableNextRow();
+               ImGui::TableNextColumn();
+               ImGui::PushID( static_cast< int >( i ) );
+               if( ImGui::Selectable( std::to_string( hits[i] ).c_str(), false, ImGuiSelectableFlags_SpanAllColumns ) )
+                  this->selected = static_cast< int >( hits[i] );
+               ImGui::PopID();
+               ImGui::TableNextColumn();
+               ImGui::TextUnformatted( static_cast< int >( hits[i] ) < snap.numBoids ? "boid" : "predator" );
+               ImGui::TableNextColumn();
+               ImGui::Text( "%.2f", std::sqrt( distSq[i] ) );
+            }
+            ImGui::EndTable();
+         }
+         if( ImGui::Button( "Clear Selection" ) )
+            this->selected = -1;
+      }
+      else
+         ImGui::TextDisabled( "Nothing selected" );
+
+      ImGui::Separator();
+      ImGui::Text( "Index: frame %llu, %u entities, built in %.2f ms", static_cast< unsigned long long >( stats.frame ), stats.entities,
+                   stats.lastBuildMs );
+      ImGui::Text( "Builds %llu (%llu incremental, %u movers last), queries %llu", static_cast< unsigned long long >( stats.builds ),
+                   static_cast< unsigned long long >( stats.incrementalBuilds ), stats.lastMovers,
+                   static_cast< unsigned long long >( stats.queries ) );
+      ImGui::End();
+   }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "AftrConfig.h"
+#ifdef  AFTR_CONFIG_USE_IMGUI
+
+namespace Aftr
+{
+class BoidSpatialIndex;
+struct BoidSpatialQueryStats;
+
+/// Boid picked with Shift + left click, its neighborhood and the spatial index behind it
+class AftrImGui_BoidSelection
+{
+public:
+   void draw( const BoidSpatialIndex* index, const BoidSpatialQueryStats& stats, bool ensembleActive );
+
+   bool isEnabled = false;   // keep a spatial index of the newest snapshot and allow picking
+   float pickRadius = 1.0f;  // distance from the mouse ray that still selects a boid
+   int k = 8;                // nearest neighbors listed
+   float radius = 5.0f;      // neighborhood counted
+   int selected = -1;        // entity index, -1 if none
+};
+
+}
+
+#endif
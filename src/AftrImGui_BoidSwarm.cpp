@@ -1,12 +1,14 @@
 #include "AftrImGui_BoidSwarm.h"
 #include "AftrImGuiIncludes.h"
 
-void Aftr::AftrImGui_BoidSwarm::draw()
+void Aftr::AftrImGui_BoidSwarm::draw( const BoidPipelineStats& pipeline, const BoidNeighborListStats& neighbors,
+                                      const BoidAggregateStats& aggregates, const BoidLodStats& lod )
 {
-   this->draw_boid_controls();
+   this->draw_boid_controls( pipeline, neighbors, aggregates, lod );
 }
 
-void Aftr::AftrImGui_BoidSwarm::draw_boid_controls()
+void Aftr::AftrImGui_BoidSwarm::draw_boid_controls( const BoidPipelineStats& pipeline, const BoidNeighborListStats& neighbors,
+                                                    const BoidAggregateStats& aggregates, const BoidLodStats& lod )
 {
    if( ImGui::Begin( "Boid Controls" ) )
    {
@@ -23,6 +25,8 @@ void Aftr::AftrImGui_BoidSwarm::draw_boid_controls()
          this->resetRequested = true;
       if( ImGui::SliderInt( "Num Predators", &this->numPredators, 0, 10 ) )
          this->resetRequested = true;
+      if( ImGui::InputScalar( "Seed", ImGuiDataType_U64, &this->seed ) )
+         this->resetRequested = true;
 
       ImGui::Separator();
       ImGui::Text( "Flocking Weights" );
@@ -49,6 +53,100 @@ void Aftr::AftrImGui_BoidSwarm::draw_boid_controls()
       ImGui::Separator();
       ImGui::Checkbox( "Show Obstacles", &this->showObstacles );
 
+      this->draw_pipeline( pipeline );
+      this->draw_neighbor_lists( neighbors );
+      this->draw_aggregates( aggregates );
+      this->draw_lod( lod );
+
       ImGui::End();
    }
 }
+
+void Aftr::AftrImGui_BoidSwarm::draw_pipeline( const BoidPipelineStats& pipeline )
+{
+   ImGui::Separator();
+   ImGui::Text( "Pipeline" );
+   if( ImGui::SliderInt( "State Buffers", &this->stateBuffers, 3, 8 ) )
+      this->resetRequested = true;
+   ImGui::SliderFloat( "Steps / Second", &this->stepsPerSecond, 0.0f, 240.0f, this->stepsPerSecond > 0.0f ? "%.0f" : "per frame" );
+   ImGui::Checkbox( "Interpolate", &this->interpolate );
+
+   ImGui::Text( "Steps: %llu (%d last frame, up to %d)", (unsigned long long)pipeline.stepsIssued, pipeline.stepsLastFrame,
+                pipeline.numSlots - 2 );
+   ImGui::Text( "Drawn with a step in flight: %llu / %llu frames", (unsigned long long)pipeline.framesOverlapped,
+                (unsigned long long)pipeline.framesDrawn );
+   ImGui::Text( "Upload waits: %llu  Alpha: %.2f", (unsigned long long)pipeline.uploadWaits, pipeline.renderAlpha );
+}
+
+void Aftr::AftrImGui_BoidSwarm::draw_neighbor_lists( const BoidNeighborListStats& neighbors )
+{
+   ImGui::Separator();
+   ImGui::Text( "Neighbor Lists" );
+   ImGui::Checkbox( "Use Neighbor Lists", &this->useNeighborLists );
+   ImGui::SliderFloat( "Skin", &this->neighborSkin, 0.1f, 5.0f );
+   ImGui::SliderInt( "Max Neighbors", &this->maxNeighbors, 16, 1024 );
+   ImGui::Checkbox( "Hashed Grid", &this->useHashedGrid );
+   if( !this->useNeighborLists )
+      return;
+
+   // Pays off when lists are short and the swarm moves slowly relative to the skin
+   if( neighbors.rebuilds > 0 )
+      ImGui::Text( "Rebuilds: %llu / %llu steps (every %.1f)", (unsigned long long)neighbors.rebuilds,
+                   (unsigned long long)neighbors.steps, static_cast< double >( neighbors.steps ) / neighbors.rebuilds );
+   else
+      ImGui::Text( "Rebuilds: none yet" );
+   ImGui::Text( "Neighbors: %.1f mean, %u max", neighbors.meanNeighbors, neighbors.maxNeighbors );
+   if( neighbors.overflowBoids > 0 )
+      ImGui::TextColored( ImVec4( 1.0f, 0.5f, 0.2f, 1.0f ), "%u boids over Max Neighbors (lists truncated)", neighbors.overflowBoids );
+   if( neighbors.gridSlots == 0 )
+      return;
+
+   // A dense grid pays for every cell of its box, a hashed one for the occupied cells only
+   const float occupancy = static_cast< float >( neighbors.occupiedCells ) / neighbors.gridSlots;
+   if( neighbors.hashedGrid )
+      ImGui::Text( "Hashed grid: %u cells in %u slots, load %.2f, longest probe %u", neighbors.occupiedCells, neighbors.gridSlots,
+                   occupancy, neighbors.maxProbe );
+   else
+      ImGui::Text( "Dense grid: %u of %u cells occupied (%.1f%%)", neighbors.occupiedCells, neighbors.gridSlots, 100.0f * occupancy );
+   ImGui::Text( "Grid memory: %.1f KB", neighbors.gridBytes / 1024.0 );
+}
+
+void Aftr::AftrImGui_BoidSwarm::draw_aggregates( const BoidAggregateStats& aggregates )
+{
+   ImGui::Separator();
+   ImGui::Text( "Approximate Far Field" );
+   ImGui::Checkbox( "Use Cell Aggregates", &this->useAggregates );
+   if( this->useLod )
+      ImGui::TextDisabled( "Error measurement pauses while Simulation LOD is on" );
+   ImGui::SliderFloat( "Opening Angle", &this->aggregateTheta, 0.0f, 1.5f );
+   ImGui::SliderInt( "Error Sample Boids", &this->aggregateErrorSamples, 64, 8192 );
+   ImGui::SliderInt( "Error Interval (frames)", &this->aggregateErrorIntervalFrames, 1, 600 );
+   if( !this->useAggregates || aggregates.levels == 0 )
+      return;
+
+   ImGui::Text( "Levels: %d (%d^3 base cells of %.2f)", aggregates.levels, aggregates.baseDim, aggregates.baseCellSize );
+   if( aggregates.probes > 0 )
+      ImGui::Text( "Steering error vs exact: %.2f%% RMS, %.2f%% max (%u boids)", aggregates.rmsError * 100.0f,
+                   aggregates.maxError * 100.0f, aggregates.sampleBoids );
+   else
+      ImGui::Text( "Steering error vs exact: not measured yet" );
+}
+
+void Aftr::AftrImGui_BoidSwarm::draw_lod( const BoidLodStats& lod )
+{
+   ImGui::Separator();
+   ImGui::Text( "Simulation LOD" );
+   ImGui::Checkbox( "Use Simulation LOD", &this->useLod );
+   ImGui::SliderFloat( "Full Rate Distance", &this->lodNearDistance, 5.0f, 200.0f );
+   ImGui::SliderFloat( "Predator Radius", &this->lodPredatorRadius, 0.0f, 50.0f );
+   ImGui::SliderFloat( "Calm Deviation", &this->lodCalmSpeed, 0.0f, 0.2f, "%.3f" );
+   ImGui::SliderInt( "Lowest Tier", &this->lodMaxTier, 0, 3 );
+   if( !this->useLod || lod.numEntities == 0 )
+      return;
+
+   if( this->useNeighborLists && !this->useAggregates )
+      ImGui::TextDisabled( "Neighbor lists are off while LOD is on" );
+   ImGui::Text( "Boids per tier (1/2/4/8): %u / %u / %u / %u", lod.tierCounts[0], lod.tierCounts[1], lod.tierCounts[2], lod.tierCounts[3] );
+   ImGui::Text( "Stepped in full: %u of %u (%.0f%%)", lod.activeEntities, lod.numEntities,
+                100.0f * lod.activeEntities / lod.numEntities );
+}
@@ -2,6 +2,7 @@
 #include "AftrConfig.h"
 #ifdef  AFTR_CONFIG_USE_IMGUI
 
+#include "BoidSwarmTypes.h"
 #include <functional>
 
 namespace Aftr
@@ -10,7 +11,8 @@ namespace Aftr
 class AftrImGui_BoidSwarm
 {
 public:
-   void draw();
+   void draw( const BoidPipelineStats& pipeline, const BoidNeighborListStats& neighbors, const BoidAggregateStats& aggregates,
+              const BoidLodStats& lod );
 
    // Flocking weights
    float separationWeight = 1.5f;
@@ -34,14 +36,44 @@ public:
    // Boid / predator count
    int numBoids = 1000;
    int numPredators = 1;
+   uint64_t seed = 1; // swarm RNG seed, applied on reset (the full 64 bits a scenario may carry)
 
    // Simulation control
    bool isPaused = false;
    bool resetRequested = false;
    bool showObstacles = true;
 
+   // Simulate/render pipeline
+   int stateBuffers = 3;         // state ring slots; more let fixed-rate stepping run further ahead
+   float stepsPerSecond = 0.0f;  // fixed simulation rate, 0 = one step per rendered frame
+   bool interpolate = true;      // blend the two newest states when the rates differ
+
+   // Verlet neighbor lists (single swarm)
+   bool useNeighborLists = false;
+   float neighborSkin = 1.0f;    // lists hold boids within max(sep, nei radius) + skin
+   int maxNeighbors = 128;       // longer lists are truncated (counted as overflow)
+   bool useHashedGrid = false;   // lists are built through a hashed grid of the occupied cells (large, sparse domains)
+
+   // Approximate far field (single swarm; takes precedence over the neighbor lists)
+   bool useAggregates = false;
+   float aggregateTheta = 0.5f;  // cells smaller than theta * distance count as one; 0 = exact
+   int aggregateErrorSamples = 1024;      // boids re-stepped exactly per error measurement
+   int aggregateErrorIntervalFrames = 60;
+
+   // Simulation LOD (single swarm): distant, calm boids are stepped every 2, 4 or 8 steps
+   bool useLod = false;
+   float lodNearDistance = 40.0f;   // full rate within this camera distance, a tier less per doubling
+   float lodPredatorRadius = 15.0f; // full rate this close to a predator
+   float lodCalmSpeed = 0.05f;      // velocity deviation from the neighbors that still counts as calm
+   int lodMaxTier = 3;
+
 private:
-   void draw_boid_controls();
+   void draw_boid_controls( const BoidPipelineStats& pipeline, const BoidNeighborListStats& neighbors, const BoidAggregateStats& aggregates,
+                            const BoidLodStats& lod );
+   void draw_pipeline( const BoidPipelineStats& pipeline );
+   void draw_neighbor_lists( const BoidNeighborListStats& neighbors );
+   void draw_aggregates( const BoidAggregateStats& aggregates );
+   void draw_lod( const BoidLodStats& lod );
 };
 
 }
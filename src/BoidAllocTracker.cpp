@@ -0,0 +1,178 @@
+#include "BoidArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Off unless the build asks for it: the counting operators sit on every allocation of the
+// process. The GTest target turns it on; the app does with -DBOID_COUNT_ALLOCATIONS=ON
+#ifndef BOID_COUNT_ALLOCATIONS
+   #define BOID_COUNT_ALLOCATIONS 0
+#endif
+
+using namespace Aftr;
+
+namespace
+{
+   // One counter pair per thread, on its own cache line and written only by its thread, so
+   // counting is a plain load and store; readers sum the slots. Threads past MAX_SLOTS share
+   // the last slot and update it atomically
+   struct alignas( 64 ) CounterSlot
+   {
+      std::atomic< uint64_t > allocations{ 0 };
+      std::atomic< uint64_t > bytes{ 0 };
+   };
+   constexpr uint32_t MAX_SLOTS = 256;
+   CounterSlot slots[MAX_SLOTS];
+   std::atomic< uint32_t > slotsTaken{ 0 };
+
+   // Plain thread_local values: no constructor, so they are usable before main() and while
+   // a thread is being torn down
+   thread_local uint64_t threadAllocations = 0;
+   thread_local CounterSlot* threadSlot = nullptr;
+}
+
+#if BOID_COUNT_ALLOCATIONS
+
+namespace
+{
+   inline void count( std::size_t bytes )
+   {
+      ++threadAllocations;
+      if( !threadSlot )
+         threadSlot = &slots[std::min( slotsTaken.fetch_add( 1, std::memory_order_relaxed ), MAX_SLOTS - 1 )];
+      CounterSlot& slot = *threadSlot;
+      if( &slot == &slots[MAX_SLOTS - 1] )
+      {
+         slot.allocations.fetch_add( 1, std::memory_order_relaxed );
+         slot.bytes.fetch_add( bytes, std::memory_order_relaxed );
+         return;
+      }
+      slot.allocations.store( slot.allocations.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+      slot.bytes.store( slot.bytes.load( std::memory_order_relaxed ) + bytes, std::memory_order_relaxed );
+   }
+
+   void* allocate( std::size_t bytes )
+   {
+      count( bytes );
+      for( ;; )
+      {
+         if( void* p = std::malloc( bytes ? bytes : 1 ) )
+            return p;
+         std::new_handler handler = std::get_new_handler();
+         if( !handler )
+            return nullptr;
+         handler();
+      }
+   }
+
+   void* allocateAligned( std::size_t bytes, std::size_t align )
+   {
+      count( bytes );
+      bytes = ( ( bytes ? bytes : 1 ) + align - 1 ) / align * align;
+      for( ;; )
+      {
+#ifdef _WIN32
+         if( void* p = _aligned_malloc( bytes, align ) )
+            return p;
+#else
+         if( void* p = std::aligned_alloc( align, bytes ) )
+            return p;
+#endif
+         std::new_handler handler = std::get_new_handler();
+         if( !handler )
+            return nullptr;
+         handler();
+      }
+   }
+
+   void freeAligned( void* p )
+   {
+#ifdef _WIN32
+      _aligned_free( p );
+#else
+      std::free( p );
+#endif
+   }
+}
+
+void* operator new( std::size_t bytes )
+{
+   if( void* p = allocate( bytes ) )
+      return p;
+   throw std::bad_alloc();
+}
+void* operator new[]( std::size_t bytes )
+{
+   return ::operator new( bytes );
+}
+void* operator new( std::size_t bytes, const std::nothrow_t& ) noexcept
+{
+   return allocate( bytes );
+}
+void* operator new[]( std::size_t bytes, const std::nothrow_t& ) noexcept
+{
+   return allocate( bytes );
+}
+void* operator new( std::size_t bytes, std::align_val_t align )
+{
+   if( void* p = allocateAligned( bytes, static_cast< std::size_t >( align ) ) )
+      return p;
+   throw std::bad_alloc();
+}
+void* operator new[]( std::size_t bytes, std::align_val_t align )
+{
+   return ::operator new( bytes, align );
+}
+void* operator new( std::size_t bytes, std::align_val_t align, const std::nothrow_t& ) noexcept
+{
+   return allocateAligned( bytes, static_cast< std::size_t >( align ) );
+}
+void* operator new[]( std::size_t bytes, std::align_val_t align, const std::nothrow_t& ) noexcept
+{
+   return allocateAligned( bytes, static_cast< std::size_t >( align ) );
+}
+
+void operator delete( void* p ) noexcept { std::free( p ); }
+void operator delete[]( void* p ) noexcept { std::free( p ); }
+void operator delete( void* p, std::size_t ) noexcept { std::free( p ); }
+void operator delete[]( void* p, std::size_t ) noexcept { std::free( p ); }
+void operator delete( void* p, const std::nothrow_t& ) noexcept { std::free( p ); }
+void operator delete[]( void* p, const std::nothrow_t& ) noexcept { std::free( p ); }
+void operator delete( void* p, std::align_val_t ) noexcept { freeAligned( p ); }
+void operator delete[]( void* p, std::align_val_t ) noexcept { freeAligned( p ); }
+void operator delete( void* p, std::size_t, std::align_val_t ) noexcept { freeAligned( p ); }
+void operator delete[]( void* p, std::size_t, std::align_val_t ) noexcept { freeAligned( p ); }
+void operator delete( void* p, std::align_val_t, const std::nothrow_t& ) noexcept { freeAligned( p ); }
+void operator delete[]( void* p, std::align_val_t, const std::nothrow_t& ) noexcept { freeAligned( p ); }
+
+#endif
+
+bool BoidAllocTracker::isEnabled()
+{
+   return BOID_COUNT_ALLOCATIONS != 0;
+}
+
+uint64_t BoidAllocTracker::getThreadAllocations()
+{
+   return threadAllocations;
+}
+
+uint64_t BoidAllocTracker::getTotalAllocations()
+{
+   uint64_t total = 0;
+   const uint32_t used = std::min( slotsTaken.load( std::memory_order_relaxed ), MAX_SLOTS );
+   for( uint32_t i = 0; i < used; ++i )
+      total += slots[i].allocations.load( std::memory_order_relaxed );
+   return total;
+}
+
+uint64_t BoidAllocTracker::getTotalBytes()
+{
+   uint64_t total = 0;
+   const uint32_t used = std::min( slotsTaken.load( std::memory_order_relaxed ), MAX_SLOTS );
+   for( uint32_t i = 0; i < used; ++i )
+      total += slots[i].bytes.load( std::memory_order_relaxed );
+   return total;
+}
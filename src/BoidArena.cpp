@@ -0,0 +1,103 @@
+#include "BoidArena.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+using namespace Aftr;
+
+BoidArena::BoidArena( size_t blockBytes ) : blockBytes( std::max< size_t >( blockBytes, 256 ) )
+{
+}
+
+BoidArena::~BoidArena()
+{
+   for( Block& b : this->blocks )
+      ::operator delete( b.data, std::align_val_t( alignof( std::max_align_t ) ) );
+}
+
+BoidArena& BoidArena::forThread()
+{
+   thread_local BoidArena arena;
+   return arena;
+}
+
+void BoidArena::addBlock( size_t minBytes )
+{
+   // Grow geometrically so a frame that outgrows the arena chains few blocks
+   size_t size = std::max( minBytes, this->blockBytes );
+   if( !this->blocks.empty() )
+      size = std::max( size, 2 * this->blocks.back().size );
+   Block b;
+   b.data = static_cast< uint8_t* >( ::operator new( size, std::align_val_t( alignof( std::max_align_t ) ) ) );
+   b.size = size;
+   this->blocks.push_back( b );
+   ++this->blockAllocations;
+}
+
+void* BoidArena::allocate( size_t bytes, size_t align )
+{
+   if( bytes == 0 )
+      bytes = 1;
+   for( ;; )
+   {
+      if( this->current < this->blocks.size() )
+      {
+         const Block& b = this->blocks[this->current];
+         const uintptr_t base = reinterpret_cast< uintptr_t >( b.data );
+         const size_t start = ( ( base + this->offset + align - 1 ) & ~( uintptr_t( align ) - 1 ) ) - base;
+         if( start + bytes <= b.size )
+         {
+            this->offset = start + bytes;
+            this->highWater = std::max( this->highWater, this->getUsed() );
+            return b.data + start;
+         }
+         // Doesn't fit: move on to the next block, chaining one if this was the last
+         if( this->current + 1 < this->blocks.size() )
+         {
+            ++this->current;
+            this->offset = 0;
+            continue;
+         }
+      }
+      this->addBlock( bytes + align );
+      this->current = this->blocks.size() - 1;
+      this->offset = 0;
+   }
+}
+
+void BoidArena::rewind( const BoidArenaMark& m )
+{
+   this->current = m.block;
+   this->offset = m.offset;
+}
+
+void BoidArena::reset()
+{
+   if( this->blocks.size() > 1 )
+   {
+      const size_t total = this->getCapacity();
+      for( Block& b : this->blocks )
+         ::operator delete( b.data, std::align_val_t( alignof( std::max_align_t ) ) );
+      this->blocks.clear();
+      this->addBlock( total );
+   }
+   this->current = 0;
+   this->offset = 0;
+}
+
+size_t BoidArena::getUsed() const
+{
+   size_t used = this->offset;
+   for( size_t i = 0; i < this->current && i < this->blocks.size(); ++i )
+      used += this->blocks[i].size;
+   return used;
+}
+
+size_t BoidArena::getCapacity() const
+{
+   size_t total = 0;
+   for( const Block& b : this->blocks )
+      total += b.size;
+   return total;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace Aftr
+{
+
+/// Position in a BoidArena to rewind to
+struct BoidArenaMark
+{
+   size_t block = 0;
+   size_t offset = 0;
+};
+
+/**
+   Bump allocator for scratch data whose lifetime is a frame, a step or a scope. allocate() only
+   moves a pointer; memory comes back all at once through reset() (or rewind() to a mark, see
+   BoidArenaScope). When a frame needs more than the current block the arena chains another
+   one, and the next reset() replaces the chain by a single block of the combined size, so a
+   workload that repeats stops touching the heap after its first frame.
+
+   Only trivially destructible types: nothing is destroyed. forThread() is the calling
+   thread's own arena for short-lived scratch inside a function; use it through a
+   BoidArenaScope so nested users don't clobber each other.
+*/
+class BoidArena
+{
+public:
+   explicit BoidArena( size_t blockBytes = 64 * 1024 );
+   ~BoidArena();
+   BoidArena( const BoidArena& ) = delete;
+   BoidArena& operator=( const BoidArena& ) = delete;
+
+   void* allocate( size_t bytes, size_t align = alignof( std::max_align_t ) );
+
+   template< typename T >
+   T* allocate( size_t count )
+   {
+      static_assert( std::is_trivially_destructible_v< T >, "BoidArena never runs destructors" );
+      return static_cast< T* >( this->allocate( count * sizeof( T ), alignof( T ) ) );
+   }
+
+   BoidArenaMark mark() const { return { this->current, this->offset }; }
+   /// Frees everything allocated since 'm'; the blocks stay for the next allocations
+   void rewind( const BoidArenaMark& m );
+   /// Frees everything and merges chained blocks into one
+   void reset();
+
+   size_t getUsed() const;           ///< bytes handed out since the last reset, including alignment
+   size_t getHighWater() const { return this->highWater; }
+   size_t getCapacity() const;
+   uint64_t getBlockAllocations() const { return this->blockAllocations; } ///< heap allocations so far
+
+   /// The calling thread's scratch arena
+   static BoidArena& forThread();
+
+private:
+   struct Block
+   {
+      uint8_t* data = nullptr;
+      size_t size = 0;
+   };
+   void addBlock( size_t minBytes );
+
+   size_t blockBytes;
+   std::vector< Block > blocks;
+   size_t current = 0;   // block being filled
+   size_t offset = 0;    // first free byte in it
+   size_t highWater = 0;
+   uint64_t blockAllocations = 0;
+};
+
+/// Rewinds an arena to where it was when the scope began
+class BoidArenaScope
+{
+public:
+   explicit BoidArenaScope( BoidArena& arena = BoidArena::forThread() ) : arena( arena ), start( arena.mark() ) {}
+   ~BoidArenaScope() { this->arena.rewind( this->start ); }
+   BoidArenaScope( const BoidArenaScope& ) = delete;
+   BoidArenaScope& operator=( const BoidArenaScope& ) = delete;
+
+   template< typename T >
+   T* allocate( size_t count ) { return this->arena.allocate< T >( count ); }
+
+private:
+   BoidArena& arena;
+   BoidArenaMark start;
+};
+
+/**
+   Heap allocation counters. Built with BOID_COUNT_ALLOCATIONS=1 (the GTest target),
+   BoidAllocTracker.cpp replaces the global operator new and counts every call per thread, so a
+   test or benchmark can assert that a code path reaches a steady state without touching the
+   heap; the process-wide numbers sum the per-thread counters when read. Other builds keep the
+   standard operators and isEnabled() is false.
+*/
+class BoidAllocTracker
+{
+public:
+   static bool isEnabled();
+   static uint64_t getThreadAllocations(); ///< by the calling thread
+   static uint64_t getTotalAllocations();  ///< by all threads
+   static uint64_t getTotalBytes();
+};
+
+/// Heap allocations made by all threads (or only this one) since construction
+class BoidAllocScope
+{
+public:
+   BoidAllocScope() : total( BoidAllocTracker::getTotalAllocations() ), thread( BoidAllocTracker::getThreadAllocations() ) {}
+   uint64_t getAllocations() const { return BoidAllocTracker::getTotalAllocations() - this->total; }
+   uint64_t getThreadAllocations() const { return BoidAllocTracker::getThreadAllocations() - this->thread; }
+
+private:
+   uint64_t total;
+   uint64_t thread;
+};
+
+} //namespace Aftr
@@ -0,0 +1,128 @@
+#include "BoidBackend.h"
+#include "BoidCpuKernel.h"
+#include "BoidThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace Aftr;
+
+namespace
+{
+   std::string lower( std::string s )
+   {
+      std::transform( s.begin(), s.end(), s.begin(), []( unsigned char c ) { return static_cast< char >( std::tolower( c ) ); } );
+      return s;
+   }
+}
+
+const char* BoidBackend::getName( BoidBackendType type )
+{
+   switch( type )
+   {
+      case BoidBackendType::GpuCompute:  return "GPU Compute";
+      case BoidBackendType::CpuThreaded: return "CPU Threaded";
+      case BoidBackendType::CpuScalar:   return "CPU Scalar";
+      default:                           return "?";
+   }
+}
+
+const char* BoidBackend::getConfigName( BoidBackendType type )
+{
+   switch( type )
+   {
+      case BoidBackendType::GpuCompute:  return "gpu";
+      case BoidBackendType::CpuThreaded: return "cpu";
+      case BoidBackendType::CpuScalar:   return "scalar";
+      default:                           return "?";
+   }
+}
+
+bool BoidBackend::parse( const std::string& name, BoidBackendType& out )
+{
+   const std::string s = lower( name );
+   if( s == "gpu" )
+      out = BoidBackendType::GpuCompute;
+   else if( s == "cpu" )
+      out = BoidBackendType::CpuThreaded;
+   else if( s == "scalar" )
+      out = BoidBackendType::CpuScalar;
+   else
+      return false;
+   return true;
+}
+
+bool BoidBackend::isSoftwareRenderer( const std::string& renderer )
+{
+   const std::string s = lower( renderer );
+   for( const char* name : { "llvmpipe", "softpipe", "swiftshader", "software", "gdi generic", "swrast" } )
+      if( s.find( name ) != std::string::npos )
+         return true;
+   return false;
+}
+
+BoidBackendType BoidBackend::pickFastest( const BoidBackendReport& report )
+{
+   int best = -1;
+   for( int i = 0; i < BoidBackendReport::NUM_BACKENDS; ++i )
+   {
+      if( !report.available[i] || report.benchMsPerStep[i] < 0.0f )
+         continue;
+      if( best < 0 || report.benchMsPerStep[i] < report.benchMsPerStep[best] )
+         best = i;
+   }
+   if( best >= 0 )
+      return static_cast< BoidBackendType >( best );
+   return report.available[0] ? BoidBackendType::GpuCompute : BoidBackendType::CpuThreaded;
+}
+
+void BoidCpuSwarm::load( const BoidGPU* src, uint32_t count )
+{
+   this->state[0].assign( src, src + count );
+   this->state[1] = this->state[0];
+   this->read = 0;
+   this->neighbors.invalidate();
+   this->neighbors.resetStats();
+}
+
+BoidGPU* BoidCpuSwarm::prepare( uint32_t count )
+{
+   this->state[0].resize( count );
+   this->state[1].resize( count );
+   this->read = 0;
+   this->neighbors.invalidate();
+   this->neighbors.resetStats();
+   return this->state[0].data();
+}
+
+void BoidCpuSwarm::clear()
+{
+   this->state[0].clear();
+   this->state[1].clear();
+   this->read = 0;
+}
+
+void BoidCpuSwarm::setTuning( int grain, float cellScale )
+{
+   this->grain = static_cast< uint32_t >( std::max( grain, 1 ) );
+   this->neighbors.setCellScale( cellScale );
+}
+
+void BoidCpuSwarm::step( const BoidSwarmParams& params, const BoidStepGlobals& globals, BoidThreadPool& pool,
+                         bool useNeighborLists, float neighborSkin )
+{
+   const BoidGPU* in = this->state[this->read].data();
+   BoidGPU* out = this->state[1 - this->read].data();
+   const BoidNeighborList* lists = nullptr;
+   if( useNeighborLists )
+   {
+      this->neighbors.setSkin( neighborSkin );
+      this->neighbors.update( in, params, pool );
+      lists = &this->neighbors;
+   }
+   else
+      this->neighbors.invalidate(); // steps without the lists never checked the skin
+
+   BoidCpuKernel::step( in, out, params, globals, pool, this->grain, lists );
+   this->read = 1 - this->read;
+}
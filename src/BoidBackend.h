@@ -0,0 +1,108 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include "BoidNeighborList.h"
+#include "BoidTuning.h"
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+class BoidThreadPool;
+
+/// Where the single swarm is stepped
+enum class BoidBackendType : int
+{
+   GpuCompute = 0, // flocking compute shader (all kernel options)
+   CpuThreaded,    // BoidCpuKernel on the shared thread pool
+   CpuScalar,      // BoidCpuKernel on the main thread only
+   Count
+};
+
+/// What startup found out about the machine and what the backend benchmark measured
+struct BoidBackendReport
+{
+   static constexpr int NUM_BACKENDS = static_cast< int >( BoidBackendType::Count );
+
+   BoidBackendType active = BoidBackendType::GpuCompute;
+   bool available[NUM_BACKENDS] = { false, true, true };
+   std::string unavailableReason[NUM_BACKENDS];
+   float benchMsPerStep[NUM_BACKENDS] = { -1.0f, -1.0f, -1.0f }; // < 0 = not measured
+   int benchEntities = 0;
+
+   std::string renderer;        // GL_RENDERER
+   std::string glVersion;       // GL_VERSION
+   bool softwareRenderer = false;
+   unsigned int cpuThreads = 1;
+
+   // Auto-tuner: configuration in use for the active backend and swarm size
+   BoidTuningConfig tuning;
+   BoidTuningKey tuningKey;
+   bool tuningFromCache = false;
+   int tuningCandidates = 0;    // configurations measured by the last tuning pass
+
+   // Drift check: the GPU kernel variant in use against the CPU reference (see BoidDriftHarness)
+   std::string driftVariant;    // empty until the first check
+   std::string driftSummary;
+   std::string driftFailure;    // empty when within tolerance
+
+   float cpuStepMs = 0.0f;      // CPU backends: smoothed wall time of a step including its upload
+   uint64_t switches = 0;
+   uint64_t uploadedBytes = 0;  // CPU backends: states streamed to the render buffers
+};
+
+/**
+   Backend selection helpers. The probe fills a BoidBackendReport, the benchmark adds a cost per
+   step to every available backend and pickFastest() turns the report into a choice.
+*/
+class BoidBackend
+{
+public:
+   static const char* getName( BoidBackendType type );
+   /// Inverse of parse(): "gpu", "cpu" or "scalar"
+   static const char* getConfigName( BoidBackendType type );
+   /// "gpu", "cpu" or "scalar" (case-insensitive); false for anything else, including "auto"
+   static bool parse( const std::string& name, BoidBackendType& out );
+   /// Mesa's llvmpipe/softpipe, SwiftShader, Microsoft's GDI renderer, ...
+   static bool isSoftwareRenderer( const std::string& renderer );
+   /// Cheapest measured available backend; without measurements the GPU when available
+   static BoidBackendType pickFastest( const BoidBackendReport& report );
+};
+
+/**
+   Authoritative state of a swarm on a CPU backend: two buffers stepped in turn by
+   BoidCpuKernel, optionally through Verlet lists. The pool decides the flavor; a pool of one
+   thread runs every chunk on the caller.
+*/
+class BoidCpuSwarm
+{
+public:
+   /// Takes over 'count' entities, e.g. read back from the GPU on a backend switch
+   void load( const BoidGPU* state, uint32_t count );
+   /// Sizes the swarm to 'count' entities and returns them to be filled in place (seeding);
+   /// clear() keeps the capacity, so reseeding a swarm of the same size doesn't allocate
+   BoidGPU* prepare( uint32_t count );
+   void clear();
+   bool isLoaded() const { return !this->state[0].empty(); }
+   uint32_t size() const { return static_cast< uint32_t >( this->state[0].size() ); }
+   const BoidGPU* getState() const { return this->state[this->read].data(); }
+
+   void step( const BoidSwarmParams& params, const BoidStepGlobals& globals, BoidThreadPool& pool,
+              bool useNeighborLists, float neighborSkin );
+   /// Tuned: entities per pool chunk and list grid cells in list radii
+   void setTuning( int grain, float cellScale );
+   /// Neighbor lists rebuild through a hashed grid (see BoidHashGrid)
+   void setHashedGrid( bool hashed ) { this->neighbors.setHashedGrid( hashed ); }
+   /// Neighbors per boid the lists reserve up front (see BoidNeighborList::setCapacity)
+   void setNeighborCapacity( uint32_t neighborsPerBoid ) { this->neighbors.setCapacity( neighborsPerBoid ); }
+
+   const BoidNeighborListStats& getNeighborStats() const { return this->neighbors.getStats(); }
+
+private:
+   std::vector< BoidGPU > state[2];
+   int read = 0;
+   uint32_t grain = 256;
+   BoidNeighborList neighbors;
+};
+
+} //namespace Aftr
@@ -0,0 +1,113 @@
+#include "BoidCellGrid.h"
+#include "BoidArena.h"
+#include "BoidThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+using namespace Aftr;
+
+void BoidCellGrid::build( const BoidGPU* boids, uint32_t count, float requestedCellSize, BoidThreadPool& pool,
+                          uint32_t maxCells )
+{
+   // Bounding box of the set
+   float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+   float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+   for( uint32_t i = 0; i < count; ++i )
+   {
+      const float p[3] = { boids[i].px, boids[i].py, boids[i].pz };
+      for( int k = 0; k < 3; ++k )
+      {
+         lo[k] = std::min( lo[k], p[k] );
+         hi[k] = std::max( hi[k], p[k] );
+      }
+   }
+   if( count == 0 )
+      for( int k = 0; k < 3; ++k )
+         lo[k] = hi[k] = 0.0f;
+
+   // Grow the cells until the box fits into maxCells
+   this->cellSize = std::max( requestedCellSize, 1e-4f );
+   for( ;; )
+   {
+      double total = 1.0;
+      for( int k = 0; k < 3; ++k )
+      {
+         this->dims[k] = std::max( 1, static_cast< int >( std::floor( ( hi[k] - lo[k] ) / this->cellSize ) ) + 1 );
+         total *= this->dims[k];
+      }
+      if( total <= maxCells )
+         break;
+      this->cellSize *= 1.25f;
+   }
+   this->invCellSize = 1.0f / this->cellSize;
+   for( int k = 0; k < 3; ++k )
+      this->origin[k] = lo[k];
+
+   // Cell of every boid (parallel), then a serial stable counting sort so each cell lists
+   // its members in ascending index order regardless of the thread count
+   this->cellOfBoid.resize( count );
+   pool.parallelFor( count, 4096, [&]( uint32_t begin, uint32_t end )
+   {
+      for( uint32_t i = begin; i < end; ++i )
+         this->cellOfBoid[i] = this->cellOf( boids[i].px, boids[i].py, boids[i].pz );
+   } );
+
+   const uint32_t numCells = this->getNumCells();
+   this->cellStart.assign( numCells + 1, 0 );
+   for( uint32_t i = 0; i < count; ++i )
+      ++this->cellStart[this->cellOfBoid[i] + 1];
+
+   this->occupied.clear();
+   for( uint32_t c = 0; c < numCells; ++c )
+   {
+      if( this->cellStart[c + 1] != 0 )
+         this->occupied.push_back( c );
+      this->cellStart[c + 1] += this->cellStart[c];
+   }
+
+   this->sortedIdx.resize( count );
+   BoidArenaScope scratch;
+   uint32_t* cursor = scratch.allocate< uint32_t >( numCells );
+   std::copy( this->cellStart.begin(), this->cellStart.end() - 1, cursor );
+   for( uint32_t i = 0; i < count; ++i )
+      this->sortedIdx[cursor[this->cellOfBoid[i]]++] = i;
+}
+
+void BoidCellGrid::reserve( uint32_t count, uint32_t maxCells )
+{
+   this->cellOfBoid.reserve( count );
+   this->sortedIdx.reserve( count );
+   this->cellStart.reserve( static_cast< size_t >( maxCells ) + 1 );
+   this->occupied.reserve( std::min( count, maxCells ) );
+   // build()'s cursors come from the thread's arena, which keeps the blocks it grew
+   BoidArenaScope scratch;
+   scratch.allocate< uint32_t >( maxCells );
+}
+
+uint32_t BoidCellGrid::cellOf( float x, float y, float z ) const
+{
+   const float p[3] = { x, y, z };
+   int c[3];
+   for( int k = 0; k < 3; ++k )
+      c[k] = std::clamp( static_cast< int >( ( p[k] - this->origin[k] ) * this->invCellSize ), 0, this->dims[k] - 1 );
+   return ( static_cast< uint32_t >( c[2] ) * this->dims[1] + c[1] ) * this->dims[0] + c[0];
+}
+
+void BoidCellGrid::cellCoords( uint32_t c, int& cx, int& cy, int& cz ) const
+{
+   cx = static_cast< int >( c % this->dims[0] );
+   cy = static_cast< int >( ( c / this->dims[0] ) % this->dims[1] );
+   cz = static_cast< int >( c / ( static_cast< uint32_t >( this->dims[0] ) * this->dims[1] ) );
+}
+
+uint32_t BoidCellGrid::offsetCell( uint32_t c, int dx, int dy, int dz ) const
+{
+   int cx, cy, cz;
+   this->cellCoords( c, cx, cy, cz );
+   cx += dx; cy += dy; cz += dz;
+   if( cx < 0 || cy < 0 || cz < 0 || cx >= this->dims[0] || cy >= this->dims[1] || cz >= this->dims[2] )
+      return NO_CELL;
+   return ( static_cast< uint32_t >( cz ) * this->dims[1] + cy ) * this->dims[0] + cx;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+class BoidThreadPool;
+
+/**
+   Dense uniform grid over the bounding box of a set of boids, stored as a counting sort:
+   the members of cell c are items()[ cellBegin( c ) .. cellEnd( c ) ), in ascending boid index.
+   Cells are cubes; if the box would need more than maxCells cells of the requested size, the
+   cells are enlarged until it fits, so callers must check getCellSize() after build().
+*/
+class BoidCellGrid
+{
+public:
+   static constexpr uint32_t NO_CELL = 0xFFFFFFFFu;
+
+   void build( const BoidGPU* boids, uint32_t count, float requestedCellSize, BoidThreadPool& pool,
+               uint32_t maxCells = 1u << 22 );
+   /// Sizes every buffer (and the calling thread's arena) for builds of up to 'count' boids into
+   /// at most 'maxCells' cells, so those builds don't touch the heap
+   void reserve( uint32_t count, uint32_t maxCells );
+
+   float getCellSize() const { return this->cellSize; }
+   uint32_t getNumCells() const { return static_cast< uint32_t >( this->dims[0] ) * this->dims[1] * this->dims[2]; }
+   const int* getDims() const { return this->dims; }
+   const float* getOrigin() const { return this->origin; }
+
+   uint32_t cellBegin( uint32_t c ) const { return this->cellStart[c]; }
+   uint32_t cellEnd( uint32_t c ) const { return this->cellStart[c + 1]; }
+   const uint32_t* items() const { return this->sortedIdx.data(); }
+   const std::vector< uint32_t >& getOccupiedCells() const { return this->occupied; }
+   /// Cell ranges and the occupied list; the per-boid arrays come on top
+   size_t getBytes() const { return ( this->cellStart.size() + this->occupied.size() ) * sizeof( uint32_t ); }
+
+   /// Cell containing point p, clamped to the grid
+   uint32_t cellOf( float x, float y, float z ) const;
+   /// Cell c shifted by (dx,dy,dz) cells, or NO_CELL when that leaves the grid
+   uint32_t offsetCell( uint32_t c, int dx, int dy, int dz ) const;
+   void cellCoords( uint32_t c, int& cx, int& cy, int& cz ) const;
+
+private:
+   float cellSize = 1.0f;
+   float invCellSize = 1.0f;
+   float origin[3] = { 0, 0, 0 };
+   int dims[3] = { 1, 1, 1 };
+   std::vector< uint32_t > cellOfBoid;
+   std::vector< uint32_t > cellStart;
+   std::vector< uint32_t > sortedIdx;
+   std::vector< uint32_t > occupied;
+};
+
+} //namespace Aftr
@@ -0,0 +1,254 @@
+#include "BoidCheckpoint.h"
+#include "BoidProfiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+   #ifndef NOMINMAX
+      #define NOMINMAX
+   #endif
+   #ifndef WIN32_LEAN_AND_MEAN
+      #define WIN32_LEAN_AND_MEAN
+   #endif
+   #include <windows.h>
+   #include <io.h>
+#else
+   #include <fcntl.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <unistd.h>
+#endif
+
+using namespace Aftr;
+
+namespace
+{
+   bool fail( std::string* error, const std::string& message )
+   {
+      if( error )
+         *error = message;
+      return false;
+   }
+
+   uint64_t alignUp( uint64_t v, uint64_t a )
+   {
+      return ( v + a - 1 ) / a * a;
+   }
+
+   /// Flushes the stdio buffer and the OS cache of 'f' to the disk
+   bool syncFile( std::FILE* f )
+   {
+      if( std::fflush( f ) != 0 )
+         return false;
+#ifdef _WIN32
+      return FlushFileBuffers( reinterpret_cast< HANDLE >( _get_osfhandle( _fileno( f ) ) ) ) != 0;
+#else
+      return fsync( fileno( f ) ) == 0;
+#endif
+   }
+
+   /// Makes a rename in 'dir' durable (POSIX; NTFS journals the rename itself)
+   void syncDirectory( const std::filesystem::path& dir )
+   {
+#ifndef _WIN32
+      const int fd = ::open( dir.empty() ? "." : dir.c_str(), O_RDONLY );
+      if( fd >= 0 )
+      {
+         fsync( fd );
+         ::close( fd );
+      }
+#else
+      (void)dir;
+#endif
+   }
+}
+
+// ============================================================
+// Writing
+// ============================================================
+
+bool BoidCheckpoint::save( const std::string& path, BoidCheckpointData& data, std::string* error )
+{
+   BOID_PROFILE_ZONE( "BoidCheckpoint::save" );
+   BoidCheckpointHeader& h = data.header;
+   const uint64_t entities = static_cast< uint64_t >( h.numBoids ) + h.numPredators;
+   if( data.previous.size() != entities || data.latest.size() != entities )
+      return fail( error, "checkpoint states do not match the swarm size" );
+   h.headerBytes = sizeof( BoidCheckpointHeader );
+   h.scenarioBytes = static_cast< uint32_t >( data.scenario.size() );
+   h.settingsBytes = static_cast< uint32_t >( data.settings.size() );
+   h.stateBytes = entities * sizeof( BoidGPU );
+   h.stateOffset = alignUp( h.headerBytes + h.scenarioBytes + h.settingsBytes, BoidCheckpointHeader::ALIGNMENT );
+
+   const std::string tmp = path + ".tmp";
+   std::FILE* f = std::fopen( tmp.c_str(), "wb" );
+   if( !f )
+      return fail( error, "cannot write " + tmp );
+   const std::vector< char > padding( h.stateOffset - h.headerBytes - h.scenarioBytes - h.settingsBytes, 0 );
+   bool ok = std::fwrite( &h, sizeof( h ), 1, f ) == 1
+          && std::fwrite( data.scenario.data(), 1, data.scenario.size(), f ) == data.scenario.size()
+          && std::fwrite( data.settings.data(), 1, data.settings.size(), f ) == data.settings.size()
+          && std::fwrite( padding.data(), 1, padding.size(), f ) == padding.size()
+          && std::fwrite( data.previous.data(), sizeof( BoidGPU ), data.previous.size(), f ) == data.previous.size()
+          && std::fwrite( data.latest.data(), sizeof( BoidGPU ), data.latest.size(), f ) == data.latest.size()
+          && syncFile( f ); // on the disk before it can replace the previous checkpoint
+   ok = std::fclose( f ) == 0 && ok;
+
+   std::error_code ec;
+   if( ok )
+      std::filesystem::rename( tmp, path, ec );
+   if( !ok || ec )
+   {
+      std::filesystem::remove( tmp, ec );
+      return fail( error, "writing " + path + " failed" );
+   }
+   syncDirectory( std::filesystem::path( path ).parent_path() );
+   return true;
+}
+
+BoidCheckpointWriter::~BoidCheckpointWriter()
+{
+   this->wait();
+}
+
+bool BoidCheckpointWriter::write( const std::string& path, BoidCheckpointData&& data )
+{
+   if( this->isBusy() )
+      return false;
+   this->job = std::async( std::launch::async, [path, data = std::move( data )]() mutable
+   {
+      BoidProfiler::setThreadName( "Checkpoint Writer" );
+      const auto t0 = std::chrono::steady_clock::now();
+      Result r;
+      r.ok = BoidCheckpoint::save( path, data, &r.error );
+      r.bytes = data.header.stateOffset + 2 * data.header.stateBytes;
+      r.ms = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - t0 ).count();
+      return r;
+   } );
+   return true;
+}
+
+bool BoidCheckpointWriter::poll( BoidCheckpointStats& stats )
+{
+   if( !this->isBusy() || this->job.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+      return false;
+   const Result r = this->job.get();
+   if( r.ok )
+   {
+      ++stats.writes;
+      stats.lastBytes = r.bytes;
+      stats.lastWriteMs = r.ms;
+      stats.lastError.clear();
+   }
+   else
+   {
+      ++stats.failures;
+      stats.lastError = r.error;
+   }
+   return true;
+}
+
+void BoidCheckpointWriter::wait()
+{
+   if( this->isBusy() )
+      this->job.wait();
+}
+
+// ============================================================
+// Mapping
+// ============================================================
+
+BoidCheckpointFile::~BoidCheckpointFile()
+{
+   this->close();
+}
+
+bool BoidCheckpointFile::open( const std::string& path, std::string* error )
+{
+   BOID_PROFILE_ZONE( "BoidCheckpointFile::open" );
+   this->close();
+#ifdef _WIN32
+   HANDLE file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+   if( file == INVALID_HANDLE_VALUE )
+      return fail( error, "cannot open " + path );
+   LARGE_INTEGER size;
+   HANDLE mapping = GetFileSizeEx( file, &size ) && size.QuadPart > 0 ? CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr ) : nullptr;
+   const void* base = mapping ? MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) : nullptr;
+   if( !base )
+   {
+      if( mapping )
+         CloseHandle( mapping );
+      CloseHandle( file );
+      return fail( error, "cannot map " + path );
+   }
+   this->file = file;
+   this->mapping = mapping;
+   this->size = static_cast< size_t >( size.QuadPart );
+#else
+   const int fd = ::open( path.c_str(), O_RDONLY );
+   if( fd < 0 )
+      return fail( error, "cannot open " + path );
+   struct stat st;
+   void* base = fstat( fd, &st ) == 0 && st.st_size > 0 ? mmap( nullptr, static_cast< size_t >( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 ) : MAP_FAILED;
+   ::close( fd ); // the mapping keeps the file
+   if( base == MAP_FAILED )
+      return fail( error, "cannot map " + path );
+   madvise( base, static_cast< size_t >( st.st_size ), MADV_WILLNEED );
+   this->size = static_cast< size_t >( st.st_size );
+#endif
+   this->base = base;
+
+   const BoidCheckpointHeader& h = this->getHeader();
+   const BoidCheckpointHeader expected;
+   std::string problem;
+   if( this->size < sizeof( BoidCheckpointHeader ) || std::memcmp( h.magic, expected.magic, sizeof( h.magic ) ) != 0 )
+      problem = " is not a boid checkpoint";
+   else if( h.version != BoidCheckpointHeader::VERSION || h.headerBytes != sizeof( BoidCheckpointHeader ) )
+      problem = " has an unsupported checkpoint version";
+   else if( h.stateBytes != static_cast< uint64_t >( this->getNumEntities() ) * sizeof( BoidGPU ) ||
+            h.stateOffset < uint64_t( h.headerBytes ) + h.scenarioBytes + h.settingsBytes ||
+            this->size < h.stateOffset + 2 * h.stateBytes )
+      problem = " is truncated or damaged";
+   if( !problem.empty() )
+   {
+      this->close();
+      return fail( error, path + problem );
+   }
+   return true;
+}
+
+void BoidCheckpointFile::close()
+{
+   if( !this->base )
+      return;
+#ifdef _WIN32
+   UnmapViewOfFile( this->base );
+   CloseHandle( static_cast< HANDLE >( this->mapping ) );
+   CloseHandle( static_cast< HANDLE >( this->file ) );
+   this->file = this->mapping = nullptr;
+#else
+   munmap( const_cast< void* >( this->base ), this->size );
+#endif
+   this->base = nullptr;
+   this->size = 0;
+}
+
+std::string BoidCheckpointFile::getScenario() const
+{
+   const char* text = static_cast< const char* >( this->base ) + this->getHeader().headerBytes;
+   return std::string( text, this->getHeader().scenarioBytes );
+}
+
+std::string BoidCheckpointFile::getSettings() const
+{
+   const char* text = static_cast< const char* >( this->base ) + this->getHeader().headerBytes + this->getHeader().scenarioBytes;
+   return std::string( text, this->getHeader().settingsBytes );
+}
+
+const void* BoidCheckpointFile::getStates() const
+{
+   return static_cast< const char* >( this->base ) + this->getHeader().stateOffset;
+}
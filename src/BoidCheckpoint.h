@@ -0,0 +1,129 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+
+/// Fixed part of a checkpoint file, at offset 0
+struct BoidCheckpointHeader
+{
+   static constexpr uint32_t VERSION = 2;
+   static constexpr uint64_t ALIGNMENT = 4096; // states start on a page so they map straight into an upload
+
+   char magic[8] = { 'B', 'O', 'I', 'D', 'C', 'K', 'P', 'T' };
+   uint32_t version = VERSION;
+   uint32_t headerBytes = sizeof( BoidCheckpointHeader );
+   uint32_t numBoids = 0;
+   uint32_t numPredators = 0;
+   uint32_t scenarioBytes = 0;    // BoidScenario::toText() (seed included) right after the header...
+   uint32_t settingsBytes = 0;    // ...then the view's key=value settings
+   uint64_t frame = 0;            // frame counter the next step continues from
+   uint64_t stepsSinceReset = 0;
+   uint64_t stateOffset = 0;      // previous state, then the latest one (which the next step reads), each stateBytes
+   uint64_t stateBytes = 0;
+};
+static_assert( sizeof( BoidCheckpointHeader ) == 64, "checkpoint header layout" );
+
+/// Everything a checkpoint holds. Predators keep their locked target in BoidGPU::pad, so the
+/// two states carry them too
+struct BoidCheckpointData
+{
+   BoidCheckpointHeader header;    // counts, offsets and sizes are filled in by save()
+   std::string scenario;
+   std::string settings;
+   std::vector< BoidGPU > previous;
+   std::vector< BoidGPU > latest;
+};
+
+/// Outcome of the last write
+struct BoidCheckpointStats
+{
+   uint64_t writes = 0;
+   uint64_t failures = 0;
+   uint64_t lastBytes = 0;
+   double lastWriteMs = 0.0;     // on the writer thread
+   double lastCaptureMs = 0.0;   // request to both states landing on the CPU
+   double lastRestoreMs = 0.0;   // open + map + upload
+   std::string lastError;
+};
+
+/**
+   Checkpoint files of a single swarm: the drawable pair of states (both SSBOs of the step that
+   was last published), the frame counter and step count it continues from, and the scenario
+   (with its seed) and view settings as text.
+
+   save() writes to "<path>.tmp", flushes it to the disk and renames it over 'path', so a crash
+   mid-write, of the process or the machine, leaves the previous checkpoint intact. The states
+   start on a page boundary, previous then latest, so a restore maps the file
+   (BoidCheckpointFile) and hands both to the GPU in one upload.
+*/
+class BoidCheckpoint
+{
+public:
+   /// Writes 'data' (blocking); false with a message in 'error'
+   static bool save( const std::string& path, BoidCheckpointData& data, std::string* error = nullptr );
+};
+
+/// Writes checkpoints on a worker thread, one at a time
+class BoidCheckpointWriter
+{
+public:
+   ~BoidCheckpointWriter();
+
+   /// Starts writing 'data' to 'path'; false (and 'data' untouched) while a write is running
+   bool write( const std::string& path, BoidCheckpointData&& data );
+   bool isBusy() const { return this->job.valid(); }
+   /// True once a write has finished, with its result in 'stats'
+   bool poll( BoidCheckpointStats& stats );
+   void wait();
+
+private:
+   struct Result
+   {
+      bool ok = false;
+      uint64_t bytes = 0;
+      double ms = 0.0;
+      std::string error;
+   };
+   std::future< Result > job;
+};
+
+/// Read-only memory map of a checkpoint file, validated on open
+class BoidCheckpointFile
+{
+public:
+   BoidCheckpointFile() = default;
+   ~BoidCheckpointFile();
+   BoidCheckpointFile( const BoidCheckpointFile& ) = delete;
+   BoidCheckpointFile& operator=( const BoidCheckpointFile& ) = delete;
+
+   /// False with a message in 'error' if the file is missing, truncated or not a checkpoint
+   bool open( const std::string& path, std::string* error = nullptr );
+   void close();
+   bool isOpen() const { return this->base != nullptr; }
+
+   const BoidCheckpointHeader& getHeader() const { return *static_cast< const BoidCheckpointHeader* >( this->base ); }
+   std::string getScenario() const;
+   std::string getSettings() const;
+   /// Both states back to back (2 * stateBytes), previous first
+   const void* getStates() const;
+   const BoidGPU* getPrevious() const { return static_cast< const BoidGPU* >( this->getStates() ); }
+   const BoidGPU* getLatest() const { return this->getPrevious() + this->getNumEntities(); }
+   uint32_t getNumEntities() const { return this->getHeader().numBoids + this->getHeader().numPredators; }
+
+private:
+   const void* base = nullptr;
+   size_t size = 0;
+#ifdef _WIN32
+   void* file = nullptr;
+   void* mapping = nullptr;
+#endif
+};
+
+} //namespace Aftr
@@ -0,0 +1,301 @@
+#include "BoidClusterAnalysis.h"
+#include "BoidThreadPool.h"
+#include "BoidProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace Aftr;
+
+namespace
+{
+   inline float distSq( const BoidGPU& a, const BoidGPU& b )
+   {
+      float dx = a.px - b.px;
+      float dy = a.py - b.py;
+      float dz = a.pz - b.pz;
+      return dx * dx + dy * dy + dz * dz;
+   }
+}
+
+void BoidClusterAnalysis::reset()
+{
+   this->prevLabels.clear();
+}
+
+uint32_t BoidClusterAnalysis::find( uint32_t x )
+{
+   // Path halving; a failed CAS is harmless because parents only ever move towards the root
+   for( ;; )
+   {
+      uint32_t p = this->parent[x].load( std::memory_order_relaxed );
+      if( p == x )
+         return x;
+      uint32_t gp = this->parent[p].load( std::memory_order_relaxed );
+      if( gp != p )
+         this->parent[x].compare_exchange_weak( p, gp, std::memory_order_relaxed );
+      x = gp;
+   }
+}
+
+void BoidClusterAnalysis::unite( uint32_t a, uint32_t b )
+{
+   for( ;; )
+   {
+      a = this->find( a );
+      b = this->find( b );
+      if( a == b )
+         return;
+      if( a < b )
+         std::swap( a, b );
+      // Link the larger root under the smaller one; retry if 'a' stopped being a root meanwhile
+      uint32_t expected = a;
+      if( this->parent[a].compare_exchange_strong( expected, b, std::memory_order_relaxed ) )
+         return;
+   }
+}
+
+BoidClusterResult BoidClusterAnalysis::analyze( const BoidSnapshot& snap, float linkRadius, BoidThreadPool& pool )
+{
+   BOID_PROFILE_ZONE( "ClusterAnalysis::analyze" );
+   auto t0 = std::chrono::steady_clock::now();
+
+   BoidClusterResult out;
+   out.frame = snap.frame;
+   const uint32_t n = static_cast< uint32_t >( std::clamp( snap.numBoids, 0, static_cast< int >( snap.boids.size() ) ) );
+   if( n == 0 || linkRadius <= 0.0f )
+   {
+      this->prevLabels.clear();
+      return out;
+   }
+
+   if( this->parentCapacity < n )
+   {
+      this->parent = std::make_unique< std::atomic< uint32_t >[] >( n );
+      this->parentCapacity = n;
+   }
+   pool.parallelFor( n, 8192, [this]( uint32_t begin, uint32_t end )
+   {
+      for( uint32_t i = begin; i < end; ++i )
+         this->parent[i].store( i, std::memory_order_relaxed );
+   } );
+
+   // Cell diagonal == link radius => every cell is a clique
+   const BoidGPU* boids = snap.boids.data();
+   this->grid.build( boids, n, linkRadius * 0.57735f * 0.999f, pool );
+   const float s = this->grid.getCellSize();
+   const float r2 = linkRadius * linkRadius;
+   const bool cellIsClique = s * 1.7320508f < linkRadius;
+   const int reach = static_cast< int >( std::ceil( linkRadius / s ) );
+
+   // Forward half of the neighbouring cells whose boxes come closer than the link radius
+   std::vector< int > offsets;
+   for( int dz = -reach; dz <= reach; ++dz )
+      for( int dy = -reach; dy <= reach; ++dy )
+         for( int dx = -reach; dx <= reach; ++dx )
+         {
+            bool forward = dz > 0 || ( dz == 0 && dy > 0 ) || ( dz == 0 && dy == 0 && dx > 0 );
+            if( !forward )
+               continue;
+            float gx = std::max( std::abs( dx ) - 1, 0 ) * s;
+            float gy = std::max( std::abs( dy ) - 1, 0 ) * s;
+            float gz = std::max( std::abs( dz ) - 1, 0 ) * s;
+            if( gx * gx + gy * gy + gz * gz < r2 )
+            {
+               offsets.push_back( dx );
+               offsets.push_back( dy );
+               offsets.push_back( dz );
+            }
+         }
+
+   const std::vector< uint32_t >& occupied = this->grid.getOccupiedCells();
+   const uint32_t* items = this->grid.items();
+   const int* dims = this->grid.getDims();
+   pool.parallelFor( static_cast< uint32_t >( occupied.size() ), 32, [&]( uint32_t begin, uint32_t end )
+   {
+      for( uint32_t oc = begin; oc < end; ++oc )
+      {
+         const uint32_t c = occupied[oc];
+         const uint32_t cb = this->grid.cellBegin( c ), ce = this->grid.cellEnd( c );
+
+         if( cellIsClique )
+         {
+            for( uint32_t k = cb + 1; k < ce; ++k )
+               this->unite( items[cb], items[k] );
+         }
+         else
+         {
+            for( uint32_t a = cb; a < ce; ++a )
+               for( uint32_t b = a + 1; b < ce; ++b )
+                  if( distSq( boids[items[a]], boids[items[b]] ) < r2 )
+                     this->unite( items[a], items[b] );
+         }
+
+         int cx, cy, cz;
+         this->grid.cellCoords( c, cx, cy, cz );
+         for( size_t o = 0; o < offsets.size(); o += 3 )
+         {
+            const int nx = cx + offsets[o], ny = cy + offsets[o + 1], nz = cz + offsets[o + 2];
+            if( nx < 0 || ny < 0 || nz < 0 || nx >= dims[0] || ny >= dims[1] || nz >= dims[2] )
+               continue;
+            const uint32_t nc = ( static_cast< uint32_t >( nz ) * dims[1] + ny ) * dims[0] + nx;
+            const uint32_t nb = this->grid.cellBegin( nc ), ne = this->grid.cellEnd( nc );
+            if( nb == ne )
+               continue;
+
+            if( cellIsClique )
+            {
+               // One linked pair joins both cliques; nothing to do if they are joined already
+               if( this->find( items[cb] ) == this->find( items[nb] ) )
+                  continue;
+               bool linked = false;
+               for( uint32_t a = cb; a < ce && !linked; ++a )
+                  for( uint32_t b = nb; b < ne; ++b )
+                     if( distSq( boids[items[a]], boids[items[b]] ) < r2 )
+                     {
+                        this->unite( items[a], items[b] );
+                        linked = true;
+                        break;
+                     }
+            }
+            else
+            {
+               for( uint32_t a = cb; a < ce; ++a )
+                  for( uint32_t b = nb; b < ne; ++b )
+                     if( distSq( boids[items[a]], boids[items[b]] ) < r2 &&
+                         this->find( items[a] ) != this->find( items[b] ) )
+                        this->unite( items[a], items[b] );
+            }
+         }
+      }
+   } );
+
+   // Compact component numbering (components are numbered in order of their smallest member)
+   std::vector< uint32_t > component( n );
+   pool.parallelFor( n, 8192, [&]( uint32_t begin, uint32_t end )
+   {
+      for( uint32_t i = begin; i < end; ++i )
+         component[i] = this->find( i );
+   } );
+   std::vector< uint32_t > compOfRoot( n, BoidCellGrid::NO_CELL );
+   uint32_t numComponents = 0;
+   for( uint32_t i = 0; i < n; ++i )
+   {
+      uint32_t& slot = compOfRoot[component[i]];
+      if( slot == BoidCellGrid::NO_CELL )
+         slot = numComponents++;
+      component[i] = slot;
+   }
+
+   // Per-cluster summaries
+   std::vector< double > sums( static_cast< size_t >( numComponents ) * 6, 0.0 );
+   std::vector< uint32_t > sizes( numComponents, 0 );
+   for( uint32_t i = 0; i < n; ++i )
+   {
+      double* s6 = &sums[static_cast< size_t >( component[i] ) * 6];
+      s6[0] += boids[i].px; s6[1] += boids[i].py; s6[2] += boids[i].pz;
+      s6[3] += boids[i].vx; s6[4] += boids[i].vy; s6[5] += boids[i].vz;
+      ++sizes[component[i]];
+   }
+
+   std::vector< uint32_t > idOfComponent;
+   this->matchStableIds( component, numComponents, idOfComponent, out );
+
+   out.clusters.resize( numComponents );
+   for( uint32_t k = 0; k < numComponents; ++k )
+   {
+      const double* s6 = &sums[static_cast< size_t >( k ) * 6];
+      const double inv = 1.0 / sizes[k];
+      BoidClusterSummary& cs = out.clusters[k];
+      cs.id = idOfComponent[k];
+      cs.size = sizes[k];
+      cs.centroid = Vector( float( s6[0] * inv ), float( s6[1] * inv ), float( s6[2] * inv ) );
+      cs.velocity = Vector( float( s6[3] * inv ), float( s6[4] * inv ), float( s6[5] * inv ) );
+   }
+   std::sort( out.clusters.begin(), out.clusters.end(), []( const BoidClusterSummary& a, const BoidClusterSummary& b )
+   {
+      return a.size != b.size ? a.size > b.size : a.id < b.id;
+   } );
+
+   out.labels.resize( n );
+   for( uint32_t i = 0; i < n; ++i )
+      out.labels[i] = idOfComponent[component[i]];
+   this->prevLabels = out.labels;
+
+   out.elapsedMs = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - t0 ).count();
+   return out;
+}
+
+void BoidClusterAnalysis::matchStableIds( const std::vector< uint32_t >& component, uint32_t numComponents,
+                                          std::vector< uint32_t >& idOfComponent, BoidClusterResult& out )
+{
+   const uint32_t n = static_cast< uint32_t >( component.size() );
+   idOfComponent.assign( numComponents, 0 );
+
+   if( this->prevLabels.size() != n )
+   {
+      for( uint32_t k = 0; k < numComponents; ++k )
+         idOfComponent[k] = this->nextId++;
+      return;
+   }
+
+   // Overlap of every (current component, previous id) pair
+   std::unordered_map< uint64_t, uint32_t > overlapCount;
+   overlapCount.reserve( numComponents * 2 );
+   for( uint32_t i = 0; i < n; ++i )
+      ++overlapCount[( static_cast< uint64_t >( component[i] ) << 32 ) | this->prevLabels[i]];
+
+   struct Overlap { uint32_t count, comp, prevId; };
+   std::vector< Overlap > overlaps;
+   overlaps.reserve( overlapCount.size() );
+   for( const auto& [key, count] : overlapCount )
+      overlaps.push_back( { count, static_cast< uint32_t >( key >> 32 ), static_cast< uint32_t >( key ) } );
+
+   // Split/merge bookkeeping ignores stragglers: only overlaps of a few boids or more count
+   const uint32_t minOverlap = 3;
+   std::vector< uint32_t > prevIds;
+   std::vector< uint32_t > compFanIn( numComponents, 0 );
+   for( const Overlap& o : overlaps )
+      if( o.count >= minOverlap )
+      {
+         ++compFanIn[o.comp];
+         prevIds.push_back( o.prevId );
+      }
+   std::sort( prevIds.begin(), prevIds.end() );
+   for( size_t i = 0; i < prevIds.size(); )
+   {
+      size_t j = i;
+      while( j < prevIds.size() && prevIds[j] == prevIds[i] )
+         ++j;
+      if( j - i > 1 )
+         ++out.numSplits;
+      i = j;
+   }
+   for( uint32_t k = 0; k < numComponents; ++k )
+      if( compFanIn[k] > 1 )
+         ++out.numMerges;
+
+   // Greedy pairing, largest overlap first
+   std::sort( overlaps.begin(), overlaps.end(), []( const Overlap& a, const Overlap& b )
+   {
+      if( a.count != b.count ) return a.count > b.count;
+      if( a.comp != b.comp ) return a.comp < b.comp;
+      return a.prevId < b.prevId;
+   } );
+   std::unordered_set< uint32_t > usedPrev;
+   usedPrev.reserve( overlaps.size() );
+   std::vector< bool > assigned( numComponents, false );
+   for( const Overlap& o : overlaps )
+   {
+      if( assigned[o.comp] || !usedPrev.insert( o.prevId ).second )
+         continue;
+      idOfComponent[o.comp] = o.prevId;
+      assigned[o.comp] = true;
+   }
+   for( uint32_t k = 0; k < numComponents; ++k )
+      if( !assigned[k] )
+         idOfComponent[k] = this->nextId++;
+}
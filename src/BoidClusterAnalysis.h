@@ -0,0 +1,68 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include "BoidCellGrid.h"
+#include "Vector.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Aftr
+{
+class BoidThreadPool;
+
+struct BoidClusterSummary
+{
+   uint32_t id = 0;   ///< stable across analyses (see BoidClusterAnalysis)
+   uint32_t size = 0;
+   Vector centroid;
+   Vector velocity;   ///< mean velocity of the members
+};
+
+struct BoidClusterResult
+{
+   uint64_t frame = 0;
+   std::vector< uint32_t > labels;             ///< stable cluster id of every boid
+   std::vector< BoidClusterSummary > clusters; ///< largest first
+   uint32_t numSplits = 0; ///< previous clusters that broke into several
+   uint32_t numMerges = 0; ///< current clusters formed from several previous ones
+   double elapsedMs = 0.0;
+};
+
+/**
+   Sub-flock detection. Two boids are linked when they are closer than the link radius
+   (the flock's neighborRadius); clusters are the connected components of that graph.
+
+   Components are found with a lock-free union-find (CAS on the parent array, roots always
+   linked under the smaller index) driven by a cell grid whose diagonal equals the link radius,
+   so all boids in one cell are joined without distance tests and a pair of cells is skipped
+   as soon as it is known to be connected.
+
+   Cluster ids are carried from one analysis to the next by overlap: current and previous
+   clusters are paired greedily by shared membership and unmatched clusters get fresh ids.
+   Predators are not part of the graph.
+*/
+class BoidClusterAnalysis
+{
+public:
+   BoidClusterResult analyze( const BoidSnapshot& snap, float linkRadius, BoidThreadPool& pool );
+
+   /// Forget the previous labelling, e.g. after the swarm was reset
+   void reset();
+
+private:
+   uint32_t find( uint32_t x );
+   void unite( uint32_t a, uint32_t b );
+   void matchStableIds( const std::vector< uint32_t >& component, uint32_t numComponents,
+                        std::vector< uint32_t >& idOfComponent, BoidClusterResult& out );
+
+   BoidCellGrid grid;
+   std::unique_ptr< std::atomic< uint32_t >[] > parent;
+   uint32_t parentCapacity = 0;
+
+   std::vector< uint32_t > prevLabels;
+   uint32_t nextId = 1;
+};
+
+} //namespace Aftr
@@ -0,0 +1,308 @@
+#include "BoidCpuKernel.h"
+#include "BoidArena.h"
+#include "BoidThreadPool.h"
+#include "BoidProfiler.h"
+#include "BoidNeighborList.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Aftr;
+
+namespace
+{
+   struct V3
+   {
+      float x, y, z;
+      V3 operator+( const V3& o ) const { return { x + o.x, y + o.y, z + o.z }; }
+      V3 operator-( const V3& o ) const { return { x - o.x, y - o.y, z - o.z }; }
+      V3 operator-() const { return { -x, -y, -z }; }
+      V3 operator*( float s ) const { return { x * s, y * s, z * s }; }
+      V3 operator/( float s ) const { return { x / s, y / s, z / s }; }
+      V3& operator+=( const V3& o ) { x += o.x; y += o.y; z += o.z; return *this; }
+   };
+
+   inline float dot( const V3& a, const V3& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+   inline float length( const V3& v ) { return std::sqrt( dot( v, v ) ); }
+   inline V3 normalize( const V3& v ) { return v / length( v ); }
+   inline V3 pos( const BoidGPU& b ) { return { b.px, b.py, b.pz }; }
+   inline V3 vel( const BoidGPU& b ) { return { b.vx, b.vy, b.vz }; }
+
+   // Same integer hash as the shader's hash3()
+   V3 hash3( uint32_t seed )
+   {
+      uint32_t s = seed;
+      s ^= s >> 16; s *= 0x45d9f3bu;
+      s ^= s >> 16; s *= 0x45d9f3bu;
+      s ^= s >> 16;
+      float x = static_cast< float >( s & 0xFFFFu ) / 32767.5f - 1.0f;
+      s *= 0x9E3779B9u;
+      s ^= s >> 16;
+      float y = static_cast< float >( s & 0xFFFFu ) / 32767.5f - 1.0f;
+      s *= 0x9E3779B9u;
+      s ^= s >> 16;
+      float z = static_cast< float >( s & 0xFFFFu ) / 32767.5f - 1.0f;
+      return { x, y, z };
+   }
+
+   // UseList picks the loop at compile time so the all-pairs path keeps its plain counter.
+   // 'id' numbers the boid for the noise and respawn hashes: its index in the whole swarm, which
+   // differs from 'idx' when 'in' only holds part of it (BoidDomainRank)
+   template< bool UseList >
+   BoidGPU stepBoid( const BoidGPU* in, uint32_t idx, uint32_t id, const BoidSwarmParams& p, const BoidStepGlobals& g,
+                     const BoidNeighborList* neighbors )
+   {
+      const uint32_t numBoids = static_cast< uint32_t >( p.numBoids );
+      const uint32_t frame = static_cast< uint32_t >( g.frame );
+      V3 myPos = pos( in[idx] );
+      V3 myVel = vel( in[idx] );
+      V3 acc = { 0, 0, 0 };
+
+      V3 separation = { 0, 0, 0 };
+      V3 alignSum = { 0, 0, 0 };
+      V3 cohesionSum = { 0, 0, 0 };
+      float cohesionWSum = 0.0f;
+      int sepCount = 0;
+      int neiCount = 0;
+
+      float mySpeed = length( myVel );
+      V3 fwd = ( mySpeed > 0.001f ) ? ( myVel / mySpeed ) : V3{ 1, 0, 0 };
+
+      // Listed neighbors or everybody, in ascending index order either way
+      const uint32_t* list = UseList ? neighbors->begin( idx ) : nullptr;
+      const uint32_t listLen = UseList ? neighbors->count( idx ) : numBoids;
+      for( uint32_t k = 0; k < listLen; ++k )
+      {
+         const uint32_t j = UseList ? list[k] : k;
+         if( j == idx )
+            continue;
+         V3 other = pos( in[j] );
+         V3 diff = myPos - other;
+         float dist = length( diff );
+
+         if( dist < p.sepRadius && dist > 0.001f )
+         {
+            float strength = ( p.sepRadius - dist ) / p.sepRadius;
+            separation += normalize( diff ) * strength;
+            sepCount++;
+         }
+
+         if( dist < p.neiRadius )
+         {
+            alignSum += vel( in[j] );
+            V3 toOther = -diff / dist;
+            float forwardness = dot( fwd, toOther );
+            float w = 0.15f + 0.85f * std::clamp( forwardness * 0.5f + 0.5f, 0.0f, 1.0f );
+            cohesionSum += other * w;
+            cohesionWSum += w;
+            neiCount++;
+         }
+      }
+
+      if( sepCount > 0 )
+         acc += separation * p.sepWeight;
+
+      if( neiCount > 0 )
+      {
+         V3 avgVel = alignSum / static_cast< float >( neiCount );
+         acc += ( avgVel - myVel ) * p.aliWeight;
+         V3 center = cohesionSum / cohesionWSum;
+         acc += ( center - myPos ) * p.cohWeight;
+      }
+
+      float distOrigin = length( myPos );
+      float softEdge = p.bndRadius * 0.7f;
+      if( distOrigin > softEdge )
+      {
+         float t = ( distOrigin - softEdge ) / ( p.bndRadius - softEdge );
+         t = std::clamp( t, 0.0f, 1.0f );
+         acc += ( -myPos / distOrigin ) * t * t * p.bndWeight;
+      }
+
+      float nearestPredDist = 1e20f;
+      for( int k = 0; k < p.numPredators; ++k )
+      {
+         V3 predDiff = myPos - pos( in[numBoids + static_cast< uint32_t >( k )] );
+         float predDist = length( predDiff );
+         if( predDist < nearestPredDist )
+            nearestPredDist = predDist;
+         if( predDist < p.feaRadius && predDist > 0.001f )
+         {
+            float strength = ( p.feaRadius - predDist ) / predDist;
+            acc += normalize( predDiff ) * strength * p.fleWeight;
+         }
+      }
+
+      for( int o = 0; o < g.numObstacles; ++o )
+      {
+         const float* obs = g.obstacles[o];
+         V3 obsDiff = myPos - V3{ obs[0], obs[1], obs[2] };
+         float obsDist = length( obsDiff );
+         if( obsDist < obs[3] && obsDist > 0.001f )
+         {
+            float strength = ( obs[3] - obsDist ) / obsDist;
+            acc += normalize( obsDiff ) * strength * p.obsWeight;
+         }
+      }
+
+      acc += hash3( id * 1777u + frame * 3571u ) * p.noiseStrength;
+
+      myVel += acc * g.dt;
+      float speed = length( myVel );
+      if( speed > p.maxSpeed )
+         myVel = normalize( myVel ) * p.maxSpeed;
+      else if( speed < p.maxSpeed * 0.1f && speed > 0.0001f )
+         myVel = normalize( myVel ) * p.maxSpeed * 0.1f;
+
+      if( nearestPredDist < p.eatRadius )
+      {
+         V3 rng = hash3( id * 7919u + frame * 6271u + 12345u );
+         myPos = normalize( rng ) * p.bndRadius * 0.6f;
+         myVel = hash3( id * 3571u + frame * 1777u + 54321u ) * p.maxSpeed * 0.5f;
+      }
+
+      myPos += myVel;
+      return { myPos.x, myPos.y, myPos.z, in[idx].type, myVel.x, myVel.y, myVel.z, 0.0f };
+   }
+
+   BoidGPU stepPredator( const BoidGPU* in, uint32_t idx, const BoidSwarmParams& p, const BoidStepGlobals& g )
+   {
+      const uint32_t numBoids = static_cast< uint32_t >( p.numBoids );
+      int lockedTarget = static_cast< int >( in[idx].pad );
+
+      // The shader reads out of bounds on an empty swarm; here the predator just coasts
+      if( numBoids == 0 )
+         return BoidCpuKernel::movePredator( in[idx], nullptr, lockedTarget, p, g );
+
+      V3 flockCenter = { 0, 0, 0 };
+      for( uint32_t j = 0; j < numBoids; ++j )
+         flockCenter += pos( in[j] );
+      flockCenter = flockCenter / static_cast< float >( p.numBoids );
+
+      bool retarget = ( g.frame % 300 == 0 )
+                   || lockedTarget < 0
+                   || lockedTarget >= p.numBoids
+                   || length( pos( in[lockedTarget] ) - flockCenter ) > p.bndRadius * 0.5f;
+
+      if( retarget )
+      {
+         float nearestDist = 1e20f;
+         for( uint32_t j = 0; j < numBoids; ++j )
+         {
+            float d = length( pos( in[j] ) - flockCenter );
+            if( d < nearestDist )
+            {
+               nearestDist = d;
+               lockedTarget = static_cast< int >( j );
+            }
+         }
+      }
+
+      return BoidCpuKernel::movePredator( in[idx], &in[lockedTarget].px, lockedTarget, p, g );
+   }
+}
+
+BoidGPU BoidCpuKernel::movePredator( const BoidGPU& predator, const float* targetPos, int target,
+                                     const BoidSwarmParams& p, const BoidStepGlobals& g )
+{
+   V3 myPos = pos( predator );
+   V3 myVel = vel( predator );
+   V3 acc = { 0, 0, 0 };
+
+   if( targetPos )
+   {
+      V3 toTarget = V3{ targetPos[0], targetPos[1], targetPos[2] } - myPos;
+      float dist = length( toTarget );
+      if( dist > 0.01f )
+         acc = normalize( toTarget ) * 0.5f;
+   }
+
+   float distOrigin = length( myPos );
+   if( distOrigin > p.bndRadius )
+   {
+      float overshoot = distOrigin - p.bndRadius;
+      acc += ( -myPos / distOrigin ) * overshoot * p.bndWeight;
+   }
+
+   myVel += acc * g.dt;
+   float speed = length( myVel );
+   if( speed > p.predSpeed )
+      myVel = normalize( myVel ) * p.predSpeed;
+
+   myPos += myVel;
+   return { myPos.x, myPos.y, myPos.z, predator.type, myVel.x, myVel.y, myVel.z, static_cast< float >( target ) };
+}
+
+void BoidCpuKernel::stepRange( const BoidGPU* in, BoidGPU* out, const BoidSwarmParams& params,
+                               const BoidStepGlobals& globals, uint32_t begin, uint32_t end,
+                               const BoidNeighborList* neighbors )
+{
+   const uint32_t numBoids = static_cast< uint32_t >( params.numBoids );
+   end = std::min( end, numBoids + static_cast< uint32_t >( params.numPredators ) );
+   for( uint32_t i = begin; i < end; ++i )
+   {
+      if( i >= numBoids )
+         out[i] = stepPredator( in, i, params, globals );
+      else if( neighbors )
+         out[i] = stepBoid< true >( in, i, i, params, globals, neighbors );
+      else
+         out[i] = stepBoid< false >( in, i, i, params, globals, nullptr );
+   }
+}
+
+void BoidCpuKernel::step( const BoidGPU* in, BoidGPU* out, const BoidSwarmParams& params,
+                          const BoidStepGlobals& globals, BoidThreadPool& pool, uint32_t grain,
+                          const BoidNeighborList* neighbors )
+{
+   BOID_PROFILE_ZONE( "CpuKernel::step" );
+   const uint32_t total = static_cast< uint32_t >( params.numBoids + params.numPredators );
+   pool.parallelFor( total, grain, [&]( uint32_t begin, uint32_t end )
+   {
+      BOID_PROFILE_ZONE( "CpuKernel::chunk" );
+      stepRange( in, out, params, globals, begin, end, neighbors );
+   } );
+}
+
+void BoidCpuKernel::stepSubset( const BoidGPU* in, const uint32_t* ids, const uint32_t* which, uint32_t count,
+                                BoidGPU* out, const BoidSwarmParams& params, const BoidStepGlobals& globals,
+                                BoidThreadPool& pool, const BoidNeighborList* neighbors, uint32_t grain )
+{
+   BOID_PROFILE_ZONE( "CpuKernel::stepSubset" );
+   pool.parallelFor( count, grain, [&]( uint32_t begin, uint32_t end )
+   {
+      BOID_PROFILE_ZONE( "CpuKernel::chunk" );
+      for( uint32_t k = begin; k < end; ++k )
+      {
+         const uint32_t i = which[k];
+         out[k] = neighbors ? stepBoid< true >( in, i, ids[i], params, globals, neighbors )
+                            : stepBoid< false >( in, i, ids[i], params, globals, nullptr );
+      }
+   } );
+}
+
+void BoidCpuKernel::stepBatch( const BoidGPU* in, BoidGPU* out, const BoidSwarmParams* swarms, int numSwarms,
+                               const BoidStepGlobals& globals, BoidThreadPool& pool, uint32_t grain )
+{
+   BOID_PROFILE_ZONE( "CpuKernel::stepBatch" );
+   // Flatten (swarm, chunk) pairs into one index space so small swarms don't serialize the batch
+   BoidArenaScope scratch;
+   uint32_t* firstChunk = scratch.allocate< uint32_t >( numSwarms + 1 );
+   firstChunk[0] = 0;
+   for( int s = 0; s < numSwarms; ++s )
+   {
+      const uint32_t total = static_cast< uint32_t >( swarms[s].numBoids + swarms[s].numPredators );
+      firstChunk[s + 1] = firstChunk[s] + ( total + grain - 1 ) / grain;
+   }
+
+   pool.parallelFor( firstChunk[numSwarms], 1, [&]( uint32_t begin, uint32_t end )
+   {
+      BOID_PROFILE_ZONE( "CpuKernel::chunk" );
+      for( uint32_t c = begin; c < end; ++c )
+      {
+         const int s = static_cast< int >( std::upper_bound( firstChunk, firstChunk + numSwarms + 1, c ) - firstChunk ) - 1;
+         const uint32_t local = ( c - firstChunk[s] ) * grain;
+         const BoidSwarmParams& p = swarms[s];
+         stepRange( in + p.base, out + p.base, p, globals, local, local + grain );
+      }
+   } );
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include <cstdint>
+
+namespace Aftr
+{
+class BoidThreadPool;
+class BoidNeighborList;
+
+/**
+   CPU port of the flocking compute shader (BOID_KF_ALL variant), statement for statement,
+   so a swarm stepped here follows the GPU one up to float rounding. 'in' and 'out' point at
+   the swarm's first entity; the params' 'base' is only used by the batched entry point.
+   With a BoidNeighborList (updated for 'in') boids only visit their listed neighbors, which
+   gives the same result as the all-pairs loop.
+*/
+class BoidCpuKernel
+{
+public:
+   /// Steps entities [begin, end) of one swarm
+   static void stepRange( const BoidGPU* in, BoidGPU* out, const BoidSwarmParams& params,
+                          const BoidStepGlobals& globals, uint32_t begin, uint32_t end,
+                          const BoidNeighborList* neighbors = nullptr );
+
+   /// Steps a whole swarm on the pool
+   static void step( const BoidGPU* in, BoidGPU* out, const BoidSwarmParams& params,
+                     const BoidStepGlobals& globals, BoidThreadPool& pool, uint32_t grain = 256,
+                     const BoidNeighborList* neighbors = nullptr );
+
+   /// Steps 'numSwarms' independent swarms that share one concatenated buffer (swarm i starts at
+   /// swarms[i].base) as one job batch; chunks of different swarms are balanced across the pool
+   static void stepBatch( const BoidGPU* in, BoidGPU* out, const BoidSwarmParams* swarms, int numSwarms,
+                          const BoidStepGlobals& globals, BoidThreadPool& pool, uint32_t grain = 256 );
+
+   /// Steps the boids in[which[k]] into out[k] for k < count, where 'in' holds only part of a
+   /// swarm (a rank's owned and halo boids, then the predators at params.numBoids) and ids[i] is
+   /// the index of in[i] in the whole swarm. The noise and respawns hash that index, so a boid
+   /// moves exactly as it would in the whole swarm as long as all its neighbors are in 'in'.
+   static void stepSubset( const BoidGPU* in, const uint32_t* ids, const uint32_t* which, uint32_t count,
+                           BoidGPU* out, const BoidSwarmParams& params, const BoidStepGlobals& globals,
+                           BoidThreadPool& pool, const BoidNeighborList* neighbors = nullptr, uint32_t grain = 256 );
+
+   /// A predator's move once its target is chosen: 'targetPos' is the xyz of boid 'target', or
+   /// nullptr when there are no boids and the predator coasts
+   static BoidGPU movePredator( const BoidGPU& predator, const float* targetPos, int target,
+                                const BoidSwarmParams& params, const BoidStepGlobals& globals );
+};
+
+} //namespace Aftr
@@ -0,0 +1,618 @@
+#include "BoidDomain.h"
+#include "BoidCpuKernel.h"
+#include "BoidDriftHarness.h"
+#include "BoidProfiler.h"
+#include "BoidRng.h"
+#include "BoidScenario.h"
+#include "BoidThreadPool.h"
+#include "BoidTransport.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#ifndef _WIN32
+   #include <sys/wait.h>
+   #include <unistd.h>
+#endif
+
+using namespace Aftr;
+
+namespace
+{
+   using Clock = std::chrono::steady_clock;
+   double msSince( Clock::time_point t0 )
+   {
+      return std::chrono::duration< double, std::milli >( Clock::now() - t0 ).count();
+   }
+
+   /// A rank's boid nearest to the flock center, allgathered when a predator retargets
+   struct Candidate
+   {
+      float dist = 1e20f;
+      uint32_t id = UINT32_MAX;
+      float pos[3] = { 0, 0, 0 };
+   };
+
+   bool fail( std::string* error, const std::string& message )
+   {
+      if( error )
+         *error = message;
+      return false;
+   }
+
+   template< typename T >
+   void unpack( const std::vector< uint8_t >& message, std::vector< T >& out )
+   {
+      const size_t n = message.size() / sizeof( T );
+      const size_t first = out.size();
+      out.resize( first + n );
+      if( n > 0 )
+         std::memcpy( out.data() + first, message.data(), n * sizeof( T ) );
+   }
+}
+
+bool BoidDomainOptions::parse( const std::vector< std::string >& args, BoidDomainOptions& out, std::string* error )
+{
+   for( const std::string& arg : args )
+   {
+      const size_t eq = arg.find( '=' );
+      const std::string flag = arg.substr( 0, eq );
+      const std::string value = eq == std::string::npos ? std::string() : arg.substr( eq + 1 );
+      auto positive = [&value]( int& field, int limit )
+      {
+         char* end = nullptr;
+         const long v = std::strtol( value.c_str(), &end, 10 );
+         if( value.empty() || *end != '\0' || v <= 0 || v > limit )
+            return false;
+         field = static_cast< int >( v );
+         return true;
+      };
+
+      if( flag == "--domain-ranks" )
+      {
+         if( !positive( out.ranks, 64 ) )
+            return fail( error, "--domain-ranks expects 1..64 processes, got '" + value + "'" );
+      }
+      else if( flag == "--domain-steps" )
+      {
+         if( !positive( out.steps, 1000000000 ) )
+            return fail( error, "--domain-steps expects a positive count, got '" + value + "'" );
+      }
+      else if( flag == "--domain-scenario" )
+      {
+         if( value.empty() )
+            return fail( error, "--domain-scenario expects a .boidscene file" );
+         out.scenarioPath = value;
+      }
+      else if( flag == "--domain-sockets" )
+      {
+         if( value.empty() )
+            return fail( error, "--domain-sockets expects a directory" );
+         out.socketDir = value;
+      }
+   }
+   return true;
+}
+
+// ============================================================
+// Rank
+// ============================================================
+
+BoidDomainRank::BoidDomainRank( BoidTransport& transport, const BoidSwarmParams& params, const BoidDomainSettings& settings )
+   : transport( transport ), params( params ), settings( settings )
+{
+   // A little over the interaction radius: a neighbor's float distance may round just below its x offset
+   this->haloWidth = std::max( params.sepRadius, params.neiRadius ) * 1.001f + 1e-4f;
+   this->neighbors.setSkin( 0.0f ); // rebuilt every step anyway, the membership changes
+
+   const int size = transport.getSize();
+   const float width = std::max( 2.0f * params.bndRadius / size, this->haloWidth );
+   this->bounds.resize( size + 1 );
+   this->bounds.front() = -FLT_MAX;
+   this->bounds.back() = FLT_MAX;
+   for( int k = 1; k < size; ++k )
+      this->bounds[k] = ( k - 0.5f * size ) * width;
+}
+
+int BoidDomainRank::owner( float x ) const
+{
+   return static_cast< int >( std::upper_bound( this->bounds.begin() + 1, this->bounds.end() - 1, x ) - ( this->bounds.begin() + 1 ) );
+}
+
+void BoidDomainRank::append( std::vector< uint8_t >& message, uint32_t id, const BoidGPU& boid )
+{
+   const Wire w{ id, boid };
+   const uint8_t* bytes = reinterpret_cast< const uint8_t* >( &w );
+   message.insert( message.end(), bytes, bytes + sizeof( w ) );
+}
+
+void BoidDomainRank::scatter( const BoidGPU* full )
+{
+   const int self = this->transport.getRank();
+   this->ids.clear();
+   this->boids.clear();
+   for( int i = 0; i < this->params.numBoids; ++i )
+      if( this->owner( full[i].px ) == self )
+      {
+         this->ids.push_back( static_cast< uint32_t >( i ) );
+         this->boids.push_back( full[i] );
+      }
+   this->predators.assign( full + this->params.numBoids, full + this->params.numBoids + this->params.numPredators );
+   this->steps = 0;
+   this->stats.owned = static_cast< int >( this->boids.size() );
+}
+
+// ============================================================
+// Step
+// ============================================================
+
+bool BoidDomainRank::step( const BoidStepGlobals& globals, BoidThreadPool& pool )
+{
+   BOID_PROFILE_ZONE( "BoidDomainRank::step" );
+   const Clock::time_point t0 = Clock::now();
+
+   // Predators first: they read the state before the step, like the kernel's. The boids flee
+   // from and are eaten by the predators as they were before it, so keep that copy for 'local'
+   this->prevPredators.assign( this->predators.begin(), this->predators.end() );
+   if( !this->stepPredators( globals ) )
+      return false;
+   const Clock::time_point t1 = Clock::now();
+   if( !this->exchangeHalo() )
+      return false;
+   const Clock::time_point t2 = Clock::now();
+
+   {
+      BOID_PROFILE_ZONE( "BoidDomainRank::kernel" );
+      BoidSwarmParams local = this->params;
+      local.numBoids = static_cast< int >( this->localIds.size() );
+      local.base = 0;
+      this->neighbors.invalidate();
+      this->neighbors.update( this->local.data(), local, pool );
+      this->stepped.resize( this->ownedLocal.size() );
+      BoidCpuKernel::stepSubset( this->local.data(), this->localIds.data(), this->ownedLocal.data(),
+                                 static_cast< uint32_t >( this->ownedLocal.size() ), this->stepped.data(),
+                                 local, globals, pool, &this->neighbors );
+      this->boids.swap( this->stepped );
+   }
+   const Clock::time_point t3 = Clock::now();
+
+   ++this->steps;
+   if( this->settings.rebalanceInterval > 0 && this->steps % this->settings.rebalanceInterval == 0 && !this->rebalance() )
+      return false;
+   if( !this->migrate() )
+      return false;
+
+   this->stats.owned = static_cast< int >( this->boids.size() );
+   this->stats.lo = this->bounds[this->transport.getRank()];
+   this->stats.hi = this->bounds[this->transport.getRank() + 1];
+   this->stats.bytesSent = this->transport.getBytesSent();
+   this->stats.messagesSent = this->transport.getMessagesSent();
+   this->stats.predatorMs = std::chrono::duration< double, std::milli >( t1 - t0 ).count();
+   this->stats.haloMs = std::chrono::duration< double, std::milli >( t2 - t1 ).count();
+   this->stats.kernelMs = std::chrono::duration< double, std::milli >( t3 - t2 ).count();
+   this->stats.migrateMs = msSince( t3 );
+   this->stats.stepMs = msSince( t0 );
+   return true;
+}
+
+bool BoidDomainRank::stepPredators( const BoidStepGlobals& globals )
+{
+   const int numPredators = this->params.numPredators;
+   if( numPredators == 0 )
+      return true;
+   if( this->params.numBoids == 0 )
+   {
+      for( BoidGPU& p : this->predators )
+         p = BoidCpuKernel::movePredator( p, nullptr, static_cast< int >( p.pad ), this->params, globals );
+      return true;
+   }
+
+   // One reduction: position sum and count, then each locked target's position from its owner
+   std::vector< double > sums( 4 + 4 * numPredators, 0.0 );
+   for( const BoidGPU& b : this->boids )
+   {
+      sums[0] += b.px;
+      sums[1] += b.py;
+      sums[2] += b.pz;
+   }
+   sums[3] = static_cast< double >( this->boids.size() );
+   for( int k = 0; k < numPredators; ++k )
+   {
+      const int target = static_cast< int >( this->predators[k].pad );
+      if( target < 0 || target >= this->params.numBoids )
+         continue;
+      auto it = std::lower_bound( this->ids.begin(), this->ids.end(), static_cast< uint32_t >( target ) );
+      if( it == this->ids.end() || *it != static_cast< uint32_t >( target ) )
+         continue;
+      const BoidGPU& b = this->boids[it - this->ids.begin()];
+      double* t = &sums[4 + 4 * k];
+      t[0] = b.px; t[1] = b.py; t[2] = b.pz; t[3] = 1.0;
+   }
+   if( !this->transport.allReduceSum( sums.data(), static_cast< int >( sums.size() ) ) )
+      return false;
+
+   const float center[3] = { static_cast< float >( sums[0] / sums[3] ), static_cast< float >( sums[1] / sums[3] ),
+                             static_cast< float >( sums[2] / sums[3] ) };
+   auto distToCenter = [&center]( float x, float y, float z )
+   {
+      const float dx = x - center[0], dy = y - center[1], dz = z - center[2];
+      return std::sqrt( dx * dx + dy * dy + dz * dz );
+   };
+
+   std::vector< bool > retarget( numPredators );
+   bool anyRetarget = false;
+   for( int k = 0; k < numPredators; ++k )
+   {
+      const int target = static_cast< int >( this->predators[k].pad );
+      const double* t = &sums[4 + 4 * k];
+      retarget[k] = ( globals.frame % 300 == 0 ) || target < 0 || target >= this->params.numBoids || t[3] < 0.5 ||
+                    distToCenter( static_cast< float >( t[0] ), static_cast< float >( t[1] ), static_cast< float >( t[2] ) ) > this->params.bndRadius * 0.5f;
+      anyRetarget = anyRetarget || retarget[k];
+   }
+
+   // The center is shared, so one nearest boid serves every retargeting predator: each rank's
+   // nearest, then the nearest of those (lower id on ties, as the kernel's first-wins scan)
+   Candidate nearest;
+   if( anyRetarget )
+   {
+      for( size_t i = 0; i < this->boids.size(); ++i )
+      {
+         const BoidGPU& b = this->boids[i];
+         const float d = distToCenter( b.px, b.py, b.pz );
+         if( d < nearest.dist )
+         {
+            nearest.dist = d;
+            nearest.id = this->ids[i];
+            nearest.pos[0] = b.px; nearest.pos[1] = b.py; nearest.pos[2] = b.pz;
+         }
+      }
+      std::vector< uint8_t > mine( sizeof( Candidate ) );
+      std::memcpy( mine.data(), &nearest, sizeof( Candidate ) );
+      std::vector< std::vector< uint8_t > > all;
+      if( !this->transport.allGather( mine, all ) )
+         return false;
+      for( const std::vector< uint8_t >& m : all )
+      {
+         Candidate c;
+         if( m.size() != sizeof( Candidate ) )
+            return false;
+         std::memcpy( &c, m.data(), sizeof( Candidate ) );
+         if( c.dist < nearest.dist || ( c.dist == nearest.dist && c.id < nearest.id ) )
+            nearest = c;
+      }
+   }
+
+   for( int k = 0; k < numPredators; ++k )
+   {
+      BoidGPU& p = this->predators[k];
+      if( retarget[k] && nearest.id != UINT32_MAX )
+      {
+         p = BoidCpuKernel::movePredator( p, nearest.pos, static_cast< int >( nearest.id ), this->params, globals );
+         continue;
+      }
+      const double* t = &sums[4 + 4 * k];
+      const float targetPos[3] = { static_cast< float >( t[0] ), static_cast< float >( t[1] ), static_cast< float >( t[2] ) };
+      p = BoidCpuKernel::movePredator( p, targetPos, static_cast< int >( p.pad ), this->params, globals );
+   }
+   return true;
+}
+
+bool BoidDomainRank::exchangeHalo()
+{
+   BOID_PROFILE_ZONE( "BoidDomainRank::exchangeHalo" );
+   const int self = this->transport.getRank();
+   const int size = this->transport.getSize();
+   const float lo = this->bounds[self];
+   const float hi = this->bounds[self + 1];
+
+   // Border boids go to the adjacent ranks; the slabs are at least a halo wide, so nobody else needs them
+   std::vector< uint8_t > down, up;
+   for( size_t i = 0; i < this->boids.size(); ++i )
+   {
+      const float x = this->boids[i].px;
+      if( self > 0 && x < lo + this->haloWidth )
+         append( down, this->ids[i], this->boids[i] );
+      if( self + 1 < size && x >= hi - this->haloWidth )
+         append( up, this->ids[i], this->boids[i] );
+   }
+   if( self > 0 )
+      this->transport.send( self - 1, std::move( down ) );
+   if( self + 1 < size )
+      this->transport.send( self + 1, std::move( up ) );
+
+   this->haloIn.clear();
+   std::vector< uint8_t > message;
+   for( int r : { self - 1, self + 1 } )
+   {
+      if( r < 0 || r >= size )
+         continue;
+      if( !this->transport.receive( r, message ) )
+         return false;
+      unpack( message, this->haloIn );
+   }
+   std::sort( this->haloIn.begin(), this->haloIn.end(), []( const Wire& a, const Wire& b ) { return a.id < b.id; } );
+
+   // Owned and halo merged by id, so neighbor lists walk them in the whole swarm's order
+   const size_t numLocal = this->boids.size() + this->haloIn.size();
+   this->localIds.resize( numLocal );
+   this->local.resize( numLocal + this->predators.size() );
+   this->ownedLocal.resize( this->boids.size() );
+   size_t a = 0, b = 0;
+   for( size_t i = 0; i < numLocal; ++i )
+   {
+      if( b == this->haloIn.size() || ( a < this->boids.size() && this->ids[a] < this->haloIn[b].id ) )
+      {
+         this->ownedLocal[a] = static_cast< uint32_t >( i );
+         this->localIds[i] = this->ids[a];
+         this->local[i] = this->boids[a++];
+      }
+      else
+      {
+         this->localIds[i] = this->haloIn[b].id;
+         this->local[i] = this->haloIn[b++].boid;
+      }
+   }
+   std::copy( this->prevPredators.begin(), this->prevPredators.end(), this->local.begin() + numLocal );
+   this->stats.halo = static_cast< int >( this->haloIn.size() );
+   return true;
+}
+
+bool BoidDomainRank::migrate()
+{
+   BOID_PROFILE_ZONE( "BoidDomainRank::migrate" );
+   const int self = this->transport.getRank();
+   const int size = this->transport.getSize();
+
+   std::vector< std::vector< uint8_t > > outgoing( size );
+   size_t kept = 0;
+   int migratedOut = 0;
+   for( size_t i = 0; i < this->boids.size(); ++i )
+   {
+      const int to = this->owner( this->boids[i].px );
+      if( to != self )
+      {
+         append( outgoing[to], this->ids[i], this->boids[i] );
+         ++migratedOut;
+         continue;
+      }
+      this->ids[kept] = this->ids[i];
+      this->boids[kept++] = this->boids[i];
+   }
+   this->ids.resize( kept );
+   this->boids.resize( kept );
+
+   // Respawns land anywhere, so every pair exchanges (mostly empty) messages
+   for( int r = 0; r < size; ++r )
+      if( r != self )
+         this->transport.send( r, std::move( outgoing[r] ) );
+   this->haloIn.clear();
+   std::vector< uint8_t > message;
+   for( int r = 0; r < size; ++r )
+   {
+      if( r == self )
+         continue;
+      if( !this->transport.receive( r, message ) )
+         return false;
+      unpack( message, this->haloIn );
+   }
+   this->stats.migratedOut = migratedOut;
+   this->stats.migratedIn = static_cast< int >( this->haloIn.size() );
+   if( this->haloIn.empty() )
+      return true;
+
+   std::sort( this->haloIn.begin(), this->haloIn.end(), []( const Wire& a, const Wire& b ) { return a.id < b.id; } );
+   std::vector< uint32_t > mergedIds( kept + this->haloIn.size() );
+   std::vector< BoidGPU > merged( mergedIds.size() );
+   size_t a = 0, b = 0;
+   for( size_t i = 0; i < merged.size(); ++i )
+   {
+      if( b == this->haloIn.size() || ( a < kept && this->ids[a] < this->haloIn[b].id ) )
+      {
+         mergedIds[i] = this->ids[a];
+         merged[i] = this->boids[a++];
+      }
+      else
+      {
+         mergedIds[i] = this->haloIn[b].id;
+         merged[i] = this->haloIn[b++].boid;
+      }
+   }
+   this->ids.swap( mergedIds );
+   this->boids.swap( merged );
+   return true;
+}
+
+bool BoidDomainRank::rebalance()
+{
+   BOID_PROFILE_ZONE( "BoidDomainRank::rebalance" );
+   const int self = this->transport.getRank();
+   const int size = this->transport.getSize();
+   if( size < 2 )
+      return true;
+
+   // Density profile over the boundary sphere (outliers land in the end bins) plus each rank's count
+   const int bins = std::max( this->settings.histogramBins, size );
+   const float extent = std::max( this->params.bndRadius, this->haloWidth * size );
+   const float binWidth = 2.0f * extent / bins;
+   std::vector< double > hist( bins + size, 0.0 );
+   for( const BoidGPU& b : this->boids )
+   {
+      const int bin = std::clamp( static_cast< int >( std::floor( ( b.px + extent ) / binWidth ) ), 0, bins - 1 );
+      hist[bin] += 1.0;
+   }
+   hist[bins + self] = static_cast< double >( this->boids.size() );
+   if( !this->transport.allReduceSum( hist.data(), static_cast< int >( hist.size() ) ) )
+      return false;
+
+   double total = 0.0, largest = 0.0;
+   for( int r = 0; r < size; ++r )
+   {
+      total += hist[bins + r];
+      largest = std::max( largest, hist[bins + r] );
+   }
+   this->stats.imbalance = total > 0.0 ? static_cast< float >( largest * size / total ) : 1.0f;
+   ++this->stats.rebalances;
+   if( total <= 0.0 )
+      return true;
+
+   // Equal-count borders, interpolated inside the bin where the running count crosses k/size
+   double running = 0.0;
+   int bin = 0;
+   for( int k = 1; k < size; ++k )
+   {
+      const double want = total * k / size;
+      while( bin < bins - 1 && running + hist[bin] < want )
+         running += hist[bin++];
+      const double inside = hist[bin] > 0.0 ? ( want - running ) / hist[bin] : 0.5;
+      const float target = -extent + ( bin + static_cast< float >( std::clamp( inside, 0.0, 1.0 ) ) ) * binWidth;
+      this->bounds[k] += this->settings.rebalanceDamping * ( target - this->bounds[k] );
+   }
+   // Inner slabs stay at least a halo wide: push the borders apart upward and downward and take
+   // the mean, which keeps the gaps and doesn't drift the crowded borders to one side
+   std::vector< float > up( this->bounds ), down( this->bounds );
+   for( int k = 2; k < size; ++k )
+      up[k] = std::max( up[k], up[k - 1] + this->haloWidth );
+   for( int k = size - 2; k >= 1; --k )
+      down[k] = std::min( down[k], down[k + 1] - this->haloWidth );
+   for( int k = 1; k < size; ++k )
+      this->bounds[k] = 0.5f * ( up[k] + down[k] );
+   return true;
+}
+
+bool BoidDomainRank::gather( std::vector< BoidGPU >* out )
+{
+   const int self = this->transport.getRank();
+   if( self != 0 )
+   {
+      std::vector< uint8_t > message;
+      message.reserve( this->boids.size() * sizeof( Wire ) );
+      for( size_t i = 0; i < this->boids.size(); ++i )
+         append( message, this->ids[i], this->boids[i] );
+      this->transport.send( 0, std::move( message ) );
+      return true;
+   }
+
+   std::vector< Wire > all;
+   for( size_t i = 0; i < this->boids.size(); ++i )
+      all.push_back( Wire{ this->ids[i], this->boids[i] } );
+   std::vector< uint8_t > message;
+   for( int r = 1; r < this->transport.getSize(); ++r )
+   {
+      if( !this->transport.receive( r, message ) )
+         return false;
+      unpack( message, all );
+   }
+   if( all.size() != static_cast< size_t >( this->params.numBoids ) )
+      return false;
+   if( out )
+   {
+      out->resize( this->params.numBoids + this->params.numPredators );
+      for( const Wire& w : all )
+         ( *out )[w.id] = w.boid;
+      std::copy( this->predators.begin(), this->predators.end(), out->begin() + this->params.numBoids );
+   }
+   return true;
+}
+
+// ============================================================
+// Processes
+// ============================================================
+
+int BoidDomainRank::runProcesses( const BoidScenario& scenario, int ranks, int steps, const std::string& socketDir )
+{
+#ifdef _WIN32
+   std::cout << "--domain-ranks needs a POSIX system (fork and Unix sockets)" << std::endl;
+   return 1;
+#else
+   std::cout << "Domain run: " << scenario.name << ", " << scenario.params.numBoids << " boids, "
+             << scenario.params.numPredators << " predators, " << steps << " steps on " << ranks << " ranks" << std::endl;
+   std::vector< pid_t > children;
+   for( int r = 0; r < ranks; ++r )
+   {
+      const pid_t pid = fork();
+      if( pid < 0 )
+      {
+         std::cout << "fork failed for rank " << r << std::endl;
+         return 1;
+      }
+      if( pid > 0 )
+      {
+         children.push_back( pid );
+         continue;
+      }
+
+      // Child: rank r
+      std::string error;
+      std::unique_ptr< BoidSocketTransport > transport = BoidSocketTransport::connect( socketDir, r, ranks, &error );
+      if( !transport )
+      {
+         std::cout << "rank " << r << ": " << error << std::endl;
+         _exit( 1 );
+      }
+      const unsigned int cores = std::max( 1u, std::thread::hardware_concurrency() / static_cast< unsigned int >( ranks ) );
+      BoidThreadPool pool( cores );
+      std::vector< BoidGPU > state( scenario.params.numBoids + scenario.params.numPredators );
+      BoidRng::initSwarm( state.data(), scenario.params.numBoids, scenario.params.numPredators, scenario.seed, scenario.spawn, pool );
+
+      BoidDomainRank rank( *transport, scenario.params );
+      rank.scatter( state.data() );
+      double totalMs = 0.0;
+      for( int i = 0; i < steps; ++i )
+      {
+         if( !rank.step( scenario.getStepGlobals( i ), pool ) )
+         {
+            std::cout << "rank " << r << ": a peer went away at step " << i << std::endl;
+            _exit( 1 );
+         }
+         totalMs += rank.getStats().stepMs;
+      }
+      const BoidDomainStats& s = rank.getStats();
+      std::cout << "rank " << r << ": " << s.owned << " owned, " << s.halo << " halo, slab [" << s.lo << ", " << s.hi
+                << "), " << totalMs / std::max( steps, 1 ) << " ms/step, " << s.bytesSent / 1024 << " KiB in "
+                << s.messagesSent << " messages, " << s.rebalances << " rebalances" << std::endl;
+
+      std::vector< BoidGPU > decomposed;
+      if( !rank.gather( r == 0 ? &decomposed : nullptr ) )
+      {
+         std::cout << "rank " << r << ": gather failed" << std::endl;
+         _exit( 1 );
+      }
+      if( r == 0 )
+      {
+         BoidScenario reference = scenario;
+         reference.steps = steps;
+         std::vector< BoidGPU > expected;
+         const BoidScenarioTiming single = reference.runCpu( pool, &expected );
+         const bool identical = std::memcmp( expected.data(), decomposed.data(), expected.size() * sizeof( BoidGPU ) ) == 0;
+         const BoidDriftSample d = BoidDriftHarness::compare( expected.data(), decomposed.data(), scenario.params.numBoids,
+                                                               scenario.params.numPredators );
+         std::cout << "imbalance " << s.imbalance << " (largest rank / mean); single process on " << cores << " threads: "
+                   << single.msPerStep << " ms/step" << std::endl;
+         if( identical )
+            std::cout << "final state bit-identical to the single-process run" << std::endl;
+         else
+            std::cout << "final state vs single process: pos RMS " << d.posRms << " (max " << d.posMax << "), vel RMS " << d.velRms
+                      << ", polarization " << d.polarization << ", speed " << d.meanSpeed * 100.0f << "%" << std::endl;
+      }
+      std::cout.flush();
+      transport.reset();
+      _exit( 0 );
+   }
+
+   int failed = 0;
+   for( pid_t pid : children )
+   {
+      int status = 0;
+      if( waitpid( pid, &status, 0 ) < 0 || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 )
+         ++failed;
+   }
+   return failed == 0 ? 0 : 1;
+#endif
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "BoidNeighborList.h"
+#include "BoidSwarmTypes.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+class BoidTransport;
+class BoidThreadPool;
+struct BoidScenario;
+
+/// Command line of a decomposed run: --domain-ranks=N [--domain-steps=N] [--domain-scenario=FILE] [--domain-sockets=DIR]
+struct BoidDomainOptions
+{
+   int ranks = 0;               // 0 = no decomposed run
+   int steps = 600;
+   std::string scenarioPath;    // empty = BoidScenario::makeDefault()
+   std::string socketDir = "/tmp";
+
+   /// Picks the domain flags out of 'args' and ignores everything else; false with a message in
+   /// 'error' when a domain flag has a bad value
+   static bool parse( const std::vector< std::string >& args, BoidDomainOptions& out, std::string* error = nullptr );
+};
+
+struct BoidDomainSettings
+{
+   int rebalanceInterval = 50;   // steps between boundary moves, 0 = fixed slabs
+   float rebalanceDamping = 0.5f; // fraction of the way to the balanced boundaries taken per move
+   int histogramBins = 256;       // resolution of the density profile the boundaries are placed on
+};
+
+/// One rank's share of the work; the byte and message counts are cumulative
+struct BoidDomainStats
+{
+   int owned = 0;
+   int halo = 0;            // copies of the neighbor ranks' border boids stepped against
+   int migratedIn = 0;      // boids that crossed into this slab in the last step
+   int migratedOut = 0;
+   float lo = 0.0f;         // owned slab lo <= x < hi; -/+FLT_MAX at the ends
+   float hi = 0.0f;
+   int rebalances = 0;
+   float imbalance = 1.0f;  // largest rank's boids / mean, as of the last rebalance
+   uint64_t bytesSent = 0;
+   uint64_t messagesSent = 0;
+   double stepMs = 0.0;     // last step, split into its phases below
+   double predatorMs = 0.0;
+   double haloMs = 0.0;
+   double kernelMs = 0.0;
+   double migrateMs = 0.0;
+};
+
+/**
+   One rank of a swarm decomposed into slabs along x. Rank r owns the boids with
+   bounds[r] <= x < bounds[r + 1]; the end slabs are open, so boids beyond the boundary sphere
+   still have an owner. Each step:
+
+   - the predators, replicated on every rank, pick their targets from allreduced sums (flock
+     center, locked target position) and an allgathered nearest-to-center candidate per rank;
+   - every rank sends its neighbors the boids within the interaction radius of the shared border
+     (the halo) and steps its own boids against owned + halo through a BoidNeighborList;
+   - boids whose new position lies in another slab migrate there (respawned boids may jump
+     several slabs, so this is an all-to-all exchange);
+   - every rebalanceInterval steps the ranks allreduce a histogram of x and move the borders
+     toward equal counts, never closer than the halo width so halos only come from adjacent ranks.
+
+   Boids keep their index in the whole swarm as an id and each rank keeps them sorted by it, so
+   neighbors are summed in the order the single-process kernel sums them and the swarm follows
+   the reference bit for bit.
+
+   Every call is collective: all ranks make it in the same order.
+*/
+class BoidDomainRank
+{
+public:
+   BoidDomainRank( BoidTransport& transport, const BoidSwarmParams& params, const BoidDomainSettings& settings = BoidDomainSettings() );
+
+   /// Takes this rank's share of 'full' (numBoids boids, then the predators); every rank passes
+   /// the same state, e.g. seeded from the scenario, so nothing is sent
+   void scatter( const BoidGPU* full );
+   /// One simulation step of the whole swarm
+   bool step( const BoidStepGlobals& globals, BoidThreadPool& pool );
+   /// Collects the whole swarm in index order on rank 0 ('out' may be null elsewhere)
+   bool gather( std::vector< BoidGPU >* out );
+
+   const BoidDomainStats& getStats() const { return this->stats; }
+   const std::vector< float >& getBounds() const { return this->bounds; }
+   float getHaloWidth() const { return this->haloWidth; }
+   int owner( float x ) const;
+
+   /// Runs 'scenario' for 'steps' steps as 'ranks' processes on this machine, connected through
+   /// Unix sockets in 'socketDir', and compares the result with the single-process CPU run.
+   /// Prints per-rank stats and the drift summary to stdout; returns the process exit status.
+   static int runProcesses( const BoidScenario& scenario, int ranks, int steps, const std::string& socketDir );
+
+private:
+   struct Wire             // a boid on the wire: its id and state
+   {
+      uint32_t id;
+      BoidGPU boid;
+   };
+
+   bool stepPredators( const BoidStepGlobals& globals );
+   bool exchangeHalo();
+   bool migrate();
+   bool rebalance();
+   static void append( std::vector< uint8_t >& message, uint32_t id, const BoidGPU& boid );
+
+   BoidTransport& transport;
+   BoidSwarmParams params;
+   BoidDomainSettings settings;
+   float haloWidth = 0.0f;
+   std::vector< float > bounds;             // size + 1 borders, the outer two +/-FLT_MAX
+   int steps = 0;
+
+   std::vector< uint32_t > ids;             // owned boids, ascending id
+   std::vector< BoidGPU > boids;
+   std::vector< BoidGPU > predators;        // replicated
+
+   // Step scratch, kept for its capacity
+   std::vector< Wire > haloIn;
+   std::vector< uint32_t > localIds;        // owned + halo, ascending id
+   std::vector< BoidGPU > local;            // ... then the predators
+   std::vector< uint32_t > ownedLocal;      // where the owned boids sit in 'local'
+   std::vector< BoidGPU > stepped;
+   std::vector< BoidGPU > prevPredators;    // the predators before this step, as the boids see them
+   BoidNeighborList neighbors;
+   BoidDomainStats stats;
+};
+
+} //namespace Aftr
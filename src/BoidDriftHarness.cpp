@@ -0,0 +1,248 @@
+#include "BoidDriftHarness.h"
+#include "BoidCpuKernel.h"
+#include "BoidNeighborList.h"
+#include "BoidProfiler.h"
+#include "BoidRng.h"
+#include "BoidScenario.h"
+#include "BoidSwarmMetrics.h"
+#include "BoidThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <sstream>
+
+using namespace Aftr;
+
+BoidDriftTolerance BoidDriftTolerance::exact()
+{
+   BoidDriftTolerance t;
+   t.posRms = t.posMax = t.velRms = t.velMax = 0.0f;
+   t.growthPerStep = 0.0f;
+   t.polarization = t.meanSpeed = t.gyrationRadius = 0.0f;
+   return t;
+}
+
+// ============================================================
+// Report
+// ============================================================
+
+bool BoidDriftReport::check( const BoidDriftTolerance& tol, std::string* failure ) const
+{
+   auto fail = [failure]( const std::string& what, int step, float value, float limit )
+   {
+      if( failure )
+      {
+         std::ostringstream ss;
+         ss << what << " " << value << " exceeds " << limit << ( step >= 0 ? " at step " + std::to_string( step ) : std::string() );
+         *failure = ss.str();
+      }
+      return false;
+   };
+
+   for( const BoidDriftSample& s : this->samples )
+   {
+      if( s.step >= tol.trajectorySteps )
+         break;
+      if( s.posRms > tol.posRms )
+         return fail( "position RMS error", s.step, s.posRms, tol.posRms );
+      if( s.posMax > tol.posMax )
+         return fail( "position max error", s.step, s.posMax, tol.posMax );
+      if( s.velRms > tol.velRms )
+         return fail( "velocity RMS error", s.step, s.velRms, tol.velRms );
+      if( s.velMax > tol.velMax )
+         return fail( "velocity max error", s.step, s.velMax, tol.velMax );
+   }
+   if( this->growthPerStep > tol.growthPerStep )
+      return fail( "divergence growth per step", -1, this->growthPerStep, tol.growthPerStep );
+
+   // Collective metrics: mean signed differences, single steps fluctuate with the chaos
+   if( !this->samples.empty() )
+   {
+      double pol = 0, speed = 0, gyr = 0;
+      for( const BoidDriftSample& s : this->samples )
+      {
+         pol += s.polarization;
+         speed += s.meanSpeed;
+         gyr += s.gyrationRadius;
+      }
+      const double n = static_cast< double >( this->samples.size() );
+      if( std::fabs( pol / n ) > tol.polarization )
+         return fail( "mean polarization difference", -1, static_cast< float >( pol / n ), tol.polarization );
+      if( std::fabs( speed / n ) > tol.meanSpeed )
+         return fail( "mean relative speed difference", -1, static_cast< float >( speed / n ), tol.meanSpeed );
+      if( std::fabs( gyr / n ) > tol.gyrationRadius )
+         return fail( "mean relative gyration radius difference", -1, static_cast< float >( gyr / n ), tol.gyrationRadius );
+   }
+   return true;
+}
+
+std::string BoidDriftReport::summary() const
+{
+   std::ostringstream ss;
+   ss << this->samples.size() << " steps: ";
+   if( this->firstDivergentStep < 0 )
+   {
+      ss << "bit-identical";
+      return ss.str();
+   }
+   float posRms = 0.0f, velRms = 0.0f;
+   double pol = 0, speed = 0, gyr = 0;
+   for( const BoidDriftSample& s : this->samples )
+   {
+      posRms = std::max( posRms, s.posRms );
+      velRms = std::max( velRms, s.velRms );
+      pol += s.polarization;
+      speed += s.meanSpeed;
+      gyr += s.gyrationRadius;
+   }
+   const double n = static_cast< double >( this->samples.size() );
+   ss << "diverges at step " << this->firstDivergentStep << ", growth " << this->growthPerStep << "/step";
+   if( this->growthPerStep > 0.0f )
+      ss << " (doubling every " << std::log( 2.0f ) / this->growthPerStep << " steps)";
+   ss << ", worst pos RMS " << posRms << ", vel RMS " << velRms << "; mean differences: polarization " << pol / n
+      << ", speed " << speed / n * 100.0 << "%, gyration radius " << gyr / n * 100.0 << "%";
+   return ss.str();
+}
+
+// ============================================================
+// Harness
+// ============================================================
+
+BoidDriftReport BoidDriftHarness::run( const BoidScenario& scenario, int steps, const BoidDriftStepper& reference,
+                                       const BoidDriftStepper& candidate, BoidThreadPool& pool )
+{
+   BOID_PROFILE_ZONE( "BoidDriftHarness::run" );
+   const int numBoids = scenario.params.numBoids;
+   const int numPredators = scenario.params.numPredators;
+   const uint32_t total = static_cast< uint32_t >( numBoids + numPredators );
+   std::vector< BoidGPU > ref[2], cand[2];
+   ref[0].resize( total );
+   BoidRng::initSwarm( ref[0].data(), numBoids, numPredators, scenario.seed, scenario.spawn, pool );
+   ref[1].resize( total );
+   cand[0] = ref[0];
+   cand[1].resize( total );
+
+   BoidDriftReport report;
+   report.samples.reserve( std::max( steps, 0 ) );
+   int read = 0;
+   for( int i = 0; i < steps; ++i )
+   {
+      const BoidStepGlobals globals = scenario.getStepGlobals( i );
+      reference( ref[read].data(), ref[1 - read].data(), total, scenario.params, globals );
+      candidate( cand[read].data(), cand[1 - read].data(), total, scenario.params, globals );
+      read = 1 - read;
+
+      BoidDriftSample s = compare( ref[read].data(), cand[read].data(), numBoids, numPredators );
+      s.step = i;
+      if( report.firstDivergentStep < 0 && std::memcmp( ref[read].data(), cand[read].data(), total * sizeof( BoidGPU ) ) != 0 )
+         report.firstDivergentStep = i;
+      report.samples.push_back( s );
+   }
+   report.growthPerStep = fitGrowth( report.samples );
+   return report;
+}
+
+BoidDriftSample BoidDriftHarness::compare( const BoidGPU* reference, const BoidGPU* candidate, int numBoids, int numPredators )
+{
+   BoidDriftSample s;
+   const int total = numBoids + numPredators;
+   if( total <= 0 )
+      return s;
+
+   double posSq = 0, velSq = 0, posWorst = 0, velWorst = 0;
+   for( int i = 0; i < total; ++i )
+   {
+      const BoidGPU& a = reference[i];
+      const BoidGPU& b = candidate[i];
+      const double px = double( b.px ) - a.px, py = double( b.py ) - a.py, pz = double( b.pz ) - a.pz;
+      const double vx = double( b.vx ) - a.vx, vy = double( b.vy ) - a.vy, vz = double( b.vz ) - a.vz;
+      const double p2 = px * px + py * py + pz * pz;
+      const double v2 = vx * vx + vy * vy + vz * vz;
+      posSq += p2;
+      velSq += v2;
+      posWorst = std::max( posWorst, p2 );
+      velWorst = std::max( velWorst, v2 );
+   }
+   s.posRms = static_cast< float >( std::sqrt( posSq / total ) );
+   s.posMax = static_cast< float >( std::sqrt( posWorst ) );
+   s.velRms = static_cast< float >( std::sqrt( velSq / total ) );
+   s.velMax = static_cast< float >( std::sqrt( velWorst ) );
+
+   const BoidSwarmMetrics ma = BoidSwarmMetrics::compute( reference, numBoids );
+   const BoidSwarmMetrics mb = BoidSwarmMetrics::compute( candidate, numBoids );
+   auto relative = []( float a, float b ) { return ( b - a ) / std::max( std::fabs( a ), 1e-6f ); };
+   s.polarization = mb.polarization - ma.polarization;
+   s.meanSpeed = relative( ma.meanSpeed, mb.meanSpeed );
+   s.gyrationRadius = relative( ma.gyrationRadius, mb.gyrationRadius );
+   const float dc[3] = { mb.centroid[0] - ma.centroid[0], mb.centroid[1] - ma.centroid[1], mb.centroid[2] - ma.centroid[2] };
+   s.centroid = std::sqrt( dc[0] * dc[0] + dc[1] * dc[1] + dc[2] * dc[2] );
+   return s;
+}
+
+float BoidDriftHarness::fitGrowth( const std::vector< BoidDriftSample >& samples )
+{
+   // The error grows exponentially from the first difference until it saturates at the size of
+   // the swarm; fit only that stretch: nonzero samples up to the largest error
+   size_t first = 0;
+   while( first < samples.size() && samples[first].posRms <= 0.0f )
+      ++first;
+   if( first == samples.size() )
+      return 0.0f;
+   size_t peak = first;
+   for( size_t i = first; i < samples.size(); ++i )
+      if( samples[i].posRms > samples[peak].posRms )
+         peak = i;
+   if( peak - first < 2 )
+      return 0.0f;
+
+   double sx = 0, sy = 0, sxx = 0, sxy = 0;
+   int n = 0;
+   for( size_t i = first; i <= peak; ++i )
+   {
+      if( samples[i].posRms <= 0.0f )
+         continue;
+      const double x = samples[i].step, y = std::log( double( samples[i].posRms ) );
+      sx += x; sy += y; sxx += x * x; sxy += x * y;
+      ++n;
+   }
+   const double denom = n * sxx - sx * sx;
+   if( n < 3 || denom <= 0.0 )
+      return 0.0f;
+   return std::max( 0.0f, static_cast< float >( ( n * sxy - sx * sy ) / denom ) );
+}
+
+// ============================================================
+// CPU steppers
+// ============================================================
+
+BoidDriftStepper BoidDriftHarness::cpuStepper( BoidThreadPool& pool, uint32_t grain )
+{
+   return [&pool, grain]( const BoidGPU* in, BoidGPU* out, uint32_t, const BoidSwarmParams& params, const BoidStepGlobals& globals )
+   {
+      BoidCpuKernel::step( in, out, params, globals, pool, grain );
+   };
+}
+
+BoidDriftStepper BoidDriftHarness::cpuNeighborListStepper( BoidThreadPool& pool, float skin, float cellScale )
+{
+   auto lists = std::make_shared< BoidNeighborList >();
+   lists->setSkin( skin );
+   lists->setCellScale( cellScale );
+   return [&pool, lists]( const BoidGPU* in, BoidGPU* out, uint32_t, const BoidSwarmParams& params, const BoidStepGlobals& globals )
+   {
+      lists->update( in, params, pool );
+      BoidCpuKernel::step( in, out, params, globals, pool, 256, lists.get() );
+   };
+}
+
+BoidDriftStepper BoidDriftHarness::cpuBatchStepper( BoidThreadPool& pool )
+{
+   return [&pool]( const BoidGPU* in, BoidGPU* out, uint32_t, const BoidSwarmParams& params, const BoidStepGlobals& globals )
+   {
+      BoidSwarmParams instance = params;
+      instance.base = 0;
+      BoidCpuKernel::stepBatch( in, out, &instance, 1, globals, pool );
+   };
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+class BoidThreadPool;
+struct BoidScenario;
+
+/// Steps 'count' entities from 'in' to 'out' on one backend or kernel variant. Steppers may keep
+/// state between calls (neighbor lists, GPU buffers); the harness always passes consecutive steps
+using BoidDriftStepper = std::function< void( const BoidGPU* in, BoidGPU* out, uint32_t count,
+                                              const BoidSwarmParams& params, const BoidStepGlobals& globals ) >;
+
+/// Difference of two runs after one step. Trajectory errors are over all entities, the
+/// collective metrics over the boids (see BoidSwarmMetrics)
+struct BoidDriftSample
+{
+   int step = 0;
+   float posRms = 0.0f;
+   float posMax = 0.0f;
+   float velRms = 0.0f;
+   float velMax = 0.0f;
+   float polarization = 0.0f;   // candidate - reference
+   float meanSpeed = 0.0f;      // candidate - reference, relative to the reference
+   float gyrationRadius = 0.0f; // candidate - reference, relative to the reference
+   float centroid = 0.0f;       // distance
+};
+
+/**
+   Limits of a candidate against the reference. Flocking is chaotic, so even a change of
+   rounding grows until the trajectories are unrelated: trajectory errors are only checked for
+   the first 'trajectorySteps' steps and the growth rate over the whole run. The collective
+   metrics are compared as their mean difference over the run, which is what an observer of the
+   swarm would notice; approximate variants set trajectorySteps to 0 and are held to these alone.
+*/
+struct BoidDriftTolerance
+{
+   int trajectorySteps = 20;
+   float posRms = 5e-3f;
+   float posMax = 5e-2f;
+   float velRms = 1e-3f;
+   float velMax = 1e-2f;
+   float growthPerStep = 0.25f; // fitted e-folding rate of posRms
+   float polarization = 0.1f;
+   float meanSpeed = 0.02f;     // relative
+   float gyrationRadius = 0.15f; // relative
+
+   /// Bit-identical runs only
+   static BoidDriftTolerance exact();
+};
+
+struct BoidDriftReport
+{
+   std::vector< BoidDriftSample > samples; // one per step
+   float growthPerStep = 0.0f;   // posRms ~ exp( growthPerStep * step ) while it grows, 0 if it never does
+   int firstDivergentStep = -1;  // first step whose state differs at all, -1 if none
+
+   /// False and the first violated limit in 'failure' if the candidate is out of tolerance
+   bool check( const BoidDriftTolerance& tol, std::string* failure = nullptr ) const;
+   /// One line: divergence onset, growth, worst errors and metric differences
+   std::string summary() const;
+};
+
+/**
+   Cross-backend equivalence harness. run() seeds the scenario's swarm once, steps two copies
+   through the reference and the candidate with the same per-step globals and compares them
+   after every step. Steppers for the CPU variants are provided here; the GPU kernel variants
+   are wrapped by the view (Boids > Backend > Check Drift).
+*/
+class BoidDriftHarness
+{
+public:
+   static BoidDriftReport run( const BoidScenario& scenario, int steps, const BoidDriftStepper& reference,
+                               const BoidDriftStepper& candidate, BoidThreadPool& pool );
+
+   static BoidDriftSample compare( const BoidGPU* reference, const BoidGPU* candidate, int numBoids, int numPredators );
+   /// Least-squares slope of log(posRms) over the steps where it is growing from a nonzero value
+   static float fitGrowth( const std::vector< BoidDriftSample >& samples );
+
+   /// BoidCpuKernel all pairs, the reference of every other backend
+   static BoidDriftStepper cpuStepper( BoidThreadPool& pool, uint32_t grain = 256 );
+   /// BoidCpuKernel through Verlet lists with the given skin
+   static BoidDriftStepper cpuNeighborListStepper( BoidThreadPool& pool, float skin, float cellScale = 1.0f );
+   /// The ensemble batch entry point with the swarm as its only instance
+   static BoidDriftStepper cpuBatchStepper( BoidThreadPool& pool );
+};
+
+} //namespace Aftr
@@ -0,0 +1,99 @@
+#include "BoidEnsemble.h"
+
+#include <algorithm>
+
+using namespace Aftr;
+
+const char* BoidEnsemble::getSweepParamName( BoidSweepParam param )
+{
+   switch( param )
+   {
+      case BoidSweepParam::Separation:     return "Separation";
+      case BoidSweepParam::Alignment:      return "Alignment";
+      case BoidSweepParam::Cohesion:       return "Cohesion";
+      case BoidSweepParam::NeighborRadius: return "Neighbor Radius";
+      case BoidSweepParam::MaxSpeed:       return "Max Boid Speed";
+      case BoidSweepParam::Noise:          return "Noise";
+      default:                             return "?";
+   }
+}
+
+float BoidEnsemble::getSweepParam( const BoidSwarmParams& params, BoidSweepParam param )
+{
+   switch( param )
+   {
+      case BoidSweepParam::Separation:     return params.sepWeight;
+      case BoidSweepParam::Alignment:      return params.aliWeight;
+      case BoidSweepParam::Cohesion:       return params.cohWeight;
+      case BoidSweepParam::NeighborRadius: return params.neiRadius;
+      case BoidSweepParam::MaxSpeed:       return params.maxSpeed;
+      case BoidSweepParam::Noise:          return params.noiseStrength;
+      default:                             return 0.0f;
+   }
+}
+
+void BoidEnsemble::setSweepParam( BoidSwarmParams& params, BoidSweepParam param, float value )
+{
+   switch( param )
+   {
+      case BoidSweepParam::Separation:     params.sepWeight = value; break;
+      case BoidSweepParam::Alignment:      params.aliWeight = value; break;
+      case BoidSweepParam::Cohesion:       params.cohWeight = value; break;
+      case BoidSweepParam::NeighborRadius: params.neiRadius = value; break;
+      case BoidSweepParam::MaxSpeed:       params.maxSpeed = value; break;
+      case BoidSweepParam::Noise:          params.noiseStrength = value; break;
+      default: break;
+   }
+}
+
+std::vector< BoidSwarmParams > BoidEnsemble::build( const BoidSwarmParams& base, int numInstances,
+                                                    BoidSweepParam param, float sweepMin, float sweepMax )
+{
+   std::vector< BoidSwarmParams > instances;
+   build( base, numInstances, param, sweepMin, sweepMax, instances );
+   return instances;
+}
+
+void BoidEnsemble::build( const BoidSwarmParams& base, int numInstances, BoidSweepParam param, float sweepMin, float sweepMax,
+                          std::vector< BoidSwarmParams >& out )
+{
+   out.assign( std::max( numInstances, 0 ), base );
+   int next = 0;
+   for( int i = 0; i < numInstances; ++i )
+   {
+      float t = ( numInstances > 1 ) ? static_cast< float >( i ) / static_cast< float >( numInstances - 1 ) : 0.0f;
+      setSweepParam( out[i], param, sweepMin + ( sweepMax - sweepMin ) * t );
+      out[i].base = next;
+      next += out[i].numBoids + out[i].numPredators;
+   }
+}
+
+int BoidEnsemble::getTotalEntities( const std::vector< BoidSwarmParams >& instances )
+{
+   int total = 0;
+   for( const auto& p : instances )
+      total += p.numBoids + p.numPredators;
+   return total;
+}
+
+int BoidEnsemble::getMaxEntities( const std::vector< BoidSwarmParams >& instances )
+{
+   int largest = 0;
+   for( const auto& p : instances )
+      largest = std::max( largest, p.numBoids + p.numPredators );
+   return largest;
+}
+
+std::vector< BoidSwarmMetrics > BoidEnsemble::measure( const BoidGPU* buffer, const std::vector< BoidSwarmParams >& instances )
+{
+   std::vector< BoidSwarmMetrics > metrics;
+   measure( buffer, instances, metrics );
+   return metrics;
+}
+
+void BoidEnsemble::measure( const BoidGPU* buffer, const std::vector< BoidSwarmParams >& instances, std::vector< BoidSwarmMetrics >& out )
+{
+   out.resize( instances.size() );
+   for( size_t i = 0; i < instances.size(); ++i )
+      out[i] = BoidSwarmMetrics::compute( buffer + instances[i].base, instances[i].numBoids );
+}
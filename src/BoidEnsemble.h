@@ -0,0 +1,52 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include "BoidSwarmMetrics.h"
+#include <vector>
+
+namespace Aftr
+{
+
+/// Parameter an ensemble spreads across its instances
+enum class BoidSweepParam : int
+{
+   Separation = 0,
+   Alignment,
+   Cohesion,
+   NeighborRadius,
+   MaxSpeed,
+   Noise,
+   Count
+};
+
+/**
+   Layout of an ensemble: M independent swarms concatenated in one buffer, instance i
+   occupying [params[i].base, params[i].base + numBoids + numPredators). Every instance
+   starts from the same base parameters with one of them swept linearly across the instances,
+   which is how parameter studies are run side by side in a single dispatch.
+*/
+class BoidEnsemble
+{
+public:
+   static const char* getSweepParamName( BoidSweepParam param );
+   static float getSweepParam( const BoidSwarmParams& params, BoidSweepParam param );
+   static void setSweepParam( BoidSwarmParams& params, BoidSweepParam param, float value );
+
+   /// One parameter block per instance with bases assigned back to back; instance i gets
+   /// sweepMin + (sweepMax - sweepMin) * i / (numInstances - 1) for the swept parameter
+   static std::vector< BoidSwarmParams > build( const BoidSwarmParams& base, int numInstances,
+                                                BoidSweepParam param, float sweepMin, float sweepMax );
+   /// Same into 'out', reusing its capacity (per-frame callers)
+   static void build( const BoidSwarmParams& base, int numInstances, BoidSweepParam param, float sweepMin, float sweepMax,
+                      std::vector< BoidSwarmParams >& out );
+   /// Entities across all instances (size of the concatenated buffer)
+   static int getTotalEntities( const std::vector< BoidSwarmParams >& instances );
+   /// Largest instance, which sizes the x dimension of the batched dispatch
+   static int getMaxEntities( const std::vector< BoidSwarmParams >& instances );
+
+   /// Per-instance metrics of a concatenated buffer
+   static std::vector< BoidSwarmMetrics > measure( const BoidGPU* buffer, const std::vector< BoidSwarmParams >& instances );
+   static void measure( const BoidGPU* buffer, const std::vector< BoidSwarmParams >& instances, std::vector< BoidSwarmMetrics >& out );
+};
+
+} //namespace Aftr
@@ -0,0 +1,53 @@
+#include "BoidEventStream.h"
+
+#include <algorithm>
+
+using namespace Aftr;
+
+BoidEventStream::BoidEventStream( size_t retained ) : ring( std::max< size_t >( retained, 1 ) )
+{
+}
+
+void BoidEventStream::append( const BoidEvent* events, uint32_t count, uint64_t dropped )
+{
+   for( uint32_t i = 0; i < count; ++i )
+   {
+      this->ring[this->head % this->ring.size()] = events[i];
+      ++this->head;
+      if( events[i].type < static_cast< uint32_t >( BoidEventType::Count ) )
+         ++this->stats.byType[events[i].type];
+   }
+   this->stats.total += count;
+   this->stats.dropped += dropped;
+   ++this->stats.batches;
+   this->stats.lastBatch = static_cast< uint32_t >( std::min< uint64_t >( count + dropped, UINT32_MAX ) );
+   this->stats.peakBatch = std::max( this->stats.peakBatch, this->stats.lastBatch );
+}
+
+uint64_t BoidEventStream::getTail() const
+{
+   const uint64_t retained = this->ring.size();
+   return std::max( this->tail, this->head > retained ? this->head - retained : 0 );
+}
+
+uint64_t BoidEventStream::read( uint64_t& cursor, std::vector< BoidEvent >& out, size_t max ) const
+{
+   const uint64_t oldest = this->getTail();
+   uint64_t missed = 0;
+   if( cursor < oldest )
+   {
+      missed = oldest - cursor;
+      cursor = oldest;
+   }
+   cursor = std::min( cursor, this->head );
+   const uint64_t end = std::min< uint64_t >( this->head, cursor + std::min< uint64_t >( max, this->head - cursor ) );
+   for( ; cursor < end; ++cursor )
+      out.push_back( this->at( cursor ) );
+   return missed;
+}
+
+void BoidEventStream::clear()
+{
+   this->tail = this->head;
+   this->stats = BoidEventStats();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+
+/**
+   CPU side of the event log: the drained batches of BoidGpuEventLog in recording order, with
+   running totals. Every event gets a sequence number; the newest 'retained' events are kept in
+   a ring, so readers poll with their own cursor (read()) and learn how many they missed if they
+   fell behind. Main thread only, like the GL side that feeds it.
+*/
+class BoidEventStream
+{
+public:
+   explicit BoidEventStream( size_t retained = 16384 );
+
+   /// Appends a drained batch; 'dropped' more were recorded but overflowed the GPU log
+   void append( const BoidEvent* events, uint32_t count, uint64_t dropped );
+
+   /// Appends the events from sequence number 'cursor' on to 'out' (at most 'max') and moves
+   /// 'cursor' past them. Returns how many events the cursor skipped because they had already
+   /// left the ring.
+   uint64_t read( uint64_t& cursor, std::vector< BoidEvent >& out, size_t max = SIZE_MAX ) const;
+
+   uint64_t getHead() const { return this->head; }   ///< sequence number of the next event
+   uint64_t getTail() const;                          ///< oldest retained event
+   /// Retained event 'seq', getTail() <= seq < getHead()
+   const BoidEvent& at( uint64_t seq ) const { return this->ring[seq % this->ring.size()]; }
+
+   const BoidEventStats& getStats() const { return this->stats; }
+   /// Forgets events and totals; sequence numbers keep counting so cursors stay valid
+   void clear();
+
+private:
+   std::vector< BoidEvent > ring;
+   uint64_t head = 0;
+   uint64_t tail = 0;
+   BoidEventStats stats;
+};
+
+} //namespace Aftr
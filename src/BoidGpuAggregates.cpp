@@ -0,0 +1,368 @@
+#include "BoidGpuAggregates.h"
+#include "BoidProgramCache.h"
+#include "BoidSwarmMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace Aftr;
+
+namespace
+{
+   // Cell coordinates are packed into 8 bits by the kernel's walk
+   constexpr int MAX_BASE_DIM = 1 << ( BoidGpuAggregates::MAX_LEVELS - 1 );
+
+   // All build passes; BOID_AGG_PASS selects one (see BoidGpuAggregates)
+   const char* aggregateShaderSource = R"(
+#version 430
+#ifndef BOID_AGG_PASS
+#define BOID_AGG_PASS 0
+#endif
+#if BOID_AGG_PASS == 2
+layout(local_size_x = 1024) in;
+#else
+layout(local_size_x = 256) in;
+#endif
+
+struct BoidData {
+    vec4 pos;
+    vec4 vel;
+};
+
+layout(std430, binding = 0) readonly buffer BoidInput { BoidData boids[]; };
+layout(std430, binding = 5) buffer AggregateGrid  { uint grid[]; };  // starts | cursors | sorted | cell of boid
+layout(std430, binding = 6) buffer AggregateNodes { vec4 nodes[]; }; // position sum + count, velocity sum
+
+uniform uint  u_numBoids;
+uniform uint  u_numCells;    // level 0
+uniform int   u_dim;         // level 0
+uniform float u_origin;
+uniform float u_invCellSize;
+uniform int   u_parentDim;   // reduce pass: level being written ...
+uniform uint  u_parentBase;
+uniform uint  u_childBase;   // ... and the one below it
+
+uint cursorBase() { return u_numCells + 1u; }
+uint sortedBase() { return 2u * u_numCells + 1u; }
+uint cellOfBase() { return 2u * u_numCells + 1u + u_numBoids; }
+
+#if BOID_AGG_PASS == 0
+// Clear the per-cell counters
+void main() {
+    uint c = gl_GlobalInvocationID.x;
+    if (c < u_numCells)
+        grid[cursorBase() + c] = 0u;
+}
+#elif BOID_AGG_PASS == 1
+// Bin every boid (out-of-grid boids clamp into the border cells)
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_numBoids) return;
+    ivec3 c = clamp(ivec3(floor((boids[i].pos.xyz - vec3(u_origin)) * u_invCellSize)), ivec3(0), ivec3(u_dim - 1));
+    uint cell = uint((c.z * u_dim + c.y) * u_dim + c.x);
+    grid[cellOfBase() + i] = cell;
+    atomicAdd(grid[cursorBase() + cell], 1u);
+}
+#elif BOID_AGG_PASS == 2
+// Exclusive scan of the counts into the cell starts (one workgroup, a run of cells per
+// thread); the cursors restart at the starts for the scatter
+shared uint partial[1024];
+void main() {
+    uint t = gl_LocalInvocationID.x;
+    uint per = (u_numCells + 1023u) / 1024u;
+    uint first = min(t * per, u_numCells);
+    uint last = min(first + per, u_numCells);
+    uint sum = 0u;
+    for (uint c = first; c < last; ++c)
+        sum += grid[cursorBase() + c];
+    partial[t] = sum;
+    barrier();
+    for (uint off = 1u; off < 1024u; off <<= 1u) {
+        uint v = (t >= off) ? partial[t - off] : 0u;
+        barrier();
+        partial[t] += v;
+        barrier();
+    }
+    uint run = partial[t] - sum;
+    for (uint c = first; c < last; ++c) {
+        uint n = grid[cursorBase() + c];
+        grid[c] = run;
+        grid[cursorBase() + c] = run;
+        run += n;
+    }
+    if (t == 1023u)
+        grid[u_numCells] = partial[t];
+}
+#elif BOID_AGG_PASS == 3
+// Scatter boids into their cells
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_numBoids) return;
+    uint slot = atomicAdd(grid[cursorBase() + grid[cellOfBase() + i]], 1u);
+    grid[sortedBase() + slot] = i;
+}
+#elif BOID_AGG_PASS == 4
+// Level 0: sum the boids of each cell
+void main() {
+    uint c = gl_GlobalInvocationID.x;
+    if (c >= u_numCells) return;
+    vec4 posSum = vec4(0.0);
+    vec3 velSum = vec3(0.0);
+    for (uint s = grid[c]; s < grid[c + 1u]; ++s) {
+        uint j = grid[sortedBase() + s];
+        posSum += vec4(boids[j].pos.xyz, 1.0);
+        velSum += boids[j].vel.xyz;
+    }
+    nodes[2u * c] = posSum;
+    nodes[2u * c + 1u] = vec4(velSum, 0.0);
+}
+#else
+// Level l: merge the 2x2x2 children on level l - 1
+void main() {
+    uint c = gl_GlobalInvocationID.x;
+    uint numParents = uint(u_parentDim * u_parentDim * u_parentDim);
+    if (c >= numParents) return;
+    int pd = u_parentDim;
+    ivec3 p = ivec3(int(c) % pd, (int(c) / pd) % pd, int(c) / (pd * pd));
+    int cd = 2 * pd;
+    vec4 posSum = vec4(0.0);
+    vec4 velSum = vec4(0.0);
+    for (int k = 0; k < 8; ++k) {
+        ivec3 q = 2 * p + ivec3(k & 1, (k >> 1) & 1, k >> 2);
+        uint child = u_childBase + uint((q.z * cd + q.y) * cd + q.x);
+        posSum += nodes[2u * child];
+        velSum += nodes[2u * child + 1u];
+    }
+    nodes[2u * (u_parentBase + c)] = posSum;
+    nodes[2u * (u_parentBase + c) + 1u] = velSum;
+}
+#endif
+)";
+
+   std::string passSource( int pass )
+   {
+      std::string src( aggregateShaderSource );
+      size_t lineEnd = src.find( '\n', src.find( "#version" ) );
+      return src.insert( lineEnd + 1, "#define BOID_AGG_PASS " + std::to_string( pass ) + "\n" );
+   }
+
+   GLuint levelCells( int dim ) { return static_cast< GLuint >( dim ) * dim * dim; }
+}
+
+BoidGpuAggregates::~BoidGpuAggregates()
+{
+   for( GLuint p : { clearProgram, countProgram, scanProgram, scatterProgram, baseProgram, reduceProgram } )
+      if( p )
+         glDeleteProgram( p );
+   for( GLuint b : { gridBuffer, nodeBuffer, probeScratch, probeStaging } )
+      if( b )
+         glDeleteBuffers( 1, &b );
+   if( probeFence )
+      glDeleteSync( probeFence );
+}
+
+void BoidGpuAggregates::compileAsync( BoidProgramCache& cache )
+{
+   GLuint* programs[] = { &clearProgram, &countProgram, &scanProgram, &scatterProgram, &baseProgram, &reduceProgram };
+   for( int pass = 0; pass < 6; ++pass )
+      *programs[pass] = cache.compileAsync( { { GL_COMPUTE_SHADER, passSource( pass ) } }, "boid aggregates pass " + std::to_string( pass ) );
+}
+
+void BoidGpuAggregates::finish( BoidProgramCache& cache )
+{
+   GLuint* programs[] = { &clearProgram, &countProgram, &scanProgram, &scatterProgram, &baseProgram, &reduceProgram };
+   bool ok = true;
+   for( GLuint* p : programs )
+   {
+      *p = cache.finish( *p );
+      ok = ok && *p;
+   }
+   if( !ok )
+   {
+      // All or nothing: isReady() keys off the reduce pass
+      for( GLuint* p : programs )
+         if( *p )
+         {
+            glDeleteProgram( *p );
+            *p = 0;
+         }
+   }
+}
+
+void BoidGpuAggregates::allocate( int numBoids, int baseDim )
+{
+   this->numBoids = numBoids;
+   this->baseDim = baseDim;
+   this->levels = 0;
+   GLsizeiptr numNodes = 0;
+   for( int d = baseDim; d >= 1; d /= 2 )
+   {
+      numNodes += levelCells( d );
+      ++this->levels;
+   }
+
+   if( !this->gridBuffer )
+   {
+      glGenBuffers( 1, &this->gridBuffer );
+      glGenBuffers( 1, &this->nodeBuffer );
+   }
+   const GLsizeiptr n = std::max( numBoids, 1 );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->gridBuffer );
+   glBufferData( GL_SHADER_STORAGE_BUFFER, ( 2 * static_cast< GLsizeiptr >( levelCells( baseDim ) ) + 1 + 2 * n ) * sizeof( GLuint ), nullptr, GL_DYNAMIC_COPY );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->nodeBuffer );
+   glBufferData( GL_SHADER_STORAGE_BUFFER, numNodes * 8 * sizeof( GLfloat ), nullptr, GL_DYNAMIC_COPY );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+}
+
+void BoidGpuAggregates::build( GLuint stateBuffer, const BoidSwarmParams& params )
+{
+   if( !this->isReady() )
+      return;
+
+   // Power-of-two grid over the tank with level-0 cells about a separation radius wide; coarser
+   // cells only cost memory, finer ones walk more levels
+   const float extent = params.bndRadius * 1.25f;
+   int dim = 2;
+   while( dim < MAX_BASE_DIM && 2.0f * extent / dim > params.sepRadius )
+      dim *= 2;
+   if( dim != this->baseDim || params.numBoids != this->numBoids )
+      this->allocate( params.numBoids, dim );
+   this->origin = -extent;
+   this->cellSize = 2.0f * extent / dim;
+   const float reach = std::max( params.sepRadius, params.neiRadius );
+   this->topLevel = 0;
+   while( this->topLevel < this->levels - 1 && this->cellSize * static_cast< float >( 1 << this->topLevel ) < reach )
+      ++this->topLevel;
+
+   this->stats.levels = this->levels;
+   this->stats.baseDim = this->baseDim;
+   this->stats.baseCellSize = this->cellSize;
+
+   const GLuint numCells = levelCells( dim );
+   const GLuint numBoidGroups = ( static_cast< GLuint >( this->numBoids ) + 255 ) / 256;
+   const GLuint numCellGroups = ( numCells + 255 ) / 256;
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, stateBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 5, this->gridBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 6, this->nodeBuffer );
+
+   struct Pass { GLuint program; GLuint groups; };
+   const Pass passes[] = { { this->clearProgram, numCellGroups }, { this->countProgram, numBoidGroups }, { this->scanProgram, 1 },
+                           { this->scatterProgram, numBoidGroups }, { this->baseProgram, numCellGroups } };
+   for( const Pass& pass : passes )
+   {
+      glUseProgram( pass.program );
+      glUniform1ui( glGetUniformLocation( pass.program, "u_numBoids" ), static_cast< GLuint >( this->numBoids ) );
+      glUniform1ui( glGetUniformLocation( pass.program, "u_numCells" ), numCells );
+      glUniform1i( glGetUniformLocation( pass.program, "u_dim" ), dim );
+      glUniform1f( glGetUniformLocation( pass.program, "u_origin" ), this->origin );
+      glUniform1f( glGetUniformLocation( pass.program, "u_invCellSize" ), 1.0f / this->cellSize );
+      if( pass.groups )
+         glDispatchCompute( pass.groups, 1, 1 );
+      glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+   }
+
+   glUseProgram( this->reduceProgram );
+   GLuint childBase = 0;
+   for( int childDim = dim; childDim > 1; childDim /= 2 )
+   {
+      const GLuint parentBase = childBase + levelCells( childDim );
+      glUniform1i( glGetUniformLocation( this->reduceProgram, "u_parentDim" ), childDim / 2 );
+      glUniform1ui( glGetUniformLocation( this->reduceProgram, "u_parentBase" ), parentBase );
+      glUniform1ui( glGetUniformLocation( this->reduceProgram, "u_childBase" ), childBase );
+      glDispatchCompute( ( levelCells( childDim / 2 ) + 255 ) / 256, 1, 1 );
+      glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+      childBase = parentBase;
+   }
+   glUseProgram( 0 );
+}
+
+void BoidGpuAggregates::bindForStep( GLuint program, float theta ) const
+{
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 5, this->gridBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 6, this->nodeBuffer );
+   glUniform1i( glGetUniformLocation( program, "u_aggDim" ), this->baseDim );
+   glUniform1i( glGetUniformLocation( program, "u_aggLevels" ), this->levels );
+   glUniform1i( glGetUniformLocation( program, "u_aggTopLevel" ), this->topLevel );
+   glUniform1f( glGetUniformLocation( program, "u_aggOrigin" ), this->origin );
+   glUniform1f( glGetUniformLocation( program, "u_aggCellSize" ), this->cellSize );
+   glUniform1f( glGetUniformLocation( program, "u_aggTheta" ), std::max( theta, 0.0f ) );
+}
+
+void BoidGpuAggregates::probeError( GLuint input, GLuint approxOutput, int sampleBoids, int workgroupSize )
+{
+   sampleBoids = std::min( sampleBoids, this->numBoids );
+   if( this->probeFence || sampleBoids <= 0 )
+      return;
+
+   // Threads of the last workgroup past the sample write too, so the scratch covers them
+   const int groups = ( sampleBoids + workgroupSize - 1 ) / workgroupSize;
+   if( groups * workgroupSize > this->probeCapacity || !this->probeStaging )
+   {
+      if( !this->probeScratch )
+      {
+         glGenBuffers( 1, &this->probeScratch );
+         glGenBuffers( 1, &this->probeStaging );
+      }
+      this->probeCapacity = std::max( groups * workgroupSize, this->probeCapacity );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, this->probeScratch );
+      glBufferData( GL_COPY_WRITE_BUFFER, static_cast< GLsizeiptr >( this->probeCapacity ) * sizeof( BoidGPU ), nullptr, GL_DYNAMIC_COPY );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, this->probeStaging );
+      glBufferData( GL_COPY_WRITE_BUFFER, 3 * static_cast< GLsizeiptr >( this->probeCapacity ) * sizeof( BoidGPU ), nullptr, GL_STREAM_READ );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   }
+
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, input );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, this->probeScratch );
+   glDispatchCompute( groups, 1, 1 );
+   glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+
+   const GLsizeiptr bytes = static_cast< GLsizeiptr >( sampleBoids ) * sizeof( BoidGPU );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, this->probeStaging );
+   const GLuint sources[3] = { input, approxOutput, this->probeScratch };
+   for( int k = 0; k < 3; ++k )
+   {
+      glBindBuffer( GL_COPY_READ_BUFFER, sources[k] );
+      glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, k * bytes, bytes );
+   }
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   this->probeSamples = sampleBoids;
+   this->probeFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+void BoidGpuAggregates::updateStats()
+{
+   if( !this->probeFence || glClientWaitSync( this->probeFence, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+      return;
+   glDeleteSync( this->probeFence );
+   this->probeFence = nullptr;
+
+   std::vector< BoidGPU > sample( 3 * static_cast< size_t >( this->probeSamples ) );
+   glBindBuffer( GL_COPY_READ_BUFFER, this->probeStaging );
+   glGetBufferSubData( GL_COPY_READ_BUFFER, 0, sample.size() * sizeof( BoidGPU ), sample.data() );
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+
+   const BoidGPU* before = sample.data();
+   BoidSteeringError e = BoidSteeringError::compute( before, before + this->probeSamples, before + 2 * this->probeSamples, this->probeSamples );
+   ++this->stats.probes;
+   this->stats.sampleBoids = static_cast< uint32_t >( this->probeSamples );
+   this->stats.rmsError = e.rms;
+   this->stats.maxError = e.max;
+}
+
+void BoidGpuAggregates::resetStats()
+{
+   if( this->probeFence )
+   {
+      // A comparison of the old swarm is of no interest any more
+      glDeleteSync( this->probeFence );
+      this->probeFence = nullptr;
+   }
+   BoidAggregateStats shape = this->stats;
+   this->stats = BoidAggregateStats();
+   this->stats.levels = shape.levels;
+   this->stats.baseDim = shape.baseDim;
+   this->stats.baseCellSize = shape.baseCellSize;
+}
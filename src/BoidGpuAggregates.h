@@ -0,0 +1,79 @@
+#pragma once
+
+#include "GLView.h"
+#include "BoidSwarmTypes.h"
+#include <cstdint>
+
+namespace Aftr
+{
+class BoidProgramCache;
+
+/**
+   Multi-resolution cell aggregates for the approximate flocking kernel (BOID_KF_AGGREGATES).
+
+   build(), issued before each approximate step, sorts the boids into a power-of-two grid
+   around the tank (count, scan, scatter) and sums count, position and velocity per cell, then
+   merges 2x2x2 cells level by level up to a single cell. The kernel walks the levels Barnes-Hut
+   style: near cells down to single boids, cells smaller than theta times their distance as one
+   pseudo-boid at their centroid. Separation stays exact; theta = 0 reproduces the exact kernel
+   up to summation order.
+
+   probeError() steps a sample of boids with the exact kernel from the same input and compares
+   the velocity change against the approximate step; the comparison is read back through a
+   fence and never stalls.
+
+   Bindings used by the flocking kernel: 5 level-0 grid, 6 aggregates.
+*/
+class BoidGpuAggregates
+{
+public:
+   ~BoidGpuAggregates();
+
+   void compileAsync( BoidProgramCache& cache );
+   void finish( BoidProgramCache& cache );
+   bool isReady() const { return this->reduceProgram != 0; }
+
+   /// Rebuilds every level from 'stateBuffer'
+   void build( GLuint stateBuffer, const BoidSwarmParams& params );
+   /// Binds the hierarchy and sets the kernel's traversal uniforms on 'program' (current program)
+   void bindForStep( GLuint program, float theta ) const;
+
+   /// Runs the current program, which must be the exact kernel with this step's uniforms set, for
+   /// the first 'sampleBoids' boids of 'input' and queues the comparison with 'approxOutput'.
+   /// Skipped while the previous comparison is still in flight.
+   void probeError( GLuint input, GLuint approxOutput, int sampleBoids, int workgroupSize );
+   /// Completes a queued comparison without stalling; call once per frame
+   void updateStats();
+   const BoidAggregateStats& getStats() const { return this->stats; }
+   void resetStats();
+
+   static constexpr int MAX_LEVELS = 8; // BOID_AGG_MAX_LEVELS in the kernel
+
+private:
+   void allocate( int numBoids, int baseDim );
+
+   GLuint clearProgram = 0;
+   GLuint countProgram = 0;
+   GLuint scanProgram = 0;
+   GLuint scatterProgram = 0;
+   GLuint baseProgram = 0;   // level 0 sums
+   GLuint reduceProgram = 0; // level l from level l - 1
+
+   GLuint gridBuffer = 0;    // level-0 cell starts, cursors, sorted boids, cell of each boid
+   GLuint nodeBuffer = 0;    // 2 vec4 per cell of every level
+   GLuint probeScratch = 0;  // exact kernel output for the sampled boids
+   GLuint probeStaging = 0;  // before | approximate | exact, sampleBoids each
+   GLsync probeFence = nullptr;
+   int probeSamples = 0;
+   int probeCapacity = 0;
+
+   int numBoids = 0;
+   int baseDim = 0;
+   int levels = 0;
+   int topLevel = 0;
+   float origin = 0.0f;
+   float cellSize = 1.0f;
+   BoidAggregateStats stats;
+};
+
+} //namespace Aftr
@@ -0,0 +1,127 @@
+#include "BoidGpuEventLog.h"
+#include "BoidEventStream.h"
+
+#include <algorithm>
+
+using namespace Aftr;
+
+namespace
+{
+   // count (atomic), capacity, padding to the std430 alignment of the records
+   constexpr GLsizeiptr HEADER_BYTES = 4 * sizeof( GLuint );
+}
+
+BoidGpuEventLog::~BoidGpuEventLog()
+{
+   this->release();
+}
+
+void BoidGpuEventLog::allocate( uint32_t capacity )
+{
+   this->cancel();
+   this->capacity = std::max( capacity, 1u );
+   const GLuint header[4] = { 0, this->capacity, 0, 0 };
+   for( Slot& s : this->slots )
+   {
+      if( !s.buffer )
+         glGenBuffers( 1, &s.buffer );
+      glBindBuffer( GL_SHADER_STORAGE_BUFFER, s.buffer );
+      glBufferData( GL_SHADER_STORAGE_BUFFER, HEADER_BYTES + static_cast< GLsizeiptr >( this->capacity ) * sizeof( BoidEvent ),
+                    nullptr, GL_DYNAMIC_READ );
+      glBufferSubData( GL_SHADER_STORAGE_BUFFER, 0, sizeof( header ), header );
+   }
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+   this->active = 0;
+}
+
+void BoidGpuEventLog::release()
+{
+   this->cancel();
+   for( Slot& s : this->slots )
+      if( s.buffer )
+      {
+         glDeleteBuffers( 1, &s.buffer );
+         s.buffer = 0;
+      }
+   this->capacity = 0;
+}
+
+void BoidGpuEventLog::bindForStep() const
+{
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, BINDING, this->slots[this->active].buffer );
+}
+
+void BoidGpuEventLog::activate( int slot )
+{
+   this->active = slot;
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->slots[slot].buffer );
+   glClearBufferSubData( GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof( GLuint ), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+}
+
+void BoidGpuEventLog::submit()
+{
+   if( !this->isReady() )
+      return;
+   const int next = ( this->active + 1 ) % NUM_SLOTS;
+   if( this->slots[next].fence )
+      return; // the drain is behind: keep appending to the active batch
+
+   // Reads through glGetBufferSubData / glMapBufferRange must see the kernel's writes
+   glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+   this->slots[this->active].fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   this->activate( next );
+}
+
+void BoidGpuEventLog::drain( BoidEventStream& stream )
+{
+   // Pending batches follow the active slot in submission order
+   for( int k = 1; k < NUM_SLOTS; ++k )
+   {
+      Slot& s = this->slots[( this->active + k ) % NUM_SLOTS];
+      if( !s.fence )
+         continue;
+      GLenum status = glClientWaitSync( s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+      if( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED )
+         return;
+      glDeleteSync( s.fence );
+      s.fence = nullptr;
+
+      GLuint recorded = 0;
+      glBindBuffer( GL_COPY_READ_BUFFER, s.buffer );
+      glGetBufferSubData( GL_COPY_READ_BUFFER, 0, sizeof( recorded ), &recorded );
+      const uint32_t kept = std::min( recorded, this->capacity );
+      if( kept > 0 )
+      {
+         void* ptr = glMapBufferRange( GL_COPY_READ_BUFFER, HEADER_BYTES, static_cast< GLsizeiptr >( kept ) * sizeof( BoidEvent ), GL_MAP_READ_BIT );
+         if( ptr )
+         {
+            stream.append( static_cast< const BoidEvent* >( ptr ), kept, recorded - kept );
+            glUnmapBuffer( GL_COPY_READ_BUFFER );
+         }
+      }
+      else
+         stream.append( nullptr, 0, recorded );
+      glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   }
+}
+
+void BoidGpuEventLog::cancel()
+{
+   for( Slot& s : this->slots )
+      if( s.fence )
+      {
+         glDeleteSync( s.fence );
+         s.fence = nullptr;
+      }
+   if( this->isReady() )
+      this->activate( this->active );
+}
+
+int BoidGpuEventLog::getNumPending() const
+{
+   int n = 0;
+   for( const Slot& s : this->slots )
+      n += s.fence ? 1 : 0;
+   return n;
+}
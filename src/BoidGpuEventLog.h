@@ -0,0 +1,58 @@
+#pragma once
+
+#include "GLView.h"
+#include <cstdint>
+
+namespace Aftr
+{
+class BoidEventStream;
+
+/**
+   GPU append log of the flocking kernel's discrete events (eats, respawns, predator retargets;
+   see BoidEventType), for the BOID_KF_EVENTS variant.
+
+   The log is a small ring of SSBOs, each a 16 byte header (atomic event count, capacity) and
+   'capacity' BoidEvent records. The kernel appends to the active one with atomicAdd and drops
+   what no longer fits while still counting it. submit() closes the active batch with a fence
+   and makes the next free SSBO active; drain() hands every batch whose fence has passed to a
+   BoidEventStream, mapping only the recorded range, and never waits. If all SSBOs are still
+   waiting to be drained the active one simply keeps collecting, so events stay in order.
+*/
+class BoidGpuEventLog
+{
+public:
+   static constexpr int NUM_SLOTS = 3;
+   static constexpr GLuint BINDING = 8;
+
+   ~BoidGpuEventLog();
+
+   /// (Re)creates the SSBOs for up to 'capacity' events per batch; pending batches are dropped
+   void allocate( uint32_t capacity );
+   void release();
+   bool isReady() const { return this->slots[0].buffer != 0; }
+   uint32_t getCapacity() const { return this->capacity; }
+
+   /// Binds the active SSBO for the next dispatches of the events kernel
+   void bindForStep() const;
+   /// Closes the active batch (everything dispatched so far) unless no SSBO is free to take over
+   void submit();
+   /// Moves the landed batches into 'stream', oldest first
+   void drain( BoidEventStream& stream );
+   /// Drops the recorded and pending events, e.g. after a reset
+   void cancel();
+   int getNumPending() const;
+
+private:
+   struct Slot
+   {
+      GLuint buffer = 0;
+      GLsync fence = nullptr;  // set while the batch waits to be drained
+   };
+   void activate( int slot );
+
+   Slot slots[NUM_SLOTS];
+   int active = 0;
+   uint32_t capacity = 0;
+};
+
+} //namespace Aftr
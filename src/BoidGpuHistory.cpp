@@ -0,0 +1,269 @@
+#include "BoidGpuHistory.h"
+#include "BoidProgramCache.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace Aftr;
+
+namespace
+{
+   constexpr GLsizeiptr RECORD_BYTES = 4 * sizeof( GLuint );
+
+   // Record and restore; BOID_HISTORY_PASS selects one (see BoidGpuHistory)
+   const char* historyShaderSource = R"(
+#version 430
+#ifndef BOID_HISTORY_PASS
+#define BOID_HISTORY_PASS 0
+#endif
+layout(local_size_x = 256) in;
+
+struct BoidData {
+    vec4 pos; // w = type (0 boid, 1 predator)
+    vec4 vel; // w = predator target or LOD state, an integer below 2^23
+};
+
+// x = pos.xy, y = (pos.z, vel.x), z = vel.yz as halves; w = vel.w | trail run << 23 | predator << 31
+layout(std430, binding = 1) buffer History { uvec4 history[]; };
+
+uniform uint  u_numEntities;
+uniform uint  u_slot;
+
+#if BOID_HISTORY_PASS == 0
+layout(std430, binding = 0) readonly buffer BoidInput { BoidData boids[]; };
+uniform uint  u_prevSlot;
+uniform int   u_hasPrev;
+uniform float u_snapDistance;
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_numEntities) return;
+    vec3 p = boids[i].pos.xyz;
+    vec3 v = boids[i].vel.xyz;
+
+    // Frames in a row without a jump, i.e. how far back this entity's trail may reach
+    uint run = 0u;
+    if (u_hasPrev != 0) {
+        uvec4 prev = history[u_prevSlot * u_numEntities + i];
+        vec3 prevPos = vec3(unpackHalf2x16(prev.x), unpackHalf2x16(prev.y).x);
+        if (distance(prevPos, p) < u_snapDistance)
+            run = min(((prev.w >> 23) & 0xFFu) + 1u, 255u);
+    }
+    uint w = (uint(max(boids[i].vel.w, 0.0)) & 0x7FFFFFu) | (run << 23) | (boids[i].pos.w > 0.5 ? 0x80000000u : 0u);
+    history[u_slot * u_numEntities + i] = uvec4(packHalf2x16(p.xy), packHalf2x16(vec2(p.z, v.x)), packHalf2x16(v.yz), w);
+}
+#else
+layout(std430, binding = 0) writeonly buffer BoidOutput { BoidData boidsOut[]; };
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_numEntities) return;
+    uvec4 h = history[u_slot * u_numEntities + i];
+    vec2 zx = unpackHalf2x16(h.y);
+    boidsOut[i].pos = vec4(unpackHalf2x16(h.x), zx.x, (h.w >> 31) != 0u ? 1.0 : 0.0);
+    boidsOut[i].vel = vec4(zx.y, unpackHalf2x16(h.z), float(h.w & 0x7FFFFFu));
+}
+#endif
+)";
+
+   const char* trailVertexShaderSource = R"(
+#version 430
+
+layout(std430, binding = 1) readonly buffer History { uvec4 history[]; };
+
+uniform mat4  u_view;
+uniform mat4  u_proj;
+uniform int   u_numEntities;
+uniform int   u_numSlots;
+uniform int   u_newestSlot;
+uniform int   u_length;
+uniform int   u_instanceOffset;
+uniform float u_opacity;
+
+out vec4 vColor;
+
+vec3 recordedPos(int age, int entity) {
+    uvec4 h = history[((u_newestSlot - age + u_numSlots) % u_numSlots) * u_numEntities + entity];
+    return vec3(unpackHalf2x16(h.x), unpackHalf2x16(h.y).x);
+}
+
+void main() {
+    int entity = gl_InstanceID + u_instanceOffset;
+    uvec4 newest = history[u_newestSlot * u_numEntities + entity];
+
+    // Past a respawn the strip collapses onto its last vertex
+    int age = min(gl_VertexID, int((newest.w >> 23) & 0xFFu));
+    gl_Position = u_proj * u_view * vec4(recordedPos(age, entity), 1.0);
+
+    // Same colors as the boid draw, fading out towards the oldest frame
+    vec3 color = (newest.w >> 31) != 0u ? vec3(0.85, 0.15, 0.15) : vec3(0.0, 0.7, 0.85);
+    vColor = vec4(color, u_opacity * (1.0 - float(gl_VertexID) / float(max(u_length, 1))));
+}
+)";
+
+   const char* trailFragmentShaderSource = R"(
+#version 430
+
+in vec4 vColor;
+out vec4 FragColor;
+
+void main() {
+    FragColor = vColor;
+}
+)";
+
+   std::string passSource( int pass )
+   {
+      std::string src( historyShaderSource );
+      size_t lineEnd = src.find( '\n', src.find( "#version" ) );
+      return src.insert( lineEnd + 1, "#define BOID_HISTORY_PASS " + std::to_string( pass ) + "\n" );
+   }
+}
+
+BoidGpuHistory::~BoidGpuHistory()
+{
+   for( GLuint p : { recordProgram, restoreProgram, trailProgram } )
+      if( p )
+         glDeleteProgram( p );
+   if( historyBuffer )
+      glDeleteBuffers( 1, &historyBuffer );
+   if( trailVAO )
+      glDeleteVertexArrays( 1, &trailVAO );
+}
+
+void BoidGpuHistory::compileAsync( BoidProgramCache& cache )
+{
+   this->recordProgram = cache.compileAsync( { { GL_COMPUTE_SHADER, passSource( 0 ) } }, "boid history record" );
+   this->restoreProgram = cache.compileAsync( { { GL_COMPUTE_SHADER, passSource( 1 ) } }, "boid history restore" );
+   this->trailProgram = cache.compileAsync( { { GL_VERTEX_SHADER, trailVertexShaderSource },
+                                              { GL_FRAGMENT_SHADER, trailFragmentShaderSource } }, "boid trails" );
+}
+
+void BoidGpuHistory::finish( BoidProgramCache& cache )
+{
+   this->recordProgram = cache.finish( this->recordProgram );
+   this->restoreProgram = cache.finish( this->restoreProgram );
+   this->trailProgram = cache.finish( this->trailProgram );
+   if( !this->recordProgram || !this->restoreProgram || !this->trailProgram )
+   {
+      // All or nothing: isReady() keys off the trail program
+      for( GLuint* p : { &this->recordProgram, &this->restoreProgram, &this->trailProgram } )
+         if( *p )
+         {
+            glDeleteProgram( *p );
+            *p = 0;
+         }
+   }
+}
+
+void BoidGpuHistory::allocate( int numSlots, int numEntities )
+{
+   numSlots = std::max( numSlots, 2 );
+   numEntities = std::max( numEntities, 1 );
+   if( !this->historyBuffer )
+      glGenBuffers( 1, &this->historyBuffer );
+   const GLsizeiptr bytes = static_cast< GLsizeiptr >( numSlots ) * numEntities * RECORD_BYTES;
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->historyBuffer );
+   glBufferData( GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_COPY );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+
+   this->numSlots = numSlots;
+   this->numEntities = numEntities;
+   this->slotFrame.assign( numSlots, 0 );
+   this->slotSteps.assign( numSlots, 0 );
+   this->clear();
+   this->stats.numSlots = numSlots;
+   this->stats.numEntities = numEntities;
+   this->stats.bytes = static_cast< uint64_t >( bytes );
+}
+
+void BoidGpuHistory::clear()
+{
+   this->head = 0;
+   this->filled = 0;
+   this->stats.filled = 0;
+   this->stats.viewedStep = 0;
+}
+
+void BoidGpuHistory::record( GLuint state, int frame, int steps, float snapDistance )
+{
+   if( !this->isReady() || !this->historyBuffer )
+      return;
+   const int prev = this->head;
+   this->head = this->filled > 0 ? ( this->head + 1 ) % this->numSlots : 0;
+
+   glUseProgram( this->recordProgram );
+   glUniform1ui( glGetUniformLocation( this->recordProgram, "u_numEntities" ), static_cast< GLuint >( this->numEntities ) );
+   glUniform1ui( glGetUniformLocation( this->recordProgram, "u_slot" ), static_cast< GLuint >( this->head ) );
+   glUniform1ui( glGetUniformLocation( this->recordProgram, "u_prevSlot" ), static_cast< GLuint >( prev ) );
+   glUniform1i( glGetUniformLocation( this->recordProgram, "u_hasPrev" ), this->filled > 0 ? 1 : 0 );
+   glUniform1f( glGetUniformLocation( this->recordProgram, "u_snapDistance" ), snapDistance );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, state );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, this->historyBuffer );
+   glDispatchCompute( ( static_cast< GLuint >( this->numEntities ) + 255 ) / 256, 1, 1 );
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT ); // next record and this frame's trails read the slot
+   glUseProgram( 0 );
+
+   this->slotFrame[this->head] = frame;
+   this->slotSteps[this->head] = steps;
+   this->filled = std::min( this->filled + 1, this->numSlots );
+   this->stats.filled = this->filled;
+   ++this->stats.framesRecorded;
+}
+
+bool BoidGpuHistory::restore( int framesBack, GLuint dst )
+{
+   if( !this->isReady() || framesBack < 0 || framesBack >= this->filled )
+      return false;
+   glUseProgram( this->restoreProgram );
+   glUniform1ui( glGetUniformLocation( this->restoreProgram, "u_numEntities" ), static_cast< GLuint >( this->numEntities ) );
+   glUniform1ui( glGetUniformLocation( this->restoreProgram, "u_slot" ), static_cast< GLuint >( this->slotOf( framesBack ) ) );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, dst );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, this->historyBuffer );
+   glDispatchCompute( ( static_cast< GLuint >( this->numEntities ) + 255 ) / 256, 1, 1 );
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+   glUseProgram( 0 );
+   this->stats.viewedStep = this->getSteps( framesBack );
+   return true;
+}
+
+void BoidGpuHistory::truncate( int framesBack )
+{
+   framesBack = std::clamp( framesBack, 0, std::max( this->filled - 1, 0 ) );
+   this->head = this->slotOf( framesBack );
+   this->filled -= framesBack;
+   this->stats.filled = this->filled;
+}
+
+void BoidGpuHistory::drawTrails( const float* view, const float* proj, int first, int count, int length, int framesBack, float opacity )
+{
+   length = std::min( { length, MAX_TRAIL + 1, this->filled - framesBack } );
+   if( !this->isReady() || length < 2 || count <= 0 || first + count > this->numEntities )
+      return;
+   if( !this->trailVAO )
+      glGenVertexArrays( 1, &this->trailVAO );
+
+   glUseProgram( this->trailProgram );
+   glUniformMatrix4fv( glGetUniformLocation( this->trailProgram, "u_view" ), 1, GL_FALSE, view );
+   glUniformMatrix4fv( glGetUniformLocation( this->trailProgram, "u_proj" ), 1, GL_FALSE, proj );
+   glUniform1i( glGetUniformLocation( this->trailProgram, "u_numEntities" ), this->numEntities );
+   glUniform1i( glGetUniformLocation( this->trailProgram, "u_numSlots" ), this->numSlots );
+   glUniform1i( glGetUniformLocation( this->trailProgram, "u_newestSlot" ), this->slotOf( framesBack ) );
+   glUniform1i( glGetUniformLocation( this->trailProgram, "u_length" ), length );
+   glUniform1i( glGetUniformLocation( this->trailProgram, "u_instanceOffset" ), first );
+   glUniform1f( glGetUniformLocation( this->trailProgram, "u_opacity" ), opacity );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, this->historyBuffer );
+
+   // Translucent and behind the boids: blend without writing depth
+   const GLboolean blend = glIsEnabled( GL_BLEND );
+   glEnable( GL_BLEND );
+   glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+   glDepthMask( GL_FALSE );
+   glBindVertexArray( this->trailVAO );
+   glDrawArraysInstanced( GL_LINE_STRIP, 0, length, count );
+   glBindVertexArray( 0 );
+   glDepthMask( GL_TRUE );
+   if( !blend )
+      glDisable( GL_BLEND );
+   glUseProgram( 0 );
+}
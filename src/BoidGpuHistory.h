@@ -0,0 +1,76 @@
+#pragma once
+
+#include "GLView.h"
+#include "BoidSwarmTypes.h"
+#include <vector>
+
+namespace Aftr
+{
+class BoidProgramCache;
+
+/**
+   GPU-resident ring of the last K frames of the swarm, for motion trails and rewind.
+
+   record() packs a state buffer into the next slot with a compute pass: 16 bytes per entity
+   (half precision position and velocity, vel.w and the entity type), half the size of a
+   BoidGPU, so the ring costs K x N x 16 bytes and never touches the CPU. Each record also
+   carries how many consecutive frames the entity has moved less than the snap distance, so
+   trails stop at respawns instead of streaking across the tank. drawTrails() draws one
+   instanced line strip per entity straight from the ring, and restore() unpacks a recorded
+   frame into a state buffer from which the simulation can continue.
+
+   Frame numbers and step counts of the recorded frames are kept on the CPU, so a rewound
+   simulation replays the same noise and LOD schedule.
+*/
+class BoidGpuHistory
+{
+public:
+   static constexpr int MAX_TRAIL = 255; // range of the per-record trail run length
+
+   ~BoidGpuHistory();
+
+   void compileAsync( BoidProgramCache& cache );
+   void finish( BoidProgramCache& cache );
+   bool isReady() const { return this->trailProgram != 0; }
+
+   /// (Re)sizes the ring for 'numSlots' frames of 'numEntities' and forgets the recorded frames
+   void allocate( int numSlots, int numEntities );
+   void clear();
+   int getNumSlots() const { return this->numSlots; }
+   int getNumEntities() const { return this->numEntities; }
+   int getFilled() const { return this->filled; }
+
+   /// Packs 'state' (BoidGPU layout, shader writes already visible) into the next slot
+   void record( GLuint state, int frame, int steps, float snapDistance );
+   /// Unpacks the frame 'framesBack' before the newest into 'dst'; false if there is no such frame
+   bool restore( int framesBack, GLuint dst );
+   /// Drops the frames newer than 'framesBack', so recording continues after it
+   void truncate( int framesBack );
+   int getFrame( int framesBack ) const { return this->slotFrame[this->slotOf( framesBack )]; }
+   int getSteps( int framesBack ) const { return this->slotSteps[this->slotOf( framesBack )]; }
+
+   /// Line strips through the 'length' frames ending 'framesBack' before the newest, for entities
+   /// [first, first + count); fades towards the oldest frame
+   void drawTrails( const float* view, const float* proj, int first, int count, int length, int framesBack, float opacity );
+
+   const BoidHistoryStats& getStats() const { return this->stats; }
+
+private:
+   int slotOf( int framesBack ) const { return ( this->head - framesBack + this->numSlots ) % this->numSlots; }
+
+   GLuint recordProgram = 0;
+   GLuint restoreProgram = 0;
+   GLuint trailProgram = 0;
+   GLuint historyBuffer = 0;
+   GLuint trailVAO = 0;     // attribute-less: the trail shader reads the ring
+
+   int numSlots = 0;
+   int numEntities = 0;
+   int head = 0;            // newest recorded slot
+   int filled = 0;
+   std::vector< int > slotFrame;
+   std::vector< int > slotSteps;
+   BoidHistoryStats stats;
+};
+
+} //namespace Aftr
@@ -0,0 +1,208 @@
+#include "BoidGpuLod.h"
+#include "BoidProgramCache.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace Aftr;
+
+namespace
+{
+   constexpr GLuint HEADER_UINTS = 8; // count, 3 dispatch args, 4 tier counts
+   constexpr GLintptr DISPATCH_ARGS = sizeof( GLuint );
+
+   // Both passes; BOID_LOD_PASS selects one (see BoidGpuLod)
+   const char* lodShaderSource = R"(
+#version 430
+#ifndef BOID_LOD_PASS
+#define BOID_LOD_PASS 0
+#endif
+#if BOID_LOD_PASS == 0
+layout(local_size_x = 256) in;
+#else
+layout(local_size_x = 1) in;
+#endif
+
+struct BoidData {
+    vec4 pos;
+    vec4 vel; // w of a boid: (last update step << 2) | tier, see the flocking kernel
+};
+
+layout(std430, binding = 0) readonly  buffer BoidInput  { BoidData boidsIn[];  };
+layout(std430, binding = 1) writeonly buffer BoidOutput { BoidData boidsOut[]; };
+layout(std430, binding = 4) buffer LodData { uint lod[]; }; // count | dispatch args | per tier | active list
+
+uniform uint u_numBoids;
+uniform uint u_numEntities;
+uniform uint u_frame;
+uniform uint u_workgroupSize;
+
+#if BOID_LOD_PASS == 0
+// List the due entities; the rest coast
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_numEntities) return;
+    bool due = true;
+    if (i < u_numBoids) {
+        uint state = uint(boidsIn[i].vel.w);
+        uint tier = state & 3u;
+        uint period = 1u << tier;
+        uint elapsed = (u_frame - (state >> 2)) & 0x1FFFFFu;
+        due = elapsed >= period || ((u_frame + i) & (period - 1u)) == 0u;
+        atomicAdd(lod[4u + tier], 1u);
+    }
+    if (due) {
+        lod[8u + atomicAdd(lod[0], 1u)] = i;
+    } else {
+        boidsOut[i].pos = vec4(boidsIn[i].pos.xyz + boidsIn[i].vel.xyz, boidsIn[i].pos.w);
+        boidsOut[i].vel = boidsIn[i].vel;
+    }
+}
+#else
+// Dispatch size of the kernel over the list
+void main() {
+    lod[1] = (lod[0] + u_workgroupSize - 1u) / u_workgroupSize;
+    lod[2] = 1u;
+    lod[3] = 1u;
+}
+#endif
+)";
+
+   std::string passSource( int pass )
+   {
+      std::string src( lodShaderSource );
+      size_t lineEnd = src.find( '\n', src.find( "#version" ) );
+      return src.insert( lineEnd + 1, "#define BOID_LOD_PASS " + std::to_string( pass ) + "\n" );
+   }
+}
+
+BoidGpuLod::~BoidGpuLod()
+{
+   for( GLuint p : { classifyProgram, argsProgram } )
+      if( p )
+         glDeleteProgram( p );
+   for( GLuint b : { lodBuffer, statsStaging } )
+      if( b )
+         glDeleteBuffers( 1, &b );
+   if( statsFence )
+      glDeleteSync( statsFence );
+}
+
+void BoidGpuLod::compileAsync( BoidProgramCache& cache )
+{
+   this->classifyProgram = cache.compileAsync( { { GL_COMPUTE_SHADER, passSource( 0 ) } }, "boid lod classify" );
+   this->argsProgram = cache.compileAsync( { { GL_COMPUTE_SHADER, passSource( 1 ) } }, "boid lod args" );
+}
+
+void BoidGpuLod::finish( BoidProgramCache& cache )
+{
+   this->classifyProgram = cache.finish( this->classifyProgram );
+   this->argsProgram = cache.finish( this->argsProgram );
+   if( !this->classifyProgram || !this->argsProgram )
+   {
+      // All or nothing: isReady() keys off the args pass
+      for( GLuint* p : { &this->classifyProgram, &this->argsProgram } )
+         if( *p )
+         {
+            glDeleteProgram( *p );
+            *p = 0;
+         }
+   }
+}
+
+void BoidGpuLod::classify( GLuint input, GLuint output, const BoidSwarmParams& params, int frame, int workgroupSize )
+{
+   if( !this->isReady() )
+      return;
+   this->numBoids = params.numBoids;
+   this->numEntities = params.numBoids + params.numPredators;
+   if( !this->lodBuffer || this->numEntities > this->capacity )
+   {
+      if( !this->lodBuffer )
+         glGenBuffers( 1, &this->lodBuffer );
+      this->capacity = std::max( this->numEntities, 1 );
+      glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->lodBuffer );
+      glBufferData( GL_SHADER_STORAGE_BUFFER, ( HEADER_UINTS + this->capacity ) * sizeof( GLuint ), nullptr, GL_DYNAMIC_COPY );
+      glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+   }
+
+   const GLuint zero = 0;
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->lodBuffer );
+   glClearBufferSubData( GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, HEADER_UINTS * sizeof( GLuint ), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, input );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, output );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 4, this->lodBuffer );
+
+   GLuint programs[2] = { this->classifyProgram, this->argsProgram };
+   GLuint groups[2] = { ( static_cast< GLuint >( this->numEntities ) + 255 ) / 256, 1 };
+   for( int k = 0; k < 2; ++k )
+   {
+      glUseProgram( programs[k] );
+      glUniform1ui( glGetUniformLocation( programs[k], "u_numBoids" ), static_cast< GLuint >( this->numBoids ) );
+      glUniform1ui( glGetUniformLocation( programs[k], "u_numEntities" ), static_cast< GLuint >( this->numEntities ) );
+      glUniform1ui( glGetUniformLocation( programs[k], "u_frame" ), static_cast< GLuint >( frame ) );
+      glUniform1ui( glGetUniformLocation( programs[k], "u_workgroupSize" ), static_cast< GLuint >( workgroupSize ) );
+      if( groups[k] )
+         glDispatchCompute( groups[k], 1, 1 );
+      glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT );
+   }
+   glUseProgram( 0 );
+}
+
+void BoidGpuLod::bindForStep( GLuint program, const Vector& cameraPos, const BoidLodSettings& settings ) const
+{
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 4, this->lodBuffer );
+   glUniform3f( glGetUniformLocation( program, "u_cameraPos" ), cameraPos.x, cameraPos.y, cameraPos.z );
+   glUniform1f( glGetUniformLocation( program, "u_lodNearDistance" ), std::max( settings.nearDistance, 0.001f ) );
+   glUniform1f( glGetUniformLocation( program, "u_lodPredatorRadius" ), settings.predatorRadius );
+   glUniform1f( glGetUniformLocation( program, "u_lodCalmSpeed" ), settings.calmSpeed );
+   glUniform1i( glGetUniformLocation( program, "u_lodMaxTier" ), std::clamp( settings.maxTier, 0, 3 ) );
+}
+
+void BoidGpuLod::dispatch() const
+{
+   glBindBuffer( GL_DISPATCH_INDIRECT_BUFFER, this->lodBuffer );
+   glDispatchComputeIndirect( DISPATCH_ARGS );
+   glBindBuffer( GL_DISPATCH_INDIRECT_BUFFER, 0 );
+}
+
+void BoidGpuLod::updateStats( int intervalFrames )
+{
+   if( !this->lodBuffer )
+      return;
+   if( this->statsFence )
+   {
+      if( glClientWaitSync( this->statsFence, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+         return;
+      glDeleteSync( this->statsFence );
+      this->statsFence = nullptr;
+
+      GLuint h[HEADER_UINTS];
+      glBindBuffer( GL_COPY_READ_BUFFER, this->statsStaging );
+      glGetBufferSubData( GL_COPY_READ_BUFFER, 0, sizeof( h ), h );
+      glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+      this->stats.activeEntities = h[0];
+      std::copy( h + 4, h + 8, this->stats.tierCounts );
+      this->stats.numEntities = static_cast< uint32_t >( this->numEntities );
+      return;
+   }
+   if( ++this->framesSinceStats < intervalFrames )
+      return;
+   this->framesSinceStats = 0;
+
+   if( !this->statsStaging )
+   {
+      glGenBuffers( 1, &this->statsStaging );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, this->statsStaging );
+      glBufferData( GL_COPY_WRITE_BUFFER, HEADER_UINTS * sizeof( GLuint ), nullptr, GL_STREAM_READ );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   }
+   glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+   glBindBuffer( GL_COPY_READ_BUFFER, this->lodBuffer );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, this->statsStaging );
+   glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, HEADER_UINTS * sizeof( GLuint ) );
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   this->statsFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "GLView.h"
+#include "BoidSwarmTypes.h"
+#include "Vector.h"
+#include <cstdint>
+
+namespace Aftr
+{
+class BoidProgramCache;
+
+/// Tier thresholds of the simulation LOD
+struct BoidLodSettings
+{
+   float nearDistance = 40.0f;   // camera distance of full rate; every doubling drops a tier
+   float predatorRadius = 15.0f; // boids this close to a predator run at full rate
+   float calmSpeed = 0.05f;      // velocity deviation from the neighbors that still counts as calm
+   int maxTier = 3;              // 0 = LOD off in effect, 3 = down to every 8th step
+};
+
+/**
+   Simulation level of detail for the flocking kernel (BOID_KF_LOD).
+
+   Every boid carries an update tier and the step it was last updated at, packed into vel.w.
+   classify(), issued before each step, lists the boids due this step (every 2^tier steps,
+   staggered by index) plus all predators, and lets the others coast on their velocity. The
+   kernel is then dispatched indirectly over that list only; it integrates the steering with
+   the true number of steps since the boid's last update and picks the boid's next tier from
+   camera distance, predator proximity and how far its velocity deviates from its neighbors'.
+   Positions move every step and velocity changes never skip time, so tier changes do not pop.
+
+   Bindings used by the flocking kernel: 4 active list.
+*/
+class BoidGpuLod
+{
+public:
+   ~BoidGpuLod();
+
+   void compileAsync( BoidProgramCache& cache );
+   void finish( BoidProgramCache& cache );
+   bool isReady() const { return this->argsProgram != 0; }
+
+   /// Lists the entities due this step and writes the coasting ones straight to 'output'
+   void classify( GLuint input, GLuint output, const BoidSwarmParams& params, int frame, int workgroupSize );
+   /// Binds the list and sets the kernel's LOD uniforms on 'program' (current program)
+   void bindForStep( GLuint program, const Vector& cameraPos, const BoidLodSettings& settings ) const;
+   /// Dispatches the current program over the listed entities
+   void dispatch() const;
+
+   /// Copies the counters back every 'intervalFrames' frames without stalling; call once per frame
+   void updateStats( int intervalFrames = 30 );
+   const BoidLodStats& getStats() const { return this->stats; }
+
+private:
+   GLuint classifyProgram = 0;
+   GLuint argsProgram = 0;
+
+   GLuint lodBuffer = 0;    // active count, dispatch size, boids per tier, then the active list
+   GLuint statsStaging = 0;
+   GLsync statsFence = nullptr;
+   int framesSinceStats = 0;
+   int capacity = 0;
+   int numBoids = 0;
+   int numEntities = 0;
+   BoidLodStats stats;
+};
+
+} //namespace Aftr
@@ -0,0 +1,457 @@
+#include "BoidGpuNeighborList.h"
+#include "BoidProgramCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+using namespace Aftr;
+
+namespace
+{
+   // Control block layout (uints)
+   constexpr GLuint CTRL_MOVED = 0;
+   constexpr GLuint CTRL_STEPS = 2;
+   constexpr GLuint CTRL_OCCUPIED = 7;
+   constexpr GLuint CTRL_PROBE = 17;
+   constexpr GLuint CTRL_COUNT = 20;
+   constexpr GLintptr BOID_ARGS = 8 * sizeof( GLuint );
+   constexpr GLintptr CELL_ARGS = 11 * sizeof( GLuint );
+   constexpr GLintptr SCAN_ARGS = 14 * sizeof( GLuint );
+
+   constexpr int MAX_GRID_DIM = 64;
+
+   // All build passes; BOID_NL_PASS selects one (see BoidGpuNeighborList)
+   const char* neighborListShaderSource = R"(
+#version 430
+#ifndef BOID_NL_PASS
+#define BOID_NL_PASS 0
+#endif
+#if BOID_NL_PASS == 0
+layout(local_size_x = 1) in;
+#elif BOID_NL_PASS == 3
+layout(local_size_x = 1024) in;
+#else
+layout(local_size_x = 256) in;
+#endif
+
+struct BoidData {
+    vec4 pos;
+    vec4 vel;
+};
+
+layout(std430, binding = 0) readonly buffer BoidInput { BoidData boids[]; };
+layout(std430, binding = 3) buffer NeighborGrid { uint grid[]; };           // starts | cursors | sorted | cell of boid | keys
+layout(std430, binding = 5) buffer NeighborList { uint neighborData[]; };   // counts | indices
+layout(std430, binding = 6) buffer NeighborRef  { vec4 refPos[]; };
+layout(std430, binding = 7) buffer NeighborControl { uint ctrl[]; };
+
+uniform uint  u_numBoids;
+uniform uint  u_numCells;
+uniform int   u_gridDim;
+uniform float u_gridOrigin;
+uniform float u_invCellSize;
+uniform float u_listRadiusSq;
+uniform uint  u_maxNeighbors;
+uniform uint  u_force;
+uniform uint  u_hashed;         // cells are table slots (see BoidHashGrid)
+
+uint cursorBase() { return u_numCells + 1u; }
+uint sortedBase() { return 2u * u_numCells + 1u; }
+uint cellOfBase() { return 2u * u_numCells + 1u + u_numBoids; }
+
+ivec3 cellCoords(vec3 p) {
+    return clamp(ivec3(floor((p - vec3(u_gridOrigin)) * u_invCellSize)), ivec3(0), ivec3(u_gridDim - 1));
+}
+uint cellIndex(ivec3 c) { return uint((c.z * u_gridDim + c.y) * u_gridDim + c.x); }
+
+// Hashed grid: unbounded cell coordinates, packed and hashed exactly as BoidHashGrid does
+const uint EMPTY_KEY = 0xFFFFFFFFu;
+uint keysBase() { return 2u * u_numCells + 1u + 2u * u_numBoids; }
+ivec3 hashCoords(vec3 p) { return ivec3(floor(p * u_invCellSize)); }
+uint packKey(ivec3 c) {
+    uvec3 u = uvec3(c) & uvec3(2047u, 2047u, 511u);
+    return u.x | (u.y << 11) | (u.z << 22);
+}
+uint hashKey(uint x) {
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+#if BOID_NL_PASS == 0
+// Decide: rebuild when forced or when the last step moved some boid more than skin/2
+void main() {
+    bool rebuild = u_force != 0u || ctrl[0] != 0u;
+    ctrl[0] = 0u;
+    ctrl[1] = rebuild ? 1u : 0u;
+    ctrl[2] += 1u;
+    if (rebuild) {
+        ctrl[3] += 1u;
+        ctrl[4] = 0u;
+        ctrl[5] = 0u;
+        ctrl[6] = 0u;
+        ctrl[7] = 0u;
+        ctrl[17] = 0u;
+    }
+    ctrl[8]  = rebuild ? (u_numBoids + 255u) / 256u : 0u; ctrl[9]  = 1u; ctrl[10] = 1u;
+    ctrl[11] = rebuild ? (u_numCells + 255u) / 256u : 0u; ctrl[12] = 1u; ctrl[13] = 1u;
+    ctrl[14] = rebuild ? 1u : 0u;                         ctrl[15] = 1u; ctrl[16] = 1u;
+}
+#elif BOID_NL_PASS == 1
+// Clear the per-cell counters (and the table)
+void main() {
+    uint c = gl_GlobalInvocationID.x;
+    if (c >= u_numCells) return;
+    grid[cursorBase() + c] = 0u;
+    if (u_hashed != 0u)
+        grid[keysBase() + c] = EMPTY_KEY;
+}
+#elif BOID_NL_PASS == 2
+// Bin every boid and remember where it was at this build
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_numBoids) return;
+    vec3 p = boids[i].pos.xyz;
+    refPos[i] = vec4(p, 0.0);
+    uint c;
+    if (u_hashed != 0u) {
+        // Claim the cell's slot or find it claimed; the table is at most half full
+        uint key = packKey(hashCoords(p));
+        uint mask = u_numCells - 1u;
+        c = hashKey(key) & mask;
+        uint probes = 1u;
+        for (; probes <= u_numCells; ++probes) {
+            uint prev = atomicCompSwap(grid[keysBase() + c], EMPTY_KEY, key);
+            if (prev == EMPTY_KEY || prev == key)
+                break;
+            c = (c + 1u) & mask;
+        }
+        atomicMax(ctrl[17], probes);
+    } else
+        c = cellIndex(cellCoords(p));
+    grid[cellOfBase() + i] = c;
+    if (atomicAdd(grid[cursorBase() + c], 1u) == 0u)
+        atomicAdd(ctrl[7], 1u);
+}
+#elif BOID_NL_PASS == 3
+// Exclusive scan of the counts into the cell starts (one workgroup, a run of cells per
+// thread); the cursors restart at the starts for the scatter
+shared uint partial[1024];
+void main() {
+    uint t = gl_LocalInvocationID.x;
+    uint per = (u_numCells + 1023u) / 1024u;
+    uint first = min(t * per, u_numCells);
+    uint last = min(first + per, u_numCells);
+    uint sum = 0u;
+    for (uint c = first; c < last; ++c)
+        sum += grid[cursorBase() + c];
+    partial[t] = sum;
+    barrier();
+    for (uint off = 1u; off < 1024u; off <<= 1u) {
+        uint v = (t >= off) ? partial[t - off] : 0u;
+        barrier();
+        partial[t] += v;
+        barrier();
+    }
+    uint run = partial[t] - sum;
+    for (uint c = first; c < last; ++c) {
+        uint n = grid[cursorBase() + c];
+        grid[c] = run;
+        grid[cursorBase() + c] = run;
+        run += n;
+    }
+    if (t == 1023u)
+        grid[u_numCells] = partial[t];
+}
+#elif BOID_NL_PASS == 4
+// Scatter boids into their cells
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_numBoids) return;
+    uint slot = atomicAdd(grid[cursorBase() + grid[cellOfBase() + i]], 1u);
+    grid[sortedBase() + slot] = i;
+}
+#else
+// Gather each boid's list from the 27 surrounding cells, sorted by index so the flocking
+// kernel sums in the same order as its all-pairs loop
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= u_numBoids) return;
+    vec3 p = refPos[i].xyz;
+    ivec3 home = u_hashed != 0u ? hashCoords(p) : cellCoords(p);
+    uint mask = u_numCells - 1u;
+    uint base = u_numBoids + i * u_maxNeighbors;
+    uint n = 0u;
+    for (int dz = -1; dz <= 1; ++dz)
+    for (int dy = -1; dy <= 1; ++dy)
+    for (int dx = -1; dx <= 1; ++dx) {
+        ivec3 c = home + ivec3(dx, dy, dz);
+        uint cell;
+        if (u_hashed != 0u) {
+            uint key = packKey(c);
+            cell = hashKey(key) & mask;
+            uint k = grid[keysBase() + cell];
+            while (k != key && k != EMPTY_KEY) {
+                cell = (cell + 1u) & mask;
+                k = grid[keysBase() + cell];
+            }
+            if (k == EMPTY_KEY)
+                continue;
+        } else {
+            if (any(lessThan(c, ivec3(0))) || any(greaterThanEqual(c, ivec3(u_gridDim))))
+                continue;
+            cell = cellIndex(c);
+        }
+        for (uint s = grid[cell]; s < grid[cell + 1u]; ++s) {
+            uint j = grid[sortedBase() + s];
+            vec3 d = p - refPos[j].xyz;
+            if (j != i && dot(d, d) < u_listRadiusSq) {
+                if (n < u_maxNeighbors)
+                    neighborData[base + n] = j;
+                n++;
+            }
+        }
+    }
+    uint kept = min(n, u_maxNeighbors);
+    for (uint a = 1u; a < kept; ++a) {
+        uint v = neighborData[base + a];
+        uint b = a;
+        while (b > 0u && neighborData[base + b - 1u] > v) {
+            neighborData[base + b] = neighborData[base + b - 1u];
+            b--;
+        }
+        neighborData[base + b] = v;
+    }
+    neighborData[i] = kept;
+    if (n > kept)
+        atomicAdd(ctrl[4], 1u);
+    atomicAdd(ctrl[5], kept);
+    atomicMax(ctrl[6], n);
+}
+#endif
+)";
+
+   std::string passSource( int pass )
+   {
+      std::string src( neighborListShaderSource );
+      size_t lineEnd = src.find( '\n', src.find( "#version" ) );
+      return src.insert( lineEnd + 1, "#define BOID_NL_PASS " + std::to_string( pass ) + "\n" );
+   }
+
+   void setUniform( GLuint program, const char* name, GLuint v ) { glUniform1ui( glGetUniformLocation( program, name ), v ); }
+   void setUniform( GLuint program, const char* name, GLint v ) { glUniform1i( glGetUniformLocation( program, name ), v ); }
+   void setUniform( GLuint program, const char* name, GLfloat v ) { glUniform1f( glGetUniformLocation( program, name ), v ); }
+}
+
+BoidGpuNeighborList::~BoidGpuNeighborList()
+{
+   for( GLuint p : { decideProgram, clearProgram, countProgram, scanProgram, scatterProgram, buildProgram } )
+      if( p )
+         glDeleteProgram( p );
+   for( GLuint b : { listBuffer, refPosBuffer, controlBuffer, gridBuffer, statsStaging } )
+      if( b )
+         glDeleteBuffers( 1, &b );
+   if( statsFence )
+      glDeleteSync( statsFence );
+}
+
+void BoidGpuNeighborList::compileAsync( BoidProgramCache& cache )
+{
+   GLuint* programs[] = { &decideProgram, &clearProgram, &countProgram, &scanProgram, &scatterProgram, &buildProgram };
+   for( int pass = 0; pass < 6; ++pass )
+      *programs[pass] = cache.compileAsync( { { GL_COMPUTE_SHADER, passSource( pass ) } }, "boid neighbor list pass " + std::to_string( pass ) );
+}
+
+void BoidGpuNeighborList::finish( BoidProgramCache& cache )
+{
+   GLuint* programs[] = { &decideProgram, &clearProgram, &countProgram, &scanProgram, &scatterProgram, &buildProgram };
+   bool ok = true;
+   for( GLuint* p : programs )
+   {
+      *p = cache.finish( *p );
+      ok = ok && *p;
+   }
+   if( !ok )
+   {
+      // All or nothing: isReady() keys off the decide pass
+      for( GLuint* p : programs )
+         if( *p )
+         {
+            glDeleteProgram( *p );
+            *p = 0;
+         }
+   }
+}
+
+void BoidGpuNeighborList::allocate( int numBoids, int maxNeighbors, float listRadius, float bndRadius )
+{
+   this->numBoids = numBoids;
+   this->maxNeighbors = maxNeighbors;
+   this->listRadius = listRadius;
+
+   // Cube around the tank with some overshoot; boids outside clamp into the border cells, which
+   // keeps the 27-cell search exact, only slower
+   float extent = bndRadius * 1.25f + listRadius;
+   this->allocatedScale = this->cellScale;
+   this->allocatedHashed = this->hashed;
+   this->gridOrigin = -extent;
+   if( this->hashed )
+   {
+      // Cells keep their list-radius size however large the domain; even one boid per cell
+      // leaves the table half empty
+      this->cellSize = listRadius * this->cellScale;
+      this->gridDim = 0;
+      this->numCells = 64;
+      while( this->numCells < 2u * static_cast< GLuint >( numBoids ) )
+         this->numCells *= 2;
+   }
+   else
+   {
+      this->cellSize = std::max( listRadius * this->cellScale, 2.0f * extent / MAX_GRID_DIM );
+      this->gridDim = std::clamp( static_cast< int >( std::ceil( 2.0f * extent / this->cellSize ) ), 1, MAX_GRID_DIM );
+      this->numCells = static_cast< GLuint >( this->gridDim * this->gridDim * this->gridDim );
+   }
+   const GLsizeiptr numCells = this->numCells;
+
+   if( !this->listBuffer )
+   {
+      glGenBuffers( 1, &this->listBuffer );
+      glGenBuffers( 1, &this->refPosBuffer );
+      glGenBuffers( 1, &this->controlBuffer );
+      glGenBuffers( 1, &this->gridBuffer );
+      glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->controlBuffer );
+      glBufferData( GL_SHADER_STORAGE_BUFFER, CTRL_COUNT * sizeof( GLuint ), nullptr, GL_DYNAMIC_COPY );
+      GLuint zero = 0;
+      glClearBufferData( GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero );
+   }
+   const GLsizeiptr n = std::max( numBoids, 1 );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->listBuffer );
+   glBufferData( GL_SHADER_STORAGE_BUFFER, n * ( 1 + maxNeighbors ) * sizeof( GLuint ), nullptr, GL_DYNAMIC_COPY );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->refPosBuffer );
+   glBufferData( GL_SHADER_STORAGE_BUFFER, n * 4 * sizeof( GLfloat ), nullptr, GL_DYNAMIC_COPY );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->gridBuffer );
+   glBufferData( GL_SHADER_STORAGE_BUFFER, ( ( this->hashed ? 3 : 2 ) * numCells + 1 + 2 * n ) * sizeof( GLuint ), nullptr, GL_DYNAMIC_COPY );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+   this->forceRebuild = true;
+}
+
+void BoidGpuNeighborList::prepare( GLuint stateBuffer, const BoidSwarmParams& params, float skin, int maxNeighbors )
+{
+   if( !this->isReady() )
+      return;
+   skin = std::max( skin, 0.01f );
+   maxNeighbors = std::max( maxNeighbors, 1 );
+   const float listRadius = std::max( params.sepRadius, params.neiRadius ) + skin;
+   if( params.numBoids != this->numBoids || maxNeighbors != this->maxNeighbors || listRadius != this->listRadius ||
+       this->gridOrigin != -( params.bndRadius * 1.25f + listRadius ) || this->cellScale != this->allocatedScale ||
+       this->hashed != this->allocatedHashed )
+      this->allocate( params.numBoids, maxNeighbors, listRadius, params.bndRadius );
+   this->halfSkin = 0.5f * skin;
+
+   const GLuint numCells = this->numCells;
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, stateBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 3, this->gridBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 5, this->listBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 6, this->refPosBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 7, this->controlBuffer );
+   glBindBuffer( GL_DISPATCH_INDIRECT_BUFFER, this->controlBuffer );
+
+   // The flag the previous step raised must be visible to the decision
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+   glUseProgram( this->decideProgram );
+   setUniform( this->decideProgram, "u_numBoids", static_cast< GLuint >( this->numBoids ) );
+   setUniform( this->decideProgram, "u_numCells", numCells );
+   setUniform( this->decideProgram, "u_force", static_cast< GLuint >( this->forceRebuild ? 1 : 0 ) );
+   glDispatchCompute( 1, 1, 1 );
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT );
+   this->forceRebuild = false;
+
+   struct Pass { GLuint program; GLintptr args; };
+   const Pass passes[] = { { this->clearProgram, CELL_ARGS }, { this->countProgram, BOID_ARGS }, { this->scanProgram, SCAN_ARGS },
+                           { this->scatterProgram, BOID_ARGS }, { this->buildProgram, BOID_ARGS } };
+   for( const Pass& pass : passes )
+   {
+      glUseProgram( pass.program );
+      setUniform( pass.program, "u_numBoids", static_cast< GLuint >( this->numBoids ) );
+      setUniform( pass.program, "u_numCells", numCells );
+      setUniform( pass.program, "u_gridDim", static_cast< GLint >( this->gridDim ) );
+      setUniform( pass.program, "u_gridOrigin", this->gridOrigin );
+      setUniform( pass.program, "u_invCellSize", 1.0f / this->cellSize );
+      setUniform( pass.program, "u_listRadiusSq", this->listRadius * this->listRadius );
+      setUniform( pass.program, "u_maxNeighbors", static_cast< GLuint >( this->maxNeighbors ) );
+      setUniform( pass.program, "u_hashed", static_cast< GLuint >( this->hashed ? 1 : 0 ) );
+      glDispatchComputeIndirect( pass.args );
+      glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+   }
+   glBindBuffer( GL_DISPATCH_INDIRECT_BUFFER, 0 );
+   glUseProgram( 0 );
+}
+
+void BoidGpuNeighborList::bindForStep( GLuint program ) const
+{
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 5, this->listBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 6, this->refPosBuffer );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 7, this->controlBuffer );
+   setUniform( program, "u_maxNeighbors", static_cast< GLuint >( this->maxNeighbors ) );
+   setUniform( program, "u_halfSkinSq", this->halfSkin * this->halfSkin );
+}
+
+void BoidGpuNeighborList::updateStats( int intervalFrames )
+{
+   if( !this->controlBuffer )
+      return;
+   if( this->statsFence )
+   {
+      if( glClientWaitSync( this->statsFence, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+         return;
+      glDeleteSync( this->statsFence );
+      this->statsFence = nullptr;
+
+      GLuint c[CTRL_COUNT];
+      glBindBuffer( GL_COPY_READ_BUFFER, this->statsStaging );
+      glGetBufferSubData( GL_COPY_READ_BUFFER, 0, sizeof( c ), c );
+      glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+      this->stats.steps = c[CTRL_STEPS];
+      this->stats.rebuilds = c[CTRL_STEPS + 1];
+      this->stats.overflowBoids = c[4];
+      this->stats.meanNeighbors = this->numBoids ? static_cast< float >( c[5] ) / this->numBoids : 0.0f;
+      this->stats.maxNeighbors = c[6];
+      this->stats.hashedGrid = this->allocatedHashed;
+      this->stats.gridSlots = this->numCells;
+      this->stats.occupiedCells = c[CTRL_OCCUPIED];
+      this->stats.maxProbe = this->allocatedHashed ? c[CTRL_PROBE] : 0;
+      this->stats.gridBytes = ( ( this->allocatedHashed ? 3ull : 2ull ) * this->numCells + 1 ) * sizeof( GLuint );
+      return;
+   }
+   if( ++this->framesSinceStats < intervalFrames )
+      return;
+   this->framesSinceStats = 0;
+
+   if( !this->statsStaging )
+   {
+      glGenBuffers( 1, &this->statsStaging );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, this->statsStaging );
+      glBufferData( GL_COPY_WRITE_BUFFER, CTRL_COUNT * sizeof( GLuint ), nullptr, GL_STREAM_READ );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   }
+   glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+   glBindBuffer( GL_COPY_READ_BUFFER, this->controlBuffer );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, this->statsStaging );
+   glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, CTRL_COUNT * sizeof( GLuint ) );
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   this->statsFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+void BoidGpuNeighborList::resetStats()
+{
+   this->stats = BoidNeighborListStats();
+   if( !this->controlBuffer )
+      return;
+   const GLuint zero[2] = { 0, 0 };
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, this->controlBuffer );
+   glBufferSubData( GL_SHADER_STORAGE_BUFFER, CTRL_STEPS * sizeof( GLuint ), sizeof( zero ), zero );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+}
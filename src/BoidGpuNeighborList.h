@@ -0,0 +1,92 @@
+#pragma once
+
+#include "GLView.h"
+#include "BoidSwarmTypes.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace Aftr
+{
+class BoidProgramCache;
+
+/**
+   Verlet neighbor lists for the flocking kernel (BOID_KF_NEIGHBOR_LIST), kept entirely on the GPU.
+
+   The flocking kernel compares every boid it writes with its position at the last build and
+   raises a flag once one has moved more than skin/2. prepare(), issued before each step, runs a
+   one-thread pass that turns the flag (or a forced rebuild) into indirect dispatch sizes for the
+   build passes: zero workgroups when the lists are still valid, so the CPU never waits on the
+   decision. A rebuild bins the boids into a uniform grid (count, scan, scatter) and writes, per
+   boid, up to maxNeighbors indices within max(sepRadius, neiRadius) + skin in ascending order;
+   longer lists are truncated and counted as overflow.
+
+   The grid is either dense, a cube of at most 64^3 cells around the tank whose cells grow with
+   the boundary, or hashed (setHashedGrid()): occupied cells of list-radius size are found through
+   an open-addressing table keyed like BoidHashGrid's, so a large, sparsely populated domain
+   neither needs more memory nor coarser cells. The table cannot grow without a stall, so it is
+   sized for one cell per boid at half load.
+
+   Bindings used by the flocking kernel: 5 lists, 6 positions at the last build, 7 control block.
+*/
+class BoidGpuNeighborList
+{
+public:
+   ~BoidGpuNeighborList();
+
+   void compileAsync( BoidProgramCache& cache );
+   void finish( BoidProgramCache& cache );
+   bool isReady() const { return this->decideProgram != 0; }
+
+   /// Grid cells of the rebuild in list radii (>= 1); applied by the next prepare()
+   void setCellScale( float scale ) { this->cellScale = std::max( scale, 1.0f ); }
+   /// Hashed grid instead of the dense one; applied by the next prepare()
+   void setHashedGrid( bool hashed ) { this->hashed = hashed; }
+
+   /// Next prepare() rebuilds, e.g. after the state buffers were reseeded
+   void invalidate() { this->forceRebuild = true; }
+
+   /// Rebuilds the lists from 'stateBuffer' if needed; issued before every step that uses them
+   void prepare( GLuint stateBuffer, const BoidSwarmParams& params, float skin, int maxNeighbors );
+   /// Binds the lists and sets the kernel's list uniforms on 'program' (current program)
+   void bindForStep( GLuint program ) const;
+
+   /// Copies the counters back every 'intervalFrames' frames without stalling; call once per frame
+   void updateStats( int intervalFrames = 30 );
+   const BoidNeighborListStats& getStats() const { return this->stats; }
+   void resetStats();
+
+private:
+   void allocate( int numBoids, int maxNeighbors, float listRadius, float bndRadius );
+
+   GLuint decideProgram = 0;
+   GLuint clearProgram = 0;
+   GLuint countProgram = 0;
+   GLuint scanProgram = 0;
+   GLuint scatterProgram = 0;
+   GLuint buildProgram = 0;
+
+   GLuint listBuffer = 0;    // [numBoids] counts, then numBoids * maxNeighbors indices
+   GLuint refPosBuffer = 0;  // vec4 per boid
+   GLuint controlBuffer = 0; // flags, counters and indirect dispatch sizes
+   GLuint gridBuffer = 0;    // cell starts, cell cursors, sorted boids, cell of each boid (, table keys)
+   GLuint statsStaging = 0;
+   GLsync statsFence = nullptr;
+   int framesSinceStats = 0;
+
+   bool forceRebuild = true;
+   int numBoids = 0;
+   int maxNeighbors = 0;
+   float listRadius = 0.0f;
+   float halfSkin = 0.0f;
+   float cellSize = 1.0f;
+   float cellScale = 1.0f;
+   float allocatedScale = 0.0f;
+   bool hashed = false;
+   bool allocatedHashed = false;
+   float gridOrigin = 0.0f;
+   int gridDim = 1;
+   GLuint numCells = 1;      // dense: gridDim^3, hashed: table slots (power of two)
+   BoidNeighborListStats stats;
+};
+
+} //namespace Aftr
@@ -0,0 +1,91 @@
+#include "BoidGpuTimer.h"
+#include "BoidProfiler.h"
+
+using namespace Aftr;
+
+BoidGpuTimer::~BoidGpuTimer()
+{
+   for( const Zone& z : this->pending )
+   {
+      this->freeQueries.push_back( z.begin );
+      this->freeQueries.push_back( z.end );
+   }
+   if( !this->freeQueries.empty() )
+      glDeleteQueries( static_cast< GLsizei >( this->freeQueries.size() ), this->freeQueries.data() );
+}
+
+void BoidGpuTimer::calibrate()
+{
+   GLint64 gpuNow = 0;
+   glGetInteger64v( GL_TIMESTAMP, &gpuNow );
+   this->gpuToCpuNs = BoidProfiler::nowNs() - static_cast< int64_t >( gpuNow );
+}
+
+GLuint BoidGpuTimer::acquireQuery()
+{
+   if( this->freeQueries.empty() )
+   {
+      GLuint q[16];
+      glGenQueries( 16, q );
+      this->freeQueries.insert( this->freeQueries.end(), q, q + 16 );
+   }
+   GLuint q = this->freeQueries.back();
+   this->freeQueries.pop_back();
+   return q;
+}
+
+void BoidGpuTimer::begin( const char* name )
+{
+   if( !BoidProfiler::isCapturing() )
+      return;
+   Zone z{ name, this->acquireQuery(), 0 };
+   glQueryCounter( z.begin, GL_TIMESTAMP );
+   this->open.push_back( z );
+}
+
+void BoidGpuTimer::end()
+{
+   if( this->open.empty() )
+      return;
+   Zone z = this->open.back();
+   this->open.pop_back();
+   z.end = this->acquireQuery();
+   glQueryCounter( z.end, GL_TIMESTAMP );
+   this->pending.push_back( z );
+}
+
+void BoidGpuTimer::collect( bool wait )
+{
+   // Queries complete in submission order, so stop at the first one still in flight
+   while( !this->pending.empty() )
+   {
+      const Zone& z = this->pending.front();
+      GLuint available = 0;
+      if( !wait )
+      {
+         glGetQueryObjectuiv( z.end, GL_QUERY_RESULT_AVAILABLE, &available );
+         if( !available )
+            break;
+      }
+      GLuint64 t0 = 0, t1 = 0;
+      glGetQueryObjectui64v( z.begin, GL_QUERY_RESULT, &t0 );
+      glGetQueryObjectui64v( z.end, GL_QUERY_RESULT, &t1 );
+      BoidProfiler::get().addGpuZone( z.name, static_cast< int64_t >( t0 ) + this->gpuToCpuNs,
+                                      static_cast< int64_t >( t1 ) + this->gpuToCpuNs );
+      this->freeQueries.push_back( z.begin );
+      this->freeQueries.push_back( z.end );
+      this->pending.pop_front();
+   }
+}
+
+BoidGpuZone::BoidGpuZone( BoidGpuTimer& timer, const char* name ) : timer( BoidProfiler::isCapturing() ? &timer : nullptr )
+{
+   if( this->timer )
+      this->timer->begin( name );
+}
+
+BoidGpuZone::~BoidGpuZone()
+{
+   if( this->timer )
+      this->timer->end();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GLView.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Aftr
+{
+
+/**
+   GPU zones for BoidProfiler. begin()/end() bracket GL work with GL_TIMESTAMP queries;
+   collect() hands finished pairs to the profiler on the CPU clock, using the GPU/CPU offset
+   sampled by calibrate() when a capture starts. Main (GL) thread only; zones are recorded
+   only while a capture is running.
+*/
+class BoidGpuTimer
+{
+public:
+   ~BoidGpuTimer();
+
+   void calibrate();
+   void begin( const char* name );
+   void end();
+   /// Forwards finished zones; 'wait' blocks for all outstanding ones (end of a capture)
+   void collect( bool wait );
+
+private:
+   GLuint acquireQuery();
+
+   struct Zone
+   {
+      const char* name;
+      GLuint begin;
+      GLuint end;
+   };
+   std::vector< GLuint > freeQueries;
+   std::vector< Zone > open;
+   std::deque< Zone > pending;
+   int64_t gpuToCpuNs = 0;
+};
+
+/// Scoped BoidGpuTimer zone
+class BoidGpuZone
+{
+public:
+   BoidGpuZone( BoidGpuTimer& timer, const char* name );
+   ~BoidGpuZone();
+   BoidGpuZone( const BoidGpuZone& ) = delete;
+   BoidGpuZone& operator=( const BoidGpuZone& ) = delete;
+
+private:
+   BoidGpuTimer* timer;
+};
+
+} //namespace Aftr
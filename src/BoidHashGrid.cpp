@@ -0,0 +1,163 @@
+#include "BoidHashGrid.h"
+#include "BoidArena.h"
+#include "BoidThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Aftr;
+
+namespace
+{
+   constexpr uint32_t MIN_SLOTS = 64;
+
+   /// Power of two that keeps 'cells' occupied cells at most half the table
+   uint32_t slotsFor( uint32_t cells )
+   {
+      uint32_t slots = MIN_SLOTS;
+      while( slots < 2 * static_cast< uint64_t >( cells ) )
+         slots *= 2;
+      return slots;
+   }
+}
+
+uint32_t BoidHashGrid::packKey( int cx, int cy, int cz )
+{
+   // 11 + 11 + 9 bits; the top bit stays clear so no key equals EMPTY_KEY
+   return ( static_cast< uint32_t >( cx ) & 2047u ) | ( ( static_cast< uint32_t >( cy ) & 2047u ) << 11 ) |
+          ( ( static_cast< uint32_t >( cz ) & 511u ) << 22 );
+}
+
+uint32_t BoidHashGrid::hash( uint32_t key )
+{
+   // Full avalanche, so neighboring cells land in unrelated slots of the power-of-two table
+   key ^= key >> 16;
+   key *= 0x7feb352du;
+   key ^= key >> 15;
+   key *= 0x846ca68bu;
+   key ^= key >> 16;
+   return key;
+}
+
+void BoidHashGrid::cellCoords( float x, float y, float z, int& cx, int& cy, int& cz ) const
+{
+   cx = static_cast< int >( std::floor( x * this->invCellSize ) );
+   cy = static_cast< int >( std::floor( y * this->invCellSize ) );
+   cz = static_cast< int >( std::floor( z * this->invCellSize ) );
+}
+
+void BoidHashGrid::build( const BoidGPU* boids, uint32_t count, float cellSize, BoidThreadPool& pool )
+{
+   this->cellSize = std::max( cellSize, 1e-4f );
+   this->invCellSize = 1.0f / this->cellSize;
+
+   // Key of every boid (parallel)
+   this->cellOfBoid.resize( count );
+   pool.parallelFor( count, 4096, [&]( uint32_t begin, uint32_t end )
+   {
+      int cx, cy, cz;
+      for( uint32_t i = begin; i < end; ++i )
+      {
+         this->cellCoords( boids[i].px, boids[i].py, boids[i].pz, cx, cy, cz );
+         this->cellOfBoid[i] = packKey( cx, cy, cz );
+      }
+   } );
+
+   // The table starts at the size the last build's cells need. A swarm that spreads out grows it
+   // while inserting; one that contracts a lot gives the memory back
+   const uint32_t wanted = std::max( slotsFor( this->occupied ), this->minSlots );
+   this->occupied = 0;
+   this->maxProbe = 0;
+   if( wanted > this->keys.size() || 8 * static_cast< uint64_t >( wanted ) <= this->keys.size() )
+      this->resizeTable( wanted );
+   else
+      std::fill( this->keys.begin(), this->keys.end(), EMPTY_KEY );
+
+   // Serial insert in boid order, numbering cells by first appearance and counting their members
+   this->cellStart.assign( 1, 0 );
+   for( uint32_t i = 0; i < count; ++i )
+   {
+      const uint32_t key = this->cellOfBoid[i];
+      uint32_t probes = 0;
+      uint32_t slot = this->probe( key, probes );
+      if( this->keys[slot] == EMPTY_KEY )
+      {
+         if( 2 * ( this->occupied + 1 ) > this->keys.size() )
+         {
+            this->resizeTable( 2 * static_cast< uint32_t >( this->keys.size() ) );
+            slot = this->probe( key, probes );
+         }
+         this->keys[slot] = key;
+         this->slotCell[slot] = this->occupied++;
+         this->cellStart.push_back( 0 );
+      }
+      this->maxProbe = std::max( this->maxProbe, probes );
+      const uint32_t c = this->slotCell[slot];
+      this->cellOfBoid[i] = c;
+      ++this->cellStart[c + 1];
+   }
+
+   // Stable counting sort over the occupied cells only
+   for( uint32_t c = 0; c < this->occupied; ++c )
+      this->cellStart[c + 1] += this->cellStart[c];
+   this->sortedIdx.resize( count );
+   BoidArenaScope scratch;
+   uint32_t* cursor = scratch.allocate< uint32_t >( this->occupied );
+   std::copy( this->cellStart.begin(), this->cellStart.end() - 1, cursor );
+   for( uint32_t i = 0; i < count; ++i )
+      this->sortedIdx[cursor[this->cellOfBoid[i]]++] = i;
+}
+
+void BoidHashGrid::reserve( uint32_t count )
+{
+   this->minSlots = slotsFor( count );
+   if( this->keys.size() < this->minSlots )
+      this->resizeTable( this->minSlots );
+   this->cellOfBoid.reserve( count );
+   this->cellStart.reserve( static_cast< size_t >( count ) + 1 );
+   this->sortedIdx.reserve( count );
+   BoidArenaScope scratch;
+   scratch.allocate< uint32_t >( count );
+}
+
+uint32_t BoidHashGrid::probe( uint32_t key, uint32_t& probes ) const
+{
+   const uint32_t mask = static_cast< uint32_t >( this->keys.size() ) - 1;
+   uint32_t slot = hash( key ) & mask;
+   for( probes = 1; this->keys[slot] != EMPTY_KEY && this->keys[slot] != key; ++probes )
+      slot = ( slot + 1 ) & mask;
+   return slot;
+}
+
+uint32_t BoidHashGrid::findCell( int cx, int cy, int cz ) const
+{
+   if( this->keys.empty() )
+      return NO_CELL;
+   uint32_t probes = 0;
+   const uint32_t slot = this->probe( packKey( cx, cy, cz ), probes );
+   return this->keys[slot] == EMPTY_KEY ? NO_CELL : this->slotCell[slot];
+}
+
+void BoidHashGrid::resizeTable( uint32_t slots )
+{
+   // Fresh vectors, so shrinking really frees; the occupied slots move over
+   std::vector< uint32_t > oldKeys( slots, EMPTY_KEY );
+   std::vector< uint32_t > oldCells( slots );
+   oldKeys.swap( this->keys );
+   oldCells.swap( this->slotCell );
+   if( this->occupied == 0 )
+      return;
+   for( size_t s = 0; s < oldKeys.size(); ++s )
+      if( oldKeys[s] != EMPTY_KEY )
+      {
+         uint32_t probes = 0;
+         const uint32_t t = this->probe( oldKeys[s], probes );
+         this->keys[t] = oldKeys[s];
+         this->slotCell[t] = oldCells[s];
+      }
+}
+
+size_t BoidHashGrid::getBytes() const
+{
+   return ( this->keys.size() + this->slotCell.size() + this->cellStart.size() ) * sizeof( uint32_t );
+}
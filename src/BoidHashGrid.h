@@ -0,0 +1,71 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+class BoidThreadPool;
+
+/**
+   Sparse uniform grid: only occupied cells exist, found through an open-addressing hash table
+   (linear probing, kept at most half full) keyed by the packed cell coordinates. Memory and
+   build time follow the number of occupied cells rather than the volume the boids span, so a
+   swarm spread thinly through a large domain costs what a compact one does. As in BoidCellGrid
+   the members of cell c are items()[ cellBegin( c ) .. cellEnd( c ) ), in ascending boid index.
+
+   Cell coordinates wrap every 2048 cells in x and y and every 512 in z (packKey()), so cells
+   that far apart share a bucket; callers filter candidates by distance anyway. The GPU lists
+   (BoidGpuNeighborList) use the same key and hash.
+*/
+class BoidHashGrid
+{
+public:
+   static constexpr uint32_t NO_CELL = 0xFFFFFFFFu;
+   static constexpr uint32_t EMPTY_KEY = 0xFFFFFFFFu; // never produced by packKey()
+
+   static uint32_t packKey( int cx, int cy, int cz );
+   static uint32_t hash( uint32_t key );
+
+   void build( const BoidGPU* boids, uint32_t count, float cellSize, BoidThreadPool& pool );
+   /// Sizes the table for 'count' occupied cells (it no longer shrinks below that) and every other
+   /// buffer, including the calling thread's arena, so builds of up to 'count' boids don't touch the heap
+   void reserve( uint32_t count );
+
+   float getCellSize() const { return this->cellSize; }
+   void cellCoords( float x, float y, float z, int& cx, int& cy, int& cz ) const;
+   /// Cell at the given coordinates, or NO_CELL when no boid is in it
+   uint32_t findCell( int cx, int cy, int cz ) const;
+
+   uint32_t cellBegin( uint32_t c ) const { return this->cellStart[c]; }
+   uint32_t cellEnd( uint32_t c ) const { return this->cellStart[c + 1]; }
+   const uint32_t* items() const { return this->sortedIdx.data(); }
+
+   uint32_t getNumOccupied() const { return this->occupied; }
+   uint32_t getNumSlots() const { return static_cast< uint32_t >( this->keys.size() ); }
+   float getLoadFactor() const { return this->keys.empty() ? 0.0f : static_cast< float >( this->occupied ) / this->keys.size(); }
+   /// Longest probe sequence of the last build's lookups (1 = every cell in its home slot)
+   uint32_t getMaxProbe() const { return this->maxProbe; }
+   /// Table and cell ranges; the per-boid arrays come on top
+   size_t getBytes() const;
+
+private:
+   /// Slot holding 'key' or the empty slot it would go into; counts the probes
+   uint32_t probe( uint32_t key, uint32_t& probes ) const;
+   void resizeTable( uint32_t slots );
+
+   float cellSize = 1.0f;
+   float invCellSize = 1.0f;
+   uint32_t occupied = 0;
+   uint32_t maxProbe = 0;
+   uint32_t minSlots = 0;              // table size reserve() asked for
+   std::vector< uint32_t > keys;       // EMPTY_KEY or the packed coordinates of an occupied cell
+   std::vector< uint32_t > slotCell;   // cell index of an occupied slot
+   std::vector< uint32_t > cellOfBoid; // key of every boid, then its cell index
+   std::vector< uint32_t > cellStart;
+   std::vector< uint32_t > sortedIdx;
+};
+
+} //namespace Aftr
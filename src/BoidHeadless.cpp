@@ -0,0 +1,213 @@
+#include "BoidHeadless.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+using namespace Aftr;
+
+namespace
+{
+   bool parsePositive( const std::string& s, int& out )
+   {
+      char* end = nullptr;
+      long v = std::strtol( s.c_str(), &end, 10 );
+      if( s.empty() || *end != '\0' || v <= 0 || v > 1000000000L )
+         return false;
+      out = static_cast< int >( v );
+      return true;
+   }
+
+   bool fail( std::string* error, const std::string& message )
+   {
+      if( error )
+         *error = message;
+      return false;
+   }
+}
+
+bool BoidHeadlessOptions::parse( const std::vector< std::string >& args, BoidHeadlessOptions& out, std::string* error )
+{
+   for( const std::string& arg : args )
+   {
+      const size_t eq = arg.find( '=' );
+      const std::string flag = arg.substr( 0, eq );
+      const std::string value = eq == std::string::npos ? std::string() : arg.substr( eq + 1 );
+
+      if( flag == "--headless" )
+         out.enabled = true;
+      else if( flag == "--frames" )
+      {
+         if( !parsePositive( value, out.frames ) )
+            return fail( error, "--frames expects a positive count, got '" + value + "'" );
+      }
+      else if( flag == "--size" )
+      {
+         const size_t x = value.find_first_of( "xX" );
+         if( x == std::string::npos || !parsePositive( value.substr( 0, x ), out.width ) ||
+             !parsePositive( value.substr( x + 1 ), out.height ) || out.width > 16384 || out.height > 16384 )
+            return fail( error, "--size expects WIDTHxHEIGHT (at most 16384 each), got '" + value + "'" );
+      }
+      else if( flag == "--dump" )
+      {
+         if( value.empty() )
+            return fail( error, "--dump expects a directory" );
+         out.dumpDir = value;
+      }
+      else if( flag == "--dump-every" )
+      {
+         if( !parsePositive( value, out.dumpEvery ) )
+            return fail( error, "--dump-every expects a positive count, got '" + value + "'" );
+      }
+   }
+   return true;
+}
+
+BoidFrameEncoder::BoidFrameEncoder( size_t maxQueued ) : maxQueued( maxQueued < 1 ? 1 : maxQueued )
+{
+}
+
+BoidFrameEncoder::~BoidFrameEncoder()
+{
+   this->finish();
+}
+
+bool BoidFrameEncoder::start( const std::string& dir, std::string* error )
+{
+   if( this->isStarted() )
+      return true;
+   std::error_code ec;
+   std::filesystem::create_directories( dir, ec );
+   if( ec )
+      return fail( error, "cannot create '" + dir + "': " + ec.message() );
+   this->dir = dir;
+   this->stopping = false;
+   this->writer = std::thread( [this]() { this->writerLoop(); } );
+   return true;
+}
+
+std::vector< uint8_t > BoidFrameEncoder::acquireBuffer()
+{
+   std::lock_guard< std::mutex > lock( this->mtx );
+   if( this->freeBuffers.empty() )
+      return {};
+   std::vector< uint8_t > buf = std::move( this->freeBuffers.back() );
+   this->freeBuffers.pop_back();
+   return buf;
+}
+
+bool BoidFrameEncoder::submit( int frame, int width, int height, std::vector< uint8_t >&& bgra )
+{
+   bool waited = false;
+   {
+      std::unique_lock< std::mutex > lock( this->mtx );
+      if( this->queue.size() >= this->maxQueued )
+      {
+         waited = true;
+         this->spaceCv.wait( lock, [this]() { return this->queue.size() < this->maxQueued; } );
+      }
+      this->queue.push_back( Job{ frame, width, height, std::move( bgra ) } );
+   }
+   this->queuedCv.notify_one();
+   return waited;
+}
+
+void BoidFrameEncoder::finish()
+{
+   if( !this->writer.joinable() )
+      return;
+   {
+      std::lock_guard< std::mutex > lock( this->mtx );
+      this->stopping = true;
+   }
+   this->queuedCv.notify_one();
+   this->writer.join();
+}
+
+void BoidFrameEncoder::writerLoop()
+{
+   for( ;; )
+   {
+      Job job;
+      {
+         std::unique_lock< std::mutex > lock( this->mtx );
+         this->queuedCv.wait( lock, [this]() { return this->stopping || !this->queue.empty(); } );
+         if( this->queue.empty() )
+            return; // stopping and drained
+         job = std::move( this->queue.front() );
+         this->queue.pop_front();
+      }
+      this->spaceCv.notify_one();
+
+      auto t0 = std::chrono::steady_clock::now();
+      bool ok = writeTga( framePath( this->dir, job.frame ), job.width, job.height, job.pixels.data() );
+      double ms = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - t0 ).count();
+
+      std::lock_guard< std::mutex > lock( this->mtx );
+      this->writeMs += ms;
+      if( ok )
+      {
+         ++this->framesWritten;
+         this->bytesWritten += 18 + job.pixels.size();
+      }
+      else
+         ++this->errors;
+      this->freeBuffers.push_back( std::move( job.pixels ) );
+   }
+}
+
+uint64_t BoidFrameEncoder::getFramesWritten() const
+{
+   std::lock_guard< std::mutex > lock( this->mtx );
+   return this->framesWritten;
+}
+
+uint64_t BoidFrameEncoder::getBytesWritten() const
+{
+   std::lock_guard< std::mutex > lock( this->mtx );
+   return this->bytesWritten;
+}
+
+uint64_t BoidFrameEncoder::getErrors() const
+{
+   std::lock_guard< std::mutex > lock( this->mtx );
+   return this->errors;
+}
+
+double BoidFrameEncoder::getWriteMs() const
+{
+   std::lock_guard< std::mutex > lock( this->mtx );
+   return this->writeMs;
+}
+
+std::string BoidFrameEncoder::framePath( const std::string& dir, int frame )
+{
+   char name[32];
+   std::snprintf( name, sizeof( name ), "boid_%06d.tga", frame );
+   return ( std::filesystem::path( dir ) / name ).string();
+}
+
+bool BoidFrameEncoder::writeTga( const std::string& path, int width, int height, const uint8_t* bgra )
+{
+   if( width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF )
+      return false;
+
+   // Uncompressed true-color, 32 bits per pixel with 8 alpha bits, bottom-left origin
+   uint8_t header[18] = {};
+   header[2] = 2;
+   header[12] = static_cast< uint8_t >( width & 0xFF );
+   header[13] = static_cast< uint8_t >( width >> 8 );
+   header[14] = static_cast< uint8_t >( height & 0xFF );
+   header[15] = static_cast< uint8_t >( height >> 8 );
+   header[16] = 32;
+   header[17] = 8;
+
+   std::ofstream out( path, std::ios::binary | std::ios::trunc );
+   if( !out )
+      return false;
+   out.write( reinterpret_cast< const char* >( header ), sizeof( header ) );
+   out.write( reinterpret_cast< const char* >( bgra ), static_cast< std::streamsize >( width ) * height * 4 );
+   return static_cast< bool >( out );
+}
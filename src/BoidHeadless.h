@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Aftr
+{
+
+/// Command line of a headless run: --headless [--frames=N] [--size=WxH] [--dump=DIR] [--dump-every=K]
+struct BoidHeadlessOptions
+{
+   bool enabled = false;
+   int frames = 600;
+   int width = 1280;
+   int height = 720;
+   std::string dumpDir;         // empty = no frame dumps
+   int dumpEvery = 1;           // dump every K-th frame
+
+   /// Picks the headless flags out of 'args' and ignores everything else; false with a message
+   /// in 'error' when a headless flag has a bad value
+   static bool parse( const std::vector< std::string >& args, BoidHeadlessOptions& out, std::string* error = nullptr );
+};
+
+/**
+   Writes captured frames to disk on its own thread so the render loop only pays for a copy.
+   Frames are 32-bit BGRA rows bottom-up, exactly what glReadPixels( GL_BGRA ) produces, and
+   go out as uncompressed TGA, whose default origin is also the bottom-left corner. At most
+   'maxQueued' frames wait; submit() blocks beyond that, so a slow disk throttles the run
+   instead of growing memory. Pixel buffers are recycled through acquireBuffer().
+*/
+class BoidFrameEncoder
+{
+public:
+   explicit BoidFrameEncoder( size_t maxQueued = 4 );
+   ~BoidFrameEncoder(); ///< finishes the queued frames
+   BoidFrameEncoder( const BoidFrameEncoder& ) = delete;
+   BoidFrameEncoder& operator=( const BoidFrameEncoder& ) = delete;
+
+   /// Creates 'dir' if needed and starts the writer thread
+   bool start( const std::string& dir, std::string* error = nullptr );
+   bool isStarted() const { return this->writer.joinable(); }
+
+   /// An empty or previously submitted buffer to fill
+   std::vector< uint8_t > acquireBuffer();
+   /// Queues a frame; true if the call had to wait for the writer
+   bool submit( int frame, int width, int height, std::vector< uint8_t >&& bgra );
+   /// Blocks until every queued frame is on disk and stops the writer
+   void finish();
+
+   uint64_t getFramesWritten() const;
+   uint64_t getBytesWritten() const;
+   uint64_t getErrors() const;
+   double getWriteMs() const; ///< writer thread time spent encoding and writing
+
+   static std::string framePath( const std::string& dir, int frame );
+   static bool writeTga( const std::string& path, int width, int height, const uint8_t* bgra );
+
+private:
+   struct Job
+   {
+      int frame = 0;
+      int width = 0;
+      int height = 0;
+      std::vector< uint8_t > pixels;
+   };
+   void writerLoop();
+
+   std::string dir;
+   size_t maxQueued;
+   std::thread writer;
+   mutable std::mutex mtx;
+   std::condition_variable queuedCv;
+   std::condition_variable spaceCv;
+   std::deque< Job > queue;
+   std::vector< std::vector< uint8_t > > freeBuffers;
+   bool stopping = false;
+
+   uint64_t framesWritten = 0;
+   uint64_t bytesWritten = 0;
+   uint64_t errors = 0;
+   double writeMs = 0.0;
+};
+
+} //namespace Aftr
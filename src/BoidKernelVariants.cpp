@@ -0,0 +1,117 @@
+#include "BoidKernelVariants.h"
+#include "BoidProgramCache.h"
+#include "BoidSwarmTypes.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace Aftr;
+
+BoidKernelVariants::BoidKernelVariants( BoidProgramCache& cache, const char* source, std::string label )
+   : cache( cache ), source( source ), label( std::move( label ) )
+{
+}
+
+BoidKernelVariants::~BoidKernelVariants()
+{
+   for( auto& [key, e] : this->table )
+      if( e.program )
+         glDeleteProgram( this->cache.finish( e.program ) );
+}
+
+std::string BoidKernelVariants::specialize( const char* source, const BoidKernelKey& key )
+{
+   std::ostringstream defs;
+   defs << "#define BOID_WORKGROUP_SIZE " << key.workgroupSize << "\n"
+        << "#define BOID_MAX_OBSTACLES " << BoidStepGlobals::MAX_OBSTACLES << "\n"
+        << "#define BOID_HAS_OBSTACLES " << ( ( key.features & BOID_KF_OBSTACLES ) ? 1 : 0 ) << "\n"
+        << "#define BOID_HAS_PREDATORS " << ( ( key.features & BOID_KF_PREDATORS ) ? 1 : 0 ) << "\n"
+        << "#define BOID_HAS_NOISE " << ( ( key.features & BOID_KF_NOISE ) ? 1 : 0 ) << "\n"
+        << "#define BOID_ENSEMBLE " << ( ( key.features & BOID_KF_ENSEMBLE ) ? 1 : 0 ) << "\n"
+        << "#define BOID_NEIGHBOR_LIST " << ( ( key.features & BOID_KF_NEIGHBOR_LIST ) ? 1 : 0 ) << "\n"
+        << "#define BOID_AGGREGATES " << ( ( key.features & BOID_KF_AGGREGATES ) ? 1 : 0 ) << "\n"
+        << "#define BOID_LOD " << ( ( key.features & BOID_KF_LOD ) ? 1 : 0 ) << "\n"
+        << "#define BOID_EVENTS " << ( ( key.features & BOID_KF_EVENTS ) ? 1 : 0 ) << "\n";
+
+   std::string src( source );
+   size_t version = src.find( "#version" );
+   size_t lineEnd = ( version == std::string::npos ) ? std::string::npos : src.find( '\n', version );
+   if( lineEnd == std::string::npos )
+      return defs.str() + src;
+   return src.insert( lineEnd + 1, defs.str() );
+}
+
+void BoidKernelVariants::request( const BoidKernelKey& key )
+{
+   auto [it, inserted] = this->table.try_emplace( key.packed() );
+   if( !inserted )
+      return;
+
+   std::ostringstream name;
+   name << this->label << " [features " << key.features << ", wg " << key.workgroupSize << "]";
+   it->second.program = this->cache.compileAsync( { { GL_COMPUTE_SHADER, specialize( this->source, key ) } }, name.str() );
+   it->second.pending = true;
+}
+
+void BoidKernelVariants::finish( Entry& e )
+{
+   e.program = this->cache.finish( e.program );
+   e.pending = false;
+   e.uniforms.resize( this->uniformNames.size() );
+   for( size_t i = 0; i < this->uniformNames.size(); ++i )
+      e.uniforms[i] = e.program ? glGetUniformLocation( e.program, this->uniformNames[i].c_str() ) : -1;
+}
+
+void BoidKernelVariants::pump()
+{
+   for( auto& [key, e] : this->table )
+      if( e.pending && this->cache.isReady( e.program ) )
+         this->finish( e );
+}
+
+GLuint BoidKernelVariants::find( const BoidKernelKey& key ) const
+{
+   auto it = this->table.find( key.packed() );
+   if( it == this->table.end() || it->second.pending )
+      return 0;
+   return it->second.program;
+}
+
+GLuint BoidKernelVariants::require( const BoidKernelKey& key )
+{
+   this->request( key );
+   Entry& e = this->table[key.packed()];
+   if( e.pending )
+      this->finish( e );
+   return e.program;
+}
+
+void BoidKernelVariants::setUniformNames( std::vector< std::string > names )
+{
+   this->uniformNames = std::move( names );
+}
+
+const GLint* BoidKernelVariants::getUniformLocations( GLuint program ) const
+{
+   // A handful of variants: a scan is cheaper than keeping a second index
+   for( const auto& [key, e] : this->table )
+      if( !e.pending && e.program == program && program )
+         return e.uniforms.data();
+   return nullptr;
+}
+
+int BoidKernelVariants::getNumReady() const
+{
+   int n = 0;
+   for( const auto& [key, e] : this->table )
+      n += ( !e.pending && e.program ) ? 1 : 0;
+   return n;
+}
+
+int BoidKernelVariants::getNumPending() const
+{
+   int n = 0;
+   for( const auto& [key, e] : this->table )
+      n += e.pending ? 1 : 0;
+   return n;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "GLView.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+class BoidProgramCache;
+
+/// Optional parts of the flocking kernel; a cleared bit compiles the feature out
+enum BoidKernelFeature : uint32_t
+{
+   BOID_KF_OBSTACLES = 1u << 0,
+   BOID_KF_PREDATORS = 1u << 1,
+   BOID_KF_NOISE     = 1u << 2,
+   BOID_KF_ALL       = BOID_KF_OBSTACLES | BOID_KF_PREDATORS | BOID_KF_NOISE,
+   // Layout bit rather than a feature: per-swarm parameter SSBO and a 2D dispatch (see ensemble mode)
+   BOID_KF_ENSEMBLE  = 1u << 3,
+   // Layout bit: boids read their Verlet neighbor list instead of looping over all boids (see BoidGpuNeighborList)
+   BOID_KF_NEIGHBOR_LIST = 1u << 4,
+   // Layout bit: far neighbors come from a hierarchy of cell aggregates (see BoidGpuAggregates); approximate
+   BOID_KF_AGGREGATES = 1u << 5,
+   // Layout bit: only the boids listed by the LOD pass are dispatched (see BoidGpuLod)
+   BOID_KF_LOD = 1u << 6,
+   // Layout bit: eats, respawns and retargets are appended to the event log SSBO (see BoidGpuEventLog)
+   BOID_KF_EVENTS = 1u << 7
+};
+
+struct BoidKernelKey
+{
+   uint32_t features = BOID_KF_ALL;
+   int workgroupSize = 256;
+
+   uint64_t packed() const { return ( static_cast< uint64_t >( this->workgroupSize ) << 32 ) | this->features; }
+};
+
+/**
+   Table of compile-time specializations of one compute shader. specialize() injects a
+   #define per feature bit plus BOID_WORKGROUP_SIZE right after the #version line; the shader
+   supplies defaults for all of them, so with no other changes the source is the BOID_KF_ALL
+   variant. Array sizes shared with the C++ side (BOID_MAX_OBSTACLES) are injected too, with no
+   default in the shader, so they cannot drift apart.
+   Variants compile through the program cache, asynchronously unless require()d.
+*/
+class BoidKernelVariants
+{
+public:
+   BoidKernelVariants( BoidProgramCache& cache, const char* source, std::string label );
+   ~BoidKernelVariants();
+   BoidKernelVariants( const BoidKernelVariants& ) = delete;
+   BoidKernelVariants& operator=( const BoidKernelVariants& ) = delete;
+
+   static std::string specialize( const char* source, const BoidKernelKey& key );
+
+   /// Starts compiling 'key' in the background (no-op if it is known already)
+   void request( const BoidKernelKey& key );
+   /// Completes variants whose background compile has finished; never blocks
+   void pump();
+   /// Program for 'key', or 0 while it is compiling (or if it failed)
+   GLuint find( const BoidKernelKey& key ) const;
+   /// Program for 'key', compiling it now if needed
+   GLuint require( const BoidKernelKey& key );
+
+   /// Uniforms whose locations are looked up once per compiled variant, so dispatches set them
+   /// without a name lookup; call before the first request()
+   void setUniformNames( std::vector< std::string > names );
+   /// Locations of the setUniformNames() uniforms in 'program' (-1 where a variant compiled one
+   /// out), or nullptr for a program of another table
+   const GLint* getUniformLocations( GLuint program ) const;
+
+   int getNumReady() const;
+   int getNumPending() const;
+
+private:
+   struct Entry
+   {
+      GLuint program = 0;
+      bool pending = false;
+      std::vector< GLint > uniforms;
+   };
+   void finish( Entry& e );
+
+   BoidProgramCache& cache;
+   const char* source;
+   std::string label;
+   std::map< uint64_t, Entry > table;
+   std::vector< std::string > uniformNames;
+};
+
+} //namespace Aftr
@@ -0,0 +1,238 @@
+#include "BoidNeighborList.h"
+#include "BoidThreadPool.h"
+#include "BoidProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+using namespace Aftr;
+
+namespace
+{
+   // Non-negative floats order like their bit patterns
+   uint32_t floatBits( float f )
+   {
+      uint32_t u;
+      std::memcpy( &u, &f, sizeof( u ) );
+      return u;
+   }
+
+   float bitsFloat( uint32_t u )
+   {
+      float f;
+      std::memcpy( &f, &u, sizeof( f ) );
+      return f;
+   }
+}
+
+void BoidNeighborList::setSkin( float skin )
+{
+   skin = std::max( skin, 0.01f );
+   if( skin != this->skin )
+      this->valid = false;
+   this->skin = skin;
+}
+
+void BoidNeighborList::setCellScale( float scale )
+{
+   scale = std::max( scale, 1.0f );
+   if( scale != this->cellScale )
+      this->valid = false;
+   this->cellScale = scale;
+}
+
+void BoidNeighborList::setHashedGrid( bool hashed )
+{
+   if( hashed != this->hashed )
+   {
+      this->valid = false;
+      this->reservedBoids = 0;
+   }
+   this->hashed = hashed;
+}
+
+void BoidNeighborList::setCapacity( uint32_t neighborsPerBoid )
+{
+   if( neighborsPerBoid != this->capacity )
+      this->reservedBoids = 0;
+   this->capacity = neighborsPerBoid;
+}
+
+bool BoidNeighborList::update( const BoidGPU* boids, const BoidSwarmParams& params, BoidThreadPool& pool )
+{
+   const uint32_t numBoids = static_cast< uint32_t >( std::max( params.numBoids, 0 ) );
+   const float listRadius = std::max( params.sepRadius, params.neiRadius ) + this->skin;
+   ++this->stats.steps;
+
+   const float halfSkin = 0.5f * this->skin;
+   if( this->valid && numBoids == this->builtBoids && listRadius == this->builtRadius &&
+       this->maxDisplacementSq( boids, pool ) <= halfSkin * halfSkin )
+      return false;
+
+   this->rebuild( boids, numBoids, listRadius, pool );
+   return true;
+}
+
+float BoidNeighborList::maxDisplacementSq( const BoidGPU* boids, BoidThreadPool& pool ) const
+{
+   std::atomic< uint32_t > maxBits{ 0 };
+   pool.parallelFor( this->builtBoids, 4096, [&]( uint32_t begin, uint32_t end )
+   {
+      float m = 0.0f;
+      for( uint32_t i = begin; i < end; ++i )
+      {
+         const float dx = boids[i].px - this->refPos[3 * i];
+         const float dy = boids[i].py - this->refPos[3 * i + 1];
+         const float dz = boids[i].pz - this->refPos[3 * i + 2];
+         m = std::max( m, dx * dx + dy * dy + dz * dz );
+      }
+      uint32_t bits = floatBits( m );
+      uint32_t prev = maxBits.load( std::memory_order_relaxed );
+      while( bits > prev && !maxBits.compare_exchange_weak( prev, bits, std::memory_order_relaxed ) )
+         ;
+   } );
+   return bitsFloat( maxBits.load( std::memory_order_relaxed ) );
+}
+
+void BoidNeighborList::rebuild( const BoidGPU* boids, uint32_t numBoids, float listRadius, BoidThreadPool& pool )
+{
+   BOID_PROFILE_ZONE( "NeighborList::rebuild" );
+   auto t0 = std::chrono::steady_clock::now();
+
+   const uint32_t maxCells = std::max( CELLS_PER_BOID * numBoids, 4096u );
+   if( this->capacity > 0 && this->reservedBoids != numBoids )
+   {
+      if( this->hashed )
+         this->hashGrid.reserve( numBoids );
+      else
+         this->grid.reserve( numBoids, maxCells );
+      this->reservedBoids = numBoids;
+   }
+
+   // Cells at least one list radius wide: every candidate is in the 27 cells around a boid
+   if( this->hashed )
+      this->hashGrid.build( boids, numBoids, listRadius * this->cellScale, pool );
+   else if( this->capacity > 0 )
+      this->grid.build( boids, numBoids, listRadius * this->cellScale, pool, maxCells );
+   else
+      this->grid.build( boids, numBoids, listRadius * this->cellScale, pool );
+   const float r2 = listRadius * listRadius;
+
+   auto forEachCandidate = [&]( uint32_t i, auto&& fn )
+   {
+      const BoidGPU& b = boids[i];
+      auto scan = [&]( uint32_t begin, uint32_t end, const uint32_t* items )
+      {
+         for( uint32_t k = begin; k < end; ++k )
+         {
+            const uint32_t j = items[k];
+            const float ex = b.px - boids[j].px, ey = b.py - boids[j].py, ez = b.pz - boids[j].pz;
+            if( j != i && ex * ex + ey * ey + ez * ez < r2 )
+               fn( j );
+         }
+      };
+      if( this->hashed )
+      {
+         int cx, cy, cz;
+         this->hashGrid.cellCoords( b.px, b.py, b.pz, cx, cy, cz );
+         for( int dz = -1; dz <= 1; ++dz )
+            for( int dy = -1; dy <= 1; ++dy )
+               for( int dx = -1; dx <= 1; ++dx )
+               {
+                  const uint32_t n = this->hashGrid.findCell( cx + dx, cy + dy, cz + dz );
+                  if( n != BoidHashGrid::NO_CELL )
+                     scan( this->hashGrid.cellBegin( n ), this->hashGrid.cellEnd( n ), this->hashGrid.items() );
+               }
+         return;
+      }
+      const uint32_t c = this->grid.cellOf( b.px, b.py, b.pz );
+      for( int dz = -1; dz <= 1; ++dz )
+         for( int dy = -1; dy <= 1; ++dy )
+            for( int dx = -1; dx <= 1; ++dx )
+            {
+               const uint32_t n = this->grid.offsetCell( c, dx, dy, dz );
+               if( n != BoidCellGrid::NO_CELL )
+                  scan( this->grid.cellBegin( n ), this->grid.cellEnd( n ), this->grid.items() );
+            }
+   };
+
+   // One pass into per-chunk buffers, then the chunks are concatenated: every list is
+   // contiguous and the cell walk happens once
+   constexpr uint32_t GRAIN = 256;
+   const uint32_t numChunks = ( numBoids + GRAIN - 1 ) / GRAIN;
+   const size_t reserved = static_cast< size_t >( this->capacity ) * numBoids;
+   const size_t indicesCapacity = this->indices.capacity();
+   std::atomic< bool > grew{ false };
+   this->chunkLists.resize( numChunks );
+   this->offsets.assign( numBoids + 1, 0 );
+   this->refPos.resize( 3 * static_cast< size_t >( numBoids ) );
+   pool.parallelFor( numBoids, GRAIN, [&]( uint32_t begin, uint32_t end )
+   {
+      // Reserved up front with a capacity; otherwise keep at least half the last build's length
+      // in reserve, so lists that drift longer between rebuilds don't regrow the chunk each time
+      std::vector< uint32_t >& chunk = this->chunkLists[begin / GRAIN];
+      const size_t chunkCapacity = chunk.capacity();
+      if( this->capacity > 0 )
+         chunk.reserve( static_cast< size_t >( this->capacity ) * ( end - begin ) );
+      else if( chunk.capacity() < chunk.size() + chunk.size() / 2 )
+         chunk.reserve( 2 * chunk.size() );
+      chunk.clear();
+      for( uint32_t i = begin; i < end; ++i )
+      {
+         const size_t first = chunk.size();
+         forEachCandidate( i, [&]( uint32_t j ) { chunk.push_back( j ); } );
+         // Ascending order keeps the kernel's summation order identical to the all-pairs loop
+         std::sort( chunk.begin() + first, chunk.end() );
+         this->offsets[i + 1] = static_cast< uint32_t >( chunk.size() - first );
+         this->refPos[3 * i] = boids[i].px;
+         this->refPos[3 * i + 1] = boids[i].py;
+         this->refPos[3 * i + 2] = boids[i].pz;
+      }
+      if( chunk.capacity() != chunkCapacity )
+         grew.store( true, std::memory_order_relaxed );
+   } );
+
+   uint32_t longest = 0;
+   for( uint32_t i = 0; i < numBoids; ++i )
+   {
+      longest = std::max( longest, this->offsets[i + 1] );
+      this->offsets[i + 1] += this->offsets[i];
+   }
+   // Headroom on growth: list lengths drift from rebuild to rebuild and shouldn't reallocate each time
+   if( this->indices.capacity() < std::max< size_t >( reserved, this->offsets[numBoids] ) )
+      this->indices.reserve( std::max< size_t >( reserved, this->offsets[numBoids] + this->offsets[numBoids] / 2 ) );
+   this->indices.resize( this->offsets[numBoids] );
+   pool.parallelFor( numChunks, 1, [&]( uint32_t begin, uint32_t end )
+   {
+      for( uint32_t c = begin; c < end; ++c )
+         std::copy( this->chunkLists[c].begin(), this->chunkLists[c].end(), this->indices.begin() + this->offsets[c * GRAIN] );
+   } );
+
+   this->valid = true;
+   this->builtBoids = numBoids;
+   this->builtRadius = listRadius;
+   ++this->stats.rebuilds;
+   if( grew.load( std::memory_order_relaxed ) || this->indices.capacity() != indicesCapacity )
+      ++this->stats.growths;
+   this->stats.meanNeighbors = numBoids ? static_cast< float >( this->offsets[numBoids] ) / numBoids : 0.0f;
+   this->stats.maxNeighbors = longest;
+   this->stats.overflowBoids = 0;
+   this->stats.hashedGrid = this->hashed;
+   if( this->hashed )
+   {
+      this->stats.gridSlots = this->hashGrid.getNumSlots();
+      this->stats.occupiedCells = this->hashGrid.getNumOccupied();
+      this->stats.maxProbe = this->hashGrid.getMaxProbe();
+      this->stats.gridBytes = this->hashGrid.getBytes();
+   }
+   else
+   {
+      this->stats.gridSlots = this->grid.getNumCells();
+      this->stats.occupiedCells = static_cast< uint32_t >( this->grid.getOccupiedCells().size() );
+      this->stats.maxProbe = 0;
+      this->stats.gridBytes = this->grid.getBytes();
+   }
+   this->stats.lastBuildMs = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - t0 ).count();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "BoidCellGrid.h"
+#include "BoidHashGrid.h"
+#include "BoidSwarmTypes.h"
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+class BoidThreadPool;
+
+/**
+   Verlet neighbor lists for the CPU kernel. Each boid gets every other boid within
+   max(sepRadius, neiRadius) + skin, in ascending index order, so a step that walks the list
+   sums exactly what the all-pairs loop sums. The lists stay valid while no boid has moved more
+   than skin/2 since the build; update() checks that before every step and rebuilds through a
+   BoidCellGrid when it no longer holds (or when the radii or the swarm size change).
+*/
+class BoidNeighborList
+{
+public:
+   static constexpr uint32_t CELLS_PER_BOID = 8;
+
+   void setSkin( float skin );
+   float getSkin() const { return this->skin; }
+   /// Grid cells of the rebuild in list radii (>= 1); larger cells trade candidates for fewer cells
+   void setCellScale( float scale );
+   /// Rebuild through a BoidHashGrid instead of a dense grid over the swarm's bounding box
+   void setHashedGrid( bool hashed );
+   bool isHashedGrid() const { return this->hashed; }
+   /// Room for this many neighbors per boid, reserved at the first build together with the grid:
+   /// later builds don't touch the heap while the lists fit. The dense grid is then capped at
+   /// CELLS_PER_BOID cells per boid (coarser cells over a very wide swarm). 0 grows the buffers
+   /// with the lists (with headroom), which keeps allocating while a flock condenses; growths
+   /// are counted in the stats either way
+   void setCapacity( uint32_t neighborsPerBoid );
+   uint32_t getCapacity() const { return this->capacity; }
+
+   /// Call before stepping 'boids'; returns true if the lists were rebuilt
+   bool update( const BoidGPU* boids, const BoidSwarmParams& params, BoidThreadPool& pool );
+   /// Forces a rebuild on the next update(), e.g. after the state was replaced
+   void invalidate() { this->valid = false; }
+
+   uint32_t count( uint32_t boid ) const { return this->offsets[boid + 1] - this->offsets[boid]; }
+   const uint32_t* begin( uint32_t boid ) const { return this->indices.data() + this->offsets[boid]; }
+   float getListRadius() const { return this->builtRadius; }
+
+   const BoidNeighborListStats& getStats() const { return this->stats; }
+   void resetStats() { this->stats = BoidNeighborListStats(); }
+
+private:
+   void rebuild( const BoidGPU* boids, uint32_t numBoids, float listRadius, BoidThreadPool& pool );
+   float maxDisplacementSq( const BoidGPU* boids, BoidThreadPool& pool ) const;
+
+   float skin = 1.0f;
+   float cellScale = 1.0f;
+   bool hashed = false;
+   uint32_t capacity = 0;
+   bool valid = false;
+   float builtRadius = 0.0f;
+   uint32_t builtBoids = 0;
+   uint32_t reservedBoids = 0;        // boids the buffers were reserved for (capacity > 0)
+   BoidCellGrid grid;
+   BoidHashGrid hashGrid;
+   std::vector< float > refPos;       // xyz per boid at the last build
+   std::vector< uint32_t > offsets;   // CSR: list of boid i is indices[offsets[i] .. offsets[i+1])
+   std::vector< uint32_t > indices;
+   std::vector< std::vector< uint32_t > > chunkLists; // build scratch, kept for its capacity
+   BoidNeighborListStats stats;
+};
+
+} //namespace Aftr
@@ -0,0 +1,131 @@
+#include "BoidOffscreen.h"
+#include "BoidHeadless.h"
+
+#include <cstring>
+
+using namespace Aftr;
+
+BoidOffscreenTarget::~BoidOffscreenTarget()
+{
+   this->destroy();
+}
+
+void BoidOffscreenTarget::destroy()
+{
+   if( this->fbo )   glDeleteFramebuffers( 1, &this->fbo );
+   if( this->color ) glDeleteRenderbuffers( 1, &this->color );
+   if( this->depth ) glDeleteRenderbuffers( 1, &this->depth );
+   this->fbo = this->color = this->depth = 0;
+   this->width = this->height = 0;
+}
+
+bool BoidOffscreenTarget::create( int width, int height )
+{
+   this->destroy();
+
+   glGenRenderbuffers( 1, &this->color );
+   glBindRenderbuffer( GL_RENDERBUFFER, this->color );
+   glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, width, height );
+   glGenRenderbuffers( 1, &this->depth );
+   glBindRenderbuffer( GL_RENDERBUFFER, this->depth );
+   glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height );
+   glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+
+   glGenFramebuffers( 1, &this->fbo );
+   glBindFramebuffer( GL_FRAMEBUFFER, this->fbo );
+   glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->color );
+   glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depth );
+   bool complete = glCheckFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE;
+   glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+   if( !complete )
+   {
+      this->destroy();
+      return false;
+   }
+   this->width = width;
+   this->height = height;
+   return true;
+}
+
+void BoidOffscreenTarget::bind() const
+{
+   glBindFramebuffer( GL_FRAMEBUFFER, this->fbo );
+   glViewport( 0, 0, this->width, this->height );
+}
+
+void BoidOffscreenTarget::unbind() const
+{
+   glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+BoidFrameCapture::~BoidFrameCapture()
+{
+   for( Slot& s : this->slots )
+   {
+      if( s.fence ) glDeleteSync( s.fence );
+      if( s.pbo )   glDeleteBuffers( 1, &s.pbo );
+   }
+}
+
+void BoidFrameCapture::capture( int frame, int width, int height, BoidFrameEncoder& encoder )
+{
+   Slot& s = this->slots[this->next]; // drained by the previous call
+   const GLsizeiptr bytes = static_cast< GLsizeiptr >( width ) * height * 4;
+   if( !s.pbo )
+      glGenBuffers( 1, &s.pbo );
+   glBindBuffer( GL_PIXEL_PACK_BUFFER, s.pbo );
+   if( s.size < bytes )
+   {
+      glBufferData( GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ );
+      s.size = bytes;
+   }
+   glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+   glReadPixels( 0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr );
+   glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+   s.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   s.frame = frame;
+   s.width = width;
+   s.height = height;
+   ++this->captured;
+
+   // The other buffer holds the previous capture
+   this->next = 1 - this->next;
+   if( this->slots[this->next].fence )
+      this->drain( this->slots[this->next], encoder );
+}
+
+void BoidFrameCapture::flush( BoidFrameEncoder& encoder )
+{
+   Slot& last = this->slots[1 - this->next];
+   if( last.fence )
+      this->drain( last, encoder );
+}
+
+void BoidFrameCapture::drain( Slot& s, BoidFrameEncoder& encoder )
+{
+   GLenum status = glClientWaitSync( s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+   if( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED )
+   {
+      ++this->stalls;
+      while( status == GL_TIMEOUT_EXPIRED )
+         status = glClientWaitSync( s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull );
+   }
+   glDeleteSync( s.fence );
+   s.fence = nullptr;
+
+   const size_t bytes = static_cast< size_t >( s.width ) * s.height * 4;
+   std::vector< uint8_t > pixels = encoder.acquireBuffer();
+   pixels.resize( bytes );
+
+   glBindBuffer( GL_PIXEL_PACK_BUFFER, s.pbo );
+   void* ptr = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, static_cast< GLsizeiptr >( bytes ), GL_MAP_READ_BIT );
+   if( ptr )
+   {
+      std::memcpy( pixels.data(), ptr, bytes );
+      glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+   }
+   glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+   if( ptr && encoder.submit( s.frame, s.width, s.height, std::move( pixels ) ) )
+      ++this->encoderWaits;
+}
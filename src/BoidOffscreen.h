@@ -0,0 +1,73 @@
+#pragma once
+
+#include "GLView.h"
+#include <cstdint>
+
+namespace Aftr
+{
+class BoidFrameEncoder;
+
+/// Framebuffer object with RGBA8 color and 24-bit depth renderbuffers, the headless draw target
+class BoidOffscreenTarget
+{
+public:
+   ~BoidOffscreenTarget();
+
+   /// false when the driver rejects the attachments at this size
+   bool create( int width, int height );
+   void bind() const;   ///< draw and read framebuffer, viewport covering the target
+   void unbind() const;
+
+   GLuint getFramebuffer() const { return this->fbo; }
+   int getWidth() const { return this->width; }
+   int getHeight() const { return this->height; }
+
+private:
+   void destroy();
+
+   GLuint fbo = 0;
+   GLuint color = 0;
+   GLuint depth = 0;
+   int width = 0;
+   int height = 0;
+};
+
+/**
+   Readback of rendered frames through two pixel pack buffers. capture() queues a glReadPixels
+   of the bound read framebuffer into one buffer and then hands the frame captured one call
+   earlier, from the other buffer, to the encoder; that copy has had a whole frame of GPU work
+   to land, so mapping it rarely waits. A capture that does wait is counted as a stall.
+*/
+class BoidFrameCapture
+{
+public:
+   ~BoidFrameCapture();
+
+   void capture( int frame, int width, int height, BoidFrameEncoder& encoder );
+   /// Hands over the frame still in flight, e.g. after the last capture
+   void flush( BoidFrameEncoder& encoder );
+
+   uint64_t getCaptured() const { return this->captured; }
+   uint64_t getStalls() const { return this->stalls; }         ///< maps that waited for the GPU
+   uint64_t getEncoderWaits() const { return this->encoderWaits; } ///< submits that waited for the disk
+
+private:
+   struct Slot
+   {
+      GLuint pbo = 0;
+      GLsizeiptr size = 0;
+      GLsync fence = nullptr;
+      int frame = 0;
+      int width = 0;
+      int height = 0;
+   };
+   void drain( Slot& slot, BoidFrameEncoder& encoder );
+
+   Slot slots[2];
+   int next = 0;
+   uint64_t captured = 0;
+   uint64_t stalls = 0;
+   uint64_t encoderWaits = 0;
+};
+
+} //namespace Aftr
@@ -0,0 +1,243 @@
+#include "BoidProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <iostream>
+
+using namespace Aftr;
+
+std::atomic< bool > BoidProfiler::capturing{ false };
+std::atomic< uint64_t > BoidProfiler::generation{ 0 };
+std::atomic< BoidProfiler::ThreadBuffer* > BoidProfiler::threads{ nullptr };
+
+// Events of one thread. Only the owner writes; the flush reads up to the published counts.
+// Buffers are never freed: a thread that exits retires its buffer and the next new thread
+// takes it over, so short-lived threads (std::async) don't grow the registry.
+struct BoidProfiler::ThreadBuffer
+{
+   static constexpr uint32_t CHUNK_EVENTS = 4096;
+   struct Chunk
+   {
+      BoidTraceEvent events[CHUNK_EVENTS];
+      std::atomic< uint32_t > count{ 0 };
+      std::atomic< Chunk* > next{ nullptr };
+   };
+
+   uint32_t tid = 0;
+   std::atomic< const char* > name{ nullptr };
+   std::atomic< uint64_t > generation{ 0 };
+   std::atomic< bool > retired{ false };
+   Chunk first;
+   Chunk* tail = &first;          // owner only
+   ThreadBuffer* nextThread = nullptr; // immutable once registered
+};
+
+namespace
+{
+   std::atomic< uint32_t > nextTid{ 1 }; // 0 is the GPU track
+
+   void appendEscaped( std::string& out, const char* s )
+   {
+      for( ; s && *s; ++s )
+      {
+         if( *s == '"' || *s == '\\' )
+            out += '\\';
+         out += *s;
+      }
+   }
+}
+
+BoidProfiler& BoidProfiler::get()
+{
+   static BoidProfiler profiler;
+   return profiler;
+}
+
+BoidProfiler::~BoidProfiler()
+{
+   if( this->writeJob.valid() )
+      this->writeJob.wait();
+}
+
+int64_t BoidProfiler::nowNs()
+{
+   return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+BoidProfiler::ThreadBuffer& BoidProfiler::threadBuffer()
+{
+   struct Holder
+   {
+      ~Holder()
+      {
+         if( this->buffer )
+            this->buffer->retired.store( true, std::memory_order_release );
+      }
+      ThreadBuffer* buffer = nullptr;
+   };
+   thread_local Holder holder;
+   if( holder.buffer )
+      return *holder.buffer;
+
+   for( ThreadBuffer* b = threads.load( std::memory_order_acquire ); b; b = b->nextThread )
+   {
+      bool expected = true;
+      if( b->retired.compare_exchange_strong( expected, false, std::memory_order_acq_rel ) )
+      {
+         b->name.store( nullptr, std::memory_order_release );
+         holder.buffer = b;
+         return *b;
+      }
+   }
+
+   ThreadBuffer* b = new ThreadBuffer();
+   b->tid = nextTid.fetch_add( 1, std::memory_order_relaxed );
+   b->nextThread = threads.load( std::memory_order_relaxed );
+   while( !threads.compare_exchange_weak( b->nextThread, b, std::memory_order_release, std::memory_order_relaxed ) )
+      ;
+   holder.buffer = b;
+   return *b;
+}
+
+void BoidProfiler::setThreadName( const char* name )
+{
+   threadBuffer().name.store( name, std::memory_order_release );
+}
+
+void BoidProfiler::record( const char* name, int64_t beginNs, int64_t endNs )
+{
+   ThreadBuffer& b = threadBuffer();
+
+   // First event of a new capture: start over in the chunks we already have
+   const uint64_t gen = generation.load( std::memory_order_acquire );
+   if( b.generation.load( std::memory_order_relaxed ) != gen )
+   {
+      for( ThreadBuffer::Chunk* c = &b.first; c; c = c->next.load( std::memory_order_relaxed ) )
+         c->count.store( 0, std::memory_order_relaxed );
+      b.tail = &b.first;
+      b.generation.store( gen, std::memory_order_release );
+   }
+
+   ThreadBuffer::Chunk* c = b.tail;
+   uint32_t n = c->count.load( std::memory_order_relaxed );
+   if( n == ThreadBuffer::CHUNK_EVENTS )
+   {
+      ThreadBuffer::Chunk* next = c->next.load( std::memory_order_relaxed );
+      if( !next )
+      {
+         next = new ThreadBuffer::Chunk();
+         c->next.store( next, std::memory_order_release );
+      }
+      c = b.tail = next;
+      n = 0;
+   }
+   c->events[n] = BoidTraceEvent{ name, beginNs, endNs - beginNs };
+   c->count.store( n + 1, std::memory_order_release );
+}
+
+bool BoidProfiler::beginCapture( int numFrames, std::string path )
+{
+   if( isCapturing() || this->isWriting() || numFrames <= 0 )
+      return false;
+
+   this->gpuEvents.clear();
+   this->path = std::move( path );
+   this->framesRemaining = numFrames;
+   generation.fetch_add( 1, std::memory_order_acq_rel );
+   capturing.store( true, std::memory_order_release );
+   return true;
+}
+
+void BoidProfiler::endFrame()
+{
+   if( !isCapturing() )
+      return;
+   if( --this->framesRemaining <= 0 )
+      this->finishCapture();
+}
+
+void BoidProfiler::addGpuZone( const char* name, int64_t beginNs, int64_t endNs )
+{
+   this->gpuEvents.push_back( BoidTraceEvent{ name, beginNs, endNs - beginNs } );
+}
+
+void BoidProfiler::finishCapture()
+{
+   capturing.store( false, std::memory_order_release );
+   const uint64_t gen = generation.load( std::memory_order_acquire );
+
+   // Copy whatever each thread has committed; threads keep running undisturbed
+   std::vector< std::pair< uint32_t, BoidTraceEvent > > events;
+   std::vector< std::pair< uint32_t, std::string > > names = { { 0u, "GPU" } };
+   for( const BoidTraceEvent& e : this->gpuEvents )
+      events.emplace_back( 0u, e );
+   for( ThreadBuffer* b = threads.load( std::memory_order_acquire ); b; b = b->nextThread )
+   {
+      if( b->generation.load( std::memory_order_acquire ) != gen )
+         continue;
+      const char* name = b->name.load( std::memory_order_acquire );
+      names.emplace_back( b->tid, name ? name : "Thread" );
+      for( const ThreadBuffer::Chunk* c = &b->first; c; c = c->next.load( std::memory_order_acquire ) )
+      {
+         const uint32_t n = c->count.load( std::memory_order_acquire );
+         for( uint32_t i = 0; i < n; ++i )
+            events.emplace_back( b->tid, c->events[i] );
+         if( n < ThreadBuffer::CHUNK_EVENTS )
+            break;
+      }
+   }
+
+   this->lastEventCount = events.size();
+   this->lastFile = this->path;
+   std::cout << "BoidProfiler: writing " << events.size() << " events to " << this->path << std::endl;
+   this->writeJob = std::async( std::launch::async, &BoidProfiler::writeJson, this->path, std::move( events ), std::move( names ) );
+}
+
+bool BoidProfiler::isWriting()
+{
+   if( !this->writeJob.valid() )
+      return false;
+   if( this->writeJob.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+      return true;
+   if( !this->writeJob.get() )
+      std::cout << "BoidProfiler: could not write " << this->lastFile << std::endl;
+   return false;
+}
+
+bool BoidProfiler::writeJson( const std::string& path, const std::vector< std::pair< uint32_t, BoidTraceEvent > >& events,
+                              const std::vector< std::pair< uint32_t, std::string > >& threadNames )
+{
+   int64_t originNs = std::numeric_limits< int64_t >::max();
+   for( const auto& [tid, e] : events )
+      originNs = std::min( originNs, e.beginNs );
+
+   std::string out;
+   out.reserve( 96 * ( events.size() + threadNames.size() ) + 128 );
+   out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+   out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"BoidSwarm\"}}";
+   char buf[160];
+   for( const auto& [tid, name] : threadNames )
+   {
+      std::snprintf( buf, sizeof( buf ), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", tid );
+      out += buf;
+      appendEscaped( out, name.c_str() );
+      out += "\"}}";
+   }
+   for( const auto& [tid, e] : events )
+   {
+      out += ",\n{\"name\":\"";
+      appendEscaped( out, e.name );
+      std::snprintf( buf, sizeof( buf ), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     tid, ( e.beginNs - originNs ) * 1e-3, e.durNs * 1e-3 );
+      out += buf;
+   }
+   out += "\n]}\n";
+
+   FILE* f = std::fopen( path.c_str(), "wb" );
+   if( !f )
+      return false;
+   bool ok = std::fwrite( out.data(), 1, out.size(), f ) == out.size();
+   return std::fclose( f ) == 0 && ok;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+
+/// One finished zone, in nanoseconds of BoidProfiler::nowNs()
+struct BoidTraceEvent
+{
+   const char* name = nullptr; // must outlive the capture (string literals)
+   int64_t beginNs = 0;
+   int64_t durNs = 0;
+};
+
+/**
+   Frame profiler writing Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+
+   Zones (BOID_PROFILE_ZONE) append to a buffer owned by the recording thread: fixed-size
+   chunks whose event counts are published with release stores, so recording never locks and
+   the flush on the main thread reads every thread's committed events without stopping it.
+   While no capture is running a zone costs one relaxed atomic load.
+
+   beginCapture() arms the profiler for N frames; the main thread calls endFrame() once per
+   frame and the last one gathers all threads plus the GPU zones handed in through
+   addGpuZone(), then writes the file on a background thread.
+*/
+class BoidProfiler
+{
+public:
+   static BoidProfiler& get();
+
+   static bool isCapturing() { return capturing.load( std::memory_order_relaxed ); }
+   static int64_t nowNs();
+   /// Names the calling thread's track in the trace
+   static void setThreadName( const char* name );
+   /// Records a zone for the calling thread
+   static void record( const char* name, int64_t beginNs, int64_t endNs );
+
+   /// Starts capturing 'numFrames' frames into 'path'; false while a capture or its write is running
+   bool beginCapture( int numFrames, std::string path );
+   /// Main thread, once per frame
+   void endFrame();
+   /// Main thread; zones measured on the GPU, already converted to the CPU clock
+   void addGpuZone( const char* name, int64_t beginNs, int64_t endNs );
+
+   int getFramesRemaining() const { return this->framesRemaining; }
+   bool isWriting();
+   const std::string& getLastFile() const { return this->lastFile; }
+   size_t getLastEventCount() const { return this->lastEventCount; }
+
+   ~BoidProfiler();
+
+private:
+   BoidProfiler() = default;
+   struct ThreadBuffer;
+   static ThreadBuffer& threadBuffer();
+   void finishCapture();
+   static bool writeJson( const std::string& path, const std::vector< std::pair< uint32_t, BoidTraceEvent > >& events,
+                          const std::vector< std::pair< uint32_t, std::string > >& threadNames );
+
+   static std::atomic< bool > capturing;
+   static std::atomic< uint64_t > generation;
+   static std::atomic< ThreadBuffer* > threads; // registry, grows only
+
+   int framesRemaining = 0;
+   std::string path;
+   std::vector< BoidTraceEvent > gpuEvents;
+   std::future< bool > writeJob;
+   std::string lastFile;
+   size_t lastEventCount = 0;
+};
+
+/// Records the enclosing scope as a zone of the calling thread while a capture runs
+class BoidProfileZone
+{
+public:
+   explicit BoidProfileZone( const char* name ) : name( BoidProfiler::isCapturing() ? name : nullptr )
+   {
+      if( this->name )
+         this->beginNs = BoidProfiler::nowNs();
+   }
+   ~BoidProfileZone()
+   {
+      if( this->name )
+         BoidProfiler::record( this->name, this->beginNs, BoidProfiler::nowNs() );
+   }
+   BoidProfileZone( const BoidProfileZone& ) = delete;
+   BoidProfileZone& operator=( const BoidProfileZone& ) = delete;
+
+private:
+   const char* name;
+   int64_t beginNs = 0;
+};
+
+#define BOID_PROFILE_CAT2( a, b ) a##b
+#define BOID_PROFILE_CAT( a, b ) BOID_PROFILE_CAT2( a, b )
+#define BOID_PROFILE_ZONE( name ) ::Aftr::BoidProfileZone BOID_PROFILE_CAT( boidProfileZone, __LINE__ )( name )
+
+} //namespace Aftr
@@ -0,0 +1,270 @@
+#include "BoidProgramCache.h"
+#include "ManagerEnvironmentConfiguration.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace Aftr;
+
+#ifndef GL_COMPLETION_STATUS_KHR
+   #define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+   struct BinaryHeader
+   {
+      char magic[4] = { 'B', 'P', 'B', '1' };
+      uint32_t format = 0;
+      uint32_t length = 0;
+      uint32_t reserved = 0;
+      uint64_t key = 0;
+   };
+
+   uint64_t fnv1a( uint64_t h, const void* data, size_t len )
+   {
+      const unsigned char* p = static_cast< const unsigned char* >( data );
+      for( size_t i = 0; i < len; ++i )
+      {
+         h ^= p[i];
+         h *= 0x100000001b3ull;
+      }
+      return h;
+   }
+
+   bool hasExtension( const char* name )
+   {
+      GLint n = 0;
+      glGetIntegerv( GL_NUM_EXTENSIONS, &n );
+      for( GLint i = 0; i < n; ++i )
+      {
+         const char* ext = reinterpret_cast< const char* >( glGetStringi( GL_EXTENSIONS, i ) );
+         if( ext && std::strcmp( ext, name ) == 0 )
+            return true;
+      }
+      return false;
+   }
+
+   void printShaderLog( GLuint shader, const std::string& label )
+   {
+      GLint success = 0;
+      glGetShaderiv( shader, GL_COMPILE_STATUS, &success );
+      if( !success )
+      {
+         char log[1024];
+         glGetShaderInfoLog( shader, 1024, nullptr, log );
+         std::cout << "Shader compile error (" << label << "):\n" << log << std::endl;
+      }
+   }
+}
+
+BoidProgramCache::BoidProgramCache( std::string cacheDir ) : cacheDir( std::move( cacheDir ) )
+{
+}
+
+BoidProgramCache::~BoidProgramCache()
+{
+   for( auto& [prog, p] : this->pending )
+   {
+      for( GLuint s : p.shaders )
+         glDeleteShader( s );
+      glDeleteProgram( prog );
+   }
+}
+
+void BoidProgramCache::initDriverInfo()
+{
+   auto str = []( GLenum e ) { const GLubyte* s = glGetString( e ); return s ? std::string( reinterpret_cast< const char* >( s ) ) : std::string(); };
+   this->driverString = str( GL_VENDOR ) + "|" + str( GL_RENDERER ) + "|" + str( GL_VERSION );
+
+   GLint numFormats = 0;
+   glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+   this->binariesSupported = numFormats > 0;
+
+   // Let the driver compile on its own threads when it can
+   typedef void ( APIENTRY* MaxShaderCompilerThreadsFn )( GLuint );
+   const char* exts[2][2] = { { "GL_KHR_parallel_shader_compile", "glMaxShaderCompilerThreadsKHR" },
+                              { "GL_ARB_parallel_shader_compile", "glMaxShaderCompilerThreadsARB" } };
+   for( auto& e : exts )
+   {
+      if( !hasExtension( e[0] ) )
+         continue;
+      auto fn = reinterpret_cast< MaxShaderCompilerThreadsFn >( SDL_GL_GetProcAddress( e[1] ) );
+      if( fn )
+         fn( 0xFFFFFFFFu );
+      this->parallelCompile = true;
+      break;
+   }
+
+   if( this->cacheDir.empty() )
+      this->cacheDir = ManagerEnvironmentConfiguration::getVariableValue( "boidshadercachedir" );
+   if( this->cacheDir.empty() )
+      this->cacheDir = "./boid_shader_cache/";
+   std::error_code ec;
+   std::filesystem::create_directories( this->cacheDir, ec );
+
+   std::cout << "Program cache: " << this->cacheDir << ( this->binariesSupported ? "" : " (binaries unsupported)" )
+             << ( this->parallelCompile ? ", parallel compile" : "" ) << std::endl;
+}
+
+uint64_t BoidProgramCache::makeKey( const std::vector< BoidShaderStage >& stages ) const
+{
+   uint64_t h = 0xcbf29ce484222325ull;
+   h = fnv1a( h, this->driverString.data(), this->driverString.size() );
+   for( const auto& s : stages )
+   {
+      h = fnv1a( h, &s.type, sizeof( s.type ) );
+      h = fnv1a( h, s.source.data(), s.source.size() );
+   }
+   return h;
+}
+
+std::string BoidProgramCache::pathFor( uint64_t key ) const
+{
+   std::ostringstream ss;
+   ss << std::hex << key;
+   return ( std::filesystem::path( this->cacheDir ) / ( ss.str() + ".bin" ) ).string();
+}
+
+bool BoidProgramCache::loadBinary( GLuint program, uint64_t key ) const
+{
+   if( !this->binariesSupported )
+      return false;
+   std::ifstream in( this->pathFor( key ), std::ios::binary );
+   if( !in )
+      return false;
+
+   BinaryHeader hdr;
+   in.read( reinterpret_cast< char* >( &hdr ), sizeof( hdr ) );
+   if( !in || std::memcmp( hdr.magic, "BPB1", 4 ) != 0 || hdr.key != key || hdr.length == 0 )
+      return false;
+   std::vector< char > blob( hdr.length );
+   in.read( blob.data(), blob.size() );
+   if( !in )
+      return false;
+
+   glProgramBinary( program, hdr.format, blob.data(), static_cast< GLsizei >( blob.size() ) );
+   GLint linked = 0;
+   glGetProgramiv( program, GL_LINK_STATUS, &linked );
+   return linked != 0;
+}
+
+void BoidProgramCache::storeBinary( GLuint program, uint64_t key ) const
+{
+   if( !this->binariesSupported )
+      return;
+   GLint length = 0;
+   glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &length );
+   if( length <= 0 )
+      return;
+
+   std::vector< char > blob( length );
+   BinaryHeader hdr;
+   GLenum format = 0;
+   glGetProgramBinary( program, length, nullptr, &format, blob.data() );
+   hdr.format = format;
+   hdr.length = static_cast< uint32_t >( length );
+   hdr.key = key;
+
+   // Write then rename so a concurrently starting instance never reads a torn file
+   std::string path = this->pathFor( key );
+   std::string tmp = path + ".tmp";
+   {
+      std::ofstream out( tmp, std::ios::binary | std::ios::trunc );
+      if( !out )
+         return;
+      out.write( reinterpret_cast< const char* >( &hdr ), sizeof( hdr ) );
+      out.write( blob.data(), blob.size() );
+   }
+   std::error_code ec;
+   std::filesystem::rename( tmp, path, ec );
+}
+
+GLuint BoidProgramCache::compileAsync( const std::vector< BoidShaderStage >& stages, const std::string& label )
+{
+   if( this->driverString.empty() )
+      this->initDriverInfo();
+
+   uint64_t key = this->makeKey( stages );
+   GLuint prog = glCreateProgram();
+   if( this->loadBinary( prog, key ) )
+   {
+      ++this->numHits;
+      this->pending[prog] = Pending{ label, key, {} };
+      return prog;
+   }
+   ++this->numMisses;
+
+   // (Re)create the program: a rejected binary may leave it in an unusable state
+   glDeleteProgram( prog );
+   prog = glCreateProgram();
+
+   Pending p{ label, key, {} };
+   for( const auto& s : stages )
+   {
+      GLuint shader = glCreateShader( s.type );
+      const char* src = s.source.c_str();
+      glShaderSource( shader, 1, &src, nullptr );
+      glCompileShader( shader );
+      glAttachShader( prog, shader );
+      p.shaders.push_back( shader );
+   }
+   glProgramParameteri( prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+   glLinkProgram( prog );
+
+   this->pending[prog] = std::move( p );
+   return prog;
+}
+
+bool BoidProgramCache::isReady( GLuint program ) const
+{
+   auto it = this->pending.find( program );
+   if( it == this->pending.end() || it->second.shaders.empty() || !this->parallelCompile )
+      return true;
+   GLint done = GL_TRUE;
+   glGetProgramiv( program, GL_COMPLETION_STATUS_KHR, &done );
+   return done == GL_TRUE;
+}
+
+GLuint BoidProgramCache::finish( GLuint program )
+{
+   auto it = this->pending.find( program );
+   if( it == this->pending.end() )
+      return program;
+   Pending p = std::move( it->second );
+   this->pending.erase( it );
+
+   GLint linked = 0;
+   glGetProgramiv( program, GL_LINK_STATUS, &linked );
+   if( !linked )
+   {
+      for( GLuint s : p.shaders )
+         printShaderLog( s, p.label );
+      char log[1024];
+      glGetProgramInfoLog( program, 1024, nullptr, log );
+      std::cout << "Program link error (" << p.label << "):\n" << log << std::endl;
+   }
+   else if( !p.shaders.empty() )
+      this->storeBinary( program, p.key );
+
+   for( GLuint s : p.shaders )
+   {
+      glDetachShader( program, s );
+      glDeleteShader( s );
+   }
+
+   if( !linked )
+   {
+      glDeleteProgram( program );
+      return 0;
+   }
+   return program;
+}
+
+GLuint BoidProgramCache::build( const std::vector< BoidShaderStage >& stages, const std::string& label )
+{
+   return this->finish( this->compileAsync( stages, label ) );
+}
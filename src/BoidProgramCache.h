@@ -0,0 +1,68 @@
+#pragma once
+
+#include "GLView.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+
+struct BoidShaderStage
+{
+   GLenum type;
+   std::string source;
+};
+
+/**
+   Builds GL programs through an on-disk cache of program binaries. Binaries are keyed by a
+   hash of the stage sources and the driver (vendor/renderer/version) string, so a driver
+   update or a shader edit simply misses the cache. A binary the driver rejects falls back to
+   compiling from source and is overwritten.
+
+   compileAsync() returns right away with a program name; when the driver exposes
+   GL_KHR/ARB_parallel_shader_compile the compile runs on driver threads and isReady() can be
+   polled without blocking. finish() waits for the link, reports errors and stores the binary.
+*/
+class BoidProgramCache
+{
+public:
+   explicit BoidProgramCache( std::string cacheDir = "" ); ///< "" = aftr.conf boidShaderCacheDir, or ./boid_shader_cache/
+   ~BoidProgramCache();
+
+   GLuint compileAsync( const std::vector< BoidShaderStage >& stages, const std::string& label );
+   bool isReady( GLuint program ) const;
+   /// Completes a compileAsync() program. Returns the program, or 0 (program deleted) if it failed to link.
+   GLuint finish( GLuint program );
+   /// compileAsync() + finish()
+   GLuint build( const std::vector< BoidShaderStage >& stages, const std::string& label );
+
+   bool hasParallelCompile() const { return this->parallelCompile; }
+   int getNumHits() const { return this->numHits; }
+   int getNumMisses() const { return this->numMisses; }
+
+private:
+   struct Pending
+   {
+      std::string label;
+      uint64_t key = 0;
+      std::vector< GLuint > shaders;
+   };
+
+   void initDriverInfo();
+   uint64_t makeKey( const std::vector< BoidShaderStage >& stages ) const;
+   std::string pathFor( uint64_t key ) const;
+   bool loadBinary( GLuint program, uint64_t key ) const;
+   void storeBinary( GLuint program, uint64_t key ) const;
+
+   std::string cacheDir;
+   std::string driverString;
+   bool binariesSupported = false;
+   bool parallelCompile = false;
+   std::map< GLuint, Pending > pending;
+   int numHits = 0;
+   int numMisses = 0;
+};
+
+} //namespace Aftr
@@ -0,0 +1,78 @@
+#include "BoidReadback.h"
+
+#include <cstring>
+
+using namespace Aftr;
+
+BoidReadback::~BoidReadback()
+{
+   this->cancel();
+   if( this->staging )
+      glDeleteBuffers( 1, &this->staging );
+}
+
+bool BoidReadback::request( GLuint srcBuffer, int numBoids, int numPredators, uint64_t frame )
+{
+   if( this->fence )
+      return false;
+
+   GLsizeiptr bytes = static_cast< GLsizeiptr >( numBoids + numPredators ) * sizeof( BoidGPU );
+   if( bytes <= 0 )
+      return false;
+
+   if( !this->staging )
+      glGenBuffers( 1, &this->staging );
+   if( this->stagingSize < bytes )
+   {
+      glBindBuffer( GL_COPY_WRITE_BUFFER, this->staging );
+      glBufferData( GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_READ );
+      this->stagingSize = bytes;
+   }
+
+   glBindBuffer( GL_COPY_READ_BUFFER, srcBuffer );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, this->staging );
+   glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes );
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+   this->fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   this->pendingBoids = numBoids;
+   this->pendingPredators = numPredators;
+   this->pendingFrame = frame;
+   return true;
+}
+
+bool BoidReadback::poll( BoidSnapshot& out )
+{
+   if( !this->fence )
+      return false;
+
+   GLenum status = glClientWaitSync( this->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+   if( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED )
+      return false;
+   glDeleteSync( this->fence );
+   this->fence = nullptr;
+
+   GLsizeiptr bytes = static_cast< GLsizeiptr >( this->pendingBoids + this->pendingPredators ) * sizeof( BoidGPU );
+   out.boids.resize( this->pendingBoids + this->pendingPredators );
+   out.numBoids = this->pendingBoids;
+   out.numPredators = this->pendingPredators;
+   out.frame = this->pendingFrame;
+
+   glBindBuffer( GL_COPY_READ_BUFFER, this->staging );
+   void* ptr = glMapBufferRange( GL_COPY_READ_BUFFER, 0, bytes, GL_MAP_READ_BIT );
+   if( ptr )
+   {
+      std::memcpy( out.boids.data(), ptr, bytes );
+      glUnmapBuffer( GL_COPY_READ_BUFFER );
+   }
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   return ptr != nullptr;
+}
+
+void BoidReadback::cancel()
+{
+   if( this->fence )
+      glDeleteSync( this->fence );
+   this->fence = nullptr;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "GLView.h"
+#include "BoidSwarmTypes.h"
+
+namespace Aftr
+{
+
+/**
+   Asynchronous copy of a boid SSBO back to the CPU. request() queues a GPU-side copy into a
+   staging buffer and a fence; poll() returns true once the copy has landed and fills the
+   snapshot without ever stalling the pipeline. Only one copy is in flight at a time.
+*/
+class BoidReadback
+{
+public:
+   ~BoidReadback();
+
+   /// Returns false (and does nothing) while a previous request is still pending
+   bool request( GLuint srcBuffer, int numBoids, int numPredators, uint64_t frame );
+   bool poll( BoidSnapshot& out );
+   bool isPending() const { return this->fence != nullptr; }
+   /// Drops a pending copy, e.g. after the source buffers were resized
+   void cancel();
+
+private:
+   GLuint staging = 0;
+   GLsizeiptr stagingSize = 0;
+   GLsync fence = nullptr;
+   int pendingBoids = 0;
+   int pendingPredators = 0;
+   uint64_t pendingFrame = 0;
+};
+
+} //namespace Aftr
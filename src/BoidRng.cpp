@@ -0,0 +1,167 @@
+#include "BoidRng.h"
+#include "BoidThreadPool.h"
+#include "BoidProfiler.h"
+
+using namespace Aftr;
+
+namespace
+{
+   // Lattice: coordinates in [-2^14, 2^14), ball radius 2^14
+   constexpr int32_t LATTICE_RADIUS = 16384;
+   constexpr int32_t LATTICE_RADIUS_SQ = LATTICE_RADIUS * LATTICE_RADIUS;
+   constexpr float LATTICE_INV = 1.0f / 16384.0f;
+   constexpr uint32_t MAX_ATTEMPTS = 16;
+
+   enum Stream : uint32_t { BOID_POS = 0, BOID_VEL = 1, PRED_POS = 2, PRED_VEL = 3 };
+
+   void sampleBall( uint32_t entity, uint32_t stream, const uint32_t key[2], int32_t p[3] )
+   {
+      uint32_t r[4];
+      for( uint32_t a = 0; a < MAX_ATTEMPTS; ++a )
+      {
+         const uint32_t ctr[4] = { entity, stream, a, 0u };
+         BoidRng::philox4x32( ctr, key, r );
+         for( int k = 0; k < 3; ++k )
+            p[k] = static_cast< int32_t >( r[k] >> 17 ) - LATTICE_RADIUS;
+         if( p[0] * p[0] + p[1] * p[1] + p[2] * p[2] <= LATTICE_RADIUS_SQ )
+            return;
+      }
+      // ~7e-6 chance: halving the last candidate always lands inside
+      for( int k = 0; k < 3; ++k )
+         p[k] >>= 1;
+   }
+}
+
+void BoidRng::philox4x32( const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4] )
+{
+   uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+   uint32_t k0 = key[0], k1 = key[1];
+   for( int round = 0; round < 10; ++round )
+   {
+      const uint64_t p0 = static_cast< uint64_t >( 0xD2511F53u ) * c0;
+      const uint64_t p1 = static_cast< uint64_t >( 0xCD9E8D57u ) * c2;
+      const uint32_t hi0 = static_cast< uint32_t >( p0 >> 32 ), lo0 = static_cast< uint32_t >( p0 );
+      const uint32_t hi1 = static_cast< uint32_t >( p1 >> 32 ), lo1 = static_cast< uint32_t >( p1 );
+      c0 = hi1 ^ c1 ^ k0;
+      c1 = lo1;
+      c2 = hi0 ^ c3 ^ k1;
+      c3 = lo0;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+   }
+   out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+void BoidRng::getScales( const BoidSpawnParams& spawn, float scales[4] )
+{
+   scales[0] = spawn.boidRadius * LATTICE_INV;
+   scales[1] = spawn.boidSpeed * LATTICE_INV;
+   scales[2] = spawn.predatorRadius * LATTICE_INV;
+   scales[3] = spawn.predatorSpeed * LATTICE_INV;
+}
+
+BoidGPU BoidRng::spawn( uint32_t index, int numBoids, uint64_t seed, const BoidSpawnParams& spawn )
+{
+   const uint32_t key[2] = { static_cast< uint32_t >( seed ), static_cast< uint32_t >( seed >> 32 ) };
+   float scales[4];
+   getScales( spawn, scales );
+
+   int32_t p[3], v[3];
+   if( index < static_cast< uint32_t >( numBoids ) )
+   {
+      sampleBall( index, BOID_POS, key, p );
+      sampleBall( index, BOID_VEL, key, v );
+      BoidGPU b = { p[0] * scales[0], p[1] * scales[0], p[2] * scales[0], 0.0f,
+                    v[0] * scales[1], v[1] * scales[1], v[2] * scales[1], 0.0f };
+      // Ensure non-zero initial velocity so boids start moving (|v| < half the spawn speed)
+      if( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] < LATTICE_RADIUS_SQ / 4 )
+      {
+         b.vx = 0.1f; b.vy = 0.1f; b.vz = 0.0f;
+      }
+      return b;
+   }
+
+   sampleBall( index, PRED_POS, key, p );
+   sampleBall( index, PRED_VEL, key, v );
+   return { p[0] * scales[2], p[1] * scales[2], p[2] * scales[2], 1.0f,
+            v[0] * scales[3], v[1] * scales[3], v[2] * scales[3], 0.0f };
+}
+
+void BoidRng::initSwarm( BoidGPU* out, int numBoids, int numPredators, uint64_t seed,
+                         const BoidSpawnParams& spawn, BoidThreadPool& pool )
+{
+   BOID_PROFILE_ZONE( "BoidRng::initSwarm" );
+   const uint32_t total = static_cast< uint32_t >( numBoids + numPredators );
+   pool.parallelFor( total, 4096, [&]( uint32_t begin, uint32_t end )
+   {
+      for( uint32_t i = begin; i < end; ++i )
+         out[i] = BoidRng::spawn( i, numBoids, seed, spawn );
+   } );
+}
+
+const char* BoidRng::getInitShaderSource()
+{
+   return R"(
+#version 430
+layout(local_size_x = 256) in;
+
+struct BoidData {
+    vec4 pos;
+    vec4 vel;
+};
+
+layout(std430, binding = 0) writeonly buffer BoidBufA { BoidData boidsA[]; };
+layout(std430, binding = 1) writeonly buffer BoidBufB { BoidData boidsB[]; };
+
+uniform int   u_numBoids;
+uniform int   u_numPredators;
+uniform uvec2 u_seed;  // lo, hi
+uniform vec4  u_scale; // boid pos, boid vel, predator pos, predator vel
+uniform int   u_base;  // first entity of the swarm in the buffers (ensembles), 0 otherwise
+
+uvec4 philox4x32(uvec4 c, uvec2 k) {
+    for (int r = 0; r < 10; ++r) {
+        uint hi0, lo0, hi1, lo1;
+        umulExtended(0xD2511F53u, c.x, hi0, lo0);
+        umulExtended(0xCD9E8D57u, c.z, hi1, lo1);
+        c = uvec4(hi1 ^ c.y ^ k.x, lo1, hi0 ^ c.w ^ k.y, lo0);
+        k += uvec2(0x9E3779B9u, 0xBB67AE85u);
+    }
+    return c;
+}
+
+// Point of the radius 2^14 integer ball, same attempts and fallback as the CPU code
+ivec3 sampleBall(uint entity, uint stream) {
+    ivec3 p = ivec3(0);
+    for (uint a = 0u; a < 16u; ++a) {
+        uvec4 r = philox4x32(uvec4(entity, stream, a, 0u), u_seed);
+        p = ivec3(r.xyz >> 17u) - ivec3(16384);
+        if (p.x * p.x + p.y * p.y + p.z * p.z <= 268435456)
+            return p;
+    }
+    return p >> 1;
+}
+
+void main() {
+    uint idx = gl_GlobalInvocationID.x;
+    if (idx >= uint(u_numBoids + u_numPredators)) return;
+
+    BoidData b;
+    if (idx < uint(u_numBoids)) {
+        ivec3 p = sampleBall(idx, 0u);
+        ivec3 v = sampleBall(idx, 1u);
+        b.pos = vec4(vec3(p) * u_scale.x, 0.0);
+        b.vel = vec4(vec3(v) * u_scale.y, 0.0);
+        if (v.x * v.x + v.y * v.y + v.z * v.z < 67108864)
+            b.vel = vec4(0.1, 0.1, 0.0, 0.0);
+    } else {
+        ivec3 p = sampleBall(idx, 2u);
+        ivec3 v = sampleBall(idx, 3u);
+        b.pos = vec4(vec3(p) * u_scale.z, 1.0);
+        b.vel = vec4(vec3(v) * u_scale.w, 0.0);
+    }
+    boidsA[uint(u_base) + idx] = b;
+    boidsB[uint(u_base) + idx] = b;
+}
+)";
+}
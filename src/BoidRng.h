@@ -0,0 +1,46 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include <cstdint>
+
+namespace Aftr
+{
+class BoidThreadPool;
+
+/// Spawn volumes for a fresh swarm (radii of the balls positions/velocities are drawn from)
+struct BoidSpawnParams
+{
+   float boidRadius = 15.0f;
+   float boidSpeed = 0.2f;
+   float predatorRadius = 20.0f;
+   float predatorSpeed = 0.05f;
+};
+
+/**
+   Counter-based swarm initialization. Every random number is Philox4x32-10 of
+   (entity index, stream, attempt) under the 64 bit seed, so each entity can be generated
+   independently and in any order. Points in a ball are drawn on a 2^15 integer lattice
+   with integer rejection tests and scaled by one float multiply; this keeps the GLSL pass
+   (getInitShaderSource()) bit-identical to the CPU path on any conforming GPU.
+*/
+class BoidRng
+{
+public:
+   static void philox4x32( const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4] );
+
+   /// Entity 'index' of a swarm whose boids occupy [0, numBoids)
+   static BoidGPU spawn( uint32_t index, int numBoids, uint64_t seed, const BoidSpawnParams& spawn );
+
+   /// Fills out[0 .. numBoids+numPredators) on the pool
+   static void initSwarm( BoidGPU* out, int numBoids, int numPredators, uint64_t seed,
+                          const BoidSpawnParams& spawn, BoidThreadPool& pool );
+
+   /// Compute shader writing the same swarm into the SSBOs at bindings 0 and 1.
+   /// Uniforms: u_numBoids, u_numPredators, u_seed (uvec2 lo/hi), u_scale (vec4, see below) and
+   /// u_base, the index the swarm starts at (ensembles; defaults to 0)
+   static const char* getInitShaderSource();
+   /// Lattice-to-world scales in the order expected by u_scale
+   static void getScales( const BoidSpawnParams& spawn, float scales[4] );
+};
+
+} //namespace Aftr
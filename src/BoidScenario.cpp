@@ -0,0 +1,343 @@
+#include "BoidScenario.h"
+#include "BoidCpuKernel.h"
+#include "BoidNeighborList.h"
+#include "BoidThreadPool.h"
+#include "BoidProfiler.h"
+#include "BoidArena.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <optional>
+#include <sstream>
+
+using namespace Aftr;
+
+namespace
+{
+   struct FloatKey
+   {
+      const char* key;
+      float BoidSwarmParams::* param;
+      float BoidSpawnParams::* spawn;
+   };
+
+   const FloatKey floatKeys[] = {
+      { "separationweight",    &BoidSwarmParams::sepWeight,     nullptr },
+      { "alignmentweight",     &BoidSwarmParams::aliWeight,     nullptr },
+      { "cohesionweight",      &BoidSwarmParams::cohWeight,     nullptr },
+      { "boundaryweight",      &BoidSwarmParams::bndWeight,     nullptr },
+      { "fleeweight",          &BoidSwarmParams::fleWeight,     nullptr },
+      { "obstacleweight",      &BoidSwarmParams::obsWeight,     nullptr },
+      { "noisestrength",       &BoidSwarmParams::noiseStrength, nullptr },
+      { "eatradius",           &BoidSwarmParams::eatRadius,     nullptr },
+      { "separationradius",    &BoidSwarmParams::sepRadius,     nullptr },
+      { "neighborradius",      &BoidSwarmParams::neiRadius,     nullptr },
+      { "fearradius",          &BoidSwarmParams::feaRadius,     nullptr },
+      { "boundaryradius",      &BoidSwarmParams::bndRadius,     nullptr },
+      { "maxspeed",            &BoidSwarmParams::maxSpeed,      nullptr },
+      { "predatorspeed",       &BoidSwarmParams::predSpeed,     nullptr },
+      { "spawnboidradius",     nullptr, &BoidSpawnParams::boidRadius },
+      { "spawnboidspeed",      nullptr, &BoidSpawnParams::boidSpeed },
+      { "spawnpredatorradius", nullptr, &BoidSpawnParams::predatorRadius },
+      { "spawnpredatorspeed",  nullptr, &BoidSpawnParams::predatorSpeed },
+   };
+
+   // Names as written by toText(); parse() compares lower case
+   const char* displayNames[] = {
+      "separationWeight", "alignmentWeight", "cohesionWeight", "boundaryWeight", "fleeWeight",
+      "obstacleWeight", "noiseStrength", "eatRadius", "separationRadius", "neighborRadius",
+      "fearRadius", "boundaryRadius", "maxSpeed", "predatorSpeed", "spawnBoidRadius",
+      "spawnBoidSpeed", "spawnPredatorRadius", "spawnPredatorSpeed",
+   };
+   static_assert( std::size( floatKeys ) == std::size( displayNames ), "one display name per key" );
+
+   using Syntax = BoidScenarioSyntax;
+}
+
+// ============================================================
+// BoidScenarioSyntax
+// ============================================================
+
+std::string BoidScenarioSyntax::trim( const std::string& s )
+{
+   size_t b = s.find_first_not_of( " \t\r" );
+   size_t e = s.find_last_not_of( " \t\r" );
+   return b == std::string::npos ? std::string() : s.substr( b, e - b + 1 );
+}
+
+std::string BoidScenarioSyntax::lower( std::string s )
+{
+   std::transform( s.begin(), s.end(), s.begin(), []( unsigned char c ) { return static_cast< char >( std::tolower( c ) ); } );
+   return s;
+}
+
+bool BoidScenarioSyntax::toFloat( const std::string& s, float& out )
+{
+   char* end = nullptr;
+   out = std::strtof( s.c_str(), &end );
+   return end != s.c_str() && *end == '\0' && std::isfinite( out );
+}
+
+bool BoidScenarioSyntax::toInt( const std::string& s, long long& out )
+{
+   char* end = nullptr;
+   out = std::strtoll( s.c_str(), &end, 10 );
+   return end != s.c_str() && *end == '\0';
+}
+
+bool BoidScenarioSyntax::fail( std::string* error, const std::string& message )
+{
+   if( error )
+      *error = message;
+   return false;
+}
+
+// ============================================================
+// BoidScenario
+// ============================================================
+
+BoidScenario BoidScenario::makeDefault()
+{
+   BoidScenario s;
+   s.name = "classic";
+   s.obstacles = {
+      { 0.0f, 0.0f, 0.0f, 4.0f },    // center pillar
+      { 10.0f, 8.0f, 0.0f, 4.0f },   // front-right
+      { -10.0f, 8.0f, 0.0f, 4.0f },  // front-left
+      { -7.0f, -10.0f, 0.0f, 4.0f }, // back-left
+      { 8.0f, -9.0f, 0.0f, 4.0f },   // back-right
+   };
+   return s;
+}
+
+bool BoidScenario::set( const std::string& name, const std::string& value, std::string* error )
+{
+   auto fail = [&]( const std::string& what ) { return Syntax::fail( error, what ); };
+   const std::string key = Syntax::lower( name );
+
+   long long i = 0;
+   float f = 0.0f;
+   if( key == "name" )
+      this->name = value;
+   else if( key == "numboids" || key == "numpredators" || key == "steps" )
+   {
+      if( !Syntax::toInt( value, i ) || i < 0 || i > 10000000 )
+         return fail( "bad count '" + value + "'" );
+      if( key == "numboids" )
+         this->params.numBoids = static_cast< int >( i );
+      else if( key == "numpredators" )
+         this->params.numPredators = static_cast< int >( i );
+      else
+         this->steps = static_cast< int >( i );
+   }
+   else if( key == "seed" )
+   {
+      if( !Syntax::toInt( value, i ) || i < 0 )
+         return fail( "bad seed '" + value + "'" );
+      this->seed = static_cast< uint64_t >( i );
+   }
+   else if( key == "neighborskin" )
+   {
+      if( !Syntax::toFloat( value, f ) || f < 0.0f )
+         return fail( "bad neighborSkin '" + value + "'" );
+      this->neighborSkin = f;
+   }
+   else if( key == "hashedgrid" )
+   {
+      if( !Syntax::toInt( value, i ) || i < 0 || i > 1 )
+         return fail( "bad hashedGrid '" + value + "' (0 or 1)" );
+      this->hashedGrid = i == 1;
+   }
+   else if( key == "neighborcapacity" )
+   {
+      if( !Syntax::toInt( value, i ) || i < 0 || i > 10000000 )
+         return fail( "bad neighborCapacity '" + value + "'" );
+      this->neighborCapacity = static_cast< int >( i );
+   }
+   else if( key == "dt" )
+   {
+      if( !Syntax::toFloat( value, f ) || f <= 0.0f )
+         return fail( "bad dt '" + value + "'" );
+      this->dt = f;
+   }
+   else if( key == "obstacle" )
+   {
+      std::array< float, 4 > o{};
+      std::istringstream fields( value );
+      std::string field;
+      int n = 0;
+      while( std::getline( fields, field, ',' ) )
+         if( n >= 4 || !Syntax::toFloat( Syntax::trim( field ), o[n++] ) )
+            return fail( "obstacle must be x,y,z,radius" );
+      if( n != 4 || o[3] <= 0.0f )
+         return fail( "obstacle must be x,y,z,radius" );
+      if( static_cast< int >( this->obstacles.size() ) >= BoidStepGlobals::MAX_OBSTACLES )
+         return fail( "more than " + std::to_string( BoidStepGlobals::MAX_OBSTACLES ) + " obstacles" );
+      this->obstacles.push_back( o );
+   }
+   else
+   {
+      auto k = std::find_if( std::begin( floatKeys ), std::end( floatKeys ), [&]( const FloatKey& fk ) { return key == fk.key; } );
+      if( k == std::end( floatKeys ) )
+         return fail( "unknown key '" + key + "'" );
+      if( !Syntax::toFloat( value, f ) || f < 0.0f )
+         return fail( "bad value '" + value + "'" );
+      if( k->param )
+         this->params.*( k->param ) = f;
+      else
+         this->spawn.*( k->spawn ) = f;
+   }
+   return true;
+}
+
+bool BoidScenario::parse( const std::string& text, BoidScenario& out, std::string* error )
+{
+   BoidScenario s;
+   std::istringstream in( text );
+   std::string line;
+   for( int lineNo = 1; std::getline( in, line ); ++lineNo )
+   {
+      line = Syntax::trim( line.substr( 0, line.find( '#' ) ) );
+      if( line.empty() )
+         continue;
+      size_t eq = line.find( '=' );
+      std::string what = "expected key=value";
+      if( eq == std::string::npos || !s.set( Syntax::trim( line.substr( 0, eq ) ), Syntax::trim( line.substr( eq + 1 ) ), &what ) )
+      {
+         if( error )
+            *error = "line " + std::to_string( lineNo ) + ": " + what;
+         return false;
+      }
+   }
+
+   out = std::move( s );
+   return true;
+}
+
+bool BoidScenario::load( const std::string& path, BoidScenario& out, std::string* error )
+{
+   std::ifstream in( path );
+   if( !in )
+   {
+      if( error )
+         *error = "cannot open " + path;
+      return false;
+   }
+   std::stringstream ss;
+   ss << in.rdbuf();
+   if( !parse( ss.str(), out, error ) )
+   {
+      if( error )
+         *error = path + ", " + *error;
+      return false;
+   }
+   return true;
+}
+
+std::string BoidScenario::toText() const
+{
+   // Nine significant digits bring every float back bit for bit, so a checkpoint resumes with
+   // exactly the parameters it was saved with
+   std::ostringstream out;
+   out << std::setprecision( 9 );
+   out << "name=" << this->name << "\n";
+   out << "seed=" << this->seed << "\n";
+   out << "steps=" << this->steps << "\n";
+   out << "dt=" << this->dt << "\n";
+   if( this->neighborSkin > 0.0f )
+      out << "neighborSkin=" << this->neighborSkin << "\n";
+   if( this->hashedGrid )
+      out << "hashedGrid=1\n";
+   if( this->neighborCapacity > 0 )
+      out << "neighborCapacity=" << this->neighborCapacity << "\n";
+   out << "numBoids=" << this->params.numBoids << "\n";
+   out << "numPredators=" << this->params.numPredators << "\n";
+   for( size_t i = 0; i < std::size( floatKeys ); ++i )
+   {
+      const FloatKey& k = floatKeys[i];
+      out << displayNames[i] << "=" << ( k.param ? this->params.*( k.param ) : this->spawn.*( k.spawn ) ) << "\n";
+   }
+   for( const auto& o : this->obstacles )
+      out << "obstacle=" << o[0] << "," << o[1] << "," << o[2] << "," << o[3] << "\n";
+   return out.str();
+}
+
+bool BoidScenario::save( const std::string& path ) const
+{
+   std::ofstream out( path );
+   out << this->toText();
+   return static_cast< bool >( out );
+}
+
+std::vector< std::string > BoidScenario::listCatalog( const std::string& dir )
+{
+   std::vector< std::string > paths;
+   std::error_code ec;
+   for( const auto& entry : std::filesystem::directory_iterator( dir, ec ) )
+      if( entry.is_regular_file() && entry.path().extension() == ".boidscene" )
+         paths.push_back( entry.path().string() );
+   std::sort( paths.begin(), paths.end() );
+   return paths;
+}
+
+BoidStepGlobals BoidScenario::getStepGlobals( int frame, bool withObstacles ) const
+{
+   BoidStepGlobals g;
+   g.dt = this->dt;
+   g.frame = frame;
+   g.numObstacles = withObstacles ? std::min( static_cast< int >( this->obstacles.size() ), BoidStepGlobals::MAX_OBSTACLES ) : 0;
+   for( int i = 0; i < g.numObstacles; ++i )
+      for( int c = 0; c < 4; ++c )
+         g.obstacles[i][c] = this->obstacles[i][c];
+   return g;
+}
+
+BoidScenarioTiming BoidScenario::runCpu( BoidThreadPool& pool, std::vector< BoidGPU >* finalState, int sampleInterval,
+                                         const SampleFn& sample ) const
+{
+   BOID_PROFILE_ZONE( "BoidScenario::runCpu" );
+   std::vector< BoidGPU > state( this->params.numBoids + this->params.numPredators );
+   std::vector< BoidGPU > next( state.size() );
+   BoidRng::initSwarm( state.data(), this->params.numBoids, this->params.numPredators, this->seed, this->spawn, pool );
+
+   BoidNeighborList neighbors;
+   neighbors.setSkin( this->neighborSkin );
+   neighbors.setHashedGrid( this->hashedGrid );
+   neighbors.setCapacity( static_cast< uint32_t >( this->neighborCapacity ) );
+   const bool useLists = this->neighborSkin > 0.0f;
+
+   BoidScenarioTiming timing;
+   timing.steps = this->steps;
+   auto t0 = std::chrono::steady_clock::now();
+   std::optional< BoidAllocScope > allocations;
+   if( sample )
+      sample( 0, state.data() );
+   for( int i = 0; i < this->steps; ++i )
+   {
+      if( i == 1 )
+         allocations.emplace(); // the first step sizes the buffers
+      if( useLists )
+         neighbors.update( state.data(), this->params, pool );
+      BoidCpuKernel::step( state.data(), next.data(), this->params, this->getStepGlobals( i ), pool, 256,
+                           useLists ? &neighbors : nullptr );
+      state.swap( next );
+      if( sample && ( ( sampleInterval > 0 && ( i + 1 ) % sampleInterval == 0 ) || i + 1 == this->steps ) )
+         sample( i + 1, state.data() );
+   }
+   timing.neighborRebuilds = neighbors.getStats().rebuilds;
+   timing.allocations = allocations ? allocations->getAllocations() : 0;
+   timing.totalMs = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - t0 ).count();
+   timing.msPerStep = this->steps > 0 ? timing.totalMs / this->steps : 0.0;
+
+   if( finalState )
+      *finalState = std::move( state );
+   return timing;
+}
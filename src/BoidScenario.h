@@ -0,0 +1,83 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include "BoidRng.h"
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+class BoidThreadPool;
+
+/// Wall-clock cost of a headless scenario run
+struct BoidScenarioTiming
+{
+   int steps = 0;
+   double totalMs = 0.0;
+   double msPerStep = 0.0;
+   uint64_t neighborRebuilds = 0; // neighbor list runs only
+   uint64_t allocations = 0;      // heap allocations by all threads after the first step (see BoidAllocTracker)
+};
+
+/// Value syntax of the scenario file format, shared by the formats built on it (*.boidsweep)
+struct BoidScenarioSyntax
+{
+   static std::string trim( const std::string& s );   ///< without leading and trailing blanks
+   static std::string lower( std::string s );
+   static bool toFloat( const std::string& s, float& out ); ///< the whole string, finite
+   static bool toInt( const std::string& s, long long& out );
+   /// Stores 'message' in 'error' when given; returns false
+   static bool fail( std::string* error, const std::string& message );
+};
+
+/**
+   Everything that defines a reproducible swarm run: counts, flocking parameters, spawn volumes,
+   obstacle layout, seed, step size and duration. Scenario files (*.boidscene) are aftr.conf
+   style "key=value" lines with '#' comments; keys are case insensitive, 'obstacle=x,y,z,radius'
+   may repeat up to BoidStepGlobals::MAX_OBSTACLES times and anything not given keeps its default.
+   makeDefault() is the classic five-pillar tank.
+*/
+struct BoidScenario
+{
+   std::string name = "default";
+   BoidSwarmParams params;
+   BoidSpawnParams spawn;
+   uint64_t seed = 1;
+   int steps = 600;       // duration in simulation steps
+   float dt = 0.05f;
+   float neighborSkin = 0.0f; // > 0 steps through Verlet neighbor lists with this skin (CPU runs)
+   bool hashedGrid = false;   // the lists rebuild through a hashed grid (see BoidHashGrid)
+   int neighborCapacity = 0;  // neighbors per boid the lists reserve up front (see BoidNeighborList::setCapacity)
+   std::vector< std::array< float, 4 > > obstacles; // xyz=position, w=avoidance radius
+
+   static BoidScenario makeDefault();
+
+   /// False (and a message naming the offending line in 'error') on unknown keys or bad values
+   static bool parse( const std::string& text, BoidScenario& out, std::string* error = nullptr );
+   static bool load( const std::string& path, BoidScenario& out, std::string* error = nullptr );
+   /// Applies one "key=value" of the file format (key case insensitive); false with a message in
+   /// 'error' on an unknown key or a bad value
+   bool set( const std::string& key, const std::string& value, std::string* error = nullptr );
+   std::string toText() const;
+   bool save( const std::string& path ) const;
+
+   /// Sorted *.boidscene paths in 'dir'
+   static std::vector< std::string > listCatalog( const std::string& dir );
+
+   /// Globals of step 'frame' with the obstacles enabled or not
+   BoidStepGlobals getStepGlobals( int frame, bool withObstacles = true ) const;
+
+   /// Sees the state after 'step' steps (0 = as seeded)
+   using SampleFn = std::function< void( int step, const BoidGPU* state ) >;
+
+   /// Seeds the swarm and runs all steps on the CPU kernel, through neighbor lists when the
+   /// scenario asks for them; 'finalState' receives the last state. 'sample' is called before the
+   /// first step, every 'sampleInterval' steps and after the last one; its time and heap
+   /// allocations count in the timing
+   BoidScenarioTiming runCpu( BoidThreadPool& pool, std::vector< BoidGPU >* finalState = nullptr, int sampleInterval = 0,
+                              const SampleFn& sample = SampleFn() ) const;
+};
+
+} //namespace Aftr
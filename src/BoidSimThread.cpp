@@ -0,0 +1,208 @@
+#include "BoidSimThread.h"
+#include "BoidProfiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Aftr;
+
+namespace
+{
+   using Clock = std::chrono::steady_clock;
+
+   constexpr std::chrono::milliseconds NAP( 2 );          // longest sleep, so stop() and new parameters are seen promptly
+   constexpr std::chrono::milliseconds STATS_WINDOW( 500 );
+
+   Clock::duration stepPeriod( const BoidSimControl& c )
+   {
+      return std::chrono::duration_cast< Clock::duration >( std::chrono::duration< double >( 1.0 / c.stepsPerSecond ) );
+   }
+}
+
+bool BoidSimControl::sameSettings( const BoidSimControl& o ) const
+{
+   // Both blocks are plain 32 bit fields without padding
+   return std::memcmp( &this->params, &o.params, sizeof( this->params ) ) == 0
+       && std::memcmp( &this->globals, &o.globals, sizeof( this->globals ) ) == 0
+       && this->stepsPerSecond == o.stepsPerSecond && this->paused == o.paused
+       && this->useNeighborLists == o.useNeighborLists && this->neighborSkin == o.neighborSkin
+       && this->hashedGrid == o.hashedGrid && this->neighborCapacity == o.neighborCapacity;
+}
+
+BoidSimThread::~BoidSimThread()
+{
+   this->stop();
+}
+
+void BoidSimThread::start( const BoidGPU* state, uint32_t count, int frame, const BoidSimControl& control, unsigned int numThreads,
+                           int grain, float cellScale )
+{
+   this->stop();
+   if( !this->pool || this->pool->getNumThreads() != std::max( numThreads, 1u ) )
+      this->pool = std::make_unique< BoidThreadPool >( std::max( numThreads, 1u ) );
+   this->swarm.load( state, count );
+   this->swarm.setTuning( grain, cellScale );
+   this->startFrame = frame;
+
+   // Nothing runs on the other ends yet, so both sides of the triple buffers may be used here
+   while( this->handoff.update() )
+      ;
+   BoidSimFrame& first = this->handoff.getReadBuffer();
+   first.state.assign( state, state + count );
+   first.frame = frame;
+   first.steps = 0;
+   first.published = Clock::now();
+   while( this->mailbox.update() )
+      ;
+
+   this->steps = 0;
+   this->stepNs = 0;
+   this->dropped = 0;
+   this->overruns = 0;
+   this->paramUpdates = 0;
+   this->stats = BoidSimThreadStats();
+   this->stats.running = true;
+   this->windowStart = Clock::now();
+   this->windowSteps = this->windowStepNs = this->windowFrames = this->windowPicked = 0;
+   this->windowLatencyMs = 0.0;
+   this->windowMaxLatencyMs = 0.0f;
+
+   this->post( control );
+   first.paramVersion = this->posted.version;
+   this->stopRequested = false;
+   this->worker = std::thread( [this]() { this->run(); } );
+}
+
+void BoidSimThread::stop()
+{
+   if( !this->worker.joinable() )
+      return;
+   this->stopRequested = true;
+   this->worker.join();
+   this->stats.running = false;
+}
+
+void BoidSimThread::post( const BoidSimControl& control )
+{
+   const uint64_t version = this->posted.version + 1;
+   this->posted = control;
+   this->posted.version = version;
+   this->mailbox.getWriteBuffer() = this->posted;
+   this->mailbox.publish();
+}
+
+void BoidSimThread::run()
+{
+   BoidProfiler::setThreadName( "Simulation" );
+   BoidSimControl control;
+   int frame = this->startFrame;
+   uint64_t stepsDone = 0;
+   Clock::time_point next = Clock::now();
+   while( !this->stopRequested.load( std::memory_order_relaxed ) )
+   {
+      if( this->mailbox.update() )
+      {
+         control = this->mailbox.getReadBuffer();
+         this->paramVersion.store( control.version, std::memory_order_relaxed );
+         this->paramUpdates.fetch_add( 1, std::memory_order_relaxed );
+         if( control.stepsPerSecond > 0.0f )
+            next = std::min( next, Clock::now() + stepPeriod( control ) ); // a faster rate applies right away
+      }
+      const Clock::time_point now = Clock::now();
+      if( control.paused )
+      {
+         std::this_thread::sleep_for( NAP );
+         next = Clock::now();
+         continue;
+      }
+      if( control.stepsPerSecond > 0.0f && now < next )
+      {
+         std::this_thread::sleep_until( std::min( next, now + Clock::duration( NAP ) ) );
+         continue;
+      }
+
+      {
+         BOID_PROFILE_ZONE( "BoidSimThread::step" );
+         BoidStepGlobals g = control.globals;
+         g.frame = frame++;
+         this->swarm.setHashedGrid( control.hashedGrid );
+         this->swarm.setNeighborCapacity( control.neighborCapacity );
+         this->swarm.step( control.params, g, *this->pool, control.useNeighborLists, control.neighborSkin );
+      }
+      const Clock::time_point done = Clock::now();
+      this->stepNs.fetch_add( static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( done - now ).count() ),
+                              std::memory_order_relaxed );
+
+      // The slot's vector keeps its capacity, so publishing does not allocate once warmed up
+      BoidSimFrame& out = this->handoff.getWriteBuffer();
+      out.state.assign( this->swarm.getState(), this->swarm.getState() + this->swarm.size() );
+      out.frame = frame;
+      out.steps = ++stepsDone;
+      out.paramVersion = control.version;
+      out.published = Clock::now();
+      if( this->handoff.publish() )
+         this->dropped.fetch_add( 1, std::memory_order_relaxed );
+      this->steps.store( stepsDone, std::memory_order_relaxed );
+
+      if( control.stepsPerSecond > 0.0f )
+      {
+         // A whole step behind the schedule: skip ahead instead of stepping back to back to catch up
+         const Clock::duration period = stepPeriod( control );
+         next += period;
+         if( done > next + period )
+         {
+            next = done;
+            this->overruns.fetch_add( 1, std::memory_order_relaxed );
+         }
+      }
+   }
+}
+
+const BoidSimFrame* BoidSimThread::acquire()
+{
+   if( !this->handoff.update() )
+      return nullptr;
+   const BoidSimFrame& f = this->handoff.getReadBuffer();
+   const float latency = std::chrono::duration< float, std::milli >( Clock::now() - f.published ).count();
+   ++this->stats.picked;
+   ++this->windowPicked;
+   this->windowLatencyMs += latency;
+   this->windowMaxLatencyMs = std::max( this->windowMaxLatencyMs, latency );
+   return &f;
+}
+
+void BoidSimThread::countRenderFrame()
+{
+   ++this->windowFrames;
+   this->updateWindow( Clock::now() );
+}
+
+void BoidSimThread::updateWindow( Clock::time_point now )
+{
+   BoidSimThreadStats& s = this->stats;
+   s.steps = this->steps.load( std::memory_order_relaxed );
+   s.dropped = this->dropped.load( std::memory_order_relaxed );
+   s.overruns = this->overruns.load( std::memory_order_relaxed );
+   s.paramVersion = this->paramVersion.load( std::memory_order_relaxed );
+   s.paramUpdates = this->paramUpdates.load( std::memory_order_relaxed );
+   s.targetRate = std::max( this->posted.stepsPerSecond, 0.0f );
+   if( now - this->windowStart < STATS_WINDOW )
+      return;
+
+   const float seconds = std::chrono::duration< float >( now - this->windowStart ).count();
+   const uint64_t ns = this->stepNs.load( std::memory_order_relaxed );
+   const uint64_t stepped = s.steps - this->windowSteps;
+   s.simRate = stepped / seconds;
+   s.renderRate = this->windowFrames / seconds;
+   s.stepsPerFrame = s.renderRate > 0.0f ? s.simRate / s.renderRate : 0.0f;
+   s.stepMs = stepped > 0 ? static_cast< float >( ( ns - this->windowStepNs ) / 1e6 / stepped ) : 0.0f;
+   s.latencyMs = this->windowPicked > 0 ? static_cast< float >( this->windowLatencyMs / this->windowPicked ) : 0.0f;
+   s.maxLatencyMs = this->windowMaxLatencyMs;
+
+   this->windowStart = now;
+   this->windowSteps = s.steps;
+   this->windowStepNs = ns;
+   this->windowFrames = this->windowPicked = 0;
+   this->windowLatencyMs = 0.0;
+   this->windowMaxLatencyMs = 0.0f;
+}
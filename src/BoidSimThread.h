@@ -0,0 +1,115 @@
+#pragma once
+
+#include "BoidBackend.h"
+#include "BoidSwarmTypes.h"
+#include "BoidThreadPool.h"
+#include "BoidTripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Aftr
+{
+
+/// What the UI thread hands the simulation thread; posted whole, as one versioned snapshot
+struct BoidSimControl
+{
+   uint64_t version = 0;        // set by BoidSimThread::post()
+   BoidSwarmParams params;
+   BoidStepGlobals globals;     // obstacles and dt; the frame number is the thread's own
+   float stepsPerSecond = 60.0f; // fixed rate, <= 0 = as fast as possible
+   bool paused = false;
+   bool useNeighborLists = false;
+   float neighborSkin = 1.0f;
+   bool hashedGrid = false;
+   uint32_t neighborCapacity = 0; // neighbors per boid the lists reserve (see BoidCpuSwarm::setNeighborCapacity)
+
+   /// Same settings, whatever the version
+   bool sameSettings( const BoidSimControl& o ) const;
+};
+
+/// A state the simulation thread published
+struct BoidSimFrame
+{
+   std::vector< BoidGPU > state;
+   int frame = 0;               // frame number the next step would use
+   uint64_t steps = 0;          // steps since start()
+   uint64_t paramVersion = 0;   // control snapshot the last step ran with
+   std::chrono::steady_clock::time_point published;
+};
+
+/**
+   Steps a CPU swarm on a thread of its own at a fixed rate, so neither a slow step nor a busy UI
+   stalls the other loop. The UI posts parameter snapshots into a lock-free mailbox (a
+   BoidTripleBuffer of BoidSimControl); the thread takes the newest one before each step. Every
+   step's state is published through a second triple buffer, from which the renderer takes the
+   newest one with acquire() without ever waiting; states it did not get to in time are dropped,
+   not queued.
+
+   The thread owns its swarm and thread pool (of 'numThreads' workers) while running; stop()
+   joins it and leaves the renderer's last acquired state in getLatest(). All methods are for the
+   render thread.
+*/
+class BoidSimThread
+{
+public:
+   BoidSimThread() = default;
+   ~BoidSimThread();
+   BoidSimThread( const BoidSimThread& ) = delete;
+   BoidSimThread& operator=( const BoidSimThread& ) = delete;
+
+   /// Takes over 'count' entities of 'state' and starts stepping them from frame 'frame'
+   void start( const BoidGPU* state, uint32_t count, int frame, const BoidSimControl& control, unsigned int numThreads,
+               int grain = 256, float cellScale = 1.0f );
+   void stop();
+   bool isRunning() const { return this->worker.joinable(); }
+
+   /// Hands the thread a new parameter snapshot; never blocks
+   void post( const BoidSimControl& control );
+   const BoidSimControl& getPosted() const { return this->posted; }
+
+   /// Newest state published since the last call, or nullptr if there is none
+   const BoidSimFrame* acquire();
+   /// Last state acquire() returned (or the starting state): what the renderer shows
+   const BoidSimFrame& getLatest() const { return this->handoff.getReadBuffer(); }
+   /// Counts a drawn frame for the rate statistics
+   void countRenderFrame();
+   const BoidSimThreadStats& getStats() const { return this->stats; }
+
+private:
+   void run();
+   void updateWindow( std::chrono::steady_clock::time_point now );
+
+   std::thread worker;
+   std::atomic< bool > stopRequested{ false };
+   std::unique_ptr< BoidThreadPool > pool;
+   BoidCpuSwarm swarm;
+   int startFrame = 0;
+
+   BoidTripleBuffer< BoidSimControl > mailbox;
+   BoidTripleBuffer< BoidSimFrame > handoff;
+   BoidSimControl posted;
+
+   // Written by the thread, read by the renderer
+   std::atomic< uint64_t > steps{ 0 };
+   std::atomic< uint64_t > stepNs{ 0 };
+   std::atomic< uint64_t > dropped{ 0 };
+   std::atomic< uint64_t > overruns{ 0 };
+   std::atomic< uint64_t > paramVersion{ 0 };
+   std::atomic< uint64_t > paramUpdates{ 0 };
+
+   // Render thread bookkeeping of the current stats window
+   BoidSimThreadStats stats;
+   std::chrono::steady_clock::time_point windowStart;
+   uint64_t windowSteps = 0;
+   uint64_t windowStepNs = 0;
+   uint64_t windowFrames = 0;
+   uint64_t windowPicked = 0;
+   double windowLatencyMs = 0.0;
+   float windowMaxLatencyMs = 0.0f;
+};
+
+} //namespace Aftr
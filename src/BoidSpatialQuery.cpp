@@ -0,0 +1,535 @@
+#include "BoidSpatialQuery.h"
+#include "BoidThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+using namespace Aftr;
+
+namespace
+{
+   constexpr uint32_t MAX_CELLS = 1u << 21;
+   constexpr float MARGIN_CELLS = 2.0f; // room to move before the grid has to be rebuilt
+
+   float distSqTo( const BoidGPU& b, const BoidQuery& q )
+   {
+      const float dx = b.px - q.x, dy = b.py - q.y, dz = b.pz - q.z;
+      return dx * dx + dy * dy + dz * dz;
+   }
+
+   // Column-major 4x4 inverse (cofactors); false if singular
+   bool invert( const double m[16], double out[16] )
+   {
+      double inv[16];
+      inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+      inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+      inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+      inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+      inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+      inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+      inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+      inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+      inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+      inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+      inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+      inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+      inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+      inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+      inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+      inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+      double det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+      if( std::fabs( det ) < 1e-300 )
+         return false;
+      for( int i = 0; i < 16; ++i )
+         out[i] = inv[i] / det;
+      return true;
+   }
+}
+
+// ============================================================
+// BoidSpatialIndex
+// ============================================================
+
+void BoidSpatialIndex::build( BoidSnapshot&& snap, float requestedCellSize, BoidThreadPool& pool, const BoidSpatialIndex* previous )
+{
+   // Take the snapshot and leave our old storage to the caller's temporary
+   std::swap( this->snapshot.boids, snap.boids );
+   this->snapshot.numBoids = snap.numBoids;
+   this->snapshot.numPredators = snap.numPredators;
+   this->snapshot.frame = snap.frame;
+   const uint32_t n = this->size();
+   const BoidGPU* boids = this->snapshot.boids.data();
+
+   for( int k = 0; k < 3; ++k )
+   {
+      this->lo[k] = n ? FLT_MAX : 0.0f;
+      this->hi[k] = n ? -FLT_MAX : 0.0f;
+   }
+   for( uint32_t i = 0; i < n; ++i )
+   {
+      const float p[3] = { boids[i].px, boids[i].py, boids[i].pz };
+      for( int k = 0; k < 3; ++k )
+      {
+         this->lo[k] = std::min( this->lo[k], p[k] );
+         this->hi[k] = std::max( this->hi[k], p[k] );
+      }
+   }
+
+   // The previous grid still fits: same geometry, so only cell changes need sorting
+   bool reuse = previous && previous->size() == n && previous->requestedCellSize == requestedCellSize;
+   for( int k = 0; reuse && k < 3; ++k )
+      reuse = this->lo[k] >= previous->origin[k] && this->hi[k] < previous->origin[k] + previous->dims[k] * previous->cellSize;
+
+   this->requestedCellSize = requestedCellSize;
+   if( reuse )
+   {
+      this->cellSize = previous->cellSize;
+      std::copy( previous->origin, previous->origin + 3, this->origin );
+      std::copy( previous->dims, previous->dims + 3, this->dims );
+   }
+   else
+   {
+      // Cells grow until the box plus margin fits into MAX_CELLS
+      this->cellSize = std::max( requestedCellSize, 1e-4f );
+      for( ;; )
+      {
+         const float margin = MARGIN_CELLS * this->cellSize;
+         double total = 1.0;
+         for( int k = 0; k < 3; ++k )
+         {
+            this->origin[k] = this->lo[k] - margin;
+            this->dims[k] = static_cast< int >( std::floor( ( this->hi[k] + margin - this->origin[k] ) / this->cellSize ) ) + 1;
+            total *= this->dims[k];
+         }
+         if( total <= MAX_CELLS )
+            break;
+         this->cellSize *= 1.25f;
+      }
+   }
+   this->invCellSize = 1.0f / this->cellSize;
+
+   this->cellOfEntity.resize( n );
+   pool.parallelFor( n, 4096, [&]( uint32_t begin, uint32_t end )
+   {
+      for( uint32_t i = begin; i < end; ++i )
+         this->cellOfEntity[i] = this->cellOf( boids[i].px, boids[i].py, boids[i].pz );
+   } );
+
+   this->incremental = reuse && this->sortIncremental( *previous );
+   if( !this->incremental )
+   {
+      this->movers = n;
+      this->sortFull();
+   }
+}
+
+void BoidSpatialIndex::sortFull()
+{
+   // Stable counting sort: every cell lists its entities in ascending index order
+   const uint32_t n = this->size();
+   const uint32_t numCells = static_cast< uint32_t >( this->dims[0] ) * this->dims[1] * this->dims[2];
+   this->cellStart.assign( numCells + 1, 0 );
+   for( uint32_t i = 0; i < n; ++i )
+      ++this->cellStart[this->cellOfEntity[i] + 1];
+   for( uint32_t c = 0; c < numCells; ++c )
+      this->cellStart[c + 1] += this->cellStart[c];
+
+   this->sorted.resize( n );
+   this->scratch.assign( this->cellStart.begin(), this->cellStart.end() - 1 );
+   for( uint32_t i = 0; i < n; ++i )
+      this->sorted[this->scratch[this->cellOfEntity[i]]++] = i;
+}
+
+bool BoidSpatialIndex::sortIncremental( const BoidSpatialIndex& previous )
+{
+   const uint32_t n = this->size();
+   const uint32_t* cell = this->cellOfEntity.data();
+   const uint32_t* prevCell = previous.cellOfEntity.data();
+   this->moverKeys.clear();
+   for( uint32_t i = 0; i < n; ++i )
+      if( cell[i] != prevCell[i] )
+         this->moverKeys.push_back( ( static_cast< uint64_t >( cell[i] ) << 32 ) | i );
+   this->movers = static_cast< uint32_t >( this->moverKeys.size() );
+   if( this->movers > n / 4 )
+      return false; // a full counting sort is cheaper
+
+   // The entities that stayed are still in (cell, index) order in the previous sort; merge
+   // the sorted movers into them
+   std::sort( this->moverKeys.begin(), this->moverKeys.end() );
+   this->sorted.resize( n );
+   uint32_t out = 0;
+   size_t m = 0;
+   for( uint32_t i : previous.sorted )
+   {
+      if( cell[i] != prevCell[i] )
+         continue;
+      const uint64_t key = ( static_cast< uint64_t >( cell[i] ) << 32 ) | i;
+      while( m < this->moverKeys.size() && this->moverKeys[m] < key )
+         this->sorted[out++] = static_cast< uint32_t >( this->moverKeys[m++] );
+      this->sorted[out++] = i;
+   }
+   while( m < this->moverKeys.size() )
+      this->sorted[out++] = static_cast< uint32_t >( this->moverKeys[m++] );
+
+   // Cell starts: the previous counts, moved by the movers
+   const uint32_t numCells = static_cast< uint32_t >( this->dims[0] ) * this->dims[1] * this->dims[2];
+   this->cellStart.resize( numCells + 1 );
+   this->cellStart[0] = 0;
+   for( uint32_t c = 0; c < numCells; ++c )
+      this->cellStart[c + 1] = previous.cellStart[c + 1] - previous.cellStart[c];
+   for( uint64_t key : this->moverKeys )
+   {
+      const uint32_t i = static_cast< uint32_t >( key );
+      --this->cellStart[prevCell[i] + 1];
+      ++this->cellStart[cell[i] + 1];
+   }
+   for( uint32_t c = 0; c < numCells; ++c )
+      this->cellStart[c + 1] += this->cellStart[c];
+   return true;
+}
+
+int BoidSpatialIndex::cellCoord( float v, int axis ) const
+{
+   return std::clamp( static_cast< int >( std::floor( ( v - this->origin[axis] ) * this->invCellSize ) ), 0, this->dims[axis] - 1 );
+}
+
+uint32_t BoidSpatialIndex::cellOf( float x, float y, float z ) const
+{
+   return static_cast< uint32_t >( this->cellCoord( x, 0 ) + this->dims[0] * ( this->cellCoord( y, 1 ) + this->dims[1] * this->cellCoord( z, 2 ) ) );
+}
+
+void BoidSpatialIndex::queryRadius( const BoidQuery& q, float radius, std::vector< uint32_t >& out, std::vector< float >* distSq ) const
+{
+   if( this->sorted.empty() || radius < 0.0f )
+      return;
+   const float r2 = radius * radius;
+   const int x0 = this->cellCoord( q.x - radius, 0 ), x1 = this->cellCoord( q.x + radius, 0 );
+   const int y0 = this->cellCoord( q.y - radius, 1 ), y1 = this->cellCoord( q.y + radius, 1 );
+   const int z0 = this->cellCoord( q.z - radius, 2 ), z1 = this->cellCoord( q.z + radius, 2 );
+   const BoidGPU* boids = this->snapshot.boids.data();
+   for( int z = z0; z <= z1; ++z )
+      for( int y = y0; y <= y1; ++y )
+      {
+         // A row of cells is one contiguous run of the sort
+         const uint32_t row = static_cast< uint32_t >( this->dims[0] * ( y + this->dims[1] * z ) );
+         for( uint32_t s = this->cellStart[row + x0], e = this->cellStart[row + x1 + 1]; s < e; ++s )
+         {
+            const uint32_t i = this->sorted[s];
+            const float d2 = distSqTo( boids[i], q );
+            if( d2 <= r2 && i != q.exclude )
+            {
+               out.push_back( i );
+               if( distSq )
+                  distSq->push_back( d2 );
+            }
+         }
+      }
+}
+
+void BoidSpatialIndex::queryNearest( const BoidQuery& q, uint32_t k, std::vector< uint32_t >& out, std::vector< float >* distSq ) const
+{
+   if( this->sorted.empty() || k == 0 )
+      return;
+   // Max-heap of the best k so far, grown ring by ring around the query's cell. After ring r
+   // every entity closer than r cells has been seen
+   std::vector< std::pair< float, uint32_t > > heap;
+   heap.reserve( k + 1 );
+   const BoidGPU* boids = this->snapshot.boids.data();
+   auto visitRun = [&]( uint32_t row, int xa, int xb )
+   {
+      xa = std::max( xa, 0 );
+      xb = std::min( xb, this->dims[0] - 1 );
+      if( xa > xb )
+         return;
+      for( uint32_t s = this->cellStart[row + xa], e = this->cellStart[row + xb + 1]; s < e; ++s )
+      {
+         const uint32_t i = this->sorted[s];
+         if( i == q.exclude )
+            continue;
+         const float d2 = distSqTo( boids[i], q );
+         if( heap.size() < k )
+         {
+            heap.emplace_back( d2, i );
+            std::push_heap( heap.begin(), heap.end() );
+         }
+         else if( d2 < heap.front().first )
+         {
+            std::pop_heap( heap.begin(), heap.end() );
+            heap.back() = { d2, i };
+            std::push_heap( heap.begin(), heap.end() );
+         }
+      }
+   };
+
+   const int qx = this->cellCoord( q.x, 0 ), qy = this->cellCoord( q.y, 1 ), qz = this->cellCoord( q.z, 2 );
+   const int maxRing = std::max( { this->dims[0], this->dims[1], this->dims[2] } );
+   for( int r = 0; r <= maxRing; ++r )
+   {
+      for( int z = qz - r; z <= qz + r; ++z )
+      {
+         if( z < 0 || z >= this->dims[2] )
+            continue;
+         for( int y = qy - r; y <= qy + r; ++y )
+         {
+            if( y < 0 || y >= this->dims[1] )
+               continue;
+            const uint32_t row = static_cast< uint32_t >( this->dims[0] * ( y + this->dims[1] * z ) );
+            if( z == qz - r || z == qz + r || y == qy - r || y == qy + r )
+               visitRun( row, qx - r, qx + r ); // face of the shell: the whole row
+            else
+            {
+               visitRun( row, qx - r, qx - r );
+               if( r > 0 )
+                  visitRun( row, qx + r, qx + r );
+            }
+         }
+      }
+      const float reach = r * this->cellSize;
+      if( heap.size() == k && heap.front().first < reach * reach )
+         break;
+   }
+
+   std::sort_heap( heap.begin(), heap.end() );
+   for( const auto& [d2, i] : heap )
+   {
+      out.push_back( i );
+      if( distSq )
+         distSq->push_back( d2 );
+   }
+}
+
+uint32_t BoidSpatialIndex::pickRay( const float o[3], const float d[3], float radius, float maxT ) const
+{
+   if( this->sorted.empty() )
+      return NONE;
+
+   // Clip to the snapshot's bounds grown by the pick radius
+   float t0 = 0.0f, t1 = maxT;
+   for( int k = 0; k < 3; ++k )
+   {
+      const float a = this->lo[k] - radius, b = this->hi[k] + radius;
+      if( std::fabs( d[k] ) < 1e-12f )
+      {
+         if( o[k] < a || o[k] > b )
+            return NONE;
+         continue;
+      }
+      float ta = ( a - o[k] ) / d[k], tb = ( b - o[k] ) / d[k];
+      if( ta > tb )
+         std::swap( ta, tb );
+      t0 = std::max( t0, ta );
+      t1 = std::min( t1, tb );
+   }
+   if( t0 > t1 )
+      return NONE;
+
+   // Radius queries along the ray, each covering one step of the capsule around it
+   const float step = this->cellSize;
+   const float reach = std::sqrt( radius * radius + 0.25f * step * step );
+   const BoidGPU* boids = this->snapshot.boids.data();
+   std::vector< uint32_t > hits;
+   uint32_t best = NONE;
+   float bestT = FLT_MAX;
+   for( float t = t0; t <= t1 + 0.5f * step && t - 0.5f * step <= bestT; t += step )
+   {
+      hits.clear();
+      this->queryRadius( BoidQuery{ o[0] + d[0] * t, o[1] + d[1] * t, o[2] + d[2] * t }, reach, hits );
+      for( uint32_t i : hits )
+      {
+         const float v[3] = { boids[i].px - o[0], boids[i].py - o[1], boids[i].pz - o[2] };
+         const float along = v[0] * d[0] + v[1] * d[1] + v[2] * d[2];
+         const float perp2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2] - along * along;
+         if( along >= 0.0f && along <= maxT && perp2 <= radius * radius && along < bestT )
+         {
+            best = i;
+            bestT = along;
+         }
+      }
+   }
+   return best;
+}
+
+void BoidSpatialIndex::scanRadius( const BoidQuery& q, float radius, std::vector< uint32_t >& out ) const
+{
+   const float r2 = radius * radius;
+   for( uint32_t i = 0; i < this->size(); ++i )
+      if( i != q.exclude && distSqTo( this->snapshot.boids[i], q ) <= r2 )
+         out.push_back( i );
+}
+
+void BoidSpatialIndex::scanNearest( const BoidQuery& q, uint32_t k, std::vector< uint32_t >& out ) const
+{
+   std::vector< std::pair< float, uint32_t > > all;
+   all.reserve( this->size() );
+   for( uint32_t i = 0; i < this->size(); ++i )
+      if( i != q.exclude )
+         all.emplace_back( distSqTo( this->snapshot.boids[i], q ), i );
+   const size_t m = std::min< size_t >( k, all.size() );
+   std::partial_sort( all.begin(), all.begin() + m, all.end() );
+   for( size_t j = 0; j < m; ++j )
+      out.push_back( all[j].second );
+}
+
+bool BoidSpatialIndex::screenRay( const float* view, const float* proj, float ndcX, float ndcY, float origin[3], float dir[3] )
+{
+   double vp[16], inv[16];
+   for( int c = 0; c < 4; ++c )
+      for( int r = 0; r < 4; ++r )
+      {
+         double s = 0.0;
+         for( int k = 0; k < 4; ++k )
+            s += static_cast< double >( proj[k * 4 + r] ) * view[c * 4 + k];
+         vp[c * 4 + r] = s;
+      }
+   if( !invert( vp, inv ) )
+      return false;
+
+   double ends[2][3];
+   for( int e = 0; e < 2; ++e )
+   {
+      const double p[4] = { ndcX, ndcY, e ? 1.0 : -1.0, 1.0 };
+      double w[4];
+      for( int r = 0; r < 4; ++r )
+         w[r] = inv[r] * p[0] + inv[4 + r] * p[1] + inv[8 + r] * p[2] + inv[12 + r] * p[3];
+      if( std::fabs( w[3] ) < 1e-300 )
+         return false;
+      for( int k = 0; k < 3; ++k )
+         ends[e][k] = w[k] / w[3];
+   }
+   double len = 0.0;
+   for( int k = 0; k < 3; ++k )
+      len += ( ends[1][k] - ends[0][k] ) * ( ends[1][k] - ends[0][k] );
+   len = std::sqrt( len );
+   if( len <= 0.0 )
+      return false;
+   for( int k = 0; k < 3; ++k )
+   {
+      origin[k] = static_cast< float >( ends[0][k] );
+      dir[k] = static_cast< float >( ( ends[1][k] - ends[0][k] ) / len );
+   }
+   return true;
+}
+
+// ============================================================
+// BoidSpatialQueryService
+// ============================================================
+
+void BoidSpatialQueryService::update( BoidSnapshot&& snapshot, BoidThreadPool& pool )
+{
+   std::lock_guard< std::mutex > updateLock( this->updateMutex );
+   std::shared_ptr< const BoidSpatialIndex > previous;
+   std::shared_ptr< BoidSpatialIndex > target;
+   {
+      std::lock_guard< std::mutex > lock( this->mtx );
+      previous = this->current;
+      if( previous && previous->getFrame() == snapshot.frame && previous->size() == snapshot.boids.size() )
+         return;
+      // Only this service can still reach the spare, so once nobody else holds it it is ours.
+      // use_count() is a relaxed load; the fence pairs it with the release in the last reader's
+      // decrement, so that reader's accesses happen before the rebuild overwrites the index
+      if( this->spare && this->spare.use_count() == 1 )
+      {
+         std::atomic_thread_fence( std::memory_order_acquire );
+         target = std::move( this->spare );
+      }
+      this->spare.reset();
+   }
+   if( !target )
+      target = std::make_shared< BoidSpatialIndex >();
+
+   auto t0 = std::chrono::steady_clock::now();
+   target->build( std::move( snapshot ), this->cellSize, pool, previous.get() );
+   float ms = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - t0 ).count();
+
+   std::lock_guard< std::mutex > lock( this->mtx );
+   this->spare = std::const_pointer_cast< BoidSpatialIndex >( previous );
+   this->current = std::move( target );
+   this->stats.frame = this->current->getFrame();
+   this->stats.entities = this->current->size();
+   ++this->stats.builds;
+   if( this->current->wasIncremental() )
+      ++this->stats.incrementalBuilds;
+   this->stats.lastMovers = this->current->getMovers();
+   this->stats.lastBuildMs = ms;
+}
+
+void BoidSpatialQueryService::clear()
+{
+   std::lock_guard< std::mutex > lock( this->mtx );
+   this->current.reset();
+   this->spare.reset();
+}
+
+std::shared_ptr< const BoidSpatialIndex > BoidSpatialQueryService::acquire() const
+{
+   std::lock_guard< std::mutex > lock( this->mtx );
+   return this->current;
+}
+
+BoidSpatialQueryStats BoidSpatialQueryService::getStats() const
+{
+   std::lock_guard< std::mutex > lock( this->mtx );
+   BoidSpatialQueryStats s = this->stats;
+   s.queries = this->queries.load( std::memory_order_relaxed );
+   return s;
+}
+
+template< typename Fn >
+void BoidSpatialQueryService::runBatch( const std::vector< BoidQuery >& queries, BoidQueryResults& out, BoidThreadPool& pool, Fn query ) const
+{
+   const uint32_t n = static_cast< uint32_t >( queries.size() );
+   out.offsets.assign( n + 1, 0 );
+   out.indices.clear();
+   out.distSq.clear();
+   std::shared_ptr< const BoidSpatialIndex > index = this->acquire();
+   if( !index || n == 0 )
+      return;
+   this->queries.fetch_add( n, std::memory_order_relaxed );
+
+   // Chunks of queries fill their own lists, concatenated in query order afterwards
+   constexpr uint32_t GRAIN = 64;
+   struct Part
+   {
+      std::vector< uint32_t > indices;
+      std::vector< float > distSq;
+   };
+   std::vector< Part > parts( ( n + GRAIN - 1 ) / GRAIN );
+   pool.parallelFor( n, GRAIN, [&]( uint32_t begin, uint32_t end )
+   {
+      Part& part = parts[begin / GRAIN];
+      for( uint32_t q = begin; q < end; ++q )
+      {
+         const size_t before = part.indices.size();
+         query( *index, queries[q], part.indices, &part.distSq );
+         out.offsets[q + 1] = static_cast< uint32_t >( part.indices.size() - before );
+      }
+   } );
+
+   for( uint32_t q = 0; q < n; ++q )
+      out.offsets[q + 1] += out.offsets[q];
+   out.indices.reserve( out.offsets[n] );
+   out.distSq.reserve( out.offsets[n] );
+   for( const Part& part : parts )
+   {
+      out.indices.insert( out.indices.end(), part.indices.begin(), part.indices.end() );
+      out.distSq.insert( out.distSq.end(), part.distSq.begin(), part.distSq.end() );
+   }
+}
+
+void BoidSpatialQueryService::radius( const std::vector< BoidQuery >& queries, float radius, BoidQueryResults& out, BoidThreadPool& pool ) const
+{
+   this->runBatch( queries, out, pool, [radius]( const BoidSpatialIndex& index, const BoidQuery& q, std::vector< uint32_t >& idx, std::vector< float >* d2 )
+   {
+      index.queryRadius( q, radius, idx, d2 );
+   } );
+}
+
+void BoidSpatialQueryService::nearest( const std::vector< BoidQuery >& queries, uint32_t k, BoidQueryResults& out, BoidThreadPool& pool ) const
+{
+   this->runBatch( queries, out, pool, [k]( const BoidSpatialIndex& index, const BoidQuery& q, std::vector< uint32_t >& idx, std::vector< float >* d2 )
+   {
+      index.queryNearest( q, k, idx, d2 );
+   } );
+}
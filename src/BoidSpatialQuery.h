@@ -0,0 +1,137 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Aftr
+{
+class BoidThreadPool;
+
+/// One point of a batched query; 'exclude' (e.g. the querying boid itself) is never returned
+struct BoidQuery
+{
+   float x = 0.0f, y = 0.0f, z = 0.0f;
+   uint32_t exclude = 0xFFFFFFFFu;
+};
+
+/// Hits of a batch, query q owning [offsets[q], offsets[q + 1]) of indices/distSq
+struct BoidQueryResults
+{
+   std::vector< uint32_t > offsets;
+   std::vector< uint32_t > indices;
+   std::vector< float > distSq;
+
+   uint32_t count( size_t q ) const { return this->offsets[q + 1] - this->offsets[q]; }
+};
+
+struct BoidSpatialQueryStats
+{
+   uint64_t frame = 0;            // frame of the indexed snapshot
+   uint32_t entities = 0;
+   uint64_t builds = 0;
+   uint64_t incrementalBuilds = 0; // builds that re-sorted only the entities that changed cell
+   uint32_t lastMovers = 0;
+   float lastBuildMs = 0.0f;
+   uint64_t queries = 0;
+};
+
+/**
+   Immutable uniform grid over one swarm snapshot, answering radius, k-nearest and ray pick
+   queries. Entities are kept sorted by cell (ties by index), so a cell is one contiguous run.
+
+   build() can start from the previous frame's index: while the swarm stays inside the old
+   grid (built with a margin) only the entities that changed cell are sorted and merged back
+   into the previous order, and the rest of the work is a linear pass. Points outside the
+   grid are clamped to its border cells, which keeps every query exact.
+*/
+class BoidSpatialIndex
+{
+public:
+   static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+   void build( BoidSnapshot&& snapshot, float cellSize, BoidThreadPool& pool, const BoidSpatialIndex* previous = nullptr );
+
+   uint64_t getFrame() const { return this->snapshot.frame; }
+   uint32_t size() const { return static_cast< uint32_t >( this->snapshot.boids.size() ); }
+   const BoidSnapshot& getSnapshot() const { return this->snapshot; }
+   float getCellSize() const { return this->cellSize; }
+   bool wasIncremental() const { return this->incremental; }
+   uint32_t getMovers() const { return this->movers; }
+
+   /// Appends the entities within 'radius' of q (unordered)
+   void queryRadius( const BoidQuery& q, float radius, std::vector< uint32_t >& out, std::vector< float >* distSq = nullptr ) const;
+   /// Appends the 'k' nearest entities to q, nearest first
+   void queryNearest( const BoidQuery& q, uint32_t k, std::vector< uint32_t >& out, std::vector< float >* distSq = nullptr ) const;
+   /// First entity along the ray (dir normalized) passing within 'radius' of it, or NONE
+   uint32_t pickRay( const float origin[3], const float dir[3], float radius, float maxT ) const;
+
+   /// Linear scans over the same snapshot, the reference for tests and benchmarks
+   void scanRadius( const BoidQuery& q, float radius, std::vector< uint32_t >& out ) const;
+   void scanNearest( const BoidQuery& q, uint32_t k, std::vector< uint32_t >& out ) const;
+
+   /// World ray through a point in normalized device coordinates, from column-major view and
+   /// projection matrices; false if they are not invertible
+   static bool screenRay( const float* view, const float* proj, float ndcX, float ndcY, float origin[3], float dir[3] );
+
+private:
+   uint32_t cellOf( float x, float y, float z ) const;
+   int cellCoord( float v, int axis ) const;
+   void sortFull();
+   bool sortIncremental( const BoidSpatialIndex& previous );
+
+   BoidSnapshot snapshot;
+   float requestedCellSize = 0.0f;
+   float cellSize = 1.0f;
+   float invCellSize = 1.0f;
+   float origin[3] = { 0, 0, 0 };
+   int dims[3] = { 1, 1, 1 };
+   float lo[3] = { 0, 0, 0 };  // bounds of the snapshot itself
+   float hi[3] = { 0, 0, 0 };
+   std::vector< uint32_t > cellOfEntity;
+   std::vector< uint32_t > cellStart;
+   std::vector< uint32_t > sorted;
+   std::vector< uint32_t > scratch;
+   std::vector< uint64_t > moverKeys; // (cell, index) of the entities that changed cell
+   bool incremental = false;
+   uint32_t movers = 0;
+};
+
+/**
+   Spatial queries over the most recent swarm snapshot for tools and interaction (boid picking,
+   selection neighborhoods, ...). update() indexes a newer snapshot, incrementally from the
+   current index, and then swaps it in; readers hold the index they acquire()d, so any number
+   of threads can query while an update runs. Batches are split over the thread pool.
+*/
+class BoidSpatialQueryService
+{
+public:
+   /// Indexes 'snapshot' unless its frame is the one already indexed
+   void update( BoidSnapshot&& snapshot, BoidThreadPool& pool );
+   void clear();
+   std::shared_ptr< const BoidSpatialIndex > acquire() const;
+
+   /// Batched queries against the current index; empty results without one
+   void radius( const std::vector< BoidQuery >& queries, float radius, BoidQueryResults& out, BoidThreadPool& pool ) const;
+   void nearest( const std::vector< BoidQuery >& queries, uint32_t k, BoidQueryResults& out, BoidThreadPool& pool ) const;
+
+   BoidSpatialQueryStats getStats() const;
+
+   float cellSize = 4.0f;
+
+private:
+   template< typename Fn >
+   void runBatch( const std::vector< BoidQuery >& queries, BoidQueryResults& out, BoidThreadPool& pool, Fn query ) const;
+
+   std::mutex updateMutex;   // one update at a time
+   mutable std::mutex mtx;   // guards the pointers and stats, held only to swap them
+   std::shared_ptr< const BoidSpatialIndex > current;
+   std::shared_ptr< BoidSpatialIndex > spare; // an index no reader holds any more, rebuilt in place
+   BoidSpatialQueryStats stats;
+   mutable std::atomic< uint64_t > queries{ 0 };
+};
+
+} //namespace Aftr
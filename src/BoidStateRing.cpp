@@ -0,0 +1,123 @@
+#include "BoidStateRing.h"
+
+#include <algorithm>
+
+using namespace Aftr;
+
+BoidStateRing::~BoidStateRing()
+{
+   this->release();
+   if( !this->buffers.empty() )
+      glDeleteBuffers( static_cast< GLsizei >( this->buffers.size() ), this->buffers.data() );
+}
+
+void BoidStateRing::release()
+{
+   for( GLsync& f : this->writeFences )
+      if( f ) { glDeleteSync( f ); f = nullptr; }
+}
+
+void BoidStateRing::replaceFence( GLsync& fence )
+{
+   if( fence )
+      glDeleteSync( fence );
+   fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+void BoidStateRing::allocate( int numSlots, GLsizeiptr bytes, const void* data )
+{
+   numSlots = std::max( numSlots, MIN_SLOTS );
+   this->release();
+   if( this->getNumSlots() != numSlots )
+   {
+      if( !this->buffers.empty() )
+         glDeleteBuffers( static_cast< GLsizei >( this->buffers.size() ), this->buffers.data() );
+      this->buffers.assign( numSlots, 0 );
+      glGenBuffers( numSlots, this->buffers.data() );
+   }
+   this->writeFences.assign( numSlots, nullptr );
+
+   for( GLuint b : this->buffers )
+   {
+      glBindBuffer( GL_SHADER_STORAGE_BUFFER, b );
+      glBufferData( GL_SHADER_STORAGE_BUFFER, bytes, data, GL_DYNAMIC_DRAW );
+   }
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+
+   this->bytes = bytes;
+   this->head = this->latest = this->previous = 0;
+   this->stats = BoidPipelineStats();
+   this->stats.numSlots = numSlots;
+}
+
+void BoidStateRing::fillFrom( int src )
+{
+   glBindBuffer( GL_COPY_READ_BUFFER, this->buffers[src] );
+   for( int i = 0; i < this->getNumSlots(); ++i )
+   {
+      if( i == src )
+         continue;
+      glBindBuffer( GL_COPY_WRITE_BUFFER, this->buffers[i] );
+      glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, this->bytes );
+   }
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+}
+
+void BoidStateRing::loadPair( GLuint src )
+{
+   glBindBuffer( GL_COPY_READ_BUFFER, src );
+   for( int i = 0; i < this->getNumSlots(); ++i )
+   {
+      glBindBuffer( GL_COPY_WRITE_BUFFER, this->buffers[i] );
+      glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, i == 0 ? 0 : this->bytes, 0, this->bytes );
+   }
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   this->previous = 0;
+   this->latest = this->head = 1;
+}
+
+void BoidStateRing::publish()
+{
+   if( this->head == this->latest )
+      return;
+
+   // One barrier covers the whole chain issued since the last publish, for both the draw and
+   // the next frame's steps
+   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+   const int n = this->getNumSlots();
+   this->latest = this->head;
+   this->previous = ( this->head + n - 1 ) % n;
+}
+
+int BoidStateRing::beginStep()
+{
+   const int n = this->getNumSlots();
+   int out = ( this->head + 1 ) % n;
+   // Never overwrite the drawable pair; a frame that outruns the ring moves the pair on
+   if( out == this->previous && this->head != this->latest )
+   {
+      this->publish();
+      out = ( this->head + 1 ) % n;
+   }
+   else if( this->head != this->latest )
+      glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT ); // chained step reads an unpublished one
+   this->pendingOut = out;
+   return out;
+}
+
+void BoidStateRing::endStep()
+{
+   replaceFence( this->writeFences[this->pendingOut] );
+   this->head = this->pendingOut;
+   ++this->stats.stepsIssued;
+}
+
+void BoidStateRing::endDraw()
+{
+   ++this->stats.framesDrawn;
+   GLsync newest = this->writeFences[this->head];
+   if( this->head != this->latest && newest && glClientWaitSync( newest, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+      ++this->stats.framesOverlapped;
+}
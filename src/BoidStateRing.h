@@ -0,0 +1,77 @@
+#pragma once
+
+#include "GLView.h"
+#include "BoidSwarmTypes.h"
+#include <vector>
+
+namespace Aftr
+{
+
+/**
+   Ring of three or more boid state buffers that lets the simulation run ahead of drawing.
+   Each frame publish() makes the steps issued so far visible with a single barrier and
+   exposes the newest two states as the drawable pair (getPrevious(), getLatest()). Steps
+   issued afterwards chain into the remaining slots, so no barrier separates them from the
+   draw of the pair and the GPU can overlap the two. Up to getMaxStepsAhead() steps fit in a
+   frame without touching the pair.
+
+   Every slot carries a fence for its last write. CPU-side states reach a slot through a
+   BoidStreamBuffer, whose GPU copy is ordered after any draw still reading the slot.
+*/
+class BoidStateRing
+{
+public:
+   static constexpr int MIN_SLOTS = 3;
+
+   BoidStateRing() = default;
+   ~BoidStateRing();
+   BoidStateRing( const BoidStateRing& ) = delete;
+   BoidStateRing& operator=( const BoidStateRing& ) = delete;
+
+   /// (Re)creates 'numSlots' (at least MIN_SLOTS) buffers of 'bytes', all holding 'data' (or
+   /// undefined contents), and forgets the history: every index refers to slot 0 afterwards
+   void allocate( int numSlots, GLsizeiptr bytes, const void* data = nullptr );
+   /// Copies slot 'src' into every other slot, e.g. after a GPU pass seeded one of them
+   void fillFrom( int src );
+   /// Restores a drawable pair from 'src', which holds the previous state followed by the latest
+   /// (getSize() bytes each): the latest goes to every slot but one, and the next step reads it
+   void loadPair( GLuint src );
+
+   int getNumSlots() const { return static_cast< int >( this->buffers.size() ); }
+   GLuint getBuffer( int slot ) const { return this->buffers[slot]; }
+   GLsizeiptr getSize() const { return this->bytes; }
+   int getMaxStepsAhead() const { return this->getNumSlots() - 2; }
+
+   /// Barrier for every unpublished step; the newest state becomes the drawable latest
+   void publish();
+   int getLatest() const { return this->latest; }
+   int getPrevious() const { return this->previous; }
+
+   /// Slot the next step reads (the newest issued state)
+   int getStepInput() const { return this->head; }
+   /// Slot the next step writes; chained steps are separated by a barrier
+   int beginStep();
+   /// Fences the step written by the last beginStep()
+   void endStep();
+
+   /// Counts the draw that just read the drawable pair
+   void endDraw();
+
+   const BoidPipelineStats& getStats() const { return this->stats; }
+   BoidPipelineStats& getStats() { return this->stats; }
+
+private:
+   void release();
+   static void replaceFence( GLsync& fence );
+
+   std::vector< GLuint > buffers;
+   std::vector< GLsync > writeFences;
+   GLsizeiptr bytes = 0;
+   int head = 0;     // newest issued state
+   int latest = 0;   // newest published state
+   int previous = 0; // published state before 'latest'
+   int pendingOut = 0;
+   BoidPipelineStats stats;
+};
+
+} //namespace Aftr
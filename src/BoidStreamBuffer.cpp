@@ -0,0 +1,73 @@
+#include "BoidStreamBuffer.h"
+
+#include <cstring>
+
+using namespace Aftr;
+
+BoidStreamBuffer::~BoidStreamBuffer()
+{
+   for( GLsync& f : this->fences )
+      if( f ) { glDeleteSync( f ); f = nullptr; }
+   if( this->staging )
+      glDeleteBuffers( 1, &this->staging );
+}
+
+void BoidStreamBuffer::reserve( GLsizeiptr regionBytes )
+{
+   if( regionBytes <= this->regionSize )
+      return;
+
+   // Orphaning hands the old storage to the pending copies, so their fences no longer matter
+   for( GLsync& f : this->fences )
+      if( f ) { glDeleteSync( f ); f = nullptr; }
+   if( !this->staging )
+      glGenBuffers( 1, &this->staging );
+   glBindBuffer( GL_COPY_READ_BUFFER, this->staging );
+   glBufferData( GL_COPY_READ_BUFFER, regionBytes * NUM_REGIONS, nullptr, GL_STREAM_DRAW );
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   this->regionSize = regionBytes;
+   this->next = 0;
+}
+
+bool BoidStreamBuffer::upload( GLuint dst, GLintptr dstOffset, GLsizeiptr bytes, const void* data )
+{
+   if( bytes <= 0 )
+      return false;
+   this->reserve( bytes );
+
+   bool waited = false;
+   const int region = this->next;
+   this->next = ( this->next + 1 ) % NUM_REGIONS;
+   GLsync& f = this->fences[region];
+   if( f )
+   {
+      if( glClientWaitSync( f, GL_SYNC_FLUSH_COMMANDS_BIT, 0 ) == GL_TIMEOUT_EXPIRED )
+      {
+         waited = true;
+         glClientWaitSync( f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull );
+      }
+      glDeleteSync( f );
+      f = nullptr;
+   }
+
+   const GLintptr offset = static_cast< GLintptr >( region ) * this->regionSize;
+   glBindBuffer( GL_COPY_READ_BUFFER, this->staging );
+   void* p = glMapBufferRange( GL_COPY_READ_BUFFER, offset, bytes,
+                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+   if( p )
+   {
+      std::memcpy( p, data, static_cast< size_t >( bytes ) );
+      glUnmapBuffer( GL_COPY_READ_BUFFER );
+   }
+   else
+      glBufferSubData( GL_COPY_READ_BUFFER, offset, bytes, data ); // mapping refused: let the driver sync
+
+   glBindBuffer( GL_COPY_WRITE_BUFFER, dst );
+   glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, dstOffset, bytes );
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   f = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+   this->uploadedBytes += static_cast< uint64_t >( bytes );
+   return waited;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "GLView.h"
+
+namespace Aftr
+{
+
+/**
+   Streams CPU-side states into GPU buffers (CPU backends, CPU ensemble batch). Every upload is
+   written into the next region of a staging ring, mapped unsynchronized so the CPU never waits
+   on the driver, and then copied into the destination on the GPU, ordered after whatever draw
+   or step is still queued on it. A region is reused once the fence behind its copy has passed,
+   so the CPU only blocks when it runs NUM_REGIONS uploads ahead of the GPU.
+*/
+class BoidStreamBuffer
+{
+public:
+   static constexpr int NUM_REGIONS = 4;
+
+   BoidStreamBuffer() = default;
+   ~BoidStreamBuffer();
+   BoidStreamBuffer( const BoidStreamBuffer& ) = delete;
+   BoidStreamBuffer& operator=( const BoidStreamBuffer& ) = delete;
+
+   /// Copies 'bytes' of 'data' into 'dst' at 'dstOffset'; returns true if it had to wait for a region
+   bool upload( GLuint dst, GLintptr dstOffset, GLsizeiptr bytes, const void* data );
+
+   uint64_t getUploadedBytes() const { return this->uploadedBytes; }
+
+private:
+   void reserve( GLsizeiptr regionBytes );
+
+   GLuint staging = 0;
+   GLsizeiptr regionSize = 0;
+   int next = 0;
+   GLsync fences[NUM_REGIONS] = {};
+   uint64_t uploadedBytes = 0;
+};
+
+} //namespace Aftr
@@ -0,0 +1,76 @@
+#include "BoidSwarmMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Aftr;
+
+BoidSwarmMetrics BoidSwarmMetrics::compute( const BoidGPU* boids, int numBoids )
+{
+   BoidSwarmMetrics m;
+   m.numBoids = numBoids;
+   if( numBoids <= 0 )
+      return m;
+
+   // Double accumulators: sums run over up to millions of boids
+   double c[3] = { 0, 0, 0 }, h[3] = { 0, 0, 0 }, speedSum = 0;
+   for( int i = 0; i < numBoids; ++i )
+   {
+      const BoidGPU& b = boids[i];
+      c[0] += b.px; c[1] += b.py; c[2] += b.pz;
+      double s = std::sqrt( double( b.vx ) * b.vx + double( b.vy ) * b.vy + double( b.vz ) * b.vz );
+      speedSum += s;
+      if( s > 1e-9 )
+      {
+         h[0] += b.vx / s; h[1] += b.vy / s; h[2] += b.vz / s;
+      }
+   }
+   for( int k = 0; k < 3; ++k )
+   {
+      c[k] /= numBoids;
+      h[k] /= numBoids;
+      m.centroid[k] = static_cast< float >( c[k] );
+   }
+
+   double r2 = 0;
+   for( int i = 0; i < numBoids; ++i )
+   {
+      const BoidGPU& b = boids[i];
+      double dx = b.px - c[0], dy = b.py - c[1], dz = b.pz - c[2];
+      r2 += dx * dx + dy * dy + dz * dz;
+   }
+
+   m.polarization = static_cast< float >( std::sqrt( h[0] * h[0] + h[1] * h[1] + h[2] * h[2] ) );
+   m.meanSpeed = static_cast< float >( speedSum / numBoids );
+   m.gyrationRadius = static_cast< float >( std::sqrt( r2 / numBoids ) );
+   return m;
+}
+
+BoidSteeringError BoidSteeringError::compute( const BoidGPU* before, const BoidGPU* approx, const BoidGPU* exact, int n )
+{
+   BoidSteeringError e;
+   if( n <= 0 )
+      return e;
+
+   double exactSq = 0, errSq = 0, worstSq = 0;
+   for( int i = 0; i < n; ++i )
+   {
+      double ex = double( exact[i].vx ) - before[i].vx;
+      double ey = double( exact[i].vy ) - before[i].vy;
+      double ez = double( exact[i].vz ) - before[i].vz;
+      double dx = double( approx[i].vx ) - exact[i].vx;
+      double dy = double( approx[i].vy ) - exact[i].vy;
+      double dz = double( approx[i].vz ) - exact[i].vz;
+      double d2 = dx * dx + dy * dy + dz * dz;
+      exactSq += ex * ex + ey * ey + ez * ez;
+      errSq += d2;
+      worstSq = std::max( worstSq, d2 );
+   }
+   // A swarm that does not steer at all has nothing to be relative to
+   double scale = std::sqrt( exactSq / n );
+   if( scale <= 0.0 )
+      return e;
+   e.rms = float( std::sqrt( errSq / n ) / scale );
+   e.max = float( std::sqrt( worstSq ) / scale );
+   return e;
+}
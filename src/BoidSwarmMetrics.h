@@ -0,0 +1,30 @@
+#pragma once
+
+#include "BoidSwarmTypes.h"
+
+namespace Aftr
+{
+
+/// Order parameters of one swarm, computed over its boids (predators excluded)
+struct BoidSwarmMetrics
+{
+   int numBoids = 0;
+   float polarization = 0.0f;   // |mean unit heading|: 0 = disordered, 1 = all boids aligned
+   float meanSpeed = 0.0f;
+   float gyrationRadius = 0.0f; // RMS distance from the centroid
+   float centroid[3] = { 0.0f, 0.0f, 0.0f };
+
+   static BoidSwarmMetrics compute( const BoidGPU* boids, int numBoids );
+};
+
+/// Velocity change of an approximate step against the exact step from the same state, per boid
+/// |dv_approx - dv_exact| relative to the RMS of |dv_exact| over all n boids
+struct BoidSteeringError
+{
+   float rms = 0.0f;
+   float max = 0.0f;
+
+   static BoidSteeringError compute( const BoidGPU* before, const BoidGPU* approx, const BoidGPU* exact, int n );
+};
+
+} //namespace Aftr
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Aftr
+{
+
+// GPU-side boid data (matches GLSL struct layout)
+struct BoidGPU {
+   float px, py, pz, type; // pos.xyz, pos.w
+   float vx, vy, vz, pad;  // vel.xyz, vel.w
+};
+
+// CPU copy of one simulation step. Boids occupy [0, numBoids), predators follow.
+struct BoidSnapshot
+{
+   std::vector< BoidGPU > boids;
+   int numBoids = 0;
+   int numPredators = 0;
+   uint64_t frame = 0;
+};
+
+// Parameters of one swarm; matches the std430 SwarmParams block of the flocking kernel.
+// 'base' is the index of the swarm's first entity when several swarms share one buffer.
+struct BoidSwarmParams
+{
+   int32_t numBoids = 1000;
+   int32_t numPredators = 1;
+   int32_t base = 0;
+   int32_t pad0 = 0;
+   float sepWeight = 1.5f;
+   float aliWeight = 2.0f;
+   float cohWeight = 1.2f;
+   float bndWeight = 1.0f;
+   float fleWeight = 3.0f;
+   float obsWeight = 3.0f;
+   float noiseStrength = 0.4f;
+   float eatRadius = 1.5f;
+   float sepRadius = 2.0f;
+   float neiRadius = 5.0f;
+   float feaRadius = 8.0f;
+   float bndRadius = 25.0f;
+   float maxSpeed = 0.3f;
+   float predSpeed = 0.45f;
+   float pad1 = 0.0f;
+   float pad2 = 0.0f;
+};
+static_assert( sizeof( BoidSwarmParams ) == 80, "BoidSwarmParams must match the GLSL SwarmParams layout" );
+
+// Per-step state shared by every swarm stepped together
+struct BoidStepGlobals
+{
+   static constexpr int MAX_OBSTACLES = 5;
+   float dt = 0.05f;
+   int frame = 0;
+   int numObstacles = 0;
+   float obstacles[MAX_OBSTACLES][4] = {}; // xyz=position, w=avoidance radius
+};
+
+// Counters of the simulate/render pipeline (see BoidStateRing)
+struct BoidPipelineStats
+{
+   int numSlots = 0;
+   int stepsLastFrame = 0;
+   uint64_t stepsIssued = 0;
+   uint64_t framesDrawn = 0;
+   uint64_t framesOverlapped = 0; // frames drawn while the newest step was still queued or running
+   uint64_t uploadWaits = 0;      // CPU uploads that had to wait for the GPU to release a staging region
+   float renderAlpha = 1.0f;      // interpolation weight of the drawn pair
+};
+
+// Verlet neighbor list bookkeeping (see BoidNeighborList / BoidGpuNeighborList)
+struct BoidNeighborListStats
+{
+   uint64_t steps = 0;          // steps that used a list
+   uint64_t rebuilds = 0;
+   uint64_t growths = 0;        // CPU rebuilds that had to grow a list buffer (see BoidNeighborList::setCapacity)
+   float meanNeighbors = 0.0f;  // list length at the last build
+   uint32_t maxNeighbors = 0;
+   uint32_t overflowBoids = 0;  // boids whose list was truncated at the last build (GPU lists are fixed size)
+   float lastBuildMs = 0.0f;    // CPU only
+   // Grid the last build binned the boids into: dense over a box, or hashed (see BoidHashGrid)
+   bool hashedGrid = false;
+   uint32_t gridSlots = 0;      // dense: cells of the grid, hashed: slots of the table
+   uint32_t occupiedCells = 0;
+   uint32_t maxProbe = 0;       // hashed: longest probe sequence into the table
+   uint64_t gridBytes = 0;      // cell ranges (and table) of the grid, per-boid arrays excluded
+};
+
+/// Approximate far-field kernel: shape of the aggregate hierarchy and its error against the exact kernel
+struct BoidAggregateStats
+{
+   int levels = 0;
+   int baseDim = 0;            // level-0 cells per axis
+   float baseCellSize = 0.0f;
+   uint64_t probes = 0;        // error measurements so far
+   uint32_t sampleBoids = 0;   // boids compared by the last one
+   float rmsError = 0.0f;      // steering error, relative to the RMS exact steering
+   float maxError = 0.0f;      // worst sampled boid, same scale
+};
+
+/// Simulation LOD: boids per update tier (stepped every 1, 2, 4, 8 steps) and boids stepped by the last step
+struct BoidLodStats
+{
+   uint32_t tierCounts[4] = { 0, 0, 0, 0 };
+   uint32_t activeEntities = 0; // boids stepped in full plus predators
+   uint32_t numEntities = 0;
+};
+
+// GPU history ring bookkeeping (see BoidGpuHistory)
+struct BoidHistoryStats
+{
+   int numSlots = 0;            // K frames
+   int filled = 0;              // slots holding a recorded frame
+   int numEntities = 0;         // N
+   uint64_t bytes = 0;          // K x N compact records
+   uint64_t framesRecorded = 0;
+   int viewedStep = 0;          // steps since reset of the frame shown while rewound
+};
+
+/// Discrete events the flocking kernel records when the event log is on (see BoidGpuEventLog)
+enum class BoidEventType : uint32_t
+{
+   Eat,       // entity: the boid, other: the predator, position: where it was caught, value: predator distance
+   Respawn,   // entity: the boid, other: the predator, position: where it reappears
+   Retarget,  // entity: the predator, other: its new target, position: the predator's, value: the old target (-1 for none)
+   Count
+};
+
+// One recorded event; matches the GLSL BoidEventData layout
+struct BoidEvent
+{
+   uint32_t type;    // BoidEventType
+   uint32_t frame;   // u_frame of the step
+   uint32_t entity;
+   int32_t other;
+   float x, y, z;
+   float value;
+};
+static_assert( sizeof( BoidEvent ) == 32, "BoidEvent must match the GLSL BoidEventData layout" );
+
+// Event log bookkeeping (see BoidEventStream)
+struct BoidEventStats
+{
+   uint64_t total = 0;                                             // events received
+   uint64_t byType[static_cast< int >( BoidEventType::Count )] = {};
+   uint64_t dropped = 0;                                           // recorded past the GPU log's capacity
+   uint64_t batches = 0;                                           // drained batches
+   uint32_t lastBatch = 0;                                         // events in the newest batch, dropped ones included
+   uint32_t peakBatch = 0;
+};
+
+// Dedicated CPU simulation thread (see BoidSimThread). Rates and times cover the last window
+struct BoidSimThreadStats
+{
+   bool running = false;
+   float targetRate = 0.0f;     // steps per second asked for, 0 = as fast as possible
+   float simRate = 0.0f;        // steps per second achieved
+   float renderRate = 0.0f;     // frames per second drawn
+   float stepsPerFrame = 0.0f;  // simRate / renderRate: how far the two loops drift apart
+   float stepMs = 0.0f;         // mean step time
+   float latencyMs = 0.0f;      // mean time from publishing a state to the renderer picking it up
+   float maxLatencyMs = 0.0f;
+   uint64_t steps = 0;
+   uint64_t picked = 0;         // states the renderer took
+   uint64_t dropped = 0;        // states replaced by a newer one before the renderer took them
+   uint64_t overruns = 0;       // times the thread fell a whole step behind its schedule and skipped ahead
+   uint64_t paramVersion = 0;   // newest parameter snapshot the thread has applied
+   uint64_t paramUpdates = 0;
+};
+
+} //namespace Aftr
@@ -0,0 +1,502 @@
+#include "BoidSweep.h"
+#include "BoidProfiler.h"
+#include "BoidRng.h"
+#include "BoidSwarmMetrics.h"
+#include "BoidThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <thread>
+
+using namespace Aftr;
+
+namespace
+{
+   using Syntax = BoidScenarioSyntax;
+   using Clock = std::chrono::steady_clock;
+   double msSince( Clock::time_point t0 )
+   {
+      return std::chrono::duration< double, std::milli >( Clock::now() - t0 ).count();
+   }
+
+   std::vector< std::string > split( const std::string& s, char sep )
+   {
+      std::vector< std::string > parts;
+      std::istringstream in( s );
+      std::string part;
+      while( std::getline( in, part, sep ) )
+         parts.push_back( Syntax::trim( part ) );
+      return parts;
+   }
+
+   std::string formatValue( float v )
+   {
+      char buf[32];
+      std::snprintf( buf, sizeof( buf ), "%.7g", v );
+      return buf;
+   }
+
+   /// "NAME:v1,v2,..." or "NAME:MIN..MAX[:COUNT]"
+   bool parseAxis( const std::string& text, BoidSweepAxis& axis, std::string& what )
+   {
+      const size_t colon = text.find( ':' );
+      axis.key = Syntax::trim( text.substr( 0, colon ) );
+      if( colon == std::string::npos || axis.key.empty() )
+      {
+         what = "expected axis=NAME:v1,v2,... or axis=NAME:MIN..MAX:COUNT";
+         return false;
+      }
+      const std::string spec = Syntax::trim( text.substr( colon + 1 ) );
+      const size_t dots = spec.find( ".." );
+      if( dots == std::string::npos )
+      {
+         axis.values = split( spec, ',' );
+         if( axis.values.empty() || std::any_of( axis.values.begin(), axis.values.end(), []( const std::string& v ) { return v.empty(); } ) )
+         {
+            what = "axis " + axis.key + " has an empty value";
+            return false;
+         }
+         return true;
+      }
+
+      axis.range = true;
+      const size_t countColon = spec.find( ':', dots );
+      const std::string hi = spec.substr( dots + 2, countColon == std::string::npos ? std::string::npos : countColon - dots - 2 );
+      long long count = 0;
+      if( !Syntax::toFloat( Syntax::trim( spec.substr( 0, dots ) ), axis.lo ) || !Syntax::toFloat( Syntax::trim( hi ), axis.hi ) )
+      {
+         what = "axis " + axis.key + " has a bad range '" + spec + "'";
+         return false;
+      }
+      if( countColon != std::string::npos )
+      {
+         if( !Syntax::toInt( Syntax::trim( spec.substr( countColon + 1 ) ), count ) || count < 1 || count > 1000000 )
+         {
+            what = "axis " + axis.key + " has a bad point count '" + spec.substr( countColon + 1 ) + "'";
+            return false;
+         }
+         axis.count = static_cast< int >( count );
+      }
+      return true;
+   }
+
+   /// The columns every row of 'job' starts with: job, replica, seed, spec and the axis values.
+   /// spec is FNV-1a of the job's full scenario and the sample interval, so an edited base key
+   /// changes it even though no axis column shows the edit
+   std::string rowPrefix( const BoidSweepJob& job, int sampleInterval )
+   {
+      const std::string text = job.scenario.toText() + "sampleInterval=" + std::to_string( sampleInterval ) + "\n";
+      uint64_t hash = 14695981039346656037ull;
+      for( unsigned char c : text )
+         hash = ( hash ^ c ) * 1099511628211ull;
+      char spec[32];
+      std::snprintf( spec, sizeof( spec ), "%016llx", static_cast< unsigned long long >( hash ) );
+
+      std::string prefix = std::to_string( job.index ) + "," + std::to_string( job.replica ) + "," +
+                           std::to_string( job.scenario.seed ) + "," + spec;
+      for( const std::string& v : job.values )
+         prefix += "," + v;
+      return prefix + ",";
+   }
+
+   /// Finished jobs' rows of a previous run of the same sweep: only newline terminated rows with
+   /// every column count whose leading columns match what the job would write now (a job edited
+   /// in the spec since runs again), and only jobs whose last row is their final step
+   bool readFinished( const std::string& path, const std::string& header, const std::vector< BoidSweepJob >& jobs,
+                      int sampleInterval, std::vector< char >& done, std::string& kept, std::string* error )
+   {
+      std::ifstream in( path, std::ios::binary );
+      if( !in )
+         return true; // nothing to resume
+      std::stringstream ss;
+      ss << in.rdbuf();
+      const std::string text = ss.str();
+      if( text.empty() )
+         return true;
+
+      const size_t columns = split( header, ',' ).size();
+      const size_t stepColumn = columns - 9;
+      std::vector< std::string > prefixes;
+      prefixes.reserve( jobs.size() );
+      for( const BoidSweepJob& job : jobs )
+         prefixes.push_back( rowPrefix( job, sampleInterval ) );
+      std::map< int, std::string > rows;
+      std::map< int, long long > lastStep;
+      std::vector< char > stale( jobs.size(), 0 );
+      size_t pos = 0;
+      for( bool first = true; ; first = false )
+      {
+         const size_t eol = text.find( '\n', pos );
+         if( eol == std::string::npos )
+            break; // a torn last row
+         const std::string line = text.substr( pos, eol - pos );
+         pos = eol + 1;
+         if( first )
+         {
+            if( line != header )
+               return Syntax::fail( error, path + " was written by a different sweep (header mismatch)" );
+            continue;
+         }
+         const std::vector< std::string > cols = split( line, ',' );
+         long long job = 0, step = 0;
+         if( cols.size() != columns || !Syntax::toInt( cols[0], job ) || !Syntax::toInt( cols[stepColumn], step ) ||
+             job < 0 || job >= static_cast< long long >( jobs.size() ) )
+            continue;
+         if( line.compare( 0, prefixes[job].size(), prefixes[job] ) != 0 )
+         {
+            stale[job] = 1;
+            continue;
+         }
+         rows[static_cast< int >( job )] += line + "\n";
+         lastStep[static_cast< int >( job )] = step;
+      }
+
+      for( const auto& [job, text] : rows )
+         if( !stale[job] && lastStep[job] == jobs[job].scenario.steps )
+         {
+            done[job] = 1;
+            kept += text;
+         }
+      return true;
+   }
+}
+
+bool BoidSweepOptions::parse( const std::vector< std::string >& args, BoidSweepOptions& out, std::string* error )
+{
+   for( const std::string& arg : args )
+   {
+      const size_t eq = arg.find( '=' );
+      const std::string flag = arg.substr( 0, eq );
+      const std::string value = eq == std::string::npos ? std::string() : arg.substr( eq + 1 );
+      auto positive = [&value]( int& field, int limit )
+      {
+         char* end = nullptr;
+         const long v = std::strtol( value.c_str(), &end, 10 );
+         if( value.empty() || *end != '\0' || v <= 0 || v > limit )
+            return false;
+         field = static_cast< int >( v );
+         return true;
+      };
+
+      if( flag == "--sweep" )
+      {
+         if( value.empty() )
+            return Syntax::fail( error, "--sweep expects a .boidsweep file" );
+         out.specPath = value;
+      }
+      else if( flag == "--sweep-out" )
+      {
+         if( value.empty() )
+            return Syntax::fail( error, "--sweep-out expects a file" );
+         out.outPath = value;
+      }
+      else if( flag == "--sweep-jobs" )
+      {
+         if( !positive( out.jobs, 1024 ) )
+            return Syntax::fail( error, "--sweep-jobs expects 1..1024 concurrent jobs, got '" + value + "'" );
+      }
+      else if( flag == "--sweep-threads" )
+      {
+         if( !positive( out.threadsPerJob, 1024 ) )
+            return Syntax::fail( error, "--sweep-threads expects 1..1024 threads per job, got '" + value + "'" );
+      }
+      else if( flag == "--sweep-resume" )
+         out.resume = true;
+   }
+   return true;
+}
+
+// ============================================================
+// Spec
+// ============================================================
+
+bool BoidSweep::parse( const std::string& text, BoidSweep& out, const std::string& baseDir, std::string* error )
+{
+   BoidSweep s;
+   std::vector< std::pair< int, std::pair< std::string, std::string > > > entries;
+   std::istringstream in( text );
+   std::string line;
+   for( int lineNo = 1; std::getline( in, line ); ++lineNo )
+   {
+      line = Syntax::trim( line.substr( 0, line.find( '#' ) ) );
+      if( line.empty() )
+         continue;
+      const size_t eq = line.find( '=' );
+      if( eq == std::string::npos )
+         return Syntax::fail( error, "line " + std::to_string( lineNo ) + ": expected key=value" );
+      const std::string key = Syntax::lower( Syntax::trim( line.substr( 0, eq ) ) );
+      const std::string value = Syntax::trim( line.substr( eq + 1 ) );
+
+      // The base scenario comes first wherever it is given, so every other key overrides it
+      if( key == "scenario" )
+      {
+         std::filesystem::path path( value );
+         if( path.is_relative() && !baseDir.empty() )
+            path = std::filesystem::path( baseDir ) / path;
+         std::string what;
+         if( !BoidScenario::load( path.string(), s.base, &what ) )
+            return Syntax::fail( error, "line " + std::to_string( lineNo ) + ": " + what );
+      }
+      else
+         entries.push_back( { lineNo, { key, value } } );
+   }
+
+   for( const auto& [lineNo, entry] : entries )
+   {
+      const auto& [key, value] = entry;
+      std::string what;
+      long long i = 0;
+      bool ok = true;
+      if( key == "mode" )
+      {
+         const std::string mode = Syntax::lower( value );
+         ok = mode == "grid" || mode == "random";
+         s.mode = mode == "random" ? Mode::Random : Mode::Grid;
+         what = "mode is grid or random, got '" + value + "'";
+      }
+      else if( key == "samples" || key == "replicas" || key == "sampleinterval" )
+      {
+         ok = Syntax::toInt( value, i ) && i > 0 && i <= 100000000;
+         what = "bad " + key + " '" + value + "'";
+         if( ok )
+            ( key == "samples" ? s.samples : key == "replicas" ? s.replicas : s.sampleInterval ) = static_cast< int >( i );
+      }
+      else if( key == "sampleseed" )
+      {
+         ok = Syntax::toInt( value, i ) && i >= 0;
+         what = "bad sampleSeed '" + value + "'";
+         s.sampleSeed = static_cast< uint64_t >( i );
+      }
+      else if( key == "axis" )
+      {
+         BoidSweepAxis axis;
+         ok = parseAxis( value, axis, what );
+         s.axes.push_back( std::move( axis ) );
+      }
+      else
+         ok = s.base.set( key, value, &what );
+      if( !ok )
+         return Syntax::fail( error, "line " + std::to_string( lineNo ) + ": " + what );
+   }
+
+   if( s.mode == Mode::Grid )
+      for( const BoidSweepAxis& a : s.axes )
+         if( a.range && a.count == 0 )
+            return Syntax::fail( error, "axis " + a.key + " needs a point count in grid mode (MIN..MAX:COUNT)" );
+
+   out = std::move( s );
+   return true;
+}
+
+bool BoidSweep::load( const std::string& path, BoidSweep& out, std::string* error )
+{
+   std::ifstream in( path );
+   if( !in )
+      return Syntax::fail( error, "cannot open " + path );
+   std::stringstream ss;
+   ss << in.rdbuf();
+   if( !parse( ss.str(), out, std::filesystem::path( path ).parent_path().string(), error ) )
+   {
+      if( error )
+         *error = path + ", " + *error;
+      return false;
+   }
+   return true;
+}
+
+int BoidSweep::getNumJobs() const
+{
+   if( this->mode == Mode::Random )
+      return this->samples * this->replicas;
+   long long points = 1;
+   for( const BoidSweepAxis& a : this->axes )
+      points *= a.range ? a.count : static_cast< long long >( a.values.size() );
+   return static_cast< int >( std::min< long long >( points * this->replicas, INT32_MAX ) );
+}
+
+bool BoidSweep::expand( std::vector< BoidSweepJob >& out, std::string* error ) const
+{
+   const int n = this->getNumJobs();
+   const uint32_t key[2] = { static_cast< uint32_t >( this->sampleSeed ), static_cast< uint32_t >( this->sampleSeed >> 32 ) };
+   out.clear();
+   out.reserve( n );
+   for( int j = 0; j < n; ++j )
+   {
+      BoidSweepJob job;
+      job.index = j;
+      job.point = j / this->replicas;
+      job.replica = j % this->replicas;
+      job.scenario = this->base;
+      job.scenario.seed = this->base.seed + job.replica;
+
+      // Grid points are mixed-radix digits of the point index, last axis fastest
+      int rest = job.point;
+      job.values.resize( this->axes.size() );
+      for( size_t a = this->axes.size(); a-- > 0; )
+      {
+         const BoidSweepAxis& axis = this->axes[a];
+         const int size = axis.range ? axis.count : static_cast< int >( axis.values.size() );
+         if( this->mode == Mode::Grid )
+         {
+            const int k = rest % size;
+            rest /= size;
+            job.values[a] = !axis.range ? axis.values[k]
+                          : formatValue( size > 1 ? axis.lo + ( axis.hi - axis.lo ) * k / ( size - 1 ) : axis.lo );
+         }
+         else
+         {
+            const uint32_t ctr[4] = { static_cast< uint32_t >( job.point ), static_cast< uint32_t >( a ), 0, 0 };
+            uint32_t r[4];
+            BoidRng::philox4x32( ctr, key, r );
+            job.values[a] = !axis.range ? axis.values[r[1] % axis.values.size()]
+                          : formatValue( axis.lo + ( axis.hi - axis.lo ) * static_cast< float >( r[0] * ( 1.0 / 4294967296.0 ) ) );
+         }
+      }
+      for( size_t a = 0; a < this->axes.size(); ++a )
+      {
+         std::string what;
+         if( !job.scenario.set( this->axes[a].key, job.values[a], &what ) )
+            return Syntax::fail( error, "axis " + this->axes[a].key + ": " + what );
+      }
+      out.push_back( std::move( job ) );
+   }
+   return true;
+}
+
+std::string BoidSweep::getHeader() const
+{
+   std::string header = "job,replica,seed,spec";
+   for( const BoidSweepAxis& a : this->axes )
+      header += "," + a.key;
+   return header + ",step,polarization,meanSpeed,gyrationRadius,centroidX,centroidY,centroidZ,stepMs,jobMs";
+}
+
+// ============================================================
+// Runner
+// ============================================================
+
+std::string BoidSweep::runJob( const BoidSweepJob& job, BoidThreadPool& pool ) const
+{
+   BOID_PROFILE_ZONE( "BoidSweep::runJob" );
+   const BoidScenario& sc = job.scenario;
+   const std::string prefix = rowPrefix( job, this->sampleInterval );
+
+   std::string rows;
+   const auto t0 = Clock::now();
+   double sampledMs = 0.0; // job time when the previous sample was taken, excluding the metrics
+   int sampledStep = 0;
+   sc.runCpu( pool, nullptr, this->sampleInterval, [&]( int step, const BoidGPU* state )
+   {
+      const double stepMs = step > sampledStep ? ( msSince( t0 ) - sampledMs ) / ( step - sampledStep ) : 0.0;
+      const BoidSwarmMetrics m = BoidSwarmMetrics::compute( state, sc.params.numBoids );
+      sampledMs = msSince( t0 );
+      sampledStep = step;
+      char buf[256];
+      std::snprintf( buf, sizeof( buf ), "%d,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.4f,%.3f\n", step, m.polarization, m.meanSpeed,
+                     m.gyrationRadius, m.centroid[0], m.centroid[1], m.centroid[2], stepMs, sampledMs );
+      rows += prefix;
+      rows += buf;
+   } );
+   return rows;
+}
+
+bool BoidSweep::run( const BoidSweepOptions& options, BoidSweepReport* report, std::ostream* progress, std::string* error ) const
+{
+   BOID_PROFILE_ZONE( "BoidSweep::run" );
+   const auto t0 = Clock::now();
+   std::vector< BoidSweepJob > jobs;
+   if( !this->expand( jobs, error ) )
+      return false;
+
+   const std::string header = this->getHeader();
+   std::vector< char > done( jobs.size(), 0 );
+   std::string kept;
+   if( options.resume && !readFinished( options.outPath, header, jobs, this->sampleInterval, done, kept, error ) )
+      return false;
+
+   // Start over from the finished rows only; the rename keeps them if we are killed right here
+   {
+      const std::string tmp = options.outPath + ".tmp";
+      std::ofstream o( tmp, std::ios::binary | std::ios::trunc );
+      o << header << "\n" << kept;
+      o.close();
+      std::error_code ec;
+      if( !o || ( std::filesystem::rename( tmp, options.outPath, ec ), ec ) )
+         return Syntax::fail( error, "cannot write " + options.outPath );
+   }
+   std::ofstream out( options.outPath, std::ios::binary | std::ios::app );
+   if( !out )
+      return Syntax::fail( error, "cannot open " + options.outPath );
+
+   std::vector< int > todo;
+   for( size_t j = 0; j < jobs.size(); ++j )
+      if( !done[j] )
+         todo.push_back( static_cast< int >( j ) );
+
+   const int threadsPerJob = std::max( 1, options.threadsPerJob );
+   const int cores = static_cast< int >( std::max( 1u, std::thread::hardware_concurrency() ) );
+   int workers = options.jobs > 0 ? options.jobs : std::max( 1, cores / threadsPerJob );
+   workers = std::max( 1, std::min( workers, static_cast< int >( todo.size() ) ) );
+   const bool pin = workers * threadsPerJob <= cores; // pinning an oversubscribed sweep would only stack jobs
+
+   if( progress )
+      *progress << "Sweep: " << jobs.size() << " jobs (" << jobs.size() - todo.size() << " resumed), " << workers
+                << " at a time on " << threadsPerJob << " thread(s) each" << ( pin ? ", pinned" : "" ) << std::endl;
+
+   std::atomic< size_t > nextJob{ 0 };
+   std::atomic< bool > failed{ false };
+   std::mutex outMutex;
+   int finished = 0;
+   auto worker = [&]( int w )
+   {
+      const int firstCore = pin ? w * threadsPerJob : -1;
+      if( pin )
+         BoidThreadPool::pinCurrentThread( static_cast< unsigned int >( firstCore ) );
+      BoidProfiler::setThreadName( "Sweep job" );
+      BoidThreadPool pool( static_cast< unsigned int >( threadsPerJob ), firstCore );
+      while( !failed )
+      {
+         const size_t k = nextJob++;
+         if( k >= todo.size() )
+            break;
+         const BoidSweepJob& job = jobs[todo[k]];
+         const auto tJob = Clock::now();
+         const std::string rows = this->runJob( job, pool );
+
+         std::lock_guard< std::mutex > lock( outMutex );
+         out.write( rows.data(), static_cast< std::streamsize >( rows.size() ) );
+         out.flush();
+         if( !out )
+            failed = true;
+         ++finished;
+         if( progress )
+            *progress << "sweep job " << job.index << " done in " << msSince( tJob ) << " ms (" << finished << "/"
+                      << todo.size() << ")" << std::endl;
+      }
+   };
+   std::vector< std::thread > threads;
+   for( int w = 0; w < workers; ++w )
+      threads.emplace_back( worker, w );
+   for( std::thread& t : threads )
+      t.join();
+
+   if( report )
+   {
+      report->jobsTotal = static_cast< int >( jobs.size() );
+      report->jobsResumed = static_cast< int >( jobs.size() - todo.size() );
+      report->jobsRun = finished;
+      report->totalMs = msSince( t0 );
+   }
+   if( failed )
+      return Syntax::fail( error, "writing " + options.outPath + " failed" );
+   return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "BoidScenario.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+
+/// Command line of a parameter sweep: --sweep=FILE [--sweep-out=FILE] [--sweep-jobs=N] [--sweep-threads=N] [--sweep-resume]
+struct BoidSweepOptions
+{
+   std::string specPath;            // empty = no sweep
+   std::string outPath = "boid_sweep.csv";
+   int jobs = 0;                    // concurrent jobs, 0 = cores / threadsPerJob
+   int threadsPerJob = 1;           // BoidThreadPool size of every job
+   bool resume = false;             // keep the finished jobs already in outPath
+
+   /// Picks the sweep flags out of 'args' and ignores everything else; false with a message in
+   /// 'error' when a sweep flag has a bad value
+   static bool parse( const std::vector< std::string >& args, BoidSweepOptions& out, std::string* error = nullptr );
+};
+
+/// One swept scenario key: a list of values, or MIN..MAX sampled at 'count' points (grid) or uniformly (random)
+struct BoidSweepAxis
+{
+   std::string key;                 // any BoidScenario file key
+   std::vector< std::string > values;
+   bool range = false;
+   float lo = 0.0f;
+   float hi = 0.0f;
+   int count = 0;
+};
+
+/// One headless run of a sweep: the base scenario with this job's axis values and replica seed applied
+struct BoidSweepJob
+{
+   int index = 0;
+   int point = 0;                   // parameter point; the replicas of a point share it
+   int replica = 0;
+   std::vector< std::string > values; // one per axis, as applied with BoidScenario::set
+   BoidScenario scenario;
+};
+
+/// How much of a sweep ran; jobsResumed were already complete in the output file
+struct BoidSweepReport
+{
+   int jobsTotal = 0;
+   int jobsResumed = 0;
+   int jobsRun = 0;
+   double totalMs = 0.0;
+};
+
+/**
+   A batch of headless CPU runs over a grid or a random sample of scenario parameters. Sweep
+   files (*.boidsweep) use the scenario file syntax:
+
+      scenario=tank.boidscene            # base scenario, relative to the sweep file; default tank otherwise
+      steps=300                          # any scenario key overrides the base
+      mode=grid                          # grid (cartesian product, last axis fastest) or random
+      samples=64                         # random mode: parameter points...
+      sampleSeed=7                       # ...and their Philox key
+      replicas=3                         # runs per point with seeds base.seed + 0, 1, 2
+      sampleInterval=20                  # metrics every K steps, plus step 0 and the last step
+      axis=cohesionWeight:0.2..1.0:5     # MIN..MAX:COUNT (grid points, or a uniform draw in random mode)
+      axis=numBoids:256,512,1024         # list
+
+   Random points are Philox4x32 of (point, axis) under sampleSeed, so a job's parameters do not
+   depend on which jobs ran before it. run() spreads the jobs over 'jobs' worker threads, each
+   with its own BoidThreadPool pinned to a disjoint range of cores when they fit, and appends
+   every finished job's rows to a single CSV file in one write. A resumed sweep drops the rows of
+   jobs that did not reach their last step or whose parameters changed in the spec since, and
+   runs only those and the ones not yet started.
+*/
+struct BoidSweep
+{
+   enum class Mode { Grid, Random };
+
+   BoidScenario base = BoidScenario::makeDefault();
+   std::vector< BoidSweepAxis > axes;
+   Mode mode = Mode::Grid;
+   int samples = 16;
+   uint64_t sampleSeed = 1;
+   int replicas = 1;
+   int sampleInterval = 10;
+
+   /// 'baseDir' resolves a relative scenario= path; false with "line N: what" in 'error'
+   static bool parse( const std::string& text, BoidSweep& out, const std::string& baseDir = std::string(), std::string* error = nullptr );
+   static bool load( const std::string& path, BoidSweep& out, std::string* error = nullptr );
+
+   int getNumJobs() const;
+   /// All jobs in index order; false if an axis value is rejected by the scenario
+   bool expand( std::vector< BoidSweepJob >& out, std::string* error = nullptr ) const;
+
+   /// CSV header: job, replica, seed, spec (a hash of the job's scenario), one column per axis, step, the BoidSwarmMetrics fields, stepMs, jobMs
+   std::string getHeader() const;
+   /// Runs 'job' on 'pool' and returns its CSV rows (newline terminated)
+   std::string runJob( const BoidSweepJob& job, BoidThreadPool& pool ) const;
+
+   /// Runs the sweep into options.outPath; 'progress' gets one line per finished job
+   bool run( const BoidSweepOptions& options, BoidSweepReport* report = nullptr, std::ostream* progress = nullptr,
+             std::string* error = nullptr ) const;
+};
+
+} //namespace Aftr
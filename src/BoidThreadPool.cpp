@@ -0,0 +1,136 @@
+#include "BoidThreadPool.h"
+#include "BoidProfiler.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+   #ifndef NOMINMAX
+      #define NOMINMAX
+   #endif
+   #ifndef WIN32_LEAN_AND_MEAN
+      #define WIN32_LEAN_AND_MEAN
+   #endif
+   #include <windows.h>
+#else
+   #include <pthread.h>
+   #include <sched.h>
+#endif
+
+using namespace Aftr;
+
+BoidThreadPool::BoidThreadPool( unsigned int numThreads, int firstCore )
+{
+   if( numThreads == 0 )
+      numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+   // The calling thread always participates, so spawn one fewer worker
+   for( unsigned int i = 1; i < numThreads; ++i )
+      this->workers.emplace_back( [this, i, firstCore]()
+      {
+         if( firstCore >= 0 )
+            pinCurrentThread( static_cast< unsigned int >( firstCore ) + i );
+         this->workerLoop();
+      } );
+}
+
+BoidThreadPool::~BoidThreadPool()
+{
+   {
+      std::lock_guard< std::mutex > lock( this->mtx );
+      this->stopping = true;
+   }
+   this->wakeCv.notify_all();
+   for( auto& t : this->workers )
+      t.join();
+}
+
+BoidThreadPool& BoidThreadPool::shared()
+{
+   static BoidThreadPool pool;
+   return pool;
+}
+
+bool BoidThreadPool::pinCurrentThread( unsigned int core )
+{
+   core %= std::max( 1u, std::thread::hardware_concurrency() );
+#ifdef _WIN32
+   return core < 64 && SetThreadAffinityMask( GetCurrentThread(), DWORD_PTR( 1 ) << core ) != 0;
+#elif defined( __linux__ )
+   cpu_set_t set;
+   CPU_ZERO( &set );
+   CPU_SET( core, &set );
+   return pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0;
+#else
+   return false;
+#endif
+}
+
+void BoidThreadPool::parallelFor( uint32_t count, uint32_t grain, BoidChunkFn fn )
+{
+   if( count == 0 )
+      return;
+   grain = std::max( 1u, grain );
+
+   // Small jobs (or a pool without workers) are not worth waking anybody up for
+   if( count <= grain || this->workers.empty() )
+   {
+      fn( 0, count );
+      return;
+   }
+
+   std::lock_guard< std::mutex > submitLock( this->submitMutex );
+   {
+      std::lock_guard< std::mutex > lock( this->mtx );
+      this->job = &fn;
+      this->jobCount = count;
+      this->jobGrain = grain;
+      this->nextChunk.store( 0, std::memory_order_relaxed );
+      this->busyWorkers = static_cast< unsigned int >( this->workers.size() );
+      ++this->generation;
+   }
+   this->wakeCv.notify_all();
+
+   this->runChunks();
+
+   std::unique_lock< std::mutex > lock( this->mtx );
+   this->doneCv.wait( lock, [this]() { return this->busyWorkers == 0; } );
+   this->job = nullptr;
+}
+
+void BoidThreadPool::runChunks()
+{
+   const uint32_t numChunks = ( this->jobCount + this->jobGrain - 1 ) / this->jobGrain;
+   for( ;; )
+   {
+      uint32_t chunk = this->nextChunk.fetch_add( 1, std::memory_order_relaxed );
+      if( chunk >= numChunks )
+         break;
+      uint32_t begin = chunk * this->jobGrain;
+      uint32_t end = std::min( this->jobCount, begin + this->jobGrain );
+      ( *this->job )( begin, end );
+   }
+}
+
+void BoidThreadPool::workerLoop()
+{
+   BoidProfiler::setThreadName( "Boid Worker" );
+   uint64_t seenGeneration = 0;
+   for( ;; )
+   {
+      {
+         std::unique_lock< std::mutex > lock( this->mtx );
+         this->wakeCv.wait( lock, [&]() { return this->stopping || this->generation != seenGeneration; } );
+         if( this->stopping )
+            return;
+         seenGeneration = this->generation;
+      }
+
+      this->runChunks();
+
+      {
+         std::lock_guard< std::mutex > lock( this->mtx );
+         --this->busyWorkers;
+      }
+      this->doneCv.notify_one();
+   }
+}
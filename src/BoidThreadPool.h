@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Aftr
+{
+
+/// Non-owning reference to a chunk function. Unlike std::function it never allocates, whatever
+/// the lambda captures; the callable must outlive the parallelFor() call it is passed to.
+class BoidChunkFn
+{
+public:
+   template< typename F >
+   BoidChunkFn( const F& fn ) : object( &fn ), call( []( const void* o, uint32_t begin, uint32_t end ) { ( *static_cast< const F* >( o ) )( begin, end ); } ) {}
+
+   void operator()( uint32_t begin, uint32_t end ) const { this->call( this->object, begin, end ); }
+
+private:
+   const void* object;
+   void ( *call )( const void*, uint32_t, uint32_t );
+};
+
+/**
+   Fixed pool of worker threads for data-parallel CPU stages (cluster analysis, CPU stepping, ...).
+   parallelFor() splits [0,count) into chunks of 'grain' items which are claimed by the workers
+   and by the calling thread; it returns once every chunk has run. Calls from different threads
+   are serialized, and calling parallelFor() from inside a chunk is not supported.
+*/
+class BoidThreadPool
+{
+public:
+   /// numThreads 0 = one thread per hardware core. With firstCore >= 0 worker i is pinned to core
+   /// firstCore + i + 1 (modulo the core count), leaving firstCore for the calling thread
+   explicit BoidThreadPool( unsigned int numThreads = 0, int firstCore = -1 );
+   ~BoidThreadPool();
+   BoidThreadPool( const BoidThreadPool& ) = delete;
+   BoidThreadPool& operator=( const BoidThreadPool& ) = delete;
+
+   /// Threads that execute chunks, including the caller of parallelFor()
+   unsigned int getNumThreads() const { return static_cast< unsigned int >( this->workers.size() ) + 1; }
+
+   void parallelFor( uint32_t count, uint32_t grain, BoidChunkFn fn );
+
+   /// Shared process-wide pool sized to the machine
+   static BoidThreadPool& shared();
+   /// Restricts the calling thread to one core (modulo the core count); false where unsupported
+   static bool pinCurrentThread( unsigned int core );
+
+private:
+   void workerLoop();
+   void runChunks();
+
+   std::vector< std::thread > workers;
+   std::mutex submitMutex;
+   std::mutex mtx;
+   std::condition_variable wakeCv;
+   std::condition_variable doneCv;
+
+   const BoidChunkFn* job = nullptr;
+   uint32_t jobCount = 0;
+   uint32_t jobGrain = 1;
+   std::atomic< uint32_t > nextChunk{ 0 };
+   uint64_t generation = 0;
+   unsigned int busyWorkers = 0;
+   bool stopping = false;
+};
+
+} //namespace Aftr
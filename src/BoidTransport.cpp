@@ -0,0 +1,412 @@
+#include "BoidTransport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+   #include <cerrno>
+   #include <fcntl.h>
+   #include <poll.h>
+   #include <sys/socket.h>
+   #include <sys/un.h>
+   #include <unistd.h>
+#endif
+
+using namespace Aftr;
+
+// ============================================================
+// Collectives
+// ============================================================
+
+bool BoidTransport::allGather( const std::vector< uint8_t >& mine, std::vector< std::vector< uint8_t > >& all )
+{
+   const int size = this->getSize();
+   const int self = this->getRank();
+   all.resize( size );
+   for( int r = 0; r < size; ++r )
+      if( r != self )
+         this->send( r, std::vector< uint8_t >( mine ) );
+   all[self] = mine;
+   for( int r = 0; r < size; ++r )
+      if( r != self && !this->receive( r, all[r] ) )
+         return false;
+   return true;
+}
+
+bool BoidTransport::allReduceSum( double* values, int count )
+{
+   const size_t bytes = count * sizeof( double );
+   std::vector< uint8_t > mine( bytes );
+   std::memcpy( mine.data(), values, bytes );
+   std::vector< std::vector< uint8_t > > all;
+   if( !this->allGather( mine, all ) )
+      return false;
+
+   // Rank order on every rank: identical sums everywhere
+   std::vector< double > part( count );
+   for( int i = 0; i < count; ++i )
+      values[i] = 0.0;
+   for( const std::vector< uint8_t >& contribution : all )
+   {
+      if( contribution.size() != bytes )
+         return false;
+      std::memcpy( part.data(), contribution.data(), bytes );
+      for( int i = 0; i < count; ++i )
+         values[i] += part[i];
+   }
+   return true;
+}
+
+// ============================================================
+// In-process ranks
+// ============================================================
+
+class BoidLocalTransportHub::Endpoint : public BoidTransport
+{
+public:
+   Endpoint( BoidLocalTransportHub& hub, int rank ) : hub( hub ), rank( rank ) {}
+
+   int getRank() const override { return this->rank; }
+   int getSize() const override { return this->hub.size; }
+
+   void send( int to, std::vector< uint8_t >&& message ) override
+   {
+      this->bytesSent += message.size();
+      ++this->messagesSent;
+      {
+         std::lock_guard< std::mutex > lock( this->hub.mtx );
+         this->hub.queues[this->rank * this->hub.size + to].messages.push_back( std::move( message ) );
+      }
+      this->hub.cv.notify_all();
+   }
+
+   bool receive( int from, std::vector< uint8_t >& message ) override
+   {
+      std::unique_lock< std::mutex > lock( this->hub.mtx );
+      Queue& q = this->hub.queues[from * this->hub.size + this->rank];
+      this->hub.cv.wait( lock, [&q]() { return !q.messages.empty(); } );
+      message = std::move( q.messages.front() );
+      q.messages.pop_front();
+      return true;
+   }
+
+private:
+   BoidLocalTransportHub& hub;
+   int rank;
+};
+
+BoidLocalTransportHub::BoidLocalTransportHub( int size ) : size( size ), queues( size * size )
+{
+   for( int r = 0; r < size; ++r )
+      this->endpoints.push_back( std::make_unique< Endpoint >( *this, r ) );
+}
+
+BoidLocalTransportHub::~BoidLocalTransportHub() = default;
+
+BoidTransport& BoidLocalTransportHub::getTransport( int rank )
+{
+   return *this->endpoints[rank];
+}
+
+// ============================================================
+// Unix domain sockets
+// ============================================================
+
+std::string BoidSocketTransport::socketPath( const std::string& dir, int rank )
+{
+   std::string path = dir;
+   if( !path.empty() && path.back() != '/' )
+      path += '/';
+   return path + "boid_rank_" + std::to_string( rank ) + ".sock";
+}
+
+#ifdef _WIN32
+
+BoidSocketTransport::~BoidSocketTransport() = default;
+
+std::unique_ptr< BoidSocketTransport > BoidSocketTransport::connect( const std::string&, int, int, std::string* error, int )
+{
+   if( error )
+      *error = "the socket transport needs a POSIX system";
+   return nullptr;
+}
+
+void BoidSocketTransport::send( int, std::vector< uint8_t >&& ) {}
+bool BoidSocketTransport::receive( int, std::vector< uint8_t >& ) { return false; }
+bool BoidSocketTransport::pump( int ) { return false; }
+bool BoidSocketTransport::popMessage( Peer&, std::vector< uint8_t >& ) { return false; }
+
+#else
+
+namespace
+{
+   // A write to a peer that already exited must fail with EPIPE rather than raise SIGPIPE,
+   // which would kill this rank before it can report the lost peer
+#ifdef MSG_NOSIGNAL
+   constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+   constexpr int sendFlags = 0; // SO_NOSIGPIPE is set on every socket instead (macOS)
+#endif
+
+   void suppressSigPipe( int fd )
+   {
+#ifdef SO_NOSIGPIPE
+      int on = 1;
+      ::setsockopt( fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof( on ) );
+#else
+      (void) fd;
+#endif
+   }
+
+   bool fillAddress( const std::string& path, sockaddr_un& addr )
+   {
+      std::memset( &addr, 0, sizeof( addr ) );
+      addr.sun_family = AF_UNIX;
+      if( path.size() >= sizeof( addr.sun_path ) )
+         return false;
+      std::memcpy( addr.sun_path, path.c_str(), path.size() + 1 );
+      return true;
+   }
+
+   bool writeAll( int fd, const void* data, size_t bytes )
+   {
+      const uint8_t* p = static_cast< const uint8_t* >( data );
+      while( bytes > 0 )
+      {
+         ssize_t n = ::send( fd, p, bytes, sendFlags );
+         if( n < 0 && errno == EINTR )
+            continue;
+         if( n <= 0 )
+            return false;
+         p += n;
+         bytes -= static_cast< size_t >( n );
+      }
+      return true;
+   }
+
+   bool readAll( int fd, void* data, size_t bytes )
+   {
+      uint8_t* p = static_cast< uint8_t* >( data );
+      while( bytes > 0 )
+      {
+         ssize_t n = ::read( fd, p, bytes );
+         if( n < 0 && errno == EINTR )
+            continue;
+         if( n <= 0 )
+            return false;
+         p += n;
+         bytes -= static_cast< size_t >( n );
+      }
+      return true;
+   }
+}
+
+BoidSocketTransport::~BoidSocketTransport()
+{
+   // Deliver what is still buffered before the peers see the connection close
+   for( Peer& p : this->peers )
+      if( p.fd >= 0 && p.outPos < p.outbox.size() )
+      {
+         fcntl( p.fd, F_SETFL, fcntl( p.fd, F_GETFL ) & ~O_NONBLOCK );
+         writeAll( p.fd, p.outbox.data() + p.outPos, p.outbox.size() - p.outPos );
+      }
+   for( Peer& p : this->peers )
+      if( p.fd >= 0 )
+         ::close( p.fd );
+   if( this->listenFd >= 0 )
+   {
+      ::close( this->listenFd );
+      ::unlink( this->listenPath.c_str() );
+   }
+}
+
+std::unique_ptr< BoidSocketTransport > BoidSocketTransport::connect( const std::string& dir, int rank, int size,
+                                                                     std::string* error, int timeoutMs )
+{
+   auto fail = [error]( const std::string& what ) -> std::unique_ptr< BoidSocketTransport >
+   {
+      if( error )
+         *error = what + ( errno ? std::string( ": " ) + std::strerror( errno ) : std::string() );
+      return nullptr;
+   };
+   if( rank < 0 || rank >= size )
+      return fail( "rank " + std::to_string( rank ) + " outside 0.." + std::to_string( size - 1 ) );
+
+   std::unique_ptr< BoidSocketTransport > t( new BoidSocketTransport() );
+   t->rank = rank;
+   t->peers.resize( size );
+   using Clock = std::chrono::steady_clock;
+   const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds( timeoutMs );
+
+   // Listen first: lower ranks may already be connecting
+   sockaddr_un addr;
+   t->listenPath = socketPath( dir, rank );
+   if( !fillAddress( t->listenPath, addr ) )
+      return fail( "socket path too long: " + t->listenPath );
+   ::unlink( t->listenPath.c_str() );
+   t->listenFd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+   if( t->listenFd < 0 || ::bind( t->listenFd, reinterpret_cast< sockaddr* >( &addr ), sizeof( addr ) ) != 0 ||
+       ::listen( t->listenFd, size ) != 0 )
+      return fail( "cannot listen on " + t->listenPath );
+
+   // Connect to every lower rank (retrying until its socket exists) and introduce ourselves
+   for( int r = 0; r < rank; ++r )
+   {
+      const std::string path = socketPath( dir, r );
+      if( !fillAddress( path, addr ) )
+         return fail( "socket path too long: " + path );
+      for( ;; )
+      {
+         int fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+         if( fd < 0 )
+            return fail( "socket" );
+         suppressSigPipe( fd );
+         if( ::connect( fd, reinterpret_cast< sockaddr* >( &addr ), sizeof( addr ) ) == 0 )
+         {
+            const uint32_t self = static_cast< uint32_t >( rank );
+            if( !writeAll( fd, &self, sizeof( self ) ) )
+            {
+               ::close( fd );
+               return fail( "handshake with rank " + std::to_string( r ) );
+            }
+            t->peers[r].fd = fd;
+            break;
+         }
+         ::close( fd );
+         if( Clock::now() > deadline )
+            return fail( "timed out connecting to rank " + std::to_string( r ) + " at " + path );
+         std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      }
+   }
+
+   // Accept every higher rank; they say who they are
+   for( int accepted = rank + 1; accepted < size; ++accepted )
+   {
+      pollfd pfd{ t->listenFd, POLLIN, 0 };
+      const int left = static_cast< int >( std::chrono::duration_cast< std::chrono::milliseconds >( deadline - Clock::now() ).count() );
+      if( left <= 0 || ::poll( &pfd, 1, left ) <= 0 )
+         return fail( "timed out waiting for the higher ranks" );
+      int fd = ::accept( t->listenFd, nullptr, nullptr );
+      uint32_t peer = 0;
+      if( fd < 0 || !readAll( fd, &peer, sizeof( peer ) ) || peer <= static_cast< uint32_t >( rank ) ||
+          peer >= static_cast< uint32_t >( size ) || t->peers[peer].fd >= 0 )
+      {
+         if( fd >= 0 )
+            ::close( fd );
+         return fail( "bad handshake on " + t->listenPath );
+      }
+      suppressSigPipe( fd );
+      t->peers[peer].fd = fd;
+   }
+
+   for( Peer& p : t->peers )
+      if( p.fd >= 0 )
+         fcntl( p.fd, F_SETFL, fcntl( p.fd, F_GETFL ) | O_NONBLOCK );
+   return t;
+}
+
+void BoidSocketTransport::send( int to, std::vector< uint8_t >&& message )
+{
+   // Frame: 64-bit length, then the bytes
+   Peer& p = this->peers[to];
+   if( p.closed )
+      return; // the next receive() from it reports the loss
+   const uint64_t len = message.size();
+   const uint8_t* lenBytes = reinterpret_cast< const uint8_t* >( &len );
+   p.outbox.insert( p.outbox.end(), lenBytes, lenBytes + sizeof( len ) );
+   p.outbox.insert( p.outbox.end(), message.begin(), message.end() );
+   this->bytesSent += message.size();
+   ++this->messagesSent;
+   this->pump( 0 );
+}
+
+bool BoidSocketTransport::receive( int from, std::vector< uint8_t >& message )
+{
+   // A peer that hangs without closing its socket counts as gone once the deadline passes
+   using Clock = std::chrono::steady_clock;
+   const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds( this->receiveTimeoutMs );
+   Peer& p = this->peers[from];
+   while( !this->popMessage( p, message ) )
+   {
+      if( p.closed || p.fd < 0 )
+         return false;
+      const int left = static_cast< int >( std::chrono::duration_cast< std::chrono::milliseconds >( deadline - Clock::now() ).count() );
+      if( left <= 0 || !this->pump( std::min( left, 1000 ) ) )
+         return false;
+   }
+   return true;
+}
+
+bool BoidSocketTransport::popMessage( Peer& p, std::vector< uint8_t >& message )
+{
+   uint64_t len = 0;
+   if( p.inbox.size() < sizeof( len ) )
+      return false;
+   std::memcpy( &len, p.inbox.data(), sizeof( len ) );
+   if( p.inbox.size() < sizeof( len ) + len )
+      return false;
+   message.assign( p.inbox.begin() + sizeof( len ), p.inbox.begin() + sizeof( len ) + len );
+   p.inbox.erase( p.inbox.begin(), p.inbox.begin() + sizeof( len ) + len );
+   return true;
+}
+
+bool BoidSocketTransport::pump( int waitMs )
+{
+   std::vector< pollfd > fds;
+   std::vector< int > owner;
+   for( int r = 0; r < static_cast< int >( this->peers.size() ); ++r )
+   {
+      Peer& p = this->peers[r];
+      if( p.fd < 0 || p.closed )
+         continue;
+      short events = POLLIN;
+      if( p.outPos < p.outbox.size() )
+         events |= POLLOUT;
+      fds.push_back( pollfd{ p.fd, events, 0 } );
+      owner.push_back( r );
+   }
+   if( fds.empty() )
+      return false;
+   int ready = ::poll( fds.data(), fds.size(), waitMs );
+   if( ready < 0 )
+      return errno == EINTR;
+
+   uint8_t buffer[65536];
+   for( size_t i = 0; i < fds.size(); ++i )
+   {
+      Peer& p = this->peers[owner[i]];
+      if( fds[i].revents & POLLOUT )
+      {
+         ssize_t n = ::send( p.fd, p.outbox.data() + p.outPos, p.outbox.size() - p.outPos, sendFlags );
+         if( n > 0 )
+            p.outPos += static_cast< size_t >( n );
+         else if( n < 0 && ( errno == EPIPE || errno == ECONNRESET ) )
+            p.closed = true;
+         if( p.closed || p.outPos == p.outbox.size() )
+         {
+            p.outbox.clear();
+            p.outPos = 0;
+         }
+      }
+      if( fds[i].revents & ( POLLIN | POLLHUP | POLLERR ) )
+      {
+         for( ;; )
+         {
+            ssize_t n = ::read( p.fd, buffer, sizeof( buffer ) );
+            if( n > 0 )
+            {
+               p.inbox.insert( p.inbox.end(), buffer, buffer + n );
+               continue;
+            }
+            if( n == 0 || ( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ) )
+               p.closed = true;
+            break;
+         }
+      }
+   }
+   return true;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+
+/**
+   Message passing between the ranks of a decomposed swarm (see BoidDomainRank). Messages
+   between a pair of ranks arrive in the order they were sent; send() never waits for the
+   receiver, so a rank may send everything for a phase before it receives anything.
+
+   The collectives are built on send()/receive() and must be called by every rank in the same
+   order. Reductions add the ranks' contributions in rank order, so every rank ends up with a
+   bit-identical result and replicated state (the predators) stays in lockstep.
+*/
+class BoidTransport
+{
+public:
+   virtual ~BoidTransport() = default;
+
+   virtual int getRank() const = 0;
+   virtual int getSize() const = 0;
+   virtual void send( int to, std::vector< uint8_t >&& message ) = 0;
+   /// Blocks for the next message from 'from'; false if that rank is gone
+   virtual bool receive( int from, std::vector< uint8_t >& message ) = 0;
+
+   /// Every rank's 'mine', indexed by rank
+   bool allGather( const std::vector< uint8_t >& mine, std::vector< std::vector< uint8_t > >& all );
+   /// Element-wise sum over the ranks
+   bool allReduceSum( double* values, int count );
+
+   uint64_t getBytesSent() const { return this->bytesSent; }
+   uint64_t getMessagesSent() const { return this->messagesSent; }
+
+protected:
+   uint64_t bytesSent = 0;
+   uint64_t messagesSent = 0;
+};
+
+/**
+   Ranks that are threads of one process, for tests and for trying a decomposition without
+   spawning processes. The hub owns the queues; getTransport( r ) is rank r's endpoint.
+*/
+class BoidLocalTransportHub
+{
+public:
+   explicit BoidLocalTransportHub( int size );
+   ~BoidLocalTransportHub();
+   BoidLocalTransportHub( const BoidLocalTransportHub& ) = delete;
+   BoidLocalTransportHub& operator=( const BoidLocalTransportHub& ) = delete;
+
+   BoidTransport& getTransport( int rank );
+
+private:
+   class Endpoint;
+   struct Queue
+   {
+      std::deque< std::vector< uint8_t > > messages;
+   };
+
+   int size;
+   std::mutex mtx;
+   std::condition_variable cv;
+   std::vector< Queue > queues; // [from * size + to]
+   std::vector< std::unique_ptr< Endpoint > > endpoints;
+};
+
+/**
+   Ranks that are processes on one machine, connected by Unix domain sockets: rank r listens on
+   '<dir>/boid_rank_<r>.sock', connects to every lower rank and accepts the higher ones. Sends
+   are buffered and written without blocking; receive() keeps flushing them while it waits, so
+   two ranks sending each other large messages cannot deadlock. A rank that exits or stalls
+   makes receive() return false on the others instead of killing or hanging them. POSIX only.
+*/
+class BoidSocketTransport : public BoidTransport
+{
+public:
+   ~BoidSocketTransport() override;
+
+   /// Connects rank 'rank' of 'size'; nullptr with a message in 'error' on failure or timeout
+   static std::unique_ptr< BoidSocketTransport > connect( const std::string& dir, int rank, int size,
+                                                          std::string* error = nullptr, int timeoutMs = 10000 );
+   static std::string socketPath( const std::string& dir, int rank );
+
+   int getRank() const override { return this->rank; }
+   int getSize() const override { return static_cast< int >( this->peers.size() ); }
+   void send( int to, std::vector< uint8_t >&& message ) override;
+   /// Also false once 'from' has closed its socket or sent nothing for getReceiveTimeout() ms
+   bool receive( int from, std::vector< uint8_t >& message ) override;
+
+   void setReceiveTimeout( int ms ) { this->receiveTimeoutMs = ms; }
+   int getReceiveTimeout() const { return this->receiveTimeoutMs; }
+
+private:
+   struct Peer
+   {
+      int fd = -1;
+      std::vector< uint8_t > outbox;  // framed messages not written yet
+      size_t outPos = 0;
+      std::vector< uint8_t > inbox;   // bytes read but not consumed
+      bool closed = false;
+   };
+
+   BoidSocketTransport() = default;
+   bool pump( int waitMs );           // one poll() round: write what fits, read what arrived
+   bool popMessage( Peer& peer, std::vector< uint8_t >& message );
+
+   int rank = 0;
+   int listenFd = -1;
+   int receiveTimeoutMs = 60000;
+   std::string listenPath;
+   std::vector< Peer > peers;          // peers[rank] is unused
+};
+
+} //namespace Aftr
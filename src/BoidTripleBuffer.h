@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Aftr
+{
+
+/**
+   Lock-free single-producer, single-consumer handoff of the newest value. The writer fills
+   getWriteBuffer() and publish()es it; the reader calls update() and, if it returns true, finds
+   the newest published value in getReadBuffer(). Three slots rotate through one atomic, so
+   neither side ever waits or copies: a value published twice before the reader looks is simply
+   replaced, which publish() reports.
+
+   Slots keep their contents when they rotate, so values holding buffers reach their steady-state
+   capacity after three publishes and never allocate again.
+*/
+template< typename T >
+class BoidTripleBuffer
+{
+public:
+   /// Writer side
+   T& getWriteBuffer() { return this->slots[this->back]; }
+   /// Writer side; true if this replaced a value the reader had not taken yet
+   bool publish()
+   {
+      const uint8_t old = this->middle.exchange( static_cast< uint8_t >( this->back | FRESH ), std::memory_order_acq_rel );
+      this->back = old & INDEX;
+      return ( old & FRESH ) != 0;
+   }
+
+   /// Reader side; true if a newer value than the current read buffer was published
+   bool update()
+   {
+      if( !( this->middle.load( std::memory_order_acquire ) & FRESH ) )
+         return false;
+      this->front = this->middle.exchange( this->front, std::memory_order_acq_rel ) & INDEX;
+      return true;
+   }
+   /// Reader side
+   T& getReadBuffer() { return this->slots[this->front]; }
+   const T& getReadBuffer() const { return this->slots[this->front]; }
+
+private:
+   static constexpr uint8_t INDEX = 3;
+   static constexpr uint8_t FRESH = 4;
+
+   T slots[3];
+   uint8_t back = 0;
+   std::atomic< uint8_t > middle{ 1 };
+   uint8_t front = 2;
+};
+
+} //namespace Aftr
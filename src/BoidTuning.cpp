@@ -0,0 +1,136 @@
+#include "BoidTuning.h"
+#include "BoidBackend.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace Aftr;
+
+bool BoidTuningConfig::operator==( const BoidTuningConfig& o ) const
+{
+   return this->workgroupSize == o.workgroupSize && this->neighborLists == o.neighborLists &&
+          this->cellScale == o.cellScale && this->cpuGrain == o.cpuGrain;
+}
+
+int BoidTuningKey::getSizeBucket( int entities )
+{
+   int bucket = 0;
+   while( entities > 1 )
+   {
+      entities >>= 1;
+      ++bucket;
+   }
+   return bucket;
+}
+
+bool BoidTuningKey::operator==( const BoidTuningKey& o ) const
+{
+   return this->device == o.device && this->backend == o.backend && this->sizeBucket == o.sizeBucket;
+}
+
+std::vector< BoidTuningConfig > BoidTuningCache::getCandidates( BoidBackendType backend )
+{
+   std::vector< int > workgroups = { 256 };
+   std::vector< int > grains = { 256 };
+   if( backend == BoidBackendType::GpuCompute )
+      workgroups = { 64, 128, 256, 512 };
+   else if( backend == BoidBackendType::CpuThreaded )
+      grains = { 64, 256, 1024 };
+
+   std::vector< BoidTuningConfig > out;
+   for( int wg : workgroups )
+      for( int grain : grains )
+      {
+         BoidTuningConfig c;
+         c.workgroupSize = wg;
+         c.cpuGrain = grain;
+         out.push_back( c );
+         c.neighborLists = true;
+         for( float scale : { 1.0f, 1.5f, 2.0f } )
+         {
+            c.cellScale = scale;
+            out.push_back( c );
+         }
+      }
+   return out;
+}
+
+std::string BoidTuningCache::toText( const BoidTuningKey& key, const BoidTuningConfig& c )
+{
+   std::ostringstream out;
+   out << key.backend << '\t' << key.sizeBucket << '\t' << c.workgroupSize << '\t' << ( c.neighborLists ? 1 : 0 ) << '\t'
+       << c.cellScale << '\t' << c.cpuGrain << '\t' << c.msPerStep << '\t' << key.device;
+   return out.str();
+}
+
+bool BoidTuningCache::parseLine( const std::string& line, BoidTuningKey& key, BoidTuningConfig& c )
+{
+   if( line.empty() || line[0] == '#' )
+      return false;
+   std::istringstream in( line );
+   std::string backend, device;
+   int lists = 0;
+   BoidBackendType type;
+   if( !std::getline( in, backend, '\t' ) || !BoidBackend::parse( backend, type ) )
+      return false;
+   if( !( in >> key.sizeBucket >> c.workgroupSize >> lists >> c.cellScale >> c.cpuGrain >> c.msPerStep ) )
+      return false;
+   in.get(); // the tab before the device
+   if( !std::getline( in, device ) || device.empty() )
+      return false;
+   if( c.workgroupSize <= 0 || c.cpuGrain <= 0 || !( c.cellScale >= 1.0f ) )
+      return false;
+   key.backend = backend;
+   key.device = device;
+   c.neighborLists = lists != 0;
+   return true;
+}
+
+bool BoidTuningCache::load( const std::string& path )
+{
+   std::ifstream in( path );
+   if( !in )
+      return false;
+   this->entries.clear();
+   std::string line;
+   while( std::getline( in, line ) )
+   {
+      BoidTuningKey key;
+      BoidTuningConfig config;
+      if( parseLine( line, key, config ) )
+         this->store( key, config );
+   }
+   return true;
+}
+
+bool BoidTuningCache::save( const std::string& path ) const
+{
+   std::ofstream out( path );
+   out << "# BoidSwarm tuning cache: backend, size bucket (log2 entities), workgroup size, neighbor lists,\n"
+       << "# cell scale, CPU chunk, ms/step, device. Delete to re-tune.\n";
+   for( const auto& [key, config] : this->entries )
+      out << toText( key, config ) << "\n";
+   return static_cast< bool >( out );
+}
+
+bool BoidTuningCache::find( const BoidTuningKey& key, BoidTuningConfig& out ) const
+{
+   for( const auto& [k, config] : this->entries )
+      if( k == key )
+      {
+         out = config;
+         return true;
+      }
+   return false;
+}
+
+void BoidTuningCache::store( const BoidTuningKey& key, const BoidTuningConfig& config )
+{
+   for( auto& [k, c] : this->entries )
+      if( k == key )
+      {
+         c = config;
+         return;
+      }
+   this->entries.emplace_back( key, config );
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Aftr
+{
+enum class BoidBackendType : int;
+
+/// One point of the auto-tuner's search grid and, once measured, its cost
+struct BoidTuningConfig
+{
+   int workgroupSize = 256;    // GPU: local_size_x of the flocking kernel
+   bool neighborLists = false; // kernel variant: Verlet lists instead of all pairs
+   float cellScale = 1.0f;     // list build grid cells, in list radii (>= 1 keeps the 27-cell search exact)
+   int cpuGrain = 256;         // CPU: entities per thread pool chunk
+   float msPerStep = -1.0f;    // < 0 = not measured
+
+   bool operator==( const BoidTuningConfig& o ) const;
+};
+
+/// What a tuning result applies to: the machine, the backend and the order of magnitude of the swarm
+struct BoidTuningKey
+{
+   std::string device;          // GL renderer and version, CPU thread count
+   std::string backend;         // BoidBackend::getConfigName()
+   int sizeBucket = 0;          // floor(log2(entities))
+
+   static int getSizeBucket( int entities );
+   bool operator==( const BoidTuningKey& o ) const;
+   bool operator!=( const BoidTuningKey& o ) const { return !( *this == o ); }
+};
+
+/**
+   Winners of the startup auto-tuner, one per BoidTuningKey, persisted in a small text file
+   (boidTuningCache in aftr.conf): one tab separated line per key with the device string last.
+   Lines that do not parse are dropped, so a cache written by another version only costs a
+   re-tune.
+*/
+class BoidTuningCache
+{
+public:
+   /// Search grid for a backend: workgroup sizes (GPU) or chunk sizes (threaded CPU) crossed
+   /// with all pairs and neighbor lists over a few cell scales
+   static std::vector< BoidTuningConfig > getCandidates( BoidBackendType backend );
+
+   /// Replaces the entries with those in 'path'; false if the file does not exist
+   bool load( const std::string& path );
+   bool save( const std::string& path ) const;
+
+   bool find( const BoidTuningKey& key, BoidTuningConfig& out ) const;
+   void store( const BoidTuningKey& key, const BoidTuningConfig& config );
+   size_t size() const { return this->entries.size(); }
+
+   static std::string toText( const BoidTuningKey& key, const BoidTuningConfig& config );
+   static bool parseLine( const std::string& line, BoidTuningKey& key, BoidTuningConfig& config );
+
+private:
+   std::vector< std::pair< BoidTuningKey, BoidTuningConfig > > entries;
+};
+
+} //namespace Aftr
@@ -26,12 +26,28 @@
 #include "IndexedGeometryTriangles.h"
 #include "IndexedGeometryCylinder.h"
 #include "ManagerEnvironmentConfiguration.h"
-
+#include "BoidSwarmTypes.h"
+#include "BoidThreadPool.h"
+#include "BoidRng.h"
+#include "BoidCpuKernel.h"
+#include "BoidEnsemble.h"
+#include "BoidArena.h"
+#include "BoidProfiler.h"
+#include "BoidOffscreen.h"
+#include "BoidDriftHarness.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <functional>
 #include <cmath>
 #include <ctime>
+#include <iomanip>
 #include <vector>
 #include <iostream>
+#include <sstream>
 
 using namespace Aftr;
 
@@ -41,7 +57,41 @@ using namespace Aftr;
 
 static const char* computeShaderSource = R"(
 #version 430
-layout(local_size_x = 256) in;
+
+// Specialization knobs (see BoidKernelVariants); the defaults give the general kernel
+#ifndef BOID_WORKGROUP_SIZE
+#define BOID_WORKGROUP_SIZE 256
+#endif
+#ifndef BOID_HAS_OBSTACLES
+#define BOID_HAS_OBSTACLES 1
+#endif
+#ifndef BOID_HAS_PREDATORS
+#define BOID_HAS_PREDATORS 1
+#endif
+#ifndef BOID_HAS_NOISE
+#define BOID_HAS_NOISE 1
+#endif
+#ifndef BOID_ENSEMBLE
+#define BOID_ENSEMBLE 0
+#endif
+#ifndef BOID_NEIGHBOR_LIST
+#define BOID_NEIGHBOR_LIST 0
+#endif
+#ifndef BOID_AGGREGATES
+#define BOID_AGGREGATES 0
+#endif
+#ifndef BOID_LOD
+#define BOID_LOD 0
+#endif
+#ifndef BOID_EVENTS
+#define BOID_EVENTS 0
+#endif
+// No default: the array must match BoidStepGlobals::MAX_OBSTACLES, which specialize() injects
+#ifndef BOID_MAX_OBSTACLES
+#error BOID_MAX_OBSTACLES is injected by BoidKernelVariants::specialize
+#endif
+
+layout(local_size_x = BOID_WORKGROUP_SIZE) in;
 
 struct BoidData {
     vec4 pos; // xyz=position, w=type (0=boid, 1=predator)
@@ -51,6 +101,86 @@ struct BoidData {
 layout(std430, binding = 0) readonly  buffer BoidInput  { BoidData boidsIn[];  };
 layout(std430, binding = 1)           buffer BoidOutput { BoidData boidsOut[]; };
 
+#if BOID_NEIGHBOR_LIST
+// Verlet lists (see BoidGpuNeighborList): count of boid i at [i], its indices from
+// u_numBoids + i * u_maxNeighbors. Moving more than skin/2 from the build position raises
+// neighborCtrl[0], which makes the next step rebuild.
+layout(std430, binding = 5) readonly buffer NeighborList { uint neighborData[]; };
+layout(std430, binding = 6) readonly buffer NeighborRef  { vec4 neighborRefPos[]; };
+layout(std430, binding = 7)          buffer NeighborControl { uint neighborCtrl[]; };
+uniform uint  u_maxNeighbors;
+uniform float u_halfSkinSq;
+#endif
+
+#if BOID_AGGREGATES
+// Cell aggregate hierarchy (see BoidGpuAggregates). Level 0 is a dim^3 grid of the boids
+// sorted by cell, level l + 1 merges 2x2x2 cells of level l; two vec4 per cell and level:
+// position sum and count, velocity sum.
+#define BOID_AGG_MAX_LEVELS 8
+#define BOID_AGG_STACK 96
+layout(std430, binding = 5) readonly buffer AggregateGrid  { uint aggGrid[]; };  // level-0 cell starts | cursors | sorted boids
+layout(std430, binding = 6) readonly buffer AggregateNodes { vec4 aggNodes[]; };
+uniform int   u_aggDim;      // level-0 cells per axis, a power of two
+uniform int   u_aggLevels;
+uniform int   u_aggTopLevel; // walk starts here: the first level whose cells are at least the reach wide
+uniform float u_aggOrigin;
+uniform float u_aggCellSize; // level 0
+uniform float u_aggTheta;    // opening angle: cells smaller than theta * distance are aggregated
+#endif
+
+#if BOID_LOD
+// Simulation LOD (see BoidGpuLod): one thread per entity listed from lodData[8] on; a boid's
+// vel.w holds (step of its last update << 2) | update tier
+layout(std430, binding = 4) readonly buffer LodData { uint lodData[]; };
+uniform vec3  u_cameraPos;
+uniform float u_lodNearDistance;   // full rate within, one tier down per doubling
+uniform float u_lodPredatorRadius;
+uniform float u_lodCalmSpeed;      // calm: deviation from the neighbors' mean velocity below this, one tier down per halving
+uniform int   u_lodMaxTier;
+#define BOID_LOD_FRAME_MASK 0x1FFFFFu
+#endif
+
+#if BOID_ENSEMBLE
+// Many independent swarms in one buffer: workgroup row y steps swarm y, whose entities start
+// at swarms[y].base. Matches BoidSwarmParams on the CPU side.
+struct SwarmParams {
+    int   numBoids, numPredators, base, pad0;
+    float sepWeight, aliWeight, cohWeight, bndWeight;
+    float fleWeight, obsWeight, noiseStrength, eatRadius;
+    float sepRadius, neiRadius, feaRadius, bndRadius;
+    float maxSpeed, predSpeed, pad1, pad2;
+};
+layout(std430, binding = 3) readonly buffer SwarmParamBlock { SwarmParams swarms[]; };
+
+// Per-invocation copies under the uniform names so the kernel body is shared
+int   u_numBoids;
+int   u_numPredators;
+float u_sepWeight;
+float u_aliWeight;
+float u_cohWeight;
+float u_bndWeight;
+float u_fleWeight;
+float u_obsWeight;
+float u_sepRadius;
+float u_neiRadius;
+float u_feaRadius;
+float u_bndRadius;
+float u_maxSpeed;
+float u_predSpeed;
+float u_noiseStrength;
+float u_eatRadius;
+uint  swarmBase;
+
+void loadSwarmParams() {
+    SwarmParams s = swarms[gl_WorkGroupID.y];
+    u_numBoids = s.numBoids;     u_numPredators = s.numPredators; swarmBase = uint(s.base);
+    u_sepWeight = s.sepWeight;   u_aliWeight = s.aliWeight;       u_cohWeight = s.cohWeight;
+    u_bndWeight = s.bndWeight;   u_fleWeight = s.fleWeight;       u_obsWeight = s.obsWeight;
+    u_noiseStrength = s.noiseStrength;                            u_eatRadius = s.eatRadius;
+    u_sepRadius = s.sepRadius;   u_neiRadius = s.neiRadius;       u_feaRadius = s.feaRadius;
+    u_bndRadius = s.bndRadius;   u_maxSpeed = s.maxSpeed;         u_predSpeed = s.predSpeed;
+}
+#else
 uniform int   u_numBoids;
 uniform int   u_numPredators;
 uniform float u_sepWeight;
@@ -65,12 +195,41 @@ uniform float u_feaRadius;
 uniform float u_bndRadius;
 uniform float u_maxSpeed;
 uniform float u_predSpeed;
-uniform float u_dt;
 uniform float u_noiseStrength;
-uniform int   u_frame;
 uniform float u_eatRadius;
+const uint swarmBase = 0u;
+#endif
+uniform float u_dt;
+uniform int   u_frame;
+#if BOID_HAS_OBSTACLES
 uniform int   u_numObstacles;
-uniform vec4  u_obstacles[5]; // xyz=position, w=avoidance radius
+uniform vec4  u_obstacles[BOID_MAX_OBSTACLES]; // xyz=position, w=avoidance radius
+#endif
+
+#if BOID_EVENTS
+// Append log of discrete events (see BoidGpuEventLog, BoidEventType). eventCount counts every
+// event since the batch began; records past eventCapacity are dropped but still counted.
+struct BoidEventData {
+    uint type, frame, entity;
+    int  other;
+    vec4 pos; // xyz = position, w = per type value
+};
+layout(std430, binding = 8) buffer EventLog {
+    uint eventCount;
+    uint eventCapacity;
+    uint eventPad0, eventPad1;
+    BoidEventData events[];
+};
+#define BOID_EVENT_EAT      0u
+#define BOID_EVENT_RESPAWN  1u
+#define BOID_EVENT_RETARGET 2u
+
+void recordEvent(uint type, uint entity, int other, vec4 pos) {
+    uint slot = atomicAdd(eventCount, 1u);
+    if (slot < eventCapacity)
+        events[slot] = BoidEventData(type, uint(u_frame), entity, other, pos);
+}
+#endif
 
 // Hash-based pseudo-random noise (returns vec3 in roughly -1..1)
 vec3 hash3( uint seed ) {
@@ -88,13 +247,144 @@ vec3 hash3( uint seed ) {
     return vec3(x, y, z);
 }
 
+// Running sums of the flocking rules over one boid's neighbors
+struct FlockSums {
+    vec3  separation;
+    vec3  alignSum;
+    vec3  cohesionSum;
+    float cohesionWSum;
+    int   sepCount;
+    float neiCount; // fractional for aggregates straddling the neighbor radius
+};
+
+void addNeighbor(inout FlockSums sums, vec3 myPos, vec3 fwd, vec3 other, vec3 otherVel) {
+    vec3 diff  = myPos - other;
+    float dist = length(diff);
+
+    // Separation
+    if (dist < u_sepRadius && dist > 0.001) {
+        float strength = (u_sepRadius - dist) / u_sepRadius;
+        sums.separation += normalize(diff) * strength;
+        sums.sepCount++;
+    }
+
+    // Alignment + Cohesion
+    if (dist < u_neiRadius) {
+        sums.alignSum += otherVel;
+
+        // Directional cohesion: neighbors ahead pull strongly,
+        // neighbors behind pull weakly — creates tadpole shape
+        vec3 toOther = -diff / dist;
+        float forwardness = dot(fwd, toOther); // -1 (behind) to +1 (ahead)
+        float w = 0.15 + 0.85 * clamp(forwardness * 0.5 + 0.5, 0.0, 1.0);
+        sums.cohesionSum += other * w;
+        sums.cohesionWSum += w;
+        sums.neiCount += 1.0;
+    }
+}
+
+#if BOID_AGGREGATES
+// Barnes-Hut style walk down the aggregate levels. A cell is opened when it could hold a
+// separation neighbor or looks larger than theta from here; level-0 cells are summed exactly,
+// the rest count as all of their boids sitting at the centroid with the mean velocity. Border
+// cells extend to infinity because out-of-grid boids are clamped into them.
+void addFarField(inout FlockSums sums, uint idx, vec3 myPos, vec3 fwd) {
+    uint levelBase[BOID_AGG_MAX_LEVELS];
+    uint base = 0u;
+    for (int l = 0; l < u_aggLevels; ++l) {
+        levelBase[l] = base;
+        uint d = uint(u_aggDim >> l);
+        base += d * d * d;
+    }
+    uint sortedBase = 2u * uint(u_aggDim * u_aggDim * u_aggDim) + 1u;
+
+    float reach = max(u_sepRadius, u_neiRadius);
+    float reachSq = reach * reach;
+    float sepSq = u_sepRadius * u_sepRadius;
+
+    // Cells of the top level are at least 'reach' wide: at most 3 per axis to start from
+    uint stack[BOID_AGG_STACK];
+    int sp = 0;
+    {
+        int dimT = u_aggDim >> u_aggTopLevel;
+        float sizeT = u_aggCellSize * float(1 << u_aggTopLevel);
+        ivec3 lo = clamp(ivec3(floor((myPos - reach - u_aggOrigin) / sizeT)), ivec3(0), ivec3(dimT - 1));
+        ivec3 hi = clamp(ivec3(floor((myPos + reach - u_aggOrigin) / sizeT)), ivec3(0), ivec3(dimT - 1));
+        for (int z = lo.z; z <= hi.z; ++z)
+        for (int y = lo.y; y <= hi.y; ++y)
+        for (int x = lo.x; x <= hi.x; ++x)
+            stack[sp++] = (uint(u_aggTopLevel) << 24) | (uint(z) << 16) | (uint(y) << 8) | uint(x);
+    }
+
+    while (sp > 0) {
+        uint e = stack[--sp];
+        int level = int(e >> 24);
+        ivec3 c = ivec3(e & 0xFFu, (e >> 8) & 0xFFu, (e >> 16) & 0xFFu);
+        int dimL = u_aggDim >> level;
+        uint cell = uint((c.z * dimL + c.y) * dimL + c.x);
+        vec4 posSum = aggNodes[2u * (levelBase[level] + cell)];
+        if (posSum.w == 0.0) continue;
+
+        float size = u_aggCellSize * float(1 << level);
+        vec3 lo = vec3(u_aggOrigin) + vec3(c) * size;
+        vec3 hi = mix(lo + size, vec3(1e30), equal(c, ivec3(dimL - 1)));
+        lo = mix(lo, vec3(-1e30), equal(c, ivec3(0)));
+        vec3 gap = max(max(lo - myPos, myPos - hi), vec3(0.0));
+        float gapSq = dot(gap, gap);
+        if (gapSq >= reachSq) continue;
+
+        if (level == 0) {
+            for (uint s = aggGrid[cell]; s < aggGrid[cell + 1u]; ++s) {
+                uint j = aggGrid[sortedBase + s];
+                if (j == idx) continue;
+                addNeighbor(sums, myPos, fwd, boidsIn[swarmBase + j].pos.xyz, boidsIn[swarmBase + j].vel.xyz);
+            }
+            continue;
+        }
+
+        vec3 cellCenter = posSum.xyz / posSum.w;
+        vec3 toCenter = cellCenter - myPos;
+        float dist = length(toCenter);
+        if ((gapSq >= sepSq && size < u_aggTheta * dist) || sp + 8 > BOID_AGG_STACK) {
+            // A cell straddling the neighbor radius counts with the share of its diagonal inside
+            float inside = clamp(0.5 + (u_neiRadius - dist) / (size * 1.7320508), 0.0, 1.0);
+            if (inside > 0.0 && dist > 0.001) {
+                sums.alignSum += aggNodes[2u * (levelBase[level] + cell) + 1u].xyz * inside;
+                float forwardness = dot(fwd, toCenter / dist);
+                float w = (0.15 + 0.85 * clamp(forwardness * 0.5 + 0.5, 0.0, 1.0)) * posSum.w * inside;
+                sums.cohesionSum += cellCenter * w;
+                sums.cohesionWSum += w;
+                sums.neiCount += posSum.w * inside;
+            }
+            continue;
+        }
+
+        uint child = (uint(level - 1) << 24) | (uint(2 * c.z) << 16) | (uint(2 * c.y) << 8) | uint(2 * c.x);
+        for (uint k = 0u; k < 8u; ++k)
+            stack[sp++] = child + ((k >> 2) << 16) + (((k >> 1) & 1u) << 8) + (k & 1u);
+    }
+}
+#endif
+
 void main() {
+#if BOID_ENSEMBLE
+    loadSwarmParams();
+#endif
+#if BOID_LOD
+    if (gl_GlobalInvocationID.x >= lodData[0]) return;
+    uint idx = lodData[8u + gl_GlobalInvocationID.x];
+#else
     uint idx = gl_GlobalInvocationID.x;
+#endif
+#if BOID_HAS_PREDATORS
     uint totalEntities = uint(u_numBoids) + uint(u_numPredators);
+#else
+    uint totalEntities = uint(u_numBoids);
+#endif
     if (idx >= totalEntities) return;
 
-    vec3 myPos = boidsIn[idx].pos.xyz;
-    vec3 myVel = boidsIn[idx].vel.xyz;
+    vec3 myPos = boidsIn[swarmBase + idx].pos.xyz;
+    vec3 myVel = boidsIn[swarmBase + idx].vel.xyz;
     bool isPredator = (idx >= uint(u_numBoids));
 
     vec3 acc = vec3(0.0);
@@ -102,53 +392,36 @@ void main() {
 
     if (!isPredator) {
         // ---- Boid flocking rules ----
-        vec3 separation = vec3(0.0);
-        vec3 alignSum   = vec3(0.0);
-        vec3 cohesionSum = vec3(0.0);
-        float cohesionWSum = 0.0;
-        int sepCount = 0;
-        int neiCount = 0;
+        FlockSums sums = FlockSums(vec3(0.0), vec3(0.0), vec3(0.0), 0.0, 0, 0.0);
 
         // Forward direction for directional cohesion
         float mySpeed = length(myVel);
         vec3 fwd = (mySpeed > 0.001) ? (myVel / mySpeed) : vec3(1, 0, 0);
 
+#if BOID_AGGREGATES
+        addFarField(sums, idx, myPos, fwd);
+#else
+#if BOID_NEIGHBOR_LIST
+        uint listLen = neighborData[idx];
+        uint listBase = uint(u_numBoids) + idx * u_maxNeighbors;
+        for (uint k = 0u; k < listLen; ++k) {
+            uint j = neighborData[listBase + k];
+#else
         for (uint j = 0u; j < uint(u_numBoids); ++j) {
+#endif
             if (j == idx) continue;
-            vec3 other = boidsIn[j].pos.xyz;
-            vec3 diff  = myPos - other;
-            float dist = length(diff);
-
-            // Separation
-            if (dist < u_sepRadius && dist > 0.001) {
-                float strength = (u_sepRadius - dist) / u_sepRadius;
-                separation += normalize(diff) * strength;
-                sepCount++;
-            }
-
-            // Alignment + Cohesion
-            if (dist < u_neiRadius) {
-                alignSum += boidsIn[j].vel.xyz;
-
-                // Directional cohesion: neighbors ahead pull strongly,
-                // neighbors behind pull weakly — creates tadpole shape
-                vec3 toOther = -diff / dist;
-                float forwardness = dot(fwd, toOther); // -1 (behind) to +1 (ahead)
-                float w = 0.15 + 0.85 * clamp(forwardness * 0.5 + 0.5, 0.0, 1.0);
-                cohesionSum += other * w;
-                cohesionWSum += w;
-                neiCount++;
-            }
+            addNeighbor(sums, myPos, fwd, boidsIn[swarmBase + j].pos.xyz, boidsIn[swarmBase + j].vel.xyz);
         }
+#endif
 
-        if (sepCount > 0)
-            acc += separation * u_sepWeight;
+        if (sums.sepCount > 0)
+            acc += sums.separation * u_sepWeight;
 
-        if (neiCount > 0) {
-            vec3 avgVel = alignSum / float(neiCount);
+        if (sums.neiCount > 0.0) {
+            vec3 avgVel = sums.alignSum / sums.neiCount;
             acc += (avgVel - myVel) * u_aliWeight;
 
-            vec3 center = cohesionSum / cohesionWSum;
+            vec3 center = sums.cohesionSum / sums.cohesionWSum;
             acc += (center - myPos) * u_cohWeight;
         }
 
@@ -161,20 +434,26 @@ void main() {
             acc += (-myPos / distOrigin) * t * t * u_bndWeight; // quadratic falloff
         }
 
+#if BOID_HAS_PREDATORS
         // Predator avoidance (flee from ALL predators)
         float nearestPredDist = 1e20;
+        int nearestPred = -1;
         for (int p = 0; p < u_numPredators; ++p) {
-            vec3 predPos  = boidsIn[uint(u_numBoids) + uint(p)].pos.xyz;
+            vec3 predPos  = boidsIn[swarmBase + uint(u_numBoids) + uint(p)].pos.xyz;
             vec3 predDiff = myPos - predPos;
             float predDist = length(predDiff);
-            if (predDist < nearestPredDist)
+            if (predDist < nearestPredDist) {
                 nearestPredDist = predDist;
+                nearestPred = u_numBoids + p;
+            }
             if (predDist < u_feaRadius && predDist > 0.001) {
                 float strength = (u_feaRadius - predDist) / predDist;
                 acc += normalize(predDiff) * strength * u_fleWeight;
             }
         }
+#endif
 
+#if BOID_HAS_OBSTACLES
         // Obstacle avoidance
         for (int o = 0; o < u_numObstacles; ++o) {
             vec3  obsPos    = u_obstacles[o].xyz;
@@ -186,56 +465,98 @@ void main() {
                 acc += normalize(obsDiff) * strength * u_obsWeight;
             }
         }
+#endif
 
+#if BOID_HAS_NOISE
         // Random jitter — breaks up perfectly uniform formations
         vec3 noise = hash3( idx * 1777u + uint(u_frame) * 3571u ) * u_noiseStrength;
         acc += noise;
+#endif
+
+#if BOID_LOD
+        // Steer for every step since the last update (a stale state, e.g. right after LOD was
+        // switched on, counts as one), then pick the tier for the coming steps: near the camera,
+        // near a predator or out of step with the neighbors means full rate
+        uint lodState = uint(boidsIn[swarmBase + idx].vel.w);
+        uint elapsed = (uint(u_frame) - (lodState >> 2)) & BOID_LOD_FRAME_MASK;
+        float stepDt = u_dt * float(elapsed > 8u ? 1u : max(elapsed, 1u));
+
+        int tier = clamp(int(floor(log2(max(length(myPos - u_cameraPos) / u_lodNearDistance, 1e-6)))) + 1, 0, u_lodMaxTier);
+        if (sums.neiCount > 0.0) {
+            float deviation = length(sums.alignSum / sums.neiCount - myVel);
+            tier = min(tier, clamp(int(floor(log2(max(u_lodCalmSpeed / max(deviation, 1e-6), 1e-6)))) + 1, 0, 3));
+        }
+#if BOID_HAS_PREDATORS
+        if (nearestPredDist < u_lodPredatorRadius)
+            tier = 0;
+#endif
+        velW = float(((uint(u_frame) & BOID_LOD_FRAME_MASK) << 2) | uint(tier));
+#else
+        float stepDt = u_dt;
+#endif
 
         // Integrate
-        myVel += acc * u_dt;
+        myVel += acc * stepDt;
         float speed = length(myVel);
         if (speed > u_maxSpeed)
             myVel = normalize(myVel) * u_maxSpeed;
         else if (speed < u_maxSpeed * 0.1 && speed > 0.0001)
             myVel = normalize(myVel) * u_maxSpeed * 0.1; // minimum speed so boids keep swimming
 
+#if BOID_HAS_PREDATORS
         // Eaten by predator — respawn at random location
         if (nearestPredDist < u_eatRadius) {
+#if BOID_EVENTS
+            recordEvent(BOID_EVENT_EAT, idx, nearestPred, vec4(myPos, nearestPredDist));
+#endif
             vec3 rng = hash3( idx * 7919u + uint(u_frame) * 6271u + 12345u );
             myPos = normalize(rng) * u_bndRadius * 0.6;
             myVel = hash3( idx * 3571u + uint(u_frame) * 1777u + 54321u ) * u_maxSpeed * 0.5;
+#if BOID_EVENTS
+            recordEvent(BOID_EVENT_RESPAWN, idx, nearestPred, vec4(myPos, 0.0));
+#endif
         }
+#endif
 
     } else {
+#if BOID_HAS_PREDATORS
         // ---- Predator: lock onto boid near swarm center ----
         // Compute flock centroid
         vec3 flockCenter = vec3(0.0);
         for (uint j = 0u; j < uint(u_numBoids); ++j)
-            flockCenter += boidsIn[j].pos.xyz;
+            flockCenter += boidsIn[swarmBase + j].pos.xyz;
         flockCenter /= float(u_numBoids);
 
         // Read locked target from vel.w (persisted across frames)
-        int lockedTarget = int(boidsIn[idx].vel.w);
+        int lockedTarget = int(boidsIn[swarmBase + idx].vel.w);
 
         // Re-evaluate every 300 frames (~5s at 60fps), on invalid target,
         // or if current target drifted far from swarm (was eaten/respawned)
         bool retarget = (u_frame % 300 == 0)
                      || lockedTarget < 0
                      || lockedTarget >= u_numBoids
-                     || length(boidsIn[lockedTarget].pos.xyz - flockCenter) > u_bndRadius * 0.5;
+                     || length(boidsIn[swarmBase + uint(lockedTarget)].pos.xyz - flockCenter) > u_bndRadius * 0.5;
 
         if (retarget) {
+#if BOID_EVENTS
+            int previousTarget = (lockedTarget >= 0 && lockedTarget < u_numBoids) ? lockedTarget : -1;
+#endif
             float nearestDist = 1e20;
             for (uint j = 0u; j < uint(u_numBoids); ++j) {
-                float d = length(boidsIn[j].pos.xyz - flockCenter);
+                float d = length(boidsIn[swarmBase + j].pos.xyz - flockCenter);
                 if (d < nearestDist) {
                     nearestDist = d;
                     lockedTarget = int(j);
                 }
             }
+#if BOID_EVENTS
+            // Only an actual change of target: the periodic re-evaluation mostly keeps it
+            if (lockedTarget != previousTarget)
+                recordEvent(BOID_EVENT_RETARGET, idx, lockedTarget, vec4(myPos, float(previousTarget)));
+#endif
         }
 
-        vec3 targetPos = boidsIn[lockedTarget].pos.xyz;
+        vec3 targetPos = boidsIn[swarmBase + uint(lockedTarget)].pos.xyz;
         vec3 toTarget = targetPos - myPos;
         float dist = length(toTarget);
         if (dist > 0.01)
@@ -256,12 +577,21 @@ void main() {
             myVel = normalize(myVel) * u_predSpeed;
 
         velW = float(lockedTarget); // persist target index
+#endif
     }
 
     myPos += myVel;
 
-    boidsOut[idx].pos = vec4(myPos, boidsIn[idx].pos.w);
-    boidsOut[idx].vel = vec4(myVel, velW);
+#if BOID_NEIGHBOR_LIST
+    if (!isPredator) {
+        vec3 moved = myPos - neighborRefPos[idx].xyz;
+        if (dot(moved, moved) > u_halfSkinSq)
+            neighborCtrl[0] = 1u;
+    }
+#endif
+
+    boidsOut[swarmBase + idx].pos = vec4(myPos, boidsIn[swarmBase + idx].pos.w);
+    boidsOut[swarmBase + idx].vel = vec4(myVel, velW);
 }
 )";
 
@@ -279,11 +609,25 @@ layout(std430, binding = 0) readonly buffer BoidBuffer {
     BoidData boids[];
 };
 
+// State one simulation step older than boids[], for interpolating between steps
+layout(std430, binding = 4) readonly buffer PrevBoidBuffer {
+    BoidData prevBoids[];
+};
+
+// Stable sub-flock id per boid, written by the CPU cluster analysis
+layout(std430, binding = 2) readonly buffer ClusterBuffer {
+    uint clusterIds[];
+};
+
 uniform mat4  u_view;
 uniform mat4  u_proj;
 uniform float u_scale;
 uniform int   u_instanceOffset;
 uniform vec4  u_color;
+uniform int   u_colorByCluster;
+uniform float u_alpha;        // weight of boids[] against prevBoids[]; 1 = no interpolation
+uniform float u_snapDistance; // longer moves (respawns) are drawn at the new position
+uniform int   u_highlight;    // selected entity, drawn larger and in yellow; -1 for none
 
 out vec3 vNormal;
 out vec4 vColor;
@@ -303,18 +647,37 @@ mat3 rotationFromVelocity(vec3 vel) {
     return mat3(fwd, right, up);
 }
 
+// Distinct hue per cluster id (golden-ratio hue walk)
+vec3 clusterColor(uint id) {
+    float h = fract(float(id) * 0.61803399);
+    vec3 k = clamp(abs(fract(vec3(h) + vec3(0.0, 2.0 / 3.0, 1.0 / 3.0)) * 6.0 - 3.0) - 1.0, 0.0, 1.0);
+    return mix(vec3(1.0), k, 0.7) * 0.95;
+}
+
 void main() {
     int boidIdx = gl_InstanceID + u_instanceOffset;
     vec3 boidPos = boids[boidIdx].pos.xyz;
     vec3 boidVel = boids[boidIdx].vel.xyz;
+    if (u_alpha < 1.0) {
+        vec3 prevPos = prevBoids[boidIdx].pos.xyz;
+        if (distance(prevPos, boidPos) < u_snapDistance) {
+            boidPos = mix(prevPos, boidPos, u_alpha);
+            boidVel = mix(prevBoids[boidIdx].vel.xyz, boidVel, u_alpha);
+        }
+    }
 
     mat3 rot = rotationFromVelocity(boidVel);
-    vec3 worldPos = boidPos + rot * (aVertex * u_scale);
+    float scale = (boidIdx == u_highlight) ? max(u_scale, 1.0) * 2.0 : u_scale;
+    vec3 worldPos = boidPos + rot * (aVertex * scale);
 
     gl_Position = u_proj * u_view * vec4(worldPos, 1.0);
 
     vNormal = rot * normalize(aVertex);
     vColor  = u_color;
+    if (u_colorByCluster != 0)
+        vColor = vec4(clusterColor(clusterIds[boidIdx]), u_color.a);
+    if (boidIdx == u_highlight)
+        vColor = vec4(1.0, 0.85, 0.1, 1.0);
 }
 )";
 
@@ -339,58 +702,6 @@ void main() {
 // Helpers
 // ============================================================
 
-static GLuint compileShader( GLenum type, const char* source )
-{
-   GLuint shader = glCreateShader( type );
-   glShaderSource( shader, 1, &source, nullptr );
-   glCompileShader( shader );
-
-   GLint success;
-   glGetShaderiv( shader, GL_COMPILE_STATUS, &success );
-   if( !success )
-   {
-      char log[1024];
-      glGetShaderInfoLog( shader, 1024, nullptr, log );
-      std::cout << "Shader compile error:\n" << log << std::endl;
-   }
-   return shader;
-}
-
-static GLuint linkProgram( GLuint* shaders, int count )
-{
-   GLuint prog = glCreateProgram();
-   for( int i = 0; i < count; ++i )
-      glAttachShader( prog, shaders[i] );
-   glLinkProgram( prog );
-
-   GLint success;
-   glGetProgramiv( prog, GL_LINK_STATUS, &success );
-   if( !success )
-   {
-      char log[1024];
-      glGetProgramInfoLog( prog, 1024, nullptr, log );
-      std::cout << "Program link error:\n" << log << std::endl;
-   }
-
-   for( int i = 0; i < count; ++i )
-      glDeleteShader( shaders[i] );
-   return prog;
-}
-
-static float randFloat( float lo, float hi )
-{
-   return lo + static_cast<float>( std::rand() ) / ( static_cast<float>( RAND_MAX / ( hi - lo ) ) );
-}
-
-static Vector randVecInSphere( float radius )
-{
-   Vector v;
-   do {
-      v = Vector( randFloat( -1, 1 ), randFloat( -1, 1 ), randFloat( -1, 1 ) );
-   } while( v.x * v.x + v.y * v.y + v.z * v.z > 1.0f );
-   return Vector( v.x * radius, v.y * radius, v.z * radius );
-}
-
 // Generate torus mesh (ring shape) as vertex + index lists
 static void generateTorus( float majorR, float minorR, int majorSegs, int minorSegs,
                            std::vector<Vector>& verts, std::vector<unsigned int>& indices )
@@ -426,10 +737,130 @@ static void generateTorus( float majorR, float minorR, int majorSegs, int minorS
    }
 }
 
-// GPU-side boid data (matches GLSL struct layout)
-struct BoidGPU {
-   float px, py, pz, type; // pos.xyz, pos.w
-   float vx, vy, vz, pad;  // vel.xyz, vel.w
+// Uniforms of the flocking kernels, in the order of their locations in
+// BoidKernelVariants::getUniformLocations(); resolved once per variant instead of by name on every dispatch
+enum BoidStepUniform
+{
+   U_NUM_BOIDS, U_NUM_PREDATORS, U_SEP_WEIGHT, U_ALI_WEIGHT, U_COH_WEIGHT, U_BND_WEIGHT, U_FLE_WEIGHT, U_OBS_WEIGHT,
+   U_SEP_RADIUS, U_NEI_RADIUS, U_FEA_RADIUS, U_BND_RADIUS, U_MAX_SPEED, U_PRED_SPEED, U_NOISE_STRENGTH, U_EAT_RADIUS,
+   U_DT, U_FRAME, U_NUM_OBSTACLES, U_OBSTACLES, U_NUM_STEP_UNIFORMS = U_OBSTACLES + BoidStepGlobals::MAX_OBSTACLES
+};
+
+static std::vector< std::string > stepUniformNames()
+{
+   std::vector< std::string > names = { "u_numBoids", "u_numPredators", "u_sepWeight", "u_aliWeight", "u_cohWeight",
+                                        "u_bndWeight", "u_fleWeight", "u_obsWeight", "u_sepRadius", "u_neiRadius",
+                                        "u_feaRadius", "u_bndRadius", "u_maxSpeed", "u_predSpeed", "u_noiseStrength",
+                                        "u_eatRadius", "u_dt", "u_frame", "u_numObstacles" };
+   for( int i = 0; i < BoidStepGlobals::MAX_OBSTACLES; ++i )
+      names.push_back( "u_obstacles[" + std::to_string( i ) + "]" );
+   return names;
+}
+
+// Per-swarm uniforms of the single-swarm kernel (the ensemble kernel reads them from binding 3)
+static void setSwarmUniforms( const GLint* u, const BoidSwarmParams& p )
+{
+   if( !u )
+      return;
+   glUniform1i( u[U_NUM_BOIDS], p.numBoids );
+   glUniform1i( u[U_NUM_PREDATORS], p.numPredators );
+   glUniform1f( u[U_SEP_WEIGHT], p.sepWeight );
+   glUniform1f( u[U_ALI_WEIGHT], p.aliWeight );
+   glUniform1f( u[U_COH_WEIGHT], p.cohWeight );
+   glUniform1f( u[U_BND_WEIGHT], p.bndWeight );
+   glUniform1f( u[U_FLE_WEIGHT], p.fleWeight );
+   glUniform1f( u[U_OBS_WEIGHT], p.obsWeight );
+   glUniform1f( u[U_SEP_RADIUS], p.sepRadius );
+   glUniform1f( u[U_NEI_RADIUS], p.neiRadius );
+   glUniform1f( u[U_FEA_RADIUS], p.feaRadius );
+   glUniform1f( u[U_BND_RADIUS], p.bndRadius );
+   glUniform1f( u[U_MAX_SPEED], p.maxSpeed );
+   glUniform1f( u[U_PRED_SPEED], p.predSpeed );
+   glUniform1f( u[U_NOISE_STRENGTH], p.noiseStrength );
+   glUniform1f( u[U_EAT_RADIUS], p.eatRadius );
+}
+
+// Uniforms shared by every swarm of a step
+static void setStepUniforms( const GLint* u, const BoidStepGlobals& g )
+{
+   if( !u )
+      return;
+   glUniform1f( u[U_DT], g.dt );
+   glUniform1i( u[U_FRAME], g.frame );
+   glUniform1i( u[U_NUM_OBSTACLES], g.numObstacles );
+   for( int i = 0; i < BoidStepGlobals::MAX_OBSTACLES; ++i )
+      glUniform4fv( u[U_OBSTACLES + i], 1, g.obstacles[i] );
+}
+
+// Wall time per step of 'step' (called with the step number), waiting for each one. The first
+// call is a warm-up: dispatches may still finish driver-side compilation, CPU steps fault pages
+// in. Stops after 'maxSteps' or once 'budgetMs' is used up
+static float timeSteps( const std::function< void( int ) >& step, int maxSteps = 8, float budgetMs = 250.0f )
+{
+   using Clock = std::chrono::steady_clock;
+   step( 0 );
+   glFinish();
+   int n = 0;
+   auto t0 = Clock::now();
+   do
+   {
+      step( ++n );
+      glFinish();
+   } while( n < maxSteps && std::chrono::duration< float, std::milli >( Clock::now() - t0 ).count() < budgetMs );
+   return std::chrono::duration< float, std::milli >( Clock::now() - t0 ).count() / n;
+}
+
+// Mean, median, 95th percentile and worst of a series of frame times
+static void printFrameTimes( const char* label, std::vector< float > ms )
+{
+   if( ms.empty() )
+      return;
+   double sum = 0.0;
+   for( float v : ms )
+      sum += v;
+   std::sort( ms.begin(), ms.end() );
+   auto pct = [&]( float p ) { return ms[std::min( ms.size() - 1, static_cast< size_t >( p * ms.size() ) )]; };
+   std::cout << "   " << label << ": mean " << sum / ms.size() << " ms, p50 " << pct( 0.5f )
+             << " ms, p95 " << pct( 0.95f ) << " ms, max " << ms.back() << " ms" << std::endl;
+}
+
+// Two scratch SSBOs holding 'state', for benchmarks that must not touch the ring
+static void createScratchPair( GLuint scratch[2], const std::vector< BoidGPU >& state )
+{
+   glGenBuffers( 2, scratch );
+   for( int i = 0; i < 2; ++i )
+   {
+      glBindBuffer( GL_SHADER_STORAGE_BUFFER, scratch[i] );
+      glBufferData( GL_SHADER_STORAGE_BUFFER, state.size() * sizeof( BoidGPU ), state.data(), GL_DYNAMIC_DRAW );
+   }
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+}
+
+// Boid Controls settings a checkpoint carries besides the scenario (counts, weights, radii,
+// speeds and seed travel in the scenario text)
+static const std::pair< const char*, float AftrImGui_BoidSwarm::* > checkpointFloats[] = {
+   { "stepsPerSecond", &AftrImGui_BoidSwarm::stepsPerSecond },
+   { "neighborSkin", &AftrImGui_BoidSwarm::neighborSkin },
+   { "aggregateTheta", &AftrImGui_BoidSwarm::aggregateTheta },
+   { "lodNearDistance", &AftrImGui_BoidSwarm::lodNearDistance },
+   { "lodPredatorRadius", &AftrImGui_BoidSwarm::lodPredatorRadius },
+   { "lodCalmSpeed", &AftrImGui_BoidSwarm::lodCalmSpeed },
+};
+static const std::pair< const char*, int AftrImGui_BoidSwarm::* > checkpointInts[] = {
+   { "stateBuffers", &AftrImGui_BoidSwarm::stateBuffers },
+   { "maxNeighbors", &AftrImGui_BoidSwarm::maxNeighbors },
+   { "aggregateErrorSamples", &AftrImGui_BoidSwarm::aggregateErrorSamples },
+   { "aggregateErrorIntervalFrames", &AftrImGui_BoidSwarm::aggregateErrorIntervalFrames },
+   { "lodMaxTier", &AftrImGui_BoidSwarm::lodMaxTier },
+};
+static const std::pair< const char*, bool AftrImGui_BoidSwarm::* > checkpointBools[] = {
+   { "isPaused", &AftrImGui_BoidSwarm::isPaused },
+   { "showObstacles", &AftrImGui_BoidSwarm::showObstacles },
+   { "interpolate", &AftrImGui_BoidSwarm::interpolate },
+   { "useNeighborLists", &AftrImGui_BoidSwarm::useNeighborLists },
+   { "useHashedGrid", &AftrImGui_BoidSwarm::useHashedGrid },
+   { "useAggregates", &AftrImGui_BoidSwarm::useAggregates },
+   { "useLod", &AftrImGui_BoidSwarm::useLod },
 };
 
 // ============================================================
@@ -444,7 +875,8 @@ GLViewBoidSwarm* GLViewBoidSwarm::New( const std::vector< std::string >& args )
    return glv;
 }
 
-GLViewBoidSwarm::GLViewBoidSwarm( const std::vector< std::string >& args ) : GLView( args )
+GLViewBoidSwarm::GLViewBoidSwarm( const std::vector< std::string >& args ) : GLView( args ),
+   computeKernels( programCache, computeShaderSource, "boid compute" )
 {
 }
 
@@ -456,21 +888,87 @@ void GLViewBoidSwarm::onCreate()
       this->pe->setGravityScalar( Aftr::GRAVITY );
    }
    this->setActorChaseType( STANDARDEZNAV );
+   BoidProfiler::setThreadName( "Main" );
+
+   scenario_gui.scenarioDir = ManagerEnvironmentConfiguration::getVariableValue( "boidscenariodir" );
+   if( scenario_gui.scenarioDir.empty() )
+      scenario_gui.scenarioDir = BOID_SCENARIO_DIR;
 
-   // GL context is ready — initialize compute + render shaders
+   // GL context is ready — start both programs (cached binaries load immediately, otherwise the
+   // driver compiles while the buffers are set up), then wait for the links
    initComputeShader();
    initRenderShader();
    initBoidBuffers();
+   finishShaders();
+   probeBackends();
+
+   // Reproducible swarms: a scenario file (boidScenario) or the seed from aftr.conf when present
+   std::string seedStr = ManagerEnvironmentConfiguration::getVariableValue( "boidseed" );
+   std::string scenarioPath = ManagerEnvironmentConfiguration::getVariableValue( "boidscenario" );
+   BoidScenario loaded;
+   std::string error;
+   bool haveScenario = !scenarioPath.empty() && BoidScenario::load( scenarioPath, loaded, &error );
+   if( !scenarioPath.empty() && !haveScenario )
+      std::cout << "BoidSwarm scenario not loaded: " << error << std::endl;
+   if( haveScenario )
+      applyScenario( loaded ); // the scenario's own seed wins
+   else if( !seedStr.empty() )
+      boid_gui.seed = std::strtoull( seedStr.c_str(), nullptr, 10 );
+   else
+      boid_gui.seed = static_cast< uint64_t >( std::time( nullptr ) );
+   std::cout << "BoidSwarm seed " << boid_gui.seed << " (set boidSeed in aftr.conf to reproduce)" << std::endl;
    resetSimulation();
+   boid_gui.resetRequested = false;
+
+   // Backend: boidBackend from aftr.conf when usable, otherwise the fastest on this swarm
+   std::string backendStr = ManagerEnvironmentConfiguration::getVariableValue( "boidbackend" );
+   BoidBackendType forced;
+   if( BoidBackend::parse( backendStr, forced ) && backendReport.available[static_cast< int >( forced )] )
+      switchBackend( forced );
+   else
+   {
+      if( !backendStr.empty() && backendStr != "auto" )
+         std::cout << "BoidSwarm backend '" << backendStr << "' unavailable, choosing automatically" << std::endl;
+      benchmarkBackends();
+      switchBackend( BoidBackend::pickFastest( backendReport ) );
+   }
+   backendReport.switches = 0;
+   std::cout << "BoidSwarm backend: " << BoidBackend::getName( backendReport.active ) << std::endl;
+   backend_gui.useSimThread = ManagerEnvironmentConfiguration::getVariableValue( "boidsimthread" ) == "1";
+
+   // Tuned configuration for this machine and swarm size, measured once per key
+   autoTuneEnabled = ManagerEnvironmentConfiguration::getVariableValue( "boidautotune" ) != "0";
+   tuningCachePath = ManagerEnvironmentConfiguration::getVariableValue( "boidtuningcache" );
+   if( tuningCachePath.empty() )
+      tuningCachePath = "./boid_tuning.cache";
+   tuningCache.load( tuningCachePath );
+   autoTune( false );
+
+   // Checkpoints: where they go, how often, and whether a restart resumes from the last one
+   std::string checkpointPath = ManagerEnvironmentConfiguration::getVariableValue( "boidcheckpoint" );
+   if( !checkpointPath.empty() )
+      std::snprintf( checkpoint_gui.path, sizeof( checkpoint_gui.path ), "%s", checkpointPath.c_str() );
+   std::string intervalStr = ManagerEnvironmentConfiguration::getVariableValue( "boidcheckpointinterval" );
+   if( !intervalStr.empty() )
+      checkpoint_gui.autosaveSeconds = std::max( 0.0f, std::strtof( intervalStr.c_str(), nullptr ) );
+   lastCheckpointTime = std::chrono::steady_clock::now();
+   if( ManagerEnvironmentConfiguration::getVariableValue( "boidrestorecheckpoint" ) == "1" )
+   {
+      std::string error;
+      if( !restoreCheckpoint( checkpoint_gui.path, &error ) )
+         std::cout << "BoidSwarm checkpoint not restored: " << error << std::endl;
+   }
 
    std::cout << "BoidSwarm compute shader initialized with " << boid_gui.numBoids << " boids." << std::endl;
 }
 
 GLViewBoidSwarm::~GLViewBoidSwarm()
 {
-   if( computeProgram ) glDeleteProgram( computeProgram );
    if( renderProgram )  glDeleteProgram( renderProgram );
-   if( ssbo[0] ) glDeleteBuffers( 2, ssbo );
+   if( initProgram )    glDeleteProgram( initProgram );
+   if( clusterJob.valid() ) clusterJob.wait();
+   if( clusterLabelSSBO ) glDeleteBuffers( 1, &clusterLabelSSBO );
+   if( ensembleParamSSBO ) glDeleteBuffers( 1, &ensembleParamSSBO );
    if( boidVAO ) glDeleteVertexArrays( 1, &boidVAO );
    if( boidVBO ) glDeleteBuffers( 1, &boidVBO );
    if( boidEBO ) glDeleteBuffers( 1, &boidEBO );
@@ -482,37 +980,67 @@ GLViewBoidSwarm::~GLViewBoidSwarm()
 
 void GLViewBoidSwarm::initComputeShader()
 {
-   GLuint cs = compileShader( GL_COMPUTE_SHADER, computeShaderSource );
-   computeProgram = linkProgram( &cs, 1 );
+   computeKernels.setUniformNames( stepUniformNames() );
+   requestKernels();
+   initProgram = programCache.compileAsync( { { GL_COMPUTE_SHADER, BoidRng::getInitShaderSource() } }, "boid init" );
+   neighborList.compileAsync( programCache );
+   cellAggregates.compileAsync( programCache );
+   lod.compileAsync( programCache );
+   history.compileAsync( programCache );
+}
 
-   GLint linkOk = 0;
-   glGetProgramiv( computeProgram, GL_LINK_STATUS, &linkOk );
-   if( linkOk )
-      std::cout << "Compute shader linked OK (program " << computeProgram << ")" << std::endl;
-   else
-      std::cout << "*** COMPUTE SHADER LINK FAILED ***" << std::endl;
+void GLViewBoidSwarm::requestKernels()
+{
+   // The general kernel is always available; the specializations build in the background and
+   // are picked up by updateWorld() as they finish
+   computeKernels.request( BoidKernelKey{ BOID_KF_ALL, computeWorkgroupSize } );
+   for( uint32_t mask = 0; mask < BOID_KF_ALL; ++mask )
+      computeKernels.request( BoidKernelKey{ mask, computeWorkgroupSize } );
 }
 
 void GLViewBoidSwarm::initRenderShader()
 {
-   GLuint shaders[2];
-   shaders[0] = compileShader( GL_VERTEX_SHADER, boidVertexShaderSource );
-   shaders[1] = compileShader( GL_FRAGMENT_SHADER, boidFragmentShaderSource );
-   renderProgram = linkProgram( shaders, 2 );
+   renderProgram = programCache.compileAsync( { { GL_VERTEX_SHADER, boidVertexShaderSource },
+                                                { GL_FRAGMENT_SHADER, boidFragmentShaderSource } }, "boid render" );
+}
+
+void GLViewBoidSwarm::finishShaders()
+{
+   GLuint computeProgram = computeKernels.require( BoidKernelKey{ BOID_KF_ALL, computeWorkgroupSize } );
+   if( computeProgram )
+      std::cout << "Compute shader linked OK (program " << computeProgram << ")" << std::endl;
+   else
+      std::cout << "*** COMPUTE SHADER LINK FAILED ***" << std::endl;
 
-   GLint linkOk = 0;
-   glGetProgramiv( renderProgram, GL_LINK_STATUS, &linkOk );
-   if( linkOk )
+   initProgram = programCache.finish( initProgram );
+   if( !initProgram )
+      std::cout << "*** INIT SHADER LINK FAILED *** (seeding swarms on the CPU)" << std::endl;
+
+   neighborList.finish( programCache );
+   if( !neighborList.isReady() )
+      std::cout << "*** NEIGHBOR LIST SHADERS LINK FAILED *** (neighbor lists unavailable)" << std::endl;
+   cellAggregates.finish( programCache );
+   if( !cellAggregates.isReady() )
+      std::cout << "*** AGGREGATE SHADERS LINK FAILED *** (approximate far field unavailable)" << std::endl;
+   lod.finish( programCache );
+   if( !lod.isReady() )
+      std::cout << "*** LOD SHADERS LINK FAILED *** (simulation LOD unavailable)" << std::endl;
+   history.finish( programCache );
+   if( !history.isReady() )
+      std::cout << "*** HISTORY SHADERS LINK FAILED *** (trails and rewind unavailable)" << std::endl;
+
+   renderProgram = programCache.finish( renderProgram );
+   if( renderProgram )
       std::cout << "Render shader linked OK (program " << renderProgram << ")" << std::endl;
    else
       std::cout << "*** RENDER SHADER LINK FAILED ***" << std::endl;
+
+   std::cout << "Program cache: " << programCache.getNumHits() << " hit(s), "
+             << programCache.getNumMisses() << " miss(es)" << std::endl;
 }
 
 void GLViewBoidSwarm::initBoidBuffers()
 {
-   // Create double-buffered SSBOs (sized later in resetSimulation)
-   glGenBuffers( 2, ssbo );
-
    // Tetrahedron mesh: nose at +X, wider tail at -X
    float verts[] = {
        1.0f,  0.0f,  0.0f,   // v0: nose
@@ -545,188 +1073,1673 @@ void GLViewBoidSwarm::initBoidBuffers()
    glBindVertexArray( 0 );
 }
 
+void GLViewBoidSwarm::clearDerivedState()
+{
+   stopSimThread();
+
+   // Old snapshots/labels describe a different swarm
+   if( clusterJob.valid() )
+      clusterJob.get();
+   clusterReadback.cancel();
+   clusterAnalysis.reset();
+   clusterLabelCount = 0;
+
+   // Nothing left to interpolate from, and the neighbor lists describe the old swarm
+   neighborList.invalidate();
+   neighborList.resetStats();
+   cellAggregates.resetStats();
+   history.clear();
+   history_gui.isRewound = false;
+   history_gui.framesBack = 0;
+   historyRecordedSteps = 0;
+   eventLog.cancel();
+   eventStream.clear();
+   queryReadback.cancel();
+   spatialQueries.clear();
+   selection_gui.selected = -1;
+   stepsSinceReset = 0;
+   simAccumulator = 0.0f;
+   renderAlpha = nextRenderAlpha = 1.0f;
+   lastUpdateTime = std::chrono::steady_clock::now();
+   if( checkpointCapturing )
+   {
+      // Capture the new swarm instead
+      checkpointReadback[0].cancel();
+      checkpointReadback[1].cancel();
+      checkpointLanded[0] = checkpointLanded[1] = false;
+      checkpointCapturing = false;
+      checkpoint_gui.saveRequested = true;
+   }
+}
+
+void GLViewBoidSwarm::releaseEnsemble()
+{
+   ensembleParams.clear();
+   ensembleCpuState[0].clear();
+   ensembleCpuState[1].clear();
+   ensembleReadback.cancel();
+   ensembleMetrics.clear();
+}
+
 void GLViewBoidSwarm::resetSimulation()
 {
+   BOID_PROFILE_ZONE( "resetSimulation" );
+   clearDerivedState();
+   if( ensemble_gui.isEnabled )
+   {
+      cpuSwarm.clear();
+      resetEnsemble();
+      return;
+   }
+   releaseEnsemble();
+   const bool onGpu = backendReport.active == BoidBackendType::GpuCompute;
+
    int n = boid_gui.numBoids;
    int np = boid_gui.numPredators;
    int total = n + np;
+   uint64_t seed = boid_gui.seed;
+   const BoidSpawnParams& spawn = scenario.spawn;
+
+   GLsizeiptr bufSize = total * sizeof( BoidGPU );
 
-   std::vector<BoidGPU> data( total );
-   for( int i = 0; i < n; ++i )
+   if( initProgram && onGpu )
    {
-      Vector p = randVecInSphere( 15.0f );
-      Vector v = randVecInSphere( 0.2f );
-      // Ensure non-zero initial velocity so boids start moving
-      if( v.x * v.x + v.y * v.y + v.z * v.z < 0.01f )
-         v = Vector( 0.1f, 0.1f, 0.0f );
-      data[i] = { p.x, p.y, p.z, 0.0f, v.x, v.y, v.z, 0.0f };
+      // Seed two slots in one pass and copy to the rest so no step ever reads garbage; nothing
+      // touches the CPU
+      stateRing.allocate( boid_gui.stateBuffers, bufSize );
+
+      float scales[4];
+      BoidRng::getScales( spawn, scales );
+      glUseProgram( initProgram );
+      glUniform1i( glGetUniformLocation( initProgram, "u_numBoids" ), n );
+      glUniform1i( glGetUniformLocation( initProgram, "u_numPredators" ), np );
+      glUniform2ui( glGetUniformLocation( initProgram, "u_seed" ), static_cast< GLuint >( seed ), static_cast< GLuint >( seed >> 32 ) );
+      glUniform4f( glGetUniformLocation( initProgram, "u_scale" ), scales[0], scales[1], scales[2], scales[3] );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, stateRing.getBuffer( 0 ) );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, stateRing.getBuffer( 1 ) );
+      {
+         BoidGpuZone gpuZone( gpuTimer, "Seed Swarm" );
+         glDispatchCompute( ( total + 255 ) / 256, 1, 1 );
+      }
+      glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+      glUseProgram( 0 );
+      stateRing.fillFrom( 0 );
+      cpuSwarm.clear();
    }
-   // Predators (elements n .. n+np-1)
-   for( int i = 0; i < np; ++i )
+   else
    {
-      Vector pp = randVecInSphere( 20.0f );
-      Vector pv = randVecInSphere( 0.05f );
-      data[n + i] = { pp.x, pp.y, pp.z, 1.0f, pv.x, pv.y, pv.z, 0.0f };
+      // Same swarm, generated on the CPU straight into the CPU backend's buffers, which keep
+      // their capacity across resets
+      BoidGPU* data = cpuSwarm.prepare( static_cast< uint32_t >( total ) );
+      BoidRng::initSwarm( data, n, np, seed, spawn, BoidThreadPool::shared() );
+      stateRing.allocate( boid_gui.stateBuffers, bufSize, data );
+      if( onGpu )
+         cpuSwarm.clear();
    }
+}
 
+void GLViewBoidSwarm::resetEnsemble()
+{
+   BOID_PROFILE_ZONE( "resetEnsemble" );
+   currentEnsembleParams( ensembleParams );
+   ensembleReadback.cancel();
+   ensembleMetrics.clear();
+   framesSinceEnsembleMetrics = 0;
+
+   int total = BoidEnsemble::getTotalEntities( ensembleParams );
+   uint64_t seed = boid_gui.seed;
+   const BoidSpawnParams& spawn = scenario.spawn;
    GLsizeiptr bufSize = total * sizeof( BoidGPU );
+   // Common random numbers by default, so instances differ only in the swept parameter
+   auto instanceSeed = [&]( size_t i ) { return ensemble_gui.sameInitialSwarm ? seed : seed + i; };
 
-   // Initialize BOTH SSBOs with the same data so ping-pong never reads garbage
-   glBindBuffer( GL_SHADER_STORAGE_BUFFER, ssbo[0] );
-   glBufferData( GL_SHADER_STORAGE_BUFFER, bufSize, data.data(), GL_DYNAMIC_DRAW );
-
-   glBindBuffer( GL_SHADER_STORAGE_BUFFER, ssbo[1] );
-   glBufferData( GL_SHADER_STORAGE_BUFFER, bufSize, data.data(), GL_DYNAMIC_DRAW );
+   const bool onCpu = ensembleOnCpu();
+   if( onCpu || !initProgram )
+   {
+      std::vector<BoidGPU> data( total );
+      for( size_t i = 0; i < ensembleParams.size(); ++i )
+      {
+         const BoidSwarmParams& p = ensembleParams[i];
+         BoidRng::initSwarm( data.data() + p.base, p.numBoids, p.numPredators, instanceSeed( i ), spawn, BoidThreadPool::shared() );
+      }
+      stateRing.allocate( boid_gui.stateBuffers, bufSize, data.data() );
+      if( onCpu )
+      {
+         ensembleCpuState[0] = data;
+         ensembleCpuState[1] = std::move( data );
+         ensembleCpuRead = 0;
+      }
+   }
+   else
+   {
+      stateRing.allocate( boid_gui.stateBuffers, bufSize );
+
+      float scales[4];
+      BoidRng::getScales( spawn, scales );
+      glUseProgram( initProgram );
+      glUniform4f( glGetUniformLocation( initProgram, "u_scale" ), scales[0], scales[1], scales[2], scales[3] );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, stateRing.getBuffer( 0 ) );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, stateRing.getBuffer( 1 ) );
+      for( size_t i = 0; i < ensembleParams.size(); ++i )
+      {
+         const BoidSwarmParams& p = ensembleParams[i];
+         uint64_t s = instanceSeed( i );
+         glUniform1i( glGetUniformLocation( initProgram, "u_numBoids" ), p.numBoids );
+         glUniform1i( glGetUniformLocation( initProgram, "u_numPredators" ), p.numPredators );
+         glUniform1i( glGetUniformLocation( initProgram, "u_base" ), p.base );
+         glUniform2ui( glGetUniformLocation( initProgram, "u_seed" ), static_cast< GLuint >( s ), static_cast< GLuint >( s >> 32 ) );
+         glDispatchCompute( ( p.numBoids + p.numPredators + 255 ) / 256, 1, 1 );
+      }
+      glUniform1i( glGetUniformLocation( initProgram, "u_base" ), 0 );
+      glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+      glUseProgram( 0 );
+      stateRing.fillFrom( 0 );
+      ensembleCpuState[0].clear();
+      ensembleCpuState[1].clear();
+   }
 
+   if( !ensembleParamSSBO )
+      glGenBuffers( 1, &ensembleParamSSBO );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, ensembleParamSSBO );
+   glBufferData( GL_SHADER_STORAGE_BUFFER, ensembleParams.size() * sizeof( BoidSwarmParams ), ensembleParams.data(), GL_DYNAMIC_DRAW );
    glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
-   readIdx = 0;
+
+   std::cout << "BoidSwarm ensemble: " << ensembleParams.size() << " instances, " << total << " entities ("
+             << ( onCpu ? "CPU batch" : "GPU batch" ) << ")" << std::endl;
 }
 
 // ============================================================
-// Per-Frame Update
+// Backends
 // ============================================================
 
-void GLViewBoidSwarm::updateWorld()
+void GLViewBoidSwarm::probeBackends()
 {
-   GLView::updateWorld();
+   const GLubyte* renderer = glGetString( GL_RENDERER );
+   backendReport.renderer = renderer ? reinterpret_cast< const char* >( renderer ) : "unknown";
+   const GLubyte* version = glGetString( GL_VERSION );
+   backendReport.glVersion = version ? reinterpret_cast< const char* >( version ) : "unknown";
+   backendReport.softwareRenderer = BoidBackend::isSoftwareRenderer( backendReport.renderer );
+   backendReport.cpuThreads = BoidThreadPool::shared().getNumThreads();
+
+   GLint major = 0, minor = 0;
+   glGetIntegerv( GL_MAJOR_VERSION, &major );
+   glGetIntegerv( GL_MINOR_VERSION, &minor );
+   const int gpu = static_cast< int >( BoidBackendType::GpuCompute );
+   backendReport.available[gpu] = false;
+   if( major * 10 + minor < 43 )
+      backendReport.unavailableReason[gpu] = "needs GL 4.3 compute shaders";
+   else if( !computeKernels.require( BoidKernelKey{ BOID_KF_ALL, computeWorkgroupSize } ) )
+      backendReport.unavailableReason[gpu] = "compute kernel failed to link";
+   else
+      backendReport.available[gpu] = true;
 
-   if( boid_gui.resetRequested )
-   {
-      boid_gui.resetRequested = false;
-      resetSimulation();
-   }
+   // Until the benchmark has run; decides where the first swarm is seeded
+   backendReport.active = backendReport.available[gpu] ? BoidBackendType::GpuCompute : BoidBackendType::CpuThreaded;
+   std::cout << "BoidSwarm backends: renderer '" << backendReport.renderer << "'" << ( backendReport.softwareRenderer ? " (software)" : "" )
+             << ", " << backendReport.cpuThreads << " CPU thread(s), GPU compute "
+             << ( backendReport.available[gpu] ? "available" : backendReport.unavailableReason[gpu] ) << std::endl;
+}
 
-   if( boid_gui.isPaused )
+void GLViewBoidSwarm::benchmarkBackends()
+{
+   BOID_PROFILE_ZONE( "benchmarkBackends" );
+   if( !ensembleParams.empty() )
       return;
 
-   // Skip compute dispatch if shader failed to compile/link
-   GLint computeLinked = 0;
-   glGetProgramiv( computeProgram, GL_LINK_STATUS, &computeLinked );
-   if( !computeLinked )
+   // Every backend steps a copy of the current swarm, all pairs and with the general kernel.
+   // CPU steps include their upload, so the numbers compare whole steps as a frame sees them
+   const BoidSwarmParams params = currentSwarmParams();
+   const BoidStepGlobals globals = scenario.getStepGlobals( frameCounter, boid_gui.showObstacles ); // not consumed
+   const std::vector< BoidGPU > start = readSwarmState();
+   const uint32_t total = static_cast< uint32_t >( start.size() );
+   const GLsizeiptr bytes = total * sizeof( BoidGPU );
+   if( total == 0 )
       return;
+   backendReport.benchEntities = static_cast< int >( total );
 
-   int n = boid_gui.numBoids;
-   int writeIdx = 1 - readIdx;
-
-   glUseProgram( computeProgram );
+   GLuint scratch[2] = {};
+   createScratchPair( scratch, start );
 
-   // Set uniforms
-   int np = boid_gui.numPredators;
-   glUniform1i( glGetUniformLocation( computeProgram, "u_numBoids" ),  n );
-   glUniform1i( glGetUniformLocation( computeProgram, "u_numPredators" ), np );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_sepWeight" ), boid_gui.separationWeight );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_aliWeight" ), boid_gui.alignmentWeight );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_cohWeight" ), boid_gui.cohesionWeight );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_bndWeight" ), boid_gui.boundaryWeight );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_fleWeight" ), boid_gui.fleeWeight );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_obsWeight" ), boid_gui.obstacleWeight );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_sepRadius" ), boid_gui.separationRadius );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_neiRadius" ), boid_gui.neighborRadius );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_feaRadius" ), boid_gui.fearRadius );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_bndRadius" ), boid_gui.boundaryRadius );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_maxSpeed" ),  boid_gui.maxSpeed );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_predSpeed" ), boid_gui.predatorSpeed );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_dt" ),        0.05f );
-   glUniform1f( glGetUniformLocation( computeProgram, "u_noiseStrength" ), boid_gui.noiseStrength );
-
-   glUniform1f( glGetUniformLocation( computeProgram, "u_eatRadius" ), 1.5f );
-
-   static int frameCounter = 0;
-   glUniform1i( glGetUniformLocation( computeProgram, "u_frame" ), frameCounter++ );
-
-   // Obstacle uniforms (pass 0 when disabled)
-   int activeObstacles = boid_gui.showObstacles ? NUM_OBSTACLES : 0;
-   glUniform1i( glGetUniformLocation( computeProgram, "u_numObstacles" ), activeObstacles );
-   for( int i = 0; i < NUM_OBSTACLES; ++i )
-   {
-      std::string name = "u_obstacles[" + std::to_string( i ) + "]";
-      glUniform4f( glGetUniformLocation( computeProgram, name.c_str() ),
-                   obstaclePositions[i].x, obstaclePositions[i].y,
-                   obstaclePositions[i].z, obstacleAvoidRadius );
+   const int gpu = static_cast< int >( BoidBackendType::GpuCompute );
+   if( backendReport.available[gpu] )
+   {
+      GLuint program = computeKernels.require( BoidKernelKey{ BOID_KF_ALL, computeWorkgroupSize } );
+      glUseProgram( program );
+      const GLint* uniforms = computeKernels.getUniformLocations( program );
+      setSwarmUniforms( uniforms, params );
+      setStepUniforms( uniforms, globals );
+      backendReport.benchMsPerStep[gpu] = timeSteps( [&]( int i )
+      {
+         glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, scratch[i & 1] );
+         glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, scratch[1 - ( i & 1 )] );
+         glDispatchCompute( ( total + computeWorkgroupSize - 1 ) / computeWorkgroupSize, 1, 1 );
+         glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+      } );
+      glUseProgram( 0 );
    }
 
-   // Show/hide pillar WOs
-   for( int i = 0; i < NUM_OBSTACLES; ++i )
-      if( obstacleWOs[i] )
-         obstacleWOs[i]->isVisible = boid_gui.showObstacles;
-
-   // Bind SSBOs: read from readIdx, write to writeIdx
-   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, ssbo[readIdx] );
-   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, ssbo[writeIdx] );
-
-   // Dispatch one thread per entity
-   glDispatchCompute( ( n + np + 255 ) / 256, 1, 1 );
+   BoidStreamBuffer benchStream;
+   for( BoidBackendType type : { BoidBackendType::CpuThreaded, BoidBackendType::CpuScalar } )
+   {
+      BoidThreadPool& pool = type == BoidBackendType::CpuScalar ? scalarPool : BoidThreadPool::shared();
+      BoidCpuSwarm swarm;
+      swarm.load( start.data(), total );
+      backendReport.benchMsPerStep[static_cast< int >( type )] = timeSteps( [&]( int i )
+      {
+         swarm.step( params, globals, pool, false, boid_gui.neighborSkin );
+         benchStream.upload( scratch[i & 1], 0, bytes, swarm.getState() );
+      } );
+   }
+   glDeleteBuffers( 2, scratch );
 
-   // Barrier: ensure compute writes are visible to subsequent reads
-   glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+   std::cout << "BoidSwarm backend benchmark (" << total << " entities, ms/step):";
+   for( int i = 0; i < BoidBackendReport::NUM_BACKENDS; ++i )
+      if( backendReport.available[i] )
+         std::cout << " " << BoidBackend::getName( static_cast< BoidBackendType >( i ) ) << " " << backendReport.benchMsPerStep[i];
+   std::cout << std::endl;
+}
 
-   // Swap buffers
-   readIdx = writeIdx;
+void GLViewBoidSwarm::checkDrift( int steps )
+{
+   BOID_PROFILE_ZONE( "checkDrift" );
+   const int gpu = static_cast< int >( BoidBackendType::GpuCompute );
+   if( !ensembleParams.empty() || !backendReport.available[gpu] )
+      return;
 
-   glUseProgram( 0 );
+   // The kernel variant the swarm would step with now, from the seeded scenario, against the
+   // CPU kernel. The CPU side walks Verlet lists, which sums exactly what all pairs sums
+   BoidScenario s = currentScenario();
+   if( !boid_gui.showObstacles )
+      s.obstacles.clear();
+   BoidKernelKey key = currentKernelKey();
+   key.features &= ~BOID_KF_EVENTS; // scratch steps are not part of the run
+   GLuint program = computeKernels.require( key );
+   if( !program )
+      return;
+   const bool useLists = ( key.features & BOID_KF_NEIGHBOR_LIST ) != 0;
+   const bool useAggregates = ( key.features & BOID_KF_AGGREGATES ) != 0;
+   const bool useLod = ( key.features & BOID_KF_LOD ) != 0;
+   BoidLodSettings lodSettings;
+   lodSettings.nearDistance = boid_gui.lodNearDistance;
+   lodSettings.predatorRadius = boid_gui.lodPredatorRadius;
+   lodSettings.calmSpeed = boid_gui.lodCalmSpeed;
+   lodSettings.maxTier = boid_gui.lodMaxTier;
+
+   const uint32_t total = static_cast< uint32_t >( s.params.numBoids + s.params.numPredators );
+   GLuint scratch[2] = {};
+   createScratchPair( scratch, std::vector< BoidGPU >( total ) );
+   neighborList.invalidate();
+
+   // Blocking round trip per step: upload the state, run the variant's passes, read it back
+   BoidDriftStepper gpuStepper = [&]( const BoidGPU* in, BoidGPU* out, uint32_t count, const BoidSwarmParams& params,
+                                      const BoidStepGlobals& globals )
+   {
+      const GLsizeiptr bytes = count * sizeof( BoidGPU );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, scratch[0] );
+      glBufferSubData( GL_COPY_WRITE_BUFFER, 0, bytes, in );
+      glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+      if( useAggregates )
+         cellAggregates.build( scratch[0], params );
+      else if( useLists )
+         neighborList.prepare( scratch[0], params, boid_gui.neighborSkin, boid_gui.maxNeighbors );
+      if( useLod )
+         lod.classify( scratch[0], scratch[1], params, globals.frame, key.workgroupSize );
+      glUseProgram( program );
+      if( useAggregates )
+         cellAggregates.bindForStep( program, boid_gui.aggregateTheta );
+      else if( useLists )
+         neighborList.bindForStep( program );
+      if( useLod )
+         lod.bindForStep( program, this->cam->getPosition(), lodSettings );
+      const GLint* uniforms = computeKernels.getUniformLocations( program );
+      setSwarmUniforms( uniforms, params );
+      setStepUniforms( uniforms, globals );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, scratch[0] );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, scratch[1] );
+      if( useLod )
+         lod.dispatch();
+      else
+         glDispatchCompute( ( count + key.workgroupSize - 1 ) / key.workgroupSize, 1, 1 );
+      glUseProgram( 0 );
+      glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+      glBindBuffer( GL_COPY_READ_BUFFER, scratch[1] );
+      glGetBufferSubData( GL_COPY_READ_BUFFER, 0, bytes, out );
+      glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   };
+   const BoidDriftReport report = BoidDriftHarness::run( s, steps, BoidDriftHarness::cpuNeighborListStepper( BoidThreadPool::shared(), 1.0f ),
+                                                         gpuStepper, BoidThreadPool::shared() );
+   glDeleteBuffers( 2, scratch );
+   neighborList.invalidate();
+
+   // Approximate variants are only held to the collective metrics
+   BoidDriftTolerance tol;
+   if( useAggregates || useLod )
+   {
+      tol.trajectorySteps = 0;
+      tol.growthPerStep = FLT_MAX;
+   }
+   backendReport.driftVariant = std::string( "workgroup " ) + std::to_string( key.workgroupSize ) + ( useLists ? ", neighbor lists" : "" ) +
+                                ( useAggregates ? ", far field" : "" ) + ( useLod ? ", LOD" : "" );
+   backendReport.driftSummary = report.summary();
+   backendReport.driftFailure.clear();
+   report.check( tol, &backendReport.driftFailure );
+   std::cout << "BoidSwarm drift check (GPU " << backendReport.driftVariant << " vs CPU): " << backendReport.driftSummary
+             << ( backendReport.driftFailure.empty() ? ", within tolerance" : ", OUT OF TOLERANCE: " + backendReport.driftFailure ) << std::endl;
 }
 
-// ============================================================
-// Rendering (called from ImGui callback, like ChaosGame)
-// ============================================================
-
-void GLViewBoidSwarm::renderBoids()
+void GLViewBoidSwarm::switchBackend( BoidBackendType to )
 {
-   if( !renderProgram ) return;
+   const BoidBackendType from = backendReport.active;
+   if( to == from || !backendReport.available[static_cast< int >( to )] )
+      return;
+   stopSimThread();
+   backendReport.active = to;
+   ++backendReport.switches;
+   std::cout << "BoidSwarm backend " << BoidBackend::getName( from ) << " -> " << BoidBackend::getName( to ) << std::endl;
 
-   int n = boid_gui.numBoids;
+   // An ensemble stays where its CPU Batch switch put it; the single swarm follows on the next reset
+   if( !ensembleParams.empty() )
+      return;
+   if( to == BoidBackendType::GpuCompute )
+   {
+      // Every CPU step was streamed into the ring, so its newest slot is the state to continue from
+      cpuSwarm.clear();
+      neighborList.invalidate();
+   }
+   else if( from == BoidBackendType::GpuCompute )
+   {
+      std::vector< BoidGPU > state = readSwarmState();
+      cpuSwarm.load( state.data(), static_cast< uint32_t >( state.size() ) );
+   }
+}
 
-   Mat4 view = this->cam->getCameraViewMatrix();
-   Mat4 proj = this->cam->getCameraProjectionMatrix();
+std::vector< BoidGPU > GLViewBoidSwarm::readSwarmState()
+{
+   stopSimThread(); // restarted by the next frame
+   if( cpuSwarm.isLoaded() )
+      return std::vector< BoidGPU >( cpuSwarm.getState(), cpuSwarm.getState() + cpuSwarm.size() );
+
+   // Blocking; only for backend switches, benchmarks and tuning
+   std::vector< BoidGPU > state( stateRing.getSize() / sizeof( BoidGPU ) );
+   glMemoryBarrier( GL_BUFFER_UPDATE_BARRIER_BIT );
+   glBindBuffer( GL_COPY_READ_BUFFER, stateRing.getBuffer( stateRing.getStepInput() ) );
+   glGetBufferSubData( GL_COPY_READ_BUFFER, 0, stateRing.getSize(), state.data() );
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   return state;
+}
 
-   // Clear only depth buffer so boids aren't occluded by the aquarium sphere
-   // (the aquarium WO rendered in the main pass writes depth)
-   glClear( GL_DEPTH_BUFFER_BIT );
+BoidTuningKey GLViewBoidSwarm::currentTuningKey() const
+{
+   BoidTuningKey key;
+   key.device = backendReport.renderer + " | " + backendReport.glVersion + " | " + std::to_string( backendReport.cpuThreads ) + " threads";
+   key.backend = BoidBackend::getConfigName( backendReport.active );
+   key.sizeBucket = BoidTuningKey::getSizeBucket( boid_gui.numBoids + boid_gui.numPredators );
+   return key;
+}
 
-   glUseProgram( renderProgram );
+void GLViewBoidSwarm::autoTune( bool force )
+{
+   if( ( !autoTuneEnabled && !force ) || !ensembleParams.empty() )
+      return;
+   BoidTuningKey key = currentTuningKey();
+   if( !force && key == backendReport.tuningKey )
+      return;
+   backendReport.tuningKey = key;
 
-   glUniformMatrix4fv( glGetUniformLocation( renderProgram, "u_view" ), 1, GL_FALSE, view.getPtr() );
-   glUniformMatrix4fv( glGetUniformLocation( renderProgram, "u_proj" ), 1, GL_FALSE, proj.getPtr() );
+   BoidTuningConfig best;
+   if( !force && tuningCache.find( key, best ) )
+   {
+      backendReport.tuningFromCache = true;
+      applyTuning( best );
+      return;
+   }
 
-   // Bind the latest SSBO for the vertex shader to read positions/velocities
-   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, ssbo[readIdx] );
+   BOID_PROFILE_ZONE( "autoTune" );
+   std::vector< BoidTuningConfig > candidates = BoidTuningCache::getCandidates( backendReport.active );
+   if( backendReport.active == BoidBackendType::GpuCompute )
+   {
+      // Drop what the device cannot run, then let the driver compile the rest side by side
+      GLint maxSize = 0, maxInvocations = 0;
+      glGetIntegeri_v( GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxSize );
+      glGetIntegerv( GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations );
+      candidates.erase( std::remove_if( candidates.begin(), candidates.end(), [&]( const BoidTuningConfig& c )
+      {
+         return c.workgroupSize > std::min( maxSize, maxInvocations ) || ( c.neighborLists && !neighborList.isReady() );
+      } ), candidates.end() );
+      for( const BoidTuningConfig& c : candidates )
+         computeKernels.request( BoidKernelKey{ BOID_KF_ALL | ( c.neighborLists ? BOID_KF_NEIGHBOR_LIST : 0u ), c.workgroupSize } );
+   }
 
-   glEnable( GL_DEPTH_TEST );
-   glDepthMask( GL_TRUE );
-   glBindVertexArray( boidVAO );
+   const std::vector< BoidGPU > start = readSwarmState();
+   GLuint scratch[2] = {};
+   if( backendReport.active == BoidBackendType::GpuCompute )
+      createScratchPair( scratch, start );
+   for( BoidTuningConfig& c : candidates )
+   {
+      c.msPerStep = benchmarkTuning( c, start, scratch );
+      if( c.msPerStep >= 0.0f && ( best.msPerStep < 0.0f || c.msPerStep < best.msPerStep ) )
+         best = c;
+   }
+   if( scratch[0] )
+      glDeleteBuffers( 2, scratch );
+   neighborList.invalidate();
+   neighborList.resetStats();
+
+   backendReport.tuningFromCache = false;
+   backendReport.tuningCandidates = static_cast< int >( candidates.size() );
+   if( best.msPerStep < 0.0f )
+      return; // nothing ran; keep the defaults
+   tuningCache.store( key, best );
+   if( !tuningCache.save( tuningCachePath ) )
+      std::cout << "BoidSwarm tuning cache not written: " << tuningCachePath << std::endl;
+   applyTuning( best );
+}
 
-   // Draw boids: teal, small
-   glUniform4f( glGetUniformLocation( renderProgram, "u_color" ), 0.0f, 0.7f, 0.85f, 1.0f );
-   glUniform1f( glGetUniformLocation( renderProgram, "u_scale" ), 0.5f );
-   glUniform1i( glGetUniformLocation( renderProgram, "u_instanceOffset" ), 0 );
-   glDrawElementsInstanced( GL_TRIANGLES, 12, GL_UNSIGNED_INT, 0, n );
+float GLViewBoidSwarm::benchmarkTuning( const BoidTuningConfig& c, const std::vector< BoidGPU >& start, const GLuint scratch[2] )
+{
+   // All candidates step the same copy of the swarm from the same globals; a list candidate's
+   // warm-up step builds its lists, later rebuilds happen at the swarm's own rate
+   const BoidSwarmParams params = currentSwarmParams();
+   const BoidStepGlobals globals = scenario.getStepGlobals( frameCounter, boid_gui.showObstacles );
+   const uint32_t total = static_cast< uint32_t >( start.size() );
 
-   // Draw predators: red, large
-   int np = boid_gui.numPredators;
-   if( np > 0 )
+   if( backendReport.active != BoidBackendType::GpuCompute )
    {
-      glUniform4f( glGetUniformLocation( renderProgram, "u_color" ), 0.85f, 0.15f, 0.15f, 1.0f );
-      glUniform1f( glGetUniformLocation( renderProgram, "u_scale" ), 1.5f );
-      glUniform1i( glGetUniformLocation( renderProgram, "u_instanceOffset" ), n );
-      glDrawElementsInstanced( GL_TRIANGLES, 12, GL_UNSIGNED_INT, 0, np );
+      BoidThreadPool& pool = backendReport.active == BoidBackendType::CpuScalar ? scalarPool : BoidThreadPool::shared();
+      BoidCpuSwarm swarm;
+      swarm.load( start.data(), total );
+      swarm.setTuning( c.cpuGrain, c.cellScale );
+      return timeSteps( [&]( int ) { swarm.step( params, globals, pool, c.neighborLists, boid_gui.neighborSkin ); } );
    }
 
-   glBindVertexArray( 0 );
+   const BoidKernelKey key{ BOID_KF_ALL | ( c.neighborLists ? BOID_KF_NEIGHBOR_LIST : 0u ), c.workgroupSize };
+   GLuint program = computeKernels.require( key );
+   if( !program )
+      return -1.0f;
+   for( int i = 0; i < 2; ++i )
+   {
+      glBindBuffer( GL_COPY_WRITE_BUFFER, scratch[i] );
+      glBufferSubData( GL_COPY_WRITE_BUFFER, 0, total * sizeof( BoidGPU ), start.data() );
+   }
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   neighborList.setCellScale( c.cellScale );
+   neighborList.invalidate();
+
+   glUseProgram( program );
+   const GLint* uniforms = computeKernels.getUniformLocations( program );
+   setSwarmUniforms( uniforms, params );
+   setStepUniforms( uniforms, globals );
+   float ms = timeSteps( [&]( int i )
+   {
+      GLuint input = scratch[i & 1], output = scratch[1 - ( i & 1 )];
+      if( c.neighborLists )
+      {
+         neighborList.prepare( input, params, boid_gui.neighborSkin, boid_gui.maxNeighbors );
+         glUseProgram( program );
+         neighborList.bindForStep( program );
+      }
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, input );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, output );
+      glDispatchCompute( ( total + c.workgroupSize - 1 ) / c.workgroupSize, 1, 1 );
+      glMemoryBarrier( GL_SHADER_STORAGE_BARRIER_BIT );
+   } );
    glUseProgram( 0 );
+   return ms;
 }
 
-// ============================================================
-// Event Handlers
-// ============================================================
-
-void GLViewBoidSwarm::onResizeWindow( GLsizei width, GLsizei height )
+void GLViewBoidSwarm::applyTuning( const BoidTuningConfig& c )
 {
-   GLView::onResizeWindow( width, height );
+   backendReport.tuning = c;
+   boid_gui.useNeighborLists = c.neighborLists;
+   if( backendReport.active == BoidBackendType::GpuCompute )
+   {
+      neighborList.setCellScale( c.cellScale );
+      neighborList.invalidate();
+      if( c.workgroupSize != computeWorkgroupSize )
+      {
+         // The general kernel of the new size is the fallback of every other, so it is built now
+         computeWorkgroupSize = c.workgroupSize;
+         requestKernels();
+         computeKernels.require( BoidKernelKey{ BOID_KF_ALL, computeWorkgroupSize } );
+      }
+   }
+   else
+   {
+      stopSimThread(); // restarted with the new tuning by the next frame
+      cpuSwarm.setTuning( c.cpuGrain, c.cellScale );
+   }
+
+   std::cout << "BoidSwarm tuning (" << backendReport.tuningKey.backend << ", 2^" << backendReport.tuningKey.sizeBucket << " entities"
+             << ( backendReport.tuningFromCache ? ", cached" : "" ) << "): workgroup " << c.workgroupSize << ", "
+             << ( c.neighborLists ? "neighbor lists" : "all pairs" ) << ", cell scale " << c.cellScale << ", CPU chunk " << c.cpuGrain
+             << ", " << c.msPerStep << " ms/step" << std::endl;
 }
 
-void GLViewBoidSwarm::onMouseDown( const SDL_MouseButtonEvent& e )
+bool GLViewBoidSwarm::ensembleOnCpu() const
+{
+   return ensemble_gui.useCpuBatch || !backendReport.available[static_cast< int >( BoidBackendType::GpuCompute )];
+}
+
+// ============================================================
+// Per-Frame Update
+// ============================================================
+
+void GLViewBoidSwarm::updateWorld()
+{
+   // Frame boundary of the trace, so outside the updateWorld zone
+   updateProfiler();
+   BOID_PROFILE_ZONE( "updateWorld" );
+
+   GLView::updateWorld();
+   updateScenario();
+   // Grid of the neighbor list builds; a change rebuilds the lists on their next use
+   neighborList.setHashedGrid( boid_gui.useHashedGrid );
+   cpuSwarm.setHashedGrid( boid_gui.useHashedGrid );
+   // The CPU lists reserve the GPU's list length per boid at their first build (and again when
+   // the swarm is resized), so a condensing flock does not grow them step after step
+   cpuSwarm.setNeighborCapacity( static_cast< uint32_t >( boid_gui.maxNeighbors ) );
+
+   if( boid_gui.resetRequested || ensemble_gui.resetRequested )
+   {
+      boid_gui.resetRequested = false;
+      ensemble_gui.resetRequested = false;
+      resetSimulation();
+      autoTune( false ); // the size bucket may have changed
+   }
+   if( backend_gui.switchRequested >= 0 )
+   {
+      switchBackend( static_cast< BoidBackendType >( backend_gui.switchRequested ) );
+      backend_gui.switchRequested = -1;
+      autoTune( false );
+   }
+   if( backend_gui.benchmarkRequested )
+   {
+      benchmarkBackends();
+      backend_gui.benchmarkRequested = false;
+   }
+   if( backend_gui.retuneRequested )
+   {
+      autoTune( true );
+      backend_gui.retuneRequested = false;
+   }
+   if( backend_gui.driftRequested )
+   {
+      checkDrift( backend_gui.driftSteps );
+      backend_gui.driftRequested = false;
+   }
+
+   // Steps issued last frame become visible and are what this frame draws; the steps issued
+   // below run while that draw is queued
+   stateRing.publish();
+   renderAlpha = nextRenderAlpha;
+
+   updateCheckpoint();
+   updateHistory();
+   updateEvents();
+   updateClusterAnalysis();
+   updateSpatialQueries();
+
+   // Show/hide pillar WOs
+   for( int i = 0; i < BoidStepGlobals::MAX_OBSTACLES; ++i )
+      if( obstacleWOs[i] )
+         obstacleWOs[i]->isVisible = boid_gui.showObstacles && i < static_cast< int >( scenario.obstacles.size() );
+
+   // Pausing goes through the thread's parameters, so this comes before the pause below
+   if( updateSimThread() )
+      return;
+
+   if( boid_gui.isPaused )
+   {
+      simAccumulator = 0.0f;
+      nextRenderAlpha = 1.0f;
+      stateRing.getStats().stepsLastFrame = 0;
+      lastUpdateTime = std::chrono::steady_clock::now();
+      return;
+   }
+
+   int steps = scheduleSteps();
+   if( scenario_gui.stopAtEnd )
+   {
+      steps = std::min( steps, std::max( 0, scenario.steps - stepsSinceReset ) );
+      if( stepsSinceReset + steps >= scenario.steps )
+         boid_gui.isPaused = true;
+   }
+   stateRing.getStats().stepsLastFrame = steps;
+   if( !ensembleParams.empty() )
+      updateEnsemble( steps );
+   else if( backendReport.active != BoidBackendType::GpuCompute )
+      stepSwarmCpu( steps );
+   else if( !stepSwarm( steps ) )
+   {
+      // Keep simulating rather than freeze on the last state
+      const int gpu = static_cast< int >( BoidBackendType::GpuCompute );
+      backendReport.available[gpu] = false;
+      backendReport.unavailableReason[gpu] = "no compute kernel";
+      std::cout << "*** NO COMPUTE KERNEL *** (falling back to the CPU backend)" << std::endl;
+      switchBackend( BoidBackendType::CpuThreaded );
+      stepSwarmCpu( steps );
+   }
+   else
+   {
+      if( neighborListsUsed )
+         neighborList.updateStats();
+      cellAggregates.updateStats();
+      if( boid_gui.useLod )
+         lod.updateStats();
+   }
+}
+
+int GLViewBoidSwarm::scheduleSteps()
+{
+   auto now = std::chrono::steady_clock::now();
+   float elapsed = std::chrono::duration< float >( now - lastUpdateTime ).count();
+   lastUpdateTime = now;
+
+   // Frame-locked: one step per rendered frame, drawn as is
+   if( boid_gui.stepsPerSecond <= 0.0f )
+   {
+      nextRenderAlpha = 1.0f;
+      return 1;
+   }
+
+   // Fixed rate: whole steps now, the remainder places next frame's draw between the two newest
+   // states. A frame that would outrun the ring drops time instead of spiralling
+   simAccumulator += elapsed * boid_gui.stepsPerSecond;
+   int steps = static_cast< int >( simAccumulator );
+   int maxSteps = stateRing.getMaxStepsAhead();
+   if( steps > maxSteps )
+   {
+      steps = maxSteps;
+      simAccumulator = static_cast< float >( maxSteps );
+   }
+   simAccumulator -= static_cast< float >( steps );
+   nextRenderAlpha = boid_gui.interpolate ? simAccumulator : 1.0f;
+   return steps;
+}
+
+bool GLViewBoidSwarm::stepSwarm( int steps )
+{
+   // Use the kernel specialized for the current settings once it has compiled, the general
+   // one until then. Skip compute dispatch if shader failed to compile/link
+   computeKernels.pump();
+   BoidKernelKey key = currentKernelKey();
+   GLuint computeProgram = computeKernels.find( key );
+   if( !computeProgram )
+   {
+      // The list, aggregate, LOD and event layouts have no general fallback of their own, so that one is built right away
+      const uint32_t layout = key.features & ( BOID_KF_NEIGHBOR_LIST | BOID_KF_AGGREGATES | BOID_KF_LOD | BOID_KF_EVENTS );
+      computeKernels.request( key );
+      key.features = BOID_KF_ALL | layout;
+      computeProgram = layout ? computeKernels.require( key ) : computeKernels.find( key );
+      if( !computeProgram && layout )
+      {
+         // A layout kernel that failed to build leaves the swarm on the plain one
+         key.features = BOID_KF_ALL;
+         computeProgram = computeKernels.find( key );
+      }
+   }
+   const bool useLists = ( key.features & BOID_KF_NEIGHBOR_LIST ) != 0;
+   const bool useAggregates = ( key.features & BOID_KF_AGGREGATES ) != 0;
+   const bool useLod = ( key.features & BOID_KF_LOD ) != 0;
+   const bool useEvents = ( key.features & BOID_KF_EVENTS ) != 0;
+
+   // Once in a while the first boids of the last step are stepped again exactly to measure the
+   // approximation (not under LOD, where most boids only coast on a given step)
+   GLuint exactProgram = 0;
+   if( useAggregates && !useLod && ++framesSinceAggregateProbe >= boid_gui.aggregateErrorIntervalFrames )
+   {
+      BoidKernelKey exactKey = key;
+      exactKey.features &= ~( BOID_KF_AGGREGATES | BOID_KF_EVENTS ); // the probe must not log events twice
+      exactProgram = computeKernels.find( exactKey );
+      if( !exactProgram )
+         computeKernels.request( exactKey );
+   }
+   if( useLists != neighborListsUsed )
+      neighborList.invalidate(); // steps without the lists never checked the skin
+   if( !computeProgram )
+      return false;
+   if( steps <= 0 )
+      return true;
+   neighborListsUsed = useLists;
+
+   BOID_PROFILE_ZONE( "stepSwarm" );
+   BoidGpuZone gpuZone( gpuTimer, "Step Swarm" );
+   BoidSwarmParams params = currentSwarmParams();
+   glUseProgram( computeProgram );
+   const GLint* uniforms = computeKernels.getUniformLocations( computeProgram );
+   setSwarmUniforms( uniforms, params );
+
+   BoidLodSettings lodSettings;
+   lodSettings.nearDistance = boid_gui.lodNearDistance;
+   lodSettings.predatorRadius = boid_gui.lodPredatorRadius;
+   lodSettings.calmSpeed = boid_gui.lodCalmSpeed;
+   lodSettings.maxTier = boid_gui.lodMaxTier;
+
+   for( int i = 0; i < steps; ++i )
+   {
+      // Read the newest state, write the next ring slot; visibility is handled by the ring
+      GLuint input = stateRing.getBuffer( stateRing.getStepInput() );
+      GLuint output = stateRing.getBuffer( stateRing.beginStep() );
+      BoidStepGlobals globals = nextStepGlobals();
+      if( useAggregates )
+      {
+         cellAggregates.build( input, params );
+         glUseProgram( computeProgram );
+         cellAggregates.bindForStep( computeProgram, boid_gui.aggregateTheta );
+      }
+      else if( useLists )
+      {
+         // Rebuild (if a boid left its skin) runs its own passes, so the kernel is rebound after
+         neighborList.prepare( input, params, boid_gui.neighborSkin, boid_gui.maxNeighbors );
+         glUseProgram( computeProgram );
+         neighborList.bindForStep( computeProgram );
+      }
+      if( useLod )
+      {
+         // Boids that are not due coast straight into the output
+         lod.classify( input, output, params, globals.frame, key.workgroupSize );
+         glUseProgram( computeProgram );
+         lod.bindForStep( computeProgram, this->cam->getPosition(), lodSettings );
+      }
+      setStepUniforms( uniforms, globals );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, input );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, output );
+      if( useEvents )
+         eventLog.bindForStep();
+
+      // Dispatch one thread per entity, or per entity due this step
+      if( useLod )
+         lod.dispatch();
+      else
+         glDispatchCompute( ( params.numBoids + params.numPredators + key.workgroupSize - 1 ) / key.workgroupSize, 1, 1 );
+
+      if( exactProgram && i == steps - 1 )
+      {
+         glUseProgram( exactProgram );
+         const GLint* exactUniforms = computeKernels.getUniformLocations( exactProgram );
+         setSwarmUniforms( exactUniforms, params );
+         setStepUniforms( exactUniforms, globals );
+         cellAggregates.probeError( input, output, boid_gui.aggregateErrorSamples, key.workgroupSize );
+         glUseProgram( computeProgram );
+         framesSinceAggregateProbe = 0;
+      }
+      stateRing.endStep();
+   }
+
+   glUseProgram( 0 );
+   return true;
+}
+
+void GLViewBoidSwarm::stepSwarmCpu( int steps )
+{
+   if( steps <= 0 || !cpuSwarm.isLoaded() )
+      return;
+   BOID_PROFILE_ZONE( "stepSwarmCpu" );
+   auto t0 = std::chrono::steady_clock::now();
+   BoidSwarmParams params = currentSwarmParams();
+   BoidThreadPool& pool = backendReport.active == BoidBackendType::CpuScalar ? scalarPool : BoidThreadPool::shared();
+   const GLsizeiptr bytes = cpuSwarm.size() * sizeof( BoidGPU );
+
+   for( int i = 0; i < steps; ++i )
+   {
+      cpuSwarm.step( params, nextStepGlobals(), pool, boid_gui.useNeighborLists, boid_gui.neighborSkin );
+
+      // Only the newest two states of a frame become the drawable pair; earlier ones still take
+      // their ring slot but skip the upload
+      int slot = stateRing.beginStep();
+      if( i >= steps - 2 && streamBuffer.upload( stateRing.getBuffer( slot ), 0, bytes, cpuSwarm.getState() ) )
+         ++stateRing.getStats().uploadWaits;
+      stateRing.endStep();
+   }
+
+   float ms = std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - t0 ).count() / steps;
+   backendReport.cpuStepMs = backendReport.cpuStepMs > 0.0f ? 0.9f * backendReport.cpuStepMs + 0.1f * ms : ms;
+   backendReport.uploadedBytes = streamBuffer.getUploadedBytes();
+}
+
+bool GLViewBoidSwarm::updateSimThread()
+{
+   if( !backend_gui.useSimThread || !ensembleParams.empty() || backendReport.active == BoidBackendType::GpuCompute || !cpuSwarm.isLoaded() )
+   {
+      stopSimThread();
+      return false;
+   }
+   BOID_PROFILE_ZONE( "updateSimThread" );
+   if( scenario_gui.stopAtEnd && stepsSinceReset >= scenario.steps )
+      boid_gui.isPaused = true; // the thread may overshoot by the steps of one frame
+
+   // The frame-locked setting (stepsPerSecond 0) has no frames to lock to here and runs free
+   BoidSimControl control;
+   control.params = currentSwarmParams();
+   control.globals = scenario.getStepGlobals( 0, boid_gui.showObstacles );
+   control.stepsPerSecond = boid_gui.stepsPerSecond;
+   control.paused = boid_gui.isPaused;
+   control.useNeighborLists = boid_gui.useNeighborLists;
+   control.neighborSkin = boid_gui.neighborSkin;
+   control.hashedGrid = boid_gui.useHashedGrid;
+   control.neighborCapacity = static_cast< uint32_t >( boid_gui.maxNeighbors );
+   if( !simThread.isRunning() )
+   {
+      const bool scalar = backendReport.active == BoidBackendType::CpuScalar;
+      const BoidTuningConfig& t = backendReport.tuning;
+      simThread.start( cpuSwarm.getState(), cpuSwarm.size(), frameCounter, control,
+                       scalar ? 1 : BoidThreadPool::shared().getNumThreads(), t.cpuGrain, t.cellScale );
+      simThreadSteps = 0;
+   }
+   else if( !control.sameSettings( simThread.getPosted() ) )
+      simThread.post( control );
+
+   // Newest finished state, if any, becomes the drawn one; there is nothing to interpolate between
+   int steps = 0;
+   if( const BoidSimFrame* f = simThread.acquire() )
+   {
+      steps = static_cast< int >( f->steps - simThreadSteps );
+      simThreadSteps = f->steps;
+      stepsSinceReset += steps;
+      frameCounter = f->frame;
+      const int slot = stateRing.beginStep();
+      if( streamBuffer.upload( stateRing.getBuffer( slot ), 0, f->state.size() * sizeof( BoidGPU ), f->state.data() ) )
+         ++stateRing.getStats().uploadWaits;
+      stateRing.endStep();
+   }
+   simThread.countRenderFrame();
+   stateRing.getStats().stepsLastFrame = steps;
+   simAccumulator = 0.0f;
+   nextRenderAlpha = 1.0f;
+   lastUpdateTime = std::chrono::steady_clock::now();
+   backendReport.cpuStepMs = simThread.getStats().stepMs;
+   backendReport.uploadedBytes = streamBuffer.getUploadedBytes();
+   return true;
+}
+
+void GLViewBoidSwarm::stopSimThread()
+{
+   if( !simThread.isRunning() )
+      return;
+   simThread.stop();
+   // Continue from the state on screen; steps the renderer never took are dropped with the thread
+   const BoidSimFrame& f = simThread.getLatest();
+   cpuSwarm.load( f.state.data(), static_cast< uint32_t >( f.state.size() ) );
+   frameCounter = f.frame;
+}
+
+void GLViewBoidSwarm::updateEnsemble( int steps )
+{
+   BOID_PROFILE_ZONE( "updateEnsemble" );
+   // Weights follow the GUI every frame; sizes only change through a reset
+   currentEnsembleParams( ensembleParamsNext );
+   if( BoidEnsemble::getTotalEntities( ensembleParamsNext ) != BoidEnsemble::getTotalEntities( ensembleParams ) )
+   {
+      resetSimulation();
+      return;
+   }
+   ensembleParams.swap( ensembleParamsNext );
+   const int numInstances = static_cast< int >( ensembleParams.size() );
+
+   if( ensembleOnCpu() )
+   {
+      const BoidSwarmParams& viewed = ensembleParams[std::clamp( ensemble_gui.viewedInstance, 0, numInstances - 1 )];
+      for( int i = 0; i < steps; ++i )
+      {
+         int writeIdx = 1 - ensembleCpuRead;
+         BoidCpuKernel::stepBatch( ensembleCpuState[ensembleCpuRead].data(), ensembleCpuState[writeIdx].data(),
+                                   ensembleParams.data(), numInstances, nextStepGlobals(), BoidThreadPool::shared() );
+         ensembleCpuRead = writeIdx;
+
+         // Only the viewed instance is drawn, so only it goes back to the GPU
+         int slot = stateRing.beginStep();
+         if( streamBuffer.upload( stateRing.getBuffer( slot ), viewed.base * sizeof( BoidGPU ),
+                                  ( viewed.numBoids + viewed.numPredators ) * sizeof( BoidGPU ), ensembleCpuState[ensembleCpuRead].data() + viewed.base ) )
+            ++stateRing.getStats().uploadWaits;
+         stateRing.endStep();
+      }
+
+      if( ++framesSinceEnsembleMetrics >= ensemble_gui.metricsIntervalFrames )
+      {
+         BoidEnsemble::measure( ensembleCpuState[ensembleCpuRead].data(), ensembleParams, ensembleMetrics );
+         ensembleMetricsFrame = static_cast< uint64_t >( frameCounter );
+         framesSinceEnsembleMetrics = 0;
+      }
+      return;
+   }
+
+   computeKernels.pump();
+   BoidKernelKey key = currentKernelKey();
+   GLuint computeProgram = computeKernels.find( key );
+   if( !computeProgram )
+   {
+      computeKernels.request( key );
+      key.features = BOID_KF_ALL | BOID_KF_ENSEMBLE;
+      computeProgram = computeKernels.require( key );
+   }
+   if( !computeProgram )
+      return;
+
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, ensembleParamSSBO );
+   glBufferSubData( GL_SHADER_STORAGE_BUFFER, 0, numInstances * sizeof( BoidSwarmParams ), ensembleParams.data() );
+   glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+
+   glUseProgram( computeProgram );
+   const GLint* uniforms = computeKernels.getUniformLocations( computeProgram );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 3, ensembleParamSSBO );
+   int maxEntities = BoidEnsemble::getMaxEntities( ensembleParams );
+   for( int i = 0; i < steps; ++i )
+   {
+      BoidGpuZone gpuZone( gpuTimer, "Step Ensemble" );
+      setStepUniforms( uniforms, nextStepGlobals() );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, stateRing.getBuffer( stateRing.getStepInput() ) );
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 1, stateRing.getBuffer( stateRing.beginStep() ) );
+
+      // One dispatch for the whole ensemble: x covers the largest instance, y selects the instance
+      glDispatchCompute( ( maxEntities + key.workgroupSize - 1 ) / key.workgroupSize, numInstances, 1 );
+      stateRing.endStep();
+   }
+   glUseProgram( 0 );
+
+   // Metrics come from a whole-ensemble snapshot, split per instance when it lands
+   if( ensembleReadback.poll( ensembleSnapshot ) && static_cast< int >( ensembleSnapshot.boids.size() ) == BoidEnsemble::getTotalEntities( ensembleParams ) )
+   {
+      BoidEnsemble::measure( ensembleSnapshot.boids.data(), ensembleParams, ensembleMetrics );
+      ensembleMetricsFrame = ensembleSnapshot.frame;
+   }
+   if( ++framesSinceEnsembleMetrics >= ensemble_gui.metricsIntervalFrames && !ensembleReadback.isPending() )
+   {
+      // The readback treats the concatenated buffer as one flat list of entities
+      if( ensembleReadback.request( stateRing.getBuffer( stateRing.getLatest() ), BoidEnsemble::getTotalEntities( ensembleParams ), 0, frameCounter ) )
+         framesSinceEnsembleMetrics = 0;
+   }
+}
+
+void GLViewBoidSwarm::updateProfiler()
+{
+   BoidProfiler& profiler = BoidProfiler::get();
+   if( BoidProfiler::isCapturing() )
+   {
+      // GPU zones trail the CPU by a frame or two; the last frame waits so the trace is complete
+      gpuTimer.collect( profiler.getFramesRemaining() <= 1 );
+      profiler.endFrame();
+   }
+
+   if( profiler_gui.captureRequested && !BoidProfiler::isCapturing() && !profiler.isWriting() )
+   {
+      profiler_gui.captureRequested = false;
+      std::string dir = ManagerEnvironmentConfiguration::getVariableValue( "boidtracedir" );
+      if( !dir.empty() && dir.back() != '/' )
+         dir += '/';
+      std::string path = dir + "boid_trace_" + std::to_string( std::time( nullptr ) ) + ".json";
+      gpuTimer.calibrate();
+      if( profiler.beginCapture( profiler_gui.captureFrames, path ) )
+         std::cout << "BoidProfiler: capturing " << profiler_gui.captureFrames << " frames" << std::endl;
+   }
+}
+
+void GLViewBoidSwarm::updateHistory()
+{
+   // Sized by the ring, which may still hold the old swarm until a requested reset runs
+   const int entities = static_cast< int >( stateRing.getSize() / sizeof( BoidGPU ) );
+   if( !history_gui.isEnabled || !ensembleParams.empty() || !history.isReady() || entities == 0 )
+   {
+      history.clear();
+      history_gui.isRewound = false;
+      historyRecordedSteps = stateRing.getStats().stepsIssued;
+      return;
+   }
+   if( history.getNumSlots() != history_gui.historyFrames || history.getNumEntities() != entities )
+      history.allocate( history_gui.historyFrames, entities );
+
+   if( history_gui.rewindRequested )
+   {
+      history_gui.rewindRequested = false;
+      rewindHistory( history_gui.framesBack );
+   }
+   if( history_gui.isRewound && ( history_gui.resumeRequested || !boid_gui.isPaused ) )
+   {
+      // The frames after the shown one are a future that no longer happens
+      history.truncate( history_gui.framesBack );
+      history_gui.framesBack = 0;
+      history_gui.isRewound = false;
+      boid_gui.isPaused = false;
+   }
+   history_gui.resumeRequested = false;
+
+   // The state published this frame, once
+   if( !history_gui.isRewound && stateRing.getStats().stepsIssued != historyRecordedSteps )
+   {
+      historyRecordedSteps = stateRing.getStats().stepsIssued;
+      const float snap = 2.0f * std::max( boid_gui.maxSpeed, boid_gui.predatorSpeed ) * std::max( stateRing.getStats().stepsLastFrame, 1 );
+      history.record( stateRing.getBuffer( stateRing.getLatest() ), frameCounter, stepsSinceReset, snap );
+   }
+}
+
+void GLViewBoidSwarm::updateSpatialQueries()
+{
+   BOID_PROFILE_ZONE( "updateSpatialQueries" );
+   if( !selection_gui.isEnabled || !ensembleParams.empty() )
+   {
+      queryReadback.cancel();
+      spatialQueries.clear();
+      return;
+   }
+
+   // Index each snapshot as it lands and ask for the next one right away, so queries trail the
+   // drawn frame by the readback latency only
+   BoidSnapshot snapshot;
+   if( queryReadback.poll( snapshot ) && static_cast< int >( snapshot.boids.size() ) == boid_gui.numBoids + boid_gui.numPredators )
+      spatialQueries.update( std::move( snapshot ), BoidThreadPool::shared() );
+   if( !queryReadback.isPending() )
+      queryReadback.request( stateRing.getBuffer( stateRing.getLatest() ), boid_gui.numBoids, boid_gui.numPredators, frameCounter );
+}
+
+void GLViewBoidSwarm::rewindHistory( int framesBack )
+{
+   BOID_PROFILE_ZONE( "rewindHistory" );
+   stopSimThread();
+   const int slot = stateRing.getStepInput();
+   if( !history.restore( framesBack, stateRing.getBuffer( slot ) ) )
+      return;
+   // Every slot holds the restored frame, so the drawable pair shows it and the next step reads it
+   stateRing.fillFrom( slot );
+   frameCounter = history.getFrame( framesBack );
+   stepsSinceReset = history.getSteps( framesBack );
+   neighborList.invalidate();
+   if( cpuSwarm.isLoaded() )
+   {
+      cpuSwarm.clear();
+      std::vector< BoidGPU > state = readSwarmState();
+      cpuSwarm.load( state.data(), static_cast< uint32_t >( state.size() ) );
+   }
+   boid_gui.isPaused = true;
+   history_gui.isRewound = true;
+}
+
+void GLViewBoidSwarm::updateEvents()
+{
+   if( events_gui.selectRequested >= 0 )
+   {
+      selection_gui.isEnabled = true;
+      selection_gui.selected = events_gui.selectRequested;
+      events_gui.selectRequested = -1;
+   }
+
+   // Only the GPU kernel records events
+   if( !events_gui.isEnabled || !ensembleParams.empty() || backendReport.active != BoidBackendType::GpuCompute )
+   {
+      if( eventLog.isReady() )
+         eventLog.release();
+      return;
+   }
+   BOID_PROFILE_ZONE( "updateEvents" );
+   if( eventLog.getCapacity() != static_cast< uint32_t >( events_gui.capacity ) )
+      eventLog.allocate( static_cast< uint32_t >( events_gui.capacity ) );
+
+   // Last frame's steps form a batch; whatever has landed goes to the stream
+   eventLog.submit();
+   eventLog.drain( eventStream );
+}
+
+// ============================================================
+// Checkpoints
+// ============================================================
+
+void GLViewBoidSwarm::updateCheckpoint()
+{
+   checkpointWriter.poll( checkpointStats );
+   if( checkpoint_gui.restoreRequested )
+   {
+      checkpoint_gui.restoreRequested = false;
+      std::string error;
+      checkpoint_gui.status = restoreCheckpoint( checkpoint_gui.path, &error ) ? "Restored " + std::string( checkpoint_gui.path ) : error;
+      return;
+   }
+
+   const auto now = std::chrono::steady_clock::now();
+   if( checkpoint_gui.autosaveSeconds > 0.0f && !boid_gui.isPaused &&
+       std::chrono::duration< float >( now - lastCheckpointTime ).count() >= checkpoint_gui.autosaveSeconds )
+      checkpoint_gui.saveRequested = true;
+   if( checkpoint_gui.saveRequested && !checkpointCapturing && !checkpointWriter.isBusy() )
+   {
+      checkpoint_gui.saveRequested = false;
+      lastCheckpointTime = now;
+      captureCheckpoint();
+   }
+   if( !checkpointCapturing )
+      return;
+
+   // Both states landed: the file is written off the render thread
+   for( int k = 0; k < 2; ++k )
+      if( !checkpointLanded[k] )
+         checkpointLanded[k] = checkpointReadback[k].poll( checkpointSnapshot[k] );
+   if( !checkpointLanded[0] || !checkpointLanded[1] )
+      return;
+   checkpointPending.previous = std::move( checkpointSnapshot[0].boids );
+   checkpointPending.latest = std::move( checkpointSnapshot[1].boids );
+   checkpointStats.lastCaptureMs = std::chrono::duration< double, std::milli >( now - checkpointRequestTime ).count();
+   checkpointWriter.write( checkpointPendingPath, std::move( checkpointPending ) );
+   checkpointLanded[0] = checkpointLanded[1] = false;
+   checkpointCapturing = false;
+}
+
+void GLViewBoidSwarm::captureCheckpoint()
+{
+   BOID_PROFILE_ZONE( "captureCheckpoint" );
+   const int n = boid_gui.numBoids;
+   const int np = boid_gui.numPredators;
+   if( !ensembleParams.empty() )
+   {
+      checkpoint_gui.status = "Checkpoints hold a single swarm; leave ensemble mode first";
+      return;
+   }
+   if( static_cast< GLsizeiptr >( n + np ) * static_cast< GLsizeiptr >( sizeof( BoidGPU ) ) != stateRing.getSize() )
+   {
+      checkpoint_gui.status = "Counts changed since the last reset; reset before saving";
+      return;
+   }
+
+   // Called right after publish(), so the drawable pair is the newest state and frameCounter
+   // is the frame the next step consumes
+   checkpointPending = BoidCheckpointData();
+   BoidCheckpointHeader& h = checkpointPending.header;
+   h.numBoids = static_cast< uint32_t >( n );
+   h.numPredators = static_cast< uint32_t >( np );
+   h.frame = static_cast< uint64_t >( frameCounter );
+   h.stepsSinceReset = static_cast< uint64_t >( stepsSinceReset );
+   checkpointPending.scenario = currentScenario().toText();
+   checkpointPending.settings = checkpointSettings();
+   checkpointPendingPath = checkpoint_gui.path;
+
+   checkpointReadback[0].request( stateRing.getBuffer( stateRing.getPrevious() ), n, np, frameCounter );
+   checkpointReadback[1].request( stateRing.getBuffer( stateRing.getLatest() ), n, np, frameCounter );
+   checkpointRequestTime = std::chrono::steady_clock::now();
+   checkpointCapturing = true;
+   checkpoint_gui.status.clear();
+}
+
+bool GLViewBoidSwarm::restoreCheckpoint( const std::string& path, std::string* error )
+{
+   BOID_PROFILE_ZONE( "restoreCheckpoint" );
+   const auto t0 = std::chrono::steady_clock::now();
+   BoidCheckpointFile file;
+   BoidScenario s;
+   if( !file.open( path, error ) || !BoidScenario::parse( file.getScenario(), s, error ) )
+      return false;
+   const BoidCheckpointHeader& h = file.getHeader();
+   if( static_cast< uint32_t >( s.params.numBoids ) != h.numBoids || static_cast< uint32_t >( s.params.numPredators ) != h.numPredators )
+   {
+      if( error )
+         *error = path + ": the scenario does not match the stored swarm";
+      return false;
+   }
+
+   ensemble_gui.isEnabled = false;
+   applyScenario( s );
+   applyCheckpointSettings( file.getSettings() );
+   boid_gui.resetRequested = false;
+   ensemble_gui.resetRequested = false;
+   clearDerivedState();
+   releaseEnsemble();
+   frameCounter = static_cast< int >( h.frame );
+   stepsSinceReset = static_cast< int >( h.stepsSinceReset );
+
+   // Both states straight from the mapping in one upload; the ring slots are filled by GPU copies
+   const GLsizeiptr bytes = static_cast< GLsizeiptr >( h.stateBytes );
+   stateRing.allocate( boid_gui.stateBuffers, bytes );
+   GLuint staging = 0;
+   glGenBuffers( 1, &staging );
+   glBindBuffer( GL_COPY_READ_BUFFER, staging );
+   glBufferData( GL_COPY_READ_BUFFER, 2 * bytes, file.getStates(), GL_STREAM_COPY );
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   stateRing.loadPair( staging );
+   glDeleteBuffers( 1, &staging );
+   if( backendReport.active == BoidBackendType::GpuCompute )
+      cpuSwarm.clear();
+   else
+      cpuSwarm.load( file.getLatest(), file.getNumEntities() );
+   autoTune( false ); // the size bucket may have changed
+
+   checkpointStats.lastRestoreMs = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - t0 ).count();
+   lastCheckpointTime = std::chrono::steady_clock::now();
+   std::cout << "BoidSwarm restored " << path << " at frame " << h.frame << " in " << checkpointStats.lastRestoreMs << " ms" << std::endl;
+   return true;
+}
+
+std::string GLViewBoidSwarm::checkpointSettings() const
+{
+   std::ostringstream out;
+   out << std::setprecision( 9 );
+   for( const auto& [key, field] : checkpointFloats )
+      out << key << "=" << boid_gui.*field << "\n";
+   for( const auto& [key, field] : checkpointInts )
+      out << key << "=" << boid_gui.*field << "\n";
+   for( const auto& [key, field] : checkpointBools )
+      out << key << "=" << ( boid_gui.*field ? 1 : 0 ) << "\n";
+   return out.str();
+}
+
+void GLViewBoidSwarm::applyCheckpointSettings( const std::string& text )
+{
+   std::istringstream in( text );
+   std::string line;
+   while( std::getline( in, line ) )
+   {
+      const size_t eq = line.find( '=' );
+      if( eq == std::string::npos )
+         continue;
+      const std::string key = line.substr( 0, eq );
+      const char* value = line.c_str() + eq + 1;
+      // Keys this build does not know are skipped, so newer checkpoints still restore
+      for( const auto& [name, field] : checkpointFloats )
+         if( key == name )
+            boid_gui.*field = std::strtof( value, nullptr );
+      for( const auto& [name, field] : checkpointInts )
+         if( key == name )
+            boid_gui.*field = static_cast< int >( std::strtol( value, nullptr, 10 ) );
+      for( const auto& [name, field] : checkpointBools )
+         if( key == name )
+            boid_gui.*field = std::strtol( value, nullptr, 10 ) != 0;
+   }
+}
+
+void GLViewBoidSwarm::updateScenario()
+{
+   std::string error;
+   if( !scenario_gui.loadRequested.empty() )
+   {
+      BoidScenario s;
+      if( BoidScenario::load( scenario_gui.loadRequested, s, &error ) )
+      {
+         applyScenario( s );
+         scenario_gui.status = "Loaded " + scenario_gui.loadRequested;
+      }
+      else
+         scenario_gui.status = error;
+      scenario_gui.loadRequested.clear();
+   }
+   if( !scenario_gui.saveRequested.empty() )
+   {
+      bool ok = currentScenario().save( scenario_gui.saveRequested );
+      scenario_gui.status = ( ok ? "Saved " : "Could not write " ) + scenario_gui.saveRequested;
+      scenario_gui.saveRequested.clear();
+   }
+}
+
+void GLViewBoidSwarm::applyScenario( const BoidScenario& s )
+{
+   scenario = s;
+   const BoidSwarmParams& p = s.params;
+   boid_gui.numBoids = p.numBoids;
+   boid_gui.numPredators = p.numPredators;
+   boid_gui.seed = s.seed;
+   boid_gui.separationWeight = p.sepWeight;
+   boid_gui.alignmentWeight = p.aliWeight;
+   boid_gui.cohesionWeight = p.cohWeight;
+   boid_gui.boundaryWeight = p.bndWeight;
+   boid_gui.fleeWeight = p.fleWeight;
+   boid_gui.obstacleWeight = p.obsWeight;
+   boid_gui.noiseStrength = p.noiseStrength;
+   boid_gui.separationRadius = p.sepRadius;
+   boid_gui.neighborRadius = p.neiRadius;
+   boid_gui.fearRadius = p.feaRadius;
+   boid_gui.boundaryRadius = p.bndRadius;
+   boid_gui.maxSpeed = p.maxSpeed;
+   boid_gui.predatorSpeed = p.predSpeed;
+   boid_gui.isPaused = false;
+   boid_gui.resetRequested = true;
+   placeObstacles();
+   std::cout << "BoidSwarm scenario '" << s.name << "': " << p.numBoids << " boids, " << p.numPredators << " predators, "
+             << s.obstacles.size() << " obstacles, seed " << s.seed << std::endl;
+}
+
+BoidScenario GLViewBoidSwarm::currentScenario() const
+{
+   BoidScenario s = scenario;
+   s.params = currentSwarmParams();
+   s.seed = boid_gui.seed;
+   return s;
+}
+
+void GLViewBoidSwarm::placeObstacles()
+{
+   for( int i = 0; i < static_cast< int >( scenario.obstacles.size() ) && i < BoidStepGlobals::MAX_OBSTACLES; ++i )
+      if( obstacleWOs[i] )
+         obstacleWOs[i]->setPosition( Vector( scenario.obstacles[i][0], scenario.obstacles[i][1], scenario.obstacles[i][2] ) );
+}
+
+BoidKernelKey GLViewBoidSwarm::currentKernelKey() const
+{
+   BoidKernelKey key;
+   key.workgroupSize = computeWorkgroupSize;
+   key.features = 0;
+   if( boid_gui.showObstacles )
+      key.features |= BOID_KF_OBSTACLES;
+   if( ensembleParams.empty() )
+   {
+      if( boid_gui.numPredators > 0 )
+         key.features |= BOID_KF_PREDATORS;
+      if( boid_gui.noiseStrength > 0.0f )
+         key.features |= BOID_KF_NOISE;
+      if( boid_gui.useLod && lod.isReady() )
+         key.features |= BOID_KF_LOD;
+      if( events_gui.isEnabled && eventLog.isReady() )
+         key.features |= BOID_KF_EVENTS;
+      // Coasting boids never check the skin, so the lists do not combine with LOD
+      if( boid_gui.useAggregates && cellAggregates.isReady() )
+         key.features |= BOID_KF_AGGREGATES;
+      else if( boid_gui.useNeighborLists && neighborList.isReady() && !( key.features & BOID_KF_LOD ) )
+         key.features |= BOID_KF_NEIGHBOR_LIST;
+      return key;
+   }
+
+   // An ensemble needs every feature any of its instances uses
+   key.features |= BOID_KF_ENSEMBLE;
+   for( const auto& p : ensembleParams )
+   {
+      if( p.numPredators > 0 )
+         key.features |= BOID_KF_PREDATORS;
+      if( p.noiseStrength > 0.0f )
+         key.features |= BOID_KF_NOISE;
+   }
+   return key;
+}
+
+BoidSwarmParams GLViewBoidSwarm::currentSwarmParams() const
+{
+   BoidSwarmParams p;
+   p.numBoids = boid_gui.numBoids;
+   p.numPredators = boid_gui.numPredators;
+   p.sepWeight = boid_gui.separationWeight;
+   p.aliWeight = boid_gui.alignmentWeight;
+   p.cohWeight = boid_gui.cohesionWeight;
+   p.bndWeight = boid_gui.boundaryWeight;
+   p.fleWeight = boid_gui.fleeWeight;
+   p.obsWeight = boid_gui.obstacleWeight;
+   p.noiseStrength = boid_gui.noiseStrength;
+   p.eatRadius = scenario.params.eatRadius;
+   p.sepRadius = boid_gui.separationRadius;
+   p.neiRadius = boid_gui.neighborRadius;
+   p.feaRadius = boid_gui.fearRadius;
+   p.bndRadius = boid_gui.boundaryRadius;
+   p.maxSpeed = boid_gui.maxSpeed;
+   p.predSpeed = boid_gui.predatorSpeed;
+   return p;
+}
+
+BoidStepGlobals GLViewBoidSwarm::nextStepGlobals()
+{
+   // Obstacles are passed as 0 when disabled
+   ++stepsSinceReset;
+   return scenario.getStepGlobals( frameCounter++, boid_gui.showObstacles );
+}
+
+void GLViewBoidSwarm::currentEnsembleParams( std::vector< BoidSwarmParams >& out ) const
+{
+   BoidEnsemble::build( currentSwarmParams(), ensemble_gui.numInstances, static_cast< BoidSweepParam >( ensemble_gui.sweptParam ),
+                        ensemble_gui.sweepMin, ensemble_gui.sweepMax, out );
+}
+
+void GLViewBoidSwarm::updateClusterAnalysis()
+{
+   BOID_PROFILE_ZONE( "updateClusterAnalysis" );
+   // Publish a finished analysis: keep the summary for the GUI, upload the labels for coloring
+   if( clusterJob.valid() && clusterJob.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready )
+   {
+      BoidClusterResult result = clusterJob.get();
+      if( static_cast< int >( result.labels.size() ) == boid_gui.numBoids )
+      {
+         if( !clusterLabelSSBO )
+            glGenBuffers( 1, &clusterLabelSSBO );
+         glBindBuffer( GL_SHADER_STORAGE_BUFFER, clusterLabelSSBO );
+         glBufferData( GL_SHADER_STORAGE_BUFFER, result.labels.size() * sizeof( uint32_t ), result.labels.data(), GL_DYNAMIC_DRAW );
+         glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+         clusterLabelCount = static_cast< int >( result.labels.size() );
+         clusterResult = std::move( result );
+      }
+   }
+
+   if( !cluster_gui.isEnabled )
+      return;
+
+   // A landed snapshot starts the next analysis on a worker; the pool parallelizes inside it
+   BoidSnapshot snapshot;
+   if( !clusterJob.valid() && clusterReadback.poll( snapshot ) )
+   {
+      float linkRadius = boid_gui.neighborRadius;
+      clusterJob = std::async( std::launch::async, [this, linkRadius]( BoidSnapshot snap )
+      {
+         BoidProfiler::setThreadName( "Cluster Analysis" );
+         return this->clusterAnalysis.analyze( snap, linkRadius, BoidThreadPool::shared() );
+      }, std::move( snapshot ) );
+   }
+
+   // Throttle snapshot requests; at most one copy and one analysis are in flight
+   // In ensemble mode the analysis follows instance 0, which starts at the front of the buffer; the
+   // CPU batch only uploads the viewed instance, so it must be instance 0 there
+   bool clusterSourceCurrent = ensembleParams.empty() || !ensemble_gui.useCpuBatch || ensemble_gui.viewedInstance == 0;
+   if( ++framesSinceClusterRequest >= cluster_gui.intervalFrames && clusterSourceCurrent &&
+       !clusterReadback.isPending() && !clusterJob.valid() )
+   {
+      if( clusterReadback.request( stateRing.getBuffer( stateRing.getLatest() ), boid_gui.numBoids, boid_gui.numPredators, frameCounter ) )
+         framesSinceClusterRequest = 0;
+   }
+}
+
+// ============================================================
+// Rendering (called from ImGui callback, like ChaosGame)
+// ============================================================
+
+void GLViewBoidSwarm::renderBoids()
+{
+   if( !renderProgram ) return;
+   BOID_PROFILE_ZONE( "renderBoids" );
+   BoidGpuZone gpuZone( gpuTimer, "Draw Boids" );
+
+   // The viewed instance of an ensemble, otherwise the one swarm at the front of the buffer
+   int base = 0;
+   int n = boid_gui.numBoids;
+   int np = boid_gui.numPredators;
+   if( !ensembleParams.empty() )
+   {
+      const BoidSwarmParams& viewed = ensembleParams[std::clamp( ensemble_gui.viewedInstance, 0, static_cast< int >( ensembleParams.size() ) - 1 )];
+      base = viewed.base;
+      n = viewed.numBoids;
+      np = viewed.numPredators;
+   }
+
+   Mat4 view = this->cam->getCameraViewMatrix();
+   Mat4 proj = this->cam->getCameraProjectionMatrix();
+
+   // Clear only depth buffer so boids aren't occluded by the aquarium sphere
+   // (the aquarium WO rendered in the main pass writes depth)
+   glClear( GL_DEPTH_BUFFER_BIT );
+
+   if( history_gui.isEnabled && history_gui.showTrails && ensembleParams.empty() )
+      history.drawTrails( view.getPtr(), proj.getPtr(), 0, n + np, history_gui.trailLength,
+                          history_gui.isRewound ? history_gui.framesBack : 0, history_gui.trailOpacity );
+
+   glUseProgram( renderProgram );
+
+   glUniformMatrix4fv( glGetUniformLocation( renderProgram, "u_view" ), 1, GL_FALSE, view.getPtr() );
+   glUniformMatrix4fv( glGetUniformLocation( renderProgram, "u_proj" ), 1, GL_FALSE, proj.getPtr() );
+
+   // Draw the newest published state, blended from the one before it by the fixed-rate remainder
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, stateRing.getBuffer( stateRing.getLatest() ) );
+   glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 4, stateRing.getBuffer( stateRing.getPrevious() ) );
+   float alpha = ( stateRing.getPrevious() == stateRing.getLatest() ) ? 1.0f : renderAlpha;
+   glUniform1f( glGetUniformLocation( renderProgram, "u_alpha" ), alpha );
+   glUniform1f( glGetUniformLocation( renderProgram, "u_snapDistance" ), 2.0f * std::max( boid_gui.maxSpeed, boid_gui.predatorSpeed ) );
+   bool highlight = selection_gui.isEnabled && ensembleParams.empty() && selection_gui.selected >= 0;
+   glUniform1i( glGetUniformLocation( renderProgram, "u_highlight" ), highlight ? selection_gui.selected : -1 );
+   stateRing.getStats().renderAlpha = alpha;
+
+   glEnable( GL_DEPTH_TEST );
+   glDepthMask( GL_TRUE );
+   glBindVertexArray( boidVAO );
+
+   // Draw boids: teal, small
+   glUniform4f( glGetUniformLocation( renderProgram, "u_color" ), 0.0f, 0.7f, 0.85f, 1.0f );
+   glUniform1f( glGetUniformLocation( renderProgram, "u_scale" ), 0.5f );
+   glUniform1i( glGetUniformLocation( renderProgram, "u_instanceOffset" ), base );
+
+   // Color by sub-flock once labels for the current swarm are available (labels index from 0)
+   bool colorByCluster = cluster_gui.isEnabled && cluster_gui.colorByCluster && clusterLabelCount == n && base == 0;
+   if( colorByCluster )
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 2, clusterLabelSSBO );
+   glUniform1i( glGetUniformLocation( renderProgram, "u_colorByCluster" ), colorByCluster ? 1 : 0 );
+   glDrawElementsInstanced( GL_TRIANGLES, 12, GL_UNSIGNED_INT, 0, n );
+   glUniform1i( glGetUniformLocation( renderProgram, "u_colorByCluster" ), 0 );
+
+   // Draw predators: red, large
+   if( np > 0 )
+   {
+      glUniform4f( glGetUniformLocation( renderProgram, "u_color" ), 0.85f, 0.15f, 0.15f, 1.0f );
+      glUniform1f( glGetUniformLocation( renderProgram, "u_scale" ), 1.5f );
+      glUniform1i( glGetUniformLocation( renderProgram, "u_instanceOffset" ), base + n );
+      glDrawElementsInstanced( GL_TRIANGLES, 12, GL_UNSIGNED_INT, 0, np );
+   }
+
+   glBindVertexArray( 0 );
+   glUseProgram( 0 );
+   stateRing.endDraw();
+}
+
+// ============================================================
+// Headless Runs (main.cpp --headless)
+// ============================================================
+
+int GLViewBoidSwarm::runHeadless( const BoidHeadlessOptions& opt )
+{
+   BoidOffscreenTarget target;
+   if( !target.create( opt.width, opt.height ) )
+   {
+      std::cout << "BoidSwarm headless: cannot create a " << opt.width << "x" << opt.height << " framebuffer" << std::endl;
+      return 1;
+   }
+   BoidFrameEncoder encoder;
+   BoidFrameCapture capture;
+   std::string error;
+   if( !opt.dumpDir.empty() && !encoder.start( opt.dumpDir, &error ) )
+   {
+      std::cout << "BoidSwarm headless: " << error << std::endl;
+      return 1;
+   }
+
+   // Frame-locked and running, so N frames are N steps on any machine
+   GLView::onResizeWindow( opt.width, opt.height ); // camera aspect
+   boid_gui.stepsPerSecond = 0.0f;
+   boid_gui.isPaused = false;
+   std::cout << "BoidSwarm headless: " << opt.frames << " frames at " << opt.width << "x" << opt.height << " on "
+             << backendReport.renderer << ", " << BoidBackend::getName( backendReport.active ) << " backend" << std::endl;
+
+   // GPU time of each frame (steps, draw, readback), collected NUM_QUERIES frames late; waiting
+   // on the oldest query also keeps the CPU from running further ahead than that
+   constexpr int NUM_QUERIES = 4;
+   GLuint queries[NUM_QUERIES];
+   glGenQueries( NUM_QUERIES, queries );
+   std::vector< float > frameMs, updateMs, drawMs, gpuMs;
+   frameMs.reserve( opt.frames );
+   updateMs.reserve( opt.frames );
+   drawMs.reserve( opt.frames );
+   gpuMs.reserve( opt.frames );
+   auto collectQuery = [&]( int frame )
+   {
+      GLuint64 ns = 0;
+      glGetQueryObjectui64v( queries[frame % NUM_QUERIES], GL_QUERY_RESULT, &ns );
+      gpuMs.push_back( static_cast< float >( ns * 1.0e-6 ) );
+   };
+   auto msSince = []( std::chrono::steady_clock::time_point t )
+   {
+      return std::chrono::duration< float, std::milli >( std::chrono::steady_clock::now() - t ).count();
+   };
+
+   // Heap allocations made by updateWorld() on this thread once the first frames have sized
+   // every buffer; a steady state that stepped without touching the heap reports zero
+   constexpr int ALLOC_WARMUP_FRAMES = 8;
+   uint64_t updateAllocations = 0;
+
+   const auto runStart = std::chrono::steady_clock::now();
+   for( int f = 0; f < opt.frames; ++f )
+   {
+      const auto frameStart = std::chrono::steady_clock::now();
+      if( f >= NUM_QUERIES )
+         collectQuery( f - NUM_QUERIES );
+      glBeginQuery( GL_TIME_ELAPSED, queries[f % NUM_QUERIES] );
+
+      BoidAllocScope allocations;
+      updateWorld();
+      if( f >= ALLOC_WARMUP_FRAMES )
+         updateAllocations += allocations.getThreadAllocations();
+      const auto drawStart = std::chrono::steady_clock::now();
+      updateMs.push_back( std::chrono::duration< float, std::milli >( drawStart - frameStart ).count() );
+
+      target.bind();
+      glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+      renderBoids();
+      if( encoder.isStarted() && f % opt.dumpEvery == 0 )
+         capture.capture( f, opt.width, opt.height, encoder );
+      target.unbind();
+
+      glEndQuery( GL_TIME_ELAPSED );
+      drawMs.push_back( msSince( drawStart ) );
+      frameMs.push_back( msSince( frameStart ) );
+   }
+   capture.flush( encoder );
+   glFinish();
+   for( int f = std::max( 0, opt.frames - NUM_QUERIES ); f < opt.frames; ++f )
+      collectQuery( f );
+   const float totalMs = msSince( runStart );
+   encoder.finish();
+   glDeleteQueries( NUM_QUERIES, queries );
+
+   std::cout << "BoidSwarm headless: " << opt.frames << " frames in " << totalMs / 1000.0f << " s ("
+             << 1000.0f * opt.frames / std::max( totalMs, 1e-3f ) << " fps), "
+             << boid_gui.numBoids + boid_gui.numPredators << " entities" << std::endl;
+   printFrameTimes( "frame (CPU)", frameMs );
+   printFrameTimes( "update (CPU)", updateMs );
+   printFrameTimes( "draw + capture (CPU)", drawMs );
+   printFrameTimes( "frame (GPU)", gpuMs );
+   if( BoidAllocTracker::isEnabled() && opt.frames > ALLOC_WARMUP_FRAMES )
+      std::cout << "   update (heap): " << updateAllocations << " allocations in " << opt.frames - ALLOC_WARMUP_FRAMES
+                << " frames after warmup" << std::endl;
+   if( encoder.isStarted() || capture.getCaptured() > 0 )
+      std::cout << "   dumped " << encoder.getFramesWritten() << "/" << capture.getCaptured() << " frames to "
+                << opt.dumpDir << " (" << encoder.getBytesWritten() / ( 1024.0 * 1024.0 ) << " MiB, "
+                << encoder.getWriteMs() << " ms writing), readback stalls " << capture.getStalls()
+                << ", encoder waits " << capture.getEncoderWaits() << ", write errors " << encoder.getErrors() << std::endl;
+   return encoder.getErrors() > 0 ? 1 : 0;
+}
+
+// ============================================================
+// Event Handlers
+// ============================================================
+
+void GLViewBoidSwarm::onResizeWindow( GLsizei width, GLsizei height )
+{
+   GLView::onResizeWindow( width, height );
+}
+
+void GLViewBoidSwarm::onMouseDown( const SDL_MouseButtonEvent& e )
 {
    GLView::onMouseDown( e );
+
+   // Shift + left click picks the boid under the cursor from the newest indexed snapshot
+   if( !selection_gui.isEnabled || e.button != SDL_BUTTON_LEFT || !( SDL_GetModState() & KMOD_SHIFT ) )
+      return;
+   std::shared_ptr< const BoidSpatialIndex > index = spatialQueries.acquire();
+   if( !index )
+      return;
+   GLint viewport[4];
+   glGetIntegerv( GL_VIEWPORT, viewport );
+   if( viewport[2] <= 0 || viewport[3] <= 0 )
+      return;
+   float ndcX = 2.0f * ( e.x - viewport[0] + 0.5f ) / viewport[2] - 1.0f;
+   float ndcY = 1.0f - 2.0f * ( e.y - viewport[1] + 0.5f ) / viewport[3];
+   float origin[3], dir[3];
+   Mat4 view = this->cam->getCameraViewMatrix();
+   Mat4 proj = this->cam->getCameraProjectionMatrix();
+   if( BoidSpatialIndex::screenRay( view.getPtr(), proj.getPtr(), ndcX, ndcY, origin, dir ) )
+   {
+      uint32_t hit = index->pickRay( origin, dir, selection_gui.pickRadius, 1000.0f );
+      selection_gui.selected = ( hit == BoidSpatialIndex::NONE ) ? -1 : static_cast< int >( hit );
+   }
 }
 
 void GLViewBoidSwarm::onMouseUp( const SDL_MouseButtonEvent& e )
@@ -769,8 +2782,6 @@ void Aftr::GLViewBoidSwarm::loadMap()
 
    this->cam->setPosition( 0, 0, 60 );
 
-   std::srand( static_cast<unsigned int>( std::time( nullptr ) ) );
-
    // ---- Light ----
    {
       float ga = 0.2f;
@@ -791,7 +2802,7 @@ void Aftr::GLViewBoidSwarm::loadMap()
       float pillarHeight = 40.0f;  // tall enough to span the aquarium vertically
       float pillarRadius = 2.0f;
 
-      for( int i = 0; i < NUM_OBSTACLES; ++i )
+      for( int i = 0; i < BoidStepGlobals::MAX_OBSTACLES; ++i )
       {
          WO* obs = WO::New();
          MGLIndexedGeometry* mgl = MGLIndexedGeometry::New( obs );
@@ -799,7 +2810,6 @@ void Aftr::GLViewBoidSwarm::loadMap()
             pillarRadius, pillarRadius, pillarHeight, 16, 1, true, false );
          mgl->setIndexedGeometry( cyl );
          obs->setModel( mgl );
-         obs->setPosition( obstaclePositions[i] );
          obs->renderOrderType = RENDER_ORDER_TYPE::roTRANSPARENT;
 
          // Semi-transparent coral color (alpha ~0.35)
@@ -812,6 +2822,7 @@ void Aftr::GLViewBoidSwarm::loadMap()
          worldLst->push_back( obs );
          obstacleWOs[i] = obs;
       }
+      placeObstacles();
    }
 
    // (Aquarium sphere removed — boundary containment still active in compute shader)
@@ -829,11 +2840,38 @@ void Aftr::GLViewBoidSwarm::loadMap()
       auto showDemoWindow_ImGui    = [this]() { ImGui::ShowDemoWindow(); };
       auto showDemoWindow_AftrDemo = [this]() { WOImGui::draw_AftrImGui_Demo( this->gui ); };
       auto showDemoWindow_ImGuiPlot = [this]() { ImPlot::ShowDemoWindow(); };
-      auto show_boid_controls = [this]() { this->boid_gui.draw(); };
+      auto show_boid_controls = [this]()
+      {
+         const bool onGpu = this->backendReport.active == BoidBackendType::GpuCompute;
+         this->boid_gui.draw( this->stateRing.getStats(), onGpu ? this->neighborList.getStats() : this->cpuSwarm.getNeighborStats(),
+                              this->cellAggregates.getStats(), this->lod.getStats() );
+      };
+      auto show_cluster_stats = [this]() { this->cluster_gui.draw( this->clusterResult, this->boid_gui.numBoids ); };
+      auto show_ensemble = [this]() { this->ensemble_gui.draw( this->ensembleParams, this->ensembleMetrics, this->ensembleMetricsFrame ); };
+      auto show_profiler = [this]() { this->profiler_gui.draw( BoidProfiler::get() ); };
+      auto show_scenarios = [this]() { this->scenario_gui.draw( this->scenario, this->stepsSinceReset ); };
+      auto show_backend = [this]() { this->backend_gui.draw( this->backendReport, this->simThread.getStats(), !this->ensembleParams.empty() ); };
+      auto show_history = [this]() { this->history_gui.draw( this->history.getStats(), !this->ensembleParams.empty() ); };
+      auto show_checkpoints = [this]()
+      {
+         this->checkpoint_gui.draw( this->checkpointStats, this->checkpointCapturing || this->checkpointWriter.isBusy(),
+                                    !this->ensembleParams.empty() );
+      };
+      auto show_events = [this]()
+      {
+         const bool available = this->ensembleParams.empty() && this->backendReport.active == BoidBackendType::GpuCompute;
+         this->events_gui.draw( this->eventStream, this->eventLog.getCapacity(), this->eventLog.getNumPending(), available );
+      };
+      auto show_selection = [this]()
+      {
+         std::shared_ptr< const BoidSpatialIndex > index = this->spatialQueries.acquire();
+         this->selection_gui.draw( index.get(), this->spatialQueries.getStats(), !this->ensembleParams.empty() );
+      };
 
       this->gui->subscribe_drawImGuiWidget(
          [=,this]()
          {
+            BOID_PROFILE_ZONE( "drawImGui" );
             // Render boids inside the ImGui callback (same pattern as ChaosGame)
             this->renderBoids();
 
@@ -842,6 +2880,15 @@ void Aftr::GLViewBoidSwarm::loadMap()
             menu.attach( "Demos", "Show Default ImPlot Demo", showDemoWindow_ImGuiPlot );
             menu.attach( "Demos", "Show Aftr ImGui w/ Markdown & File Dialogs", showDemoWindow_AftrDemo );
             menu.attach( "Boids", "Boid Controls", show_boid_controls, true );
+            menu.attach( "Boids", "Cluster Analysis", show_cluster_stats );
+            menu.attach( "Boids", "Ensemble", show_ensemble );
+            menu.attach( "Boids", "Scenarios", show_scenarios );
+            menu.attach( "Boids", "Profiler", show_profiler );
+            menu.attach( "Boids", "Backend", show_backend );
+            menu.attach( "Boids", "History", show_history );
+            menu.attach( "Boids", "Selection", show_selection );
+            menu.attach( "Boids", "Events", show_events );
+            menu.attach( "Boids", "Checkpoints", show_checkpoints );
             menu.draw();
          } );
       this->worldLst->push_back( this->gui );
@@ -4,7 +4,38 @@
 #include "AftrImGui_MenuBar.h"
 #include "AftrImGui_WO_Editor.h"
 #include "AftrImGui_BoidSwarm.h"
+#include "AftrImGui_BoidClusters.h"
+#include "AftrImGui_BoidEnsemble.h"
+#include "AftrImGui_BoidProfiler.h"
+#include "AftrImGui_BoidScenario.h"
+#include "AftrImGui_BoidBackend.h"
+#include "AftrImGui_BoidHistory.h"
+#include "AftrImGui_BoidSelection.h"
+#include "AftrImGui_BoidEvents.h"
+#include "AftrImGui_BoidCheckpoint.h"
+#include "BoidClusterAnalysis.h"
+#include "BoidProgramCache.h"
+#include "BoidKernelVariants.h"
+#include "BoidReadback.h"
+#include "BoidStateRing.h"
+#include "BoidGpuTimer.h"
+#include "BoidScenario.h"
+#include "BoidGpuNeighborList.h"
+#include "BoidGpuAggregates.h"
+#include "BoidGpuLod.h"
+#include "BoidGpuHistory.h"
+#include "BoidGpuEventLog.h"
+#include "BoidEventStream.h"
+#include "BoidCheckpoint.h"
+#include "BoidSpatialQuery.h"
+#include "BoidBackend.h"
+#include "BoidSimThread.h"
+#include "BoidStreamBuffer.h"
+#include "BoidThreadPool.h"
+#include "BoidHeadless.h"
 #include "Vector.h"
+#include <chrono>
+#include <future>
 #include <vector>
 
 namespace Aftr
@@ -26,25 +57,144 @@ public:
    virtual void onKeyDown( const SDL_KeyboardEvent& key ) override;
    virtual void onKeyUp( const SDL_KeyboardEvent& key ) override;
 
+   /// Instead of startWorldSimulationLoop(): steps and draws opt.frames frames into an offscreen
+   /// framebuffer, optionally dumping them, prints timing stats and returns the exit code
+   int runHeadless( const BoidHeadlessOptions& opt );
+
 protected:
    GLViewBoidSwarm( const std::vector< std::string >& args );
    virtual void onCreate();
 
    void initComputeShader();
+   void requestKernels();
    void initRenderShader();
+   void finishShaders();
    void initBoidBuffers();
    void renderBoids();
    void resetSimulation();
+   void clearDerivedState(); // drops everything computed from the current swarm (lists, history, events, queries...)
+   void releaseEnsemble();
+   void updateClusterAnalysis();
+   int scheduleSteps();
+   bool stepSwarm( int steps ); // false when no compute kernel is available
+   void stepSwarmCpu( int steps );
+   bool updateSimThread(); // true when the simulation thread stepped the swarm this frame
+   void stopSimThread();   // joins it and continues the CPU swarm from the state on screen
+   void probeBackends();
+   void benchmarkBackends();
+   void checkDrift( int steps );
+   void switchBackend( BoidBackendType to );
+   std::vector< BoidGPU > readSwarmState();
+   BoidTuningKey currentTuningKey() const;
+   void autoTune( bool force ); // when the tuning key changed since the last call, or 'force'
+   float benchmarkTuning( const BoidTuningConfig& config, const std::vector< BoidGPU >& start, const GLuint scratch[2] );
+   void applyTuning( const BoidTuningConfig& config );
+   bool ensembleOnCpu() const;
+   void resetEnsemble();
+   void updateEnsemble( int steps );
+   void updateProfiler();
+   void updateHistory();
+   void rewindHistory( int framesBack );
+   void updateEvents();
+   void updateCheckpoint();
+   void captureCheckpoint();
+   bool restoreCheckpoint( const std::string& path, std::string* error = nullptr );
+   std::string checkpointSettings() const;
+   void applyCheckpointSettings( const std::string& text );
+   void updateSpatialQueries();
+   void updateScenario();
+   void applyScenario( const BoidScenario& s );
+   BoidScenario currentScenario() const;
+   void placeObstacles();
+   BoidKernelKey currentKernelKey() const;
+   BoidSwarmParams currentSwarmParams() const;
+   BoidStepGlobals nextStepGlobals(); // consumes a frame number
+   void currentEnsembleParams( std::vector< BoidSwarmParams >& out ) const;
 
    WOImGui* gui = nullptr;
    AftrImGui_MenuBar menu;
    AftrImGui_WO_Editor wo_editor;
    AftrImGui_BoidSwarm boid_gui;
+   AftrImGui_BoidClusters cluster_gui;
+   AftrImGui_BoidEnsemble ensemble_gui;
+   AftrImGui_BoidProfiler profiler_gui;
+   AftrImGui_BoidScenario scenario_gui;
+   AftrImGui_BoidBackend backend_gui;
+   AftrImGui_BoidHistory history_gui;
+   AftrImGui_BoidSelection selection_gui;
+   AftrImGui_BoidEvents events_gui;
+   AftrImGui_BoidCheckpoint checkpoint_gui;
+
+   BoidProgramCache programCache;
+
+   // Compute shader, specialized per feature mask and workgroup size
+   BoidKernelVariants computeKernels;
+   int computeWorkgroupSize = 256;
+   int frameCounter = 0;
+
+   // Swarm state ring: steps write ahead while the newest published pair is drawn
+   BoidStateRing stateRing;
+   float simAccumulator = 0.0f;   // fixed-rate stepping: fraction of a step not yet simulated
+   float renderAlpha = 1.0f;      // interpolation weight used by this frame's draw
+   float nextRenderAlpha = 1.0f;  // ... and by the next frame's (set when its steps are scheduled)
+   std::chrono::steady_clock::time_point lastUpdateTime;
+
+   // Verlet neighbor lists for the single-swarm kernel (Boids > Controls > Neighbor Lists)
+   BoidGpuNeighborList neighborList;
+   bool neighborListsUsed = false; // last issued steps ran the list variant
+
+   // Approximate far field for the single-swarm kernel (Boids > Controls > Approximate Far Field)
+   BoidGpuAggregates cellAggregates;
+   int framesSinceAggregateProbe = 0;
+
+   // Simulation LOD for the single-swarm kernel (Boids > Controls > Simulation LOD)
+   BoidGpuLod lod;
+
+   // Last K frames of the single swarm on the GPU, for trails and rewind (Boids > History)
+   BoidGpuHistory history;
+   uint64_t historyRecordedSteps = 0; // ring steps issued when the newest frame was recorded
+
+   // Eats, respawns and retargets appended by the single-swarm kernel, drained every frame (Boids > Events)
+   BoidGpuEventLog eventLog;
+   BoidEventStream eventStream;
 
-   // Compute shader
-   GLuint computeProgram = 0;
-   GLuint ssbo[2] = { 0, 0 }; // double-buffered
-   int readIdx = 0;
+   // Checkpoints of the single swarm (Boids > Checkpoints): the drawable pair is read back without
+   // stalling, then written on the writer thread
+   BoidReadback checkpointReadback[2];
+   BoidSnapshot checkpointSnapshot[2];
+   bool checkpointLanded[2] = { false, false };
+   bool checkpointCapturing = false;
+   BoidCheckpointData checkpointPending; // header and settings of the capture in flight
+   std::string checkpointPendingPath;
+   BoidCheckpointWriter checkpointWriter;
+   BoidCheckpointStats checkpointStats;
+   std::chrono::steady_clock::time_point checkpointRequestTime;
+   std::chrono::steady_clock::time_point lastCheckpointTime;
+
+   // Radius / k-nearest / pick queries over the newest snapshot of the single swarm (Boids > Selection)
+   BoidReadback queryReadback;
+   BoidSpatialQueryService spatialQueries;
+
+   // Backend stepping the single swarm (Boids > Backend). The CPU backends own the state and
+   // stream every drawn step into the ring
+   BoidBackendReport backendReport;
+   BoidCpuSwarm cpuSwarm;
+   BoidThreadPool scalarPool{ 1 };
+   BoidStreamBuffer streamBuffer;
+   // Optional fixed-rate stepping on a thread of its own; cpuSwarm is stale while it runs
+   BoidSimThread simThread;
+   uint64_t simThreadSteps = 0; // thread steps already counted into stepsSinceReset
+
+   // Startup auto-tuner: best configuration per device, backend and swarm size bucket
+   BoidTuningCache tuningCache;
+   std::string tuningCachePath;
+   bool autoTuneEnabled = true;
+
+   // GPU half of the trace captured from Boids > Profiler (see BoidProfiler)
+   BoidGpuTimer gpuTimer;
+
+   // Seeds a fresh swarm directly into both SSBOs (see BoidRng)
+   GLuint initProgram = 0;
 
    // Render shader (vertex + fragment for instanced boid drawing)
    GLuint renderProgram = 0;
@@ -52,20 +202,38 @@ protected:
    GLuint boidVBO = 0;
    GLuint boidEBO = 0;
 
+   // Sub-flock analysis (snapshot readback -> worker thread -> per-boid label SSBO)
+   BoidReadback clusterReadback;
+   BoidClusterAnalysis clusterAnalysis;
+   std::future< BoidClusterResult > clusterJob;
+   BoidClusterResult clusterResult;
+   GLuint clusterLabelSSBO = 0;
+   int clusterLabelCount = 0;
+   int framesSinceClusterRequest = 0;
+
+   // Ensemble mode: independent swarms concatenated in the state ring, one parameter block each.
+   // Non-empty ensembleParams means the buffers currently hold an ensemble.
+   std::vector< BoidSwarmParams > ensembleParams;
+   std::vector< BoidSwarmParams > ensembleParamsNext; // this frame's GUI values, swapped in
+   GLuint ensembleParamSSBO = 0;
+   std::vector< BoidGPU > ensembleCpuState[2]; // CPU batch: authoritative state, ping-pong
+   int ensembleCpuRead = 0;
+   BoidReadback ensembleReadback;
+   BoidSnapshot ensembleSnapshot; // landed readback, kept for its capacity
+   std::vector< BoidSwarmMetrics > ensembleMetrics;
+   uint64_t ensembleMetricsFrame = 0;
+   int framesSinceEnsembleMetrics = 0;
+
    // Aquarium sphere
    WO* aquarium = nullptr;
 
-   // Obstacles (vertical pillars)
-   static constexpr int NUM_OBSTACLES = 5;
-   Vector obstaclePositions[NUM_OBSTACLES] = {
-      Vector( 0, 0, 0 ),       // center pillar
-      Vector( 10, 8, 0 ),      // front-right
-      Vector( -10, 8, 0 ),     // front-left
-      Vector( -7, -10, 0 ),    // back-left
-      Vector( 8, -9, 0 )       // back-right
-   };
-   float obstacleAvoidRadius = 4.0f;
-   WO* obstacleWOs[NUM_OBSTACLES] = {};
+   // Scene description: obstacle layout, spawn volumes, step size and duration. Counts and
+   // weights are copied into boid_gui when a scenario is applied and read back from it on save
+   BoidScenario scenario = BoidScenario::makeDefault();
+   int stepsSinceReset = 0;
+
+   // Obstacles (vertical pillars), one WO per possible scenario obstacle
+   WO* obstacleWOs[BoidStepGlobals::MAX_OBSTACLES] = {};
 };
 
 } //namespace Aftr
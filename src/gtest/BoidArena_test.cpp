@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+#include "BoidArena.h"
+#include "BoidBackend.h"
+#include "BoidCpuKernel.h"
+#include "BoidEnsemble.h"
+#include "BoidRng.h"
+#include "BoidSwarmMetrics.h"
+#include "BoidThreadPool.h"
+#include <memory>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   constexpr int warmupSteps = 3;
+   constexpr int measuredSteps = 20;
+
+   TEST( BoidArena, bumps_rewinds_and_merges_blocks )
+   {
+      BoidArena arena( 1024 );
+      int* a = arena.allocate< int >( 10 );
+      double* b = arena.allocate< double >( 3 );
+      EXPECT_EQ( reinterpret_cast< uintptr_t >( b ) % alignof( double ), 0u );
+      EXPECT_GE( reinterpret_cast< uint8_t* >( b ), reinterpret_cast< uint8_t* >( a + 10 ) );
+      {
+         BoidArenaScope scope( arena );
+         const size_t used = arena.getUsed();
+         scope.allocate< float >( 100 );
+         EXPECT_GT( arena.getUsed(), used );
+      }
+      EXPECT_EQ( arena.allocate< int >( 1 ), reinterpret_cast< int* >( b + 3 ) ) << "the scope rewound";
+
+      // Outgrowing the block chains more; reset() merges them so the same frame fits in one
+      arena.reset();
+      for( int i = 0; i < 8; ++i )
+         arena.allocate( 700 );
+      EXPECT_GT( arena.getBlockAllocations(), 1u );
+      const size_t highWater = arena.getHighWater();
+      arena.reset();
+      const uint64_t blocks = arena.getBlockAllocations();
+      EXPECT_GE( arena.getCapacity(), highWater );
+      for( int i = 0; i < 8; ++i )
+         arena.allocate( 700 );
+      EXPECT_EQ( arena.getBlockAllocations(), blocks );
+   }
+
+   TEST( BoidArena, tracker_counts_heap_allocations )
+   {
+      if( !BoidAllocTracker::isEnabled() )
+         GTEST_SKIP() << "built with BOID_COUNT_ALLOCATIONS=0";
+      BoidAllocScope scope;
+      auto p = std::make_unique< int >( 5 );
+      std::vector< int > v( 100 );
+      EXPECT_EQ( scope.getThreadAllocations(), 2u );
+      EXPECT_GE( scope.getAllocations(), 2u );
+   }
+
+   // The per-frame CPU paths reuse their buffers: after a few warmup steps the same swarm keeps
+   // stepping without touching the heap on any thread. A flock condenses for hundreds of steps,
+   // up to nearly every boid in every list, so the lists get a capacity bound up front (here the
+   // whole swarm, which no list can exceed) instead of growing with the lists
+   TEST( BoidArena, cpu_stepping_is_allocation_free_after_warmup )
+   {
+      if( !BoidAllocTracker::isEnabled() )
+         GTEST_SKIP() << "built with BOID_COUNT_ALLOCATIONS=0";
+      constexpr int condensingSteps = 400;
+      BoidThreadPool pool( 3 );
+      BoidSwarmParams params;
+      params.numBoids = 400;
+      params.numPredators = 2;
+
+      for( int variant = 0; variant < 3; ++variant )
+      {
+         const bool lists = variant > 0;
+         BoidCpuSwarm swarm;
+         swarm.setHashedGrid( variant == 2 );
+         swarm.setNeighborCapacity( params.numBoids );
+         BoidRng::initSwarm( swarm.prepare( params.numBoids + params.numPredators ), params.numBoids,
+                             params.numPredators, 7, BoidSpawnParams(), pool );
+         BoidStepGlobals globals;
+         for( ; globals.frame < warmupSteps; ++globals.frame )
+         {
+            swarm.step( params, globals, pool, lists, 2.0f );
+            BoidSwarmMetrics::compute( swarm.getState(), params.numBoids );
+         }
+
+         BoidAllocScope scope;
+         for( ; globals.frame < warmupSteps + condensingSteps; ++globals.frame )
+         {
+            swarm.step( params, globals, pool, lists, 2.0f );
+            BoidSwarmMetrics::compute( swarm.getState(), params.numBoids );
+         }
+         const char* name = variant == 0 ? "all pairs" : variant == 1 ? "dense grid lists" : "hashed grid lists";
+         EXPECT_EQ( scope.getAllocations(), 0u ) << name;
+         if( lists )
+         {
+            EXPECT_GT( swarm.getNeighborStats().rebuilds, 1u ) << name;
+            EXPECT_EQ( swarm.getNeighborStats().growths, 1u ) << name << ": only the first build reserves";
+         }
+      }
+   }
+
+   TEST( BoidArena, ensemble_stepping_is_allocation_free_after_warmup )
+   {
+      if( !BoidAllocTracker::isEnabled() )
+         GTEST_SKIP() << "built with BOID_COUNT_ALLOCATIONS=0";
+      BoidThreadPool pool( 3 );
+      BoidSwarmParams base;
+      base.numBoids = 200;
+      base.numPredators = 1;
+      std::vector< BoidSwarmParams > instances;
+      std::vector< BoidSwarmMetrics > metrics;
+      BoidEnsemble::build( base, 4, BoidSweepParam::Separation, 1.0f, 3.0f, instances );
+      std::vector< BoidGPU > state( BoidEnsemble::getTotalEntities( instances ) ), next( state.size() );
+      for( const BoidSwarmParams& s : instances )
+         BoidRng::initSwarm( state.data() + s.base, s.numBoids, s.numPredators, 11, BoidSpawnParams(), pool );
+
+      BoidStepGlobals globals;
+      auto frame = [&]()
+      {
+         BoidEnsemble::build( base, 4, BoidSweepParam::Separation, 1.0f, 3.0f, instances );
+         BoidCpuKernel::stepBatch( state.data(), next.data(), instances.data(), static_cast< int >( instances.size() ),
+                                   globals, pool, 64 );
+         state.swap( next );
+         BoidEnsemble::measure( state.data(), instances, metrics );
+         ++globals.frame;
+      };
+      for( int s = 0; s < warmupSteps; ++s )
+         frame();
+
+      BoidAllocScope scope;
+      for( int s = 0; s < measuredSteps; ++s )
+         frame();
+      EXPECT_EQ( scope.getAllocations(), 0u );
+      EXPECT_EQ( metrics.size(), instances.size() );
+   }
+}
@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+#include "BoidBackend.h"
+#include "BoidRng.h"
+#include "BoidScenario.h"
+#include "BoidThreadPool.h"
+#include <cstring>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   TEST( BoidBackend, parses_config_names )
+   {
+      BoidBackendType t = BoidBackendType::Count;
+      EXPECT_TRUE( BoidBackend::parse( "GPU", t ) );
+      EXPECT_EQ( t, BoidBackendType::GpuCompute );
+      EXPECT_TRUE( BoidBackend::parse( "cpu", t ) );
+      EXPECT_EQ( t, BoidBackendType::CpuThreaded );
+      EXPECT_TRUE( BoidBackend::parse( "Scalar", t ) );
+      EXPECT_EQ( t, BoidBackendType::CpuScalar );
+      EXPECT_FALSE( BoidBackend::parse( "auto", t ) );
+      EXPECT_FALSE( BoidBackend::parse( "", t ) );
+
+      EXPECT_TRUE( BoidBackend::isSoftwareRenderer( "llvmpipe (LLVM 15.0.7, 256 bits)" ) );
+      EXPECT_FALSE( BoidBackend::isSoftwareRenderer( "NVIDIA GeForce RTX 3080/PCIe/SSE2" ) );
+   }
+
+   TEST( BoidBackend, picks_fastest_available )
+   {
+      BoidBackendReport r;
+      r.available[0] = true;
+      EXPECT_EQ( BoidBackend::pickFastest( r ), BoidBackendType::GpuCompute ); // nothing measured yet
+      r.benchMsPerStep[0] = 4.0f;
+      r.benchMsPerStep[1] = 1.5f;
+      r.benchMsPerStep[2] = 3.0f;
+      EXPECT_EQ( BoidBackend::pickFastest( r ), BoidBackendType::CpuThreaded );
+      r.available[1] = false;
+      EXPECT_EQ( BoidBackend::pickFastest( r ), BoidBackendType::CpuScalar );
+      r.available[0] = false;
+      r.benchMsPerStep[2] = -1.0f;
+      EXPECT_EQ( BoidBackend::pickFastest( r ), BoidBackendType::CpuThreaded ); // the fallback of a GPU-less node
+   }
+
+   TEST( BoidBackend, cpu_flavors_step_identically )
+   {
+      // A switch between the CPU backends must not change the trajectory
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.numBoids = 700;
+      s.params.numPredators = 2;
+      const uint32_t total = 702;
+      std::vector< BoidGPU > start( total );
+      BoidRng::initSwarm( start.data(), 700, 2, 21, s.spawn, BoidThreadPool::shared() );
+
+      BoidThreadPool scalar( 1 );
+      BoidCpuSwarm threaded, serial, switched;
+      threaded.load( start.data(), total );
+      serial.load( start.data(), total );
+      switched.load( start.data(), total );
+      for( int i = 0; i < 60; ++i )
+      {
+         BoidStepGlobals g = s.getStepGlobals( i, true );
+         threaded.step( s.params, g, BoidThreadPool::shared(), false, 1.0f );
+         serial.step( s.params, g, scalar, false, 1.0f );
+         // Hops between the pools and in and out of the neighbor lists
+         switched.step( s.params, g, ( i / 10 ) % 2 ? scalar : BoidThreadPool::shared(), ( i / 15 ) % 2 == 1, 1.0f );
+      }
+      ASSERT_EQ( threaded.size(), total );
+      EXPECT_EQ( 0, std::memcmp( threaded.getState(), serial.getState(), total * sizeof( BoidGPU ) ) );
+      EXPECT_EQ( 0, std::memcmp( threaded.getState(), switched.getState(), total * sizeof( BoidGPU ) ) );
+      EXPECT_GT( switched.getNeighborStats().rebuilds, 0u );
+   }
+}
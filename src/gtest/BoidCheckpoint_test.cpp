@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+#include "BoidCheckpoint.h"
+#include "BoidRng.h"
+#include "BoidScenario.h"
+#include "BoidThreadPool.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   BoidCheckpointData makeData( int numBoids, int numPredators )
+   {
+      BoidCheckpointData d;
+      d.header.numBoids = numBoids;
+      d.header.numPredators = numPredators;
+      d.header.frame = 12345;
+      d.header.stepsSinceReset = 678;
+      d.scenario = "name=test\nnumBoids=" + std::to_string( numBoids ) + "\n";
+      d.settings = "stepsPerSecond=30\n";
+      d.previous.resize( numBoids + numPredators );
+      d.latest.resize( numBoids + numPredators );
+      BoidRng::initSwarm( d.previous.data(), numBoids, numPredators, 1, BoidSpawnParams(), BoidThreadPool::shared() );
+      BoidRng::initSwarm( d.latest.data(), numBoids, numPredators, 2, BoidSpawnParams(), BoidThreadPool::shared() );
+      d.latest.back().pad = 17.0f; // a predator's locked target
+      return d;
+   }
+
+   std::string tempPath( const char* name )
+   {
+      return ( std::filesystem::temp_directory_path() / name ).string();
+   }
+
+   TEST( BoidCheckpoint, round_trips_through_the_mapped_file )
+   {
+      const std::string path = tempPath( "boid_checkpoint_test.bin" );
+      BoidCheckpointData d = makeData( 1000, 3 );
+      const BoidCheckpointData expected = d;
+      std::string error;
+      ASSERT_TRUE( BoidCheckpoint::save( path, d, &error ) ) << error;
+
+      BoidCheckpointFile f;
+      ASSERT_TRUE( f.open( path, &error ) ) << error;
+      const BoidCheckpointHeader& h = f.getHeader();
+      EXPECT_EQ( h.numBoids, 1000u );
+      EXPECT_EQ( h.numPredators, 3u );
+      EXPECT_EQ( h.frame, 12345u );
+      EXPECT_EQ( h.stepsSinceReset, 678u );
+      EXPECT_EQ( h.stateOffset % BoidCheckpointHeader::ALIGNMENT, 0u );
+      EXPECT_EQ( f.getScenario(), expected.scenario );
+      EXPECT_EQ( f.getSettings(), expected.settings );
+      EXPECT_EQ( std::memcmp( f.getPrevious(), expected.previous.data(), h.stateBytes ), 0 );
+      EXPECT_EQ( std::memcmp( f.getLatest(), expected.latest.data(), h.stateBytes ), 0 );
+      EXPECT_EQ( f.getLatest()[1002].pad, 17.0f );
+      f.close();
+      std::remove( path.c_str() );
+   }
+
+   TEST( BoidCheckpoint, restores_the_scenario_parameters_exactly )
+   {
+      // Values that do not survive six significant digits
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.sepWeight = 1.23456788f;
+      s.params.neiRadius = 7.77777767f;
+      s.spawn.boidRadius = 3.14159274f;
+      s.dt = 1.0f / 60.0f;
+      s.neighborSkin = 0.333333343f;
+      s.obstacles[0][0] = 10.123457f;
+
+      const std::string path = tempPath( "boid_checkpoint_scenario_test.bin" );
+      BoidCheckpointData d = makeData( 64, 1 );
+      d.scenario = s.toText();
+      std::string error;
+      ASSERT_TRUE( BoidCheckpoint::save( path, d, &error ) ) << error;
+      BoidCheckpointFile f;
+      ASSERT_TRUE( f.open( path, &error ) ) << error;
+      BoidScenario r;
+      ASSERT_TRUE( BoidScenario::parse( f.getScenario(), r, &error ) ) << error;
+      f.close();
+      std::remove( path.c_str() );
+
+      EXPECT_EQ( r.params.sepWeight, s.params.sepWeight );
+      EXPECT_EQ( r.params.neiRadius, s.params.neiRadius );
+      EXPECT_EQ( r.spawn.boidRadius, s.spawn.boidRadius );
+      EXPECT_EQ( r.dt, s.dt );
+      EXPECT_EQ( r.neighborSkin, s.neighborSkin );
+      ASSERT_EQ( r.obstacles.size(), s.obstacles.size() );
+      EXPECT_EQ( std::memcmp( r.obstacles.data(), s.obstacles.data(), s.obstacles.size() * sizeof( s.obstacles[0] ) ), 0 );
+   }
+
+   TEST( BoidCheckpoint, writer_runs_in_the_background_and_replaces_the_file )
+   {
+      const std::string path = tempPath( "boid_checkpoint_async.bin" );
+      BoidCheckpointWriter writer;
+      BoidCheckpointStats stats;
+      for( int round = 0; round < 2; ++round )
+      {
+         BoidCheckpointData d = makeData( 500 + round, 1 );
+         ASSERT_TRUE( writer.write( path, std::move( d ) ) );
+         BoidCheckpointData again = makeData( 10, 0 );
+         EXPECT_FALSE( writer.write( path, std::move( again ) ) ); // one at a time
+         EXPECT_EQ( again.latest.size(), 10u );                   // and the rejected data is left alone
+         writer.wait();
+         EXPECT_TRUE( writer.poll( stats ) );
+         EXPECT_FALSE( writer.isBusy() );
+      }
+      EXPECT_EQ( stats.writes, 2u );
+      EXPECT_EQ( stats.failures, 0u );
+      EXPECT_FALSE( std::filesystem::exists( path + ".tmp" ) );
+
+      BoidCheckpointFile f;
+      std::string error;
+      ASSERT_TRUE( f.open( path, &error ) ) << error;
+      EXPECT_EQ( f.getHeader().numBoids, 501u );
+      EXPECT_EQ( stats.lastBytes, std::filesystem::file_size( path ) );
+      f.close();
+      std::remove( path.c_str() );
+   }
+
+   TEST( BoidCheckpoint, rejects_damaged_files )
+   {
+      const std::string path = tempPath( "boid_checkpoint_bad.bin" );
+      BoidCheckpointData d = makeData( 200, 1 );
+      std::string error;
+      ASSERT_TRUE( BoidCheckpoint::save( path, d, &error ) ) << error;
+      const auto size = std::filesystem::file_size( path );
+
+      BoidCheckpointFile f;
+      std::filesystem::resize_file( path, size - 1 );
+      EXPECT_FALSE( f.open( path, &error ) );
+      EXPECT_NE( error.find( "truncated" ), std::string::npos ) << error;
+      EXPECT_FALSE( f.isOpen() );
+
+      {
+         std::ofstream out( path, std::ios::binary | std::ios::trunc );
+         out << "name=classic\nseed=1\n";
+      }
+      EXPECT_FALSE( f.open( path, &error ) );
+      EXPECT_FALSE( f.open( path + ".missing", &error ) );
+
+      d.latest.pop_back();
+      EXPECT_FALSE( BoidCheckpoint::save( path, d, &error ) );
+      std::remove( path.c_str() );
+   }
+}
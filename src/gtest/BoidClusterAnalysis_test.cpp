@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+#include "BoidClusterAnalysis.h"
+#include "BoidThreadPool.h"
+#include <random>
+
+using namespace Aftr;
+namespace
+{
+   // Two tight blobs of 'perBlob' boids, 'gap' apart along x
+   BoidSnapshot makeTwoBlobs( int perBlob, float gap, unsigned int seed )
+   {
+      std::mt19937 rng( seed );
+      std::uniform_real_distribution< float > u( -1.0f, 1.0f );
+      BoidSnapshot snap;
+      snap.numBoids = 2 * perBlob;
+      snap.boids.resize( snap.numBoids );
+      for( int i = 0; i < snap.numBoids; ++i )
+      {
+         float cx = ( i < perBlob ) ? 0.0f : gap;
+         snap.boids[i] = { cx + u( rng ), u( rng ), u( rng ), 0.0f, 0.1f, 0.0f, 0.0f, 0.0f };
+      }
+      return snap;
+   }
+
+   TEST( BoidClusterAnalysis, finds_separated_blobs )
+   {
+      BoidThreadPool pool( 4 );
+      BoidClusterAnalysis analysis;
+      BoidSnapshot snap = makeTwoBlobs( 500, 20.0f, 1 );
+
+      BoidClusterResult r = analysis.analyze( snap, 5.0f, pool );
+      ASSERT_EQ( r.clusters.size(), 2u );
+      EXPECT_EQ( r.clusters[0].size, 500u );
+      EXPECT_EQ( r.clusters[1].size, 500u );
+      EXPECT_NE( r.labels[0], r.labels[500] );
+      for( int i = 0; i < 500; ++i )
+      {
+         EXPECT_EQ( r.labels[i], r.labels[0] );
+         EXPECT_EQ( r.labels[500 + i], r.labels[500] );
+      }
+      EXPECT_NEAR( r.clusters[0].velocity.x, 0.1f, 1e-5f );
+
+      // Closing the gap merges them
+      BoidClusterResult merged = analysis.analyze( makeTwoBlobs( 500, 3.0f, 1 ), 5.0f, pool );
+      ASSERT_EQ( merged.clusters.size(), 1u );
+      EXPECT_EQ( merged.numMerges, 1u );
+   }
+
+   TEST( BoidClusterAnalysis, ids_are_stable_and_splits_are_counted )
+   {
+      BoidThreadPool pool( 2 );
+      BoidClusterAnalysis analysis;
+
+      BoidClusterResult joined = analysis.analyze( makeTwoBlobs( 300, 2.0f, 7 ), 5.0f, pool );
+      ASSERT_EQ( joined.clusters.size(), 1u );
+      const uint32_t flockId = joined.labels[0];
+
+      // The same flock keeps its id, the half that drifted away gets a fresh one
+      BoidClusterResult split = analysis.analyze( makeTwoBlobs( 300, 30.0f, 7 ), 5.0f, pool );
+      ASSERT_EQ( split.clusters.size(), 2u );
+      EXPECT_EQ( split.numSplits, 1u );
+      EXPECT_TRUE( split.labels[0] == flockId || split.labels[300] == flockId );
+      EXPECT_NE( split.labels[0], split.labels[300] );
+
+      BoidClusterResult again = analysis.analyze( makeTwoBlobs( 300, 30.0f, 7 ), 5.0f, pool );
+      EXPECT_EQ( again.labels, split.labels );
+      EXPECT_EQ( again.numSplits, 0u );
+      EXPECT_EQ( again.numMerges, 0u );
+   }
+
+   TEST( BoidClusterAnalysis, matches_brute_force_components )
+   {
+      std::mt19937 rng( 3 );
+      std::uniform_real_distribution< float > u( -10.0f, 10.0f );
+      BoidSnapshot snap;
+      snap.numBoids = 1500;
+      snap.boids.resize( snap.numBoids );
+      for( auto& b : snap.boids )
+         b = { u( rng ), u( rng ), u( rng ), 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+      const float r = 1.2f;
+      BoidThreadPool pool( 3 );
+      BoidClusterAnalysis analysis;
+      BoidClusterResult res = analysis.analyze( snap, r, pool );
+
+      // Reference labelling by flood fill over all pairs
+      std::vector< int > ref( snap.numBoids, -1 );
+      int numRef = 0;
+      for( int i = 0; i < snap.numBoids; ++i )
+      {
+         if( ref[i] >= 0 )
+            continue;
+         std::vector< int > stack{ i };
+         ref[i] = numRef;
+         while( !stack.empty() )
+         {
+            int a = stack.back();
+            stack.pop_back();
+            for( int b = 0; b < snap.numBoids; ++b )
+            {
+               float dx = snap.boids[a].px - snap.boids[b].px;
+               float dy = snap.boids[a].py - snap.boids[b].py;
+               float dz = snap.boids[a].pz - snap.boids[b].pz;
+               if( ref[b] < 0 && dx * dx + dy * dy + dz * dz < r * r )
+               {
+                  ref[b] = numRef;
+                  stack.push_back( b );
+               }
+            }
+         }
+         ++numRef;
+      }
+
+      ASSERT_EQ( static_cast< int >( res.clusters.size() ), numRef );
+      for( int i = 0; i < snap.numBoids; ++i )
+         for( int j = i + 1; j < snap.numBoids; j += 37 )
+            EXPECT_EQ( ref[i] == ref[j], res.labels[i] == res.labels[j] );
+   }
+}
@@ -0,0 +1,255 @@
+#include "gtest/gtest.h"
+#include "BoidDomain.h"
+#include "BoidCpuKernel.h"
+#include "BoidRng.h"
+#include "BoidScenario.h"
+#include "BoidThreadPool.h"
+#include "BoidTransport.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+   #include <unistd.h>
+#endif
+
+using namespace Aftr;
+namespace
+{
+   BoidScenario makeScenario( int numBoids, int numPredators )
+   {
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.numBoids = numBoids;
+      s.params.numPredators = numPredators;
+      s.seed = 7;
+      return s;
+   }
+
+   /// Runs 'scenario' decomposed over 'ranks' threads; the whole state is gathered after every
+   /// 'sampleEvery' steps and after the last one
+   std::vector< BoidDomainStats > runDecomposed( const BoidScenario& scenario, int ranks, int steps, const BoidDomainSettings& settings,
+                                                 std::vector< std::vector< BoidGPU > >& snapshots, int sampleEvery = 0 )
+   {
+      std::vector< BoidGPU > initial( scenario.params.numBoids + scenario.params.numPredators );
+      BoidRng::initSwarm( initial.data(), scenario.params.numBoids, scenario.params.numPredators, scenario.seed, scenario.spawn,
+                          BoidThreadPool::shared() );
+
+      BoidLocalTransportHub hub( ranks );
+      std::vector< BoidDomainStats > stats( ranks );
+      std::vector< std::thread > threads;
+      snapshots.clear();
+      for( int r = 0; r < ranks; ++r )
+         threads.emplace_back( [&, r]()
+         {
+            BoidThreadPool pool( 1 );
+            BoidDomainRank rank( hub.getTransport( r ), scenario.params, settings );
+            rank.scatter( initial.data() );
+            for( int i = 0; i < steps; ++i )
+            {
+               ASSERT_TRUE( rank.step( scenario.getStepGlobals( i ), pool ) );
+               if( ( sampleEvery > 0 && ( i + 1 ) % sampleEvery == 0 ) || i + 1 == steps )
+               {
+                  std::vector< BoidGPU > state;
+                  ASSERT_TRUE( rank.gather( r == 0 ? &state : nullptr ) );
+                  if( r == 0 )
+                     snapshots.push_back( std::move( state ) );
+               }
+            }
+            stats[r] = rank.getStats();
+         } );
+      for( std::thread& t : threads )
+         t.join();
+      return stats;
+   }
+
+   /// The single-process CPU run, sampled like runDecomposed()
+   std::vector< std::vector< BoidGPU > > runSingle( const BoidScenario& scenario, int steps, int sampleEvery = 0 )
+   {
+      std::vector< BoidGPU > state( scenario.params.numBoids + scenario.params.numPredators ), next( state.size() );
+      BoidRng::initSwarm( state.data(), scenario.params.numBoids, scenario.params.numPredators, scenario.seed, scenario.spawn,
+                          BoidThreadPool::shared() );
+      std::vector< std::vector< BoidGPU > > snapshots;
+      for( int i = 0; i < steps; ++i )
+      {
+         BoidCpuKernel::step( state.data(), next.data(), scenario.params, scenario.getStepGlobals( i ), BoidThreadPool::shared() );
+         state.swap( next );
+         if( ( sampleEvery > 0 && ( i + 1 ) % sampleEvery == 0 ) || i + 1 == steps )
+            snapshots.push_back( state );
+      }
+      return snapshots;
+   }
+
+   TEST( BoidDomain, boids_without_predators_match_the_single_process_run )
+   {
+      // Ids keep the neighbor sums in the kernel's order and the hashes on the global index
+      const BoidScenario s = makeScenario( 600, 0 );
+      BoidDomainSettings settings;
+      settings.rebalanceInterval = 10;
+      const std::vector< BoidGPU > expected = runSingle( s, 80 ).back();
+      for( int ranks : { 1, 2, 4 } )
+      {
+         std::vector< std::vector< BoidGPU > > snapshots;
+         const std::vector< BoidDomainStats > stats = runDecomposed( s, ranks, 80, settings, snapshots );
+         const std::vector< BoidGPU >& decomposed = snapshots.back();
+         ASSERT_EQ( decomposed.size(), expected.size() );
+         EXPECT_EQ( std::memcmp( decomposed.data(), expected.data(), expected.size() * sizeof( BoidGPU ) ), 0 ) << ranks << " ranks";
+
+         int owned = 0;
+         for( const BoidDomainStats& st : stats )
+            owned += st.owned;
+         EXPECT_EQ( owned, s.params.numBoids );
+         if( ranks > 1 )
+         {
+            EXPECT_GT( stats[0].halo, 0 );
+            EXPECT_GT( stats[0].bytesSent, 0u );
+         }
+      }
+   }
+
+   TEST( BoidDomain, predators_match_the_single_process_run )
+   {
+      // The predators chase, eat and retarget over the run; the boids see them as they were
+      // before each step, like the kernel, so the whole swarm stays bit-identical
+      const BoidScenario s = makeScenario( 600, 3 );
+      const int steps = 200, every = 10;
+      std::vector< std::vector< BoidGPU > > decomposed;
+      runDecomposed( s, 3, steps, BoidDomainSettings(), decomposed, every );
+      const std::vector< std::vector< BoidGPU > > expected = runSingle( s, steps, every );
+      ASSERT_EQ( decomposed.size(), expected.size() );
+      for( size_t i = 0; i < expected.size(); ++i )
+      {
+         ASSERT_EQ( decomposed[i].size(), expected[i].size() );
+         EXPECT_EQ( std::memcmp( decomposed[i].data(), expected[i].data(), expected[i].size() * sizeof( BoidGPU ) ), 0 )
+            << "after step " << ( i + 1 ) * every - 1;
+      }
+
+      for( int k = 0; k < s.params.numPredators; ++k )
+      {
+         const BoidGPU& p = decomposed.back()[s.params.numBoids + k];
+         EXPECT_EQ( p.type, expected.back()[s.params.numBoids + k].type );
+         EXPECT_GE( p.pad, 0.0f );
+         EXPECT_LT( p.pad, static_cast< float >( s.params.numBoids ) );
+      }
+   }
+
+   TEST( BoidDomain, rebalancing_evens_out_the_ranks )
+   {
+      // The spawn ball is smaller than the boundary sphere, so the even split crowds the middle slab
+      const BoidScenario s = makeScenario( 1000, 0 );
+      BoidDomainSettings fixed;
+      fixed.rebalanceInterval = 0;
+      BoidDomainSettings moving;
+      moving.rebalanceInterval = 5;
+
+      std::vector< std::vector< BoidGPU > > a, b;
+      const std::vector< BoidDomainStats > before = runDecomposed( s, 3, 60, fixed, a );
+      const std::vector< BoidDomainStats > after = runDecomposed( s, 3, 60, moving, b );
+      auto spread = []( const std::vector< BoidDomainStats >& stats )
+      {
+         int lo = INT32_MAX, hi = 0;
+         for( const BoidDomainStats& st : stats )
+         {
+            lo = std::min( lo, st.owned );
+            hi = std::max( hi, st.owned );
+         }
+         return hi - lo;
+      };
+      EXPECT_LT( spread( after ), spread( before ) / 2 );
+      EXPECT_LT( after[0].imbalance, 1.5f );
+      EXPECT_EQ( after[0].rebalances, 12 );
+      for( size_t r = 1; r + 1 < after.size(); ++r )
+         EXPECT_GE( after[r].hi - after[r].lo, std::max( s.params.sepRadius, s.params.neiRadius ) );
+      // Moving borders changes nothing about the result
+      EXPECT_EQ( std::memcmp( a.back().data(), b.back().data(), a.back().size() * sizeof( BoidGPU ) ), 0 );
+   }
+
+   TEST( BoidDomain, collectives_agree_on_every_rank )
+   {
+      const int ranks = 4;
+      BoidLocalTransportHub hub( ranks );
+      std::vector< std::vector< double > > results( ranks );
+      std::vector< std::thread > threads;
+      for( int r = 0; r < ranks; ++r )
+         threads.emplace_back( [&, r]()
+         {
+            std::vector< double > v = { 0.1 * r, 1e16, r == 2 ? -1e16 : 0.0 };
+            ASSERT_TRUE( hub.getTransport( r ).allReduceSum( v.data(), 3 ) );
+            results[r] = v;
+         } );
+      for( std::thread& t : threads )
+         t.join();
+      for( int r = 1; r < ranks; ++r )
+         EXPECT_EQ( std::memcmp( results[r].data(), results[0].data(), 3 * sizeof( double ) ), 0 );
+      EXPECT_DOUBLE_EQ( results[0][1], 4e16 );
+   }
+
+#ifndef _WIN32
+   TEST( BoidDomain, socket_transport_round_trip )
+   {
+      // Three ranks as threads over real sockets; the messages are large enough to fill the
+      // socket buffers both ways at once
+      const int ranks = 3;
+      const std::string dir = ( std::filesystem::temp_directory_path() / ( "boid_gtest_" + std::to_string( getpid() ) ) ).string();
+      std::filesystem::create_directories( dir );
+      const size_t big = 4u << 20;
+      std::vector< int > ok( ranks, 0 );
+      std::vector< std::thread > threads;
+      for( int r = 0; r < ranks; ++r )
+         threads.emplace_back( [&, r]()
+         {
+            std::string error;
+            std::unique_ptr< BoidSocketTransport > t = BoidSocketTransport::connect( dir, r, ranks, &error );
+            ASSERT_TRUE( t ) << error;
+            for( int to = 0; to < ranks; ++to )
+               if( to != r )
+                  t->send( to, std::vector< uint8_t >( big, static_cast< uint8_t >( r ) ) );
+            std::vector< uint8_t > m;
+            for( int from = 0; from < ranks; ++from )
+            {
+               if( from == r )
+                  continue;
+               ASSERT_TRUE( t->receive( from, m ) );
+               ASSERT_EQ( m.size(), big );
+               EXPECT_EQ( m.front(), from );
+               EXPECT_EQ( m.back(), from );
+            }
+            double v[2] = { 1.0, static_cast< double >( r ) };
+            ASSERT_TRUE( t->allReduceSum( v, 2 ) );
+            EXPECT_EQ( v[0], ranks );
+            EXPECT_EQ( v[1], 3.0 );
+            ok[r] = 1;
+         } );
+      for( std::thread& t : threads )
+         t.join();
+      EXPECT_EQ( ok, std::vector< int >( ranks, 1 ) );
+      std::filesystem::remove_all( dir );
+   }
+
+   TEST( BoidDomain, socket_transport_lost_peer )
+   {
+      // A silent peer times out, and writing to a peer that exited fails instead of raising SIGPIPE
+      const std::string dir = ( std::filesystem::temp_directory_path() / ( "boid_gtest_lost_" + std::to_string( getpid() ) ) ).string();
+      std::filesystem::create_directories( dir );
+      std::unique_ptr< BoidSocketTransport > t[2];
+      std::vector< std::thread > threads;
+      for( int r = 0; r < 2; ++r )
+         threads.emplace_back( [&, r]() { t[r] = BoidSocketTransport::connect( dir, r, 2 ); } );
+      for( std::thread& th : threads )
+         th.join();
+      ASSERT_TRUE( t[0] && t[1] );
+
+      std::vector< uint8_t > m;
+      t[0]->setReceiveTimeout( 200 );
+      EXPECT_FALSE( t[0]->receive( 1, m ) );
+
+      t[1].reset();
+      t[0]->send( 1, std::vector< uint8_t >( 4u << 20, 1 ) );
+      EXPECT_FALSE( t[0]->receive( 1, m ) );
+      std::filesystem::remove_all( dir );
+   }
+#endif
+}
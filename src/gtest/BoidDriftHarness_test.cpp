@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+#include "BoidDriftHarness.h"
+#include "BoidCpuKernel.h"
+#include "BoidScenario.h"
+#include "BoidThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   BoidScenario makeScenario( int numBoids, int numPredators )
+   {
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.numBoids = numBoids;
+      s.params.numPredators = numPredators;
+      s.seed = 42;
+      return s;
+   }
+
+   /// The reference step followed by a one-ulp nudge of every velocity: what a kernel that only
+   /// rounds differently (FMA contraction, reordered sums, SIMD) does to the trajectory
+   BoidDriftStepper roundingStepper( BoidThreadPool& pool )
+   {
+      return [&pool]( const BoidGPU* in, BoidGPU* out, uint32_t count, const BoidSwarmParams& params, const BoidStepGlobals& globals )
+      {
+         BoidCpuKernel::step( in, out, params, globals, pool );
+         for( uint32_t i = 0; i < count; ++i )
+            out[i].vx = std::nextafter( out[i].vx, ( i & 1 ) ? 1.0f : -1.0f );
+      };
+   }
+
+   TEST( BoidDriftHarness, cpu_variants_are_bit_identical )
+   {
+      BoidThreadPool scalar( 1 );
+      const BoidScenario s = makeScenario( 400, 2 );
+      const BoidDriftStepper reference = BoidDriftHarness::cpuStepper( BoidThreadPool::shared() );
+      const BoidDriftStepper candidates[] = { BoidDriftHarness::cpuStepper( scalar, 64 ),
+                                              BoidDriftHarness::cpuNeighborListStepper( BoidThreadPool::shared(), 1.0f ),
+                                              BoidDriftHarness::cpuNeighborListStepper( BoidThreadPool::shared(), 0.5f, 2.0f ),
+                                              BoidDriftHarness::cpuBatchStepper( BoidThreadPool::shared() ) };
+      for( const BoidDriftStepper& candidate : candidates )
+      {
+         const BoidDriftReport r = BoidDriftHarness::run( s, 60, reference, candidate, BoidThreadPool::shared() );
+         std::string failure;
+         EXPECT_TRUE( r.check( BoidDriftTolerance::exact(), &failure ) ) << failure;
+         EXPECT_EQ( r.firstDivergentStep, -1 );
+         EXPECT_EQ( r.samples.size(), 60u );
+      }
+   }
+
+   TEST( BoidDriftHarness, rounding_differences_pass_the_default_tolerance )
+   {
+      const BoidScenario s = makeScenario( 400, 2 );
+      const BoidDriftReport r = BoidDriftHarness::run( s, 300, BoidDriftHarness::cpuStepper( BoidThreadPool::shared() ),
+                                                       roundingStepper( BoidThreadPool::shared() ), BoidThreadPool::shared() );
+      std::cout << "[ BoidDrift ] rounding: " << r.summary() << std::endl;
+      std::string failure;
+      EXPECT_TRUE( r.check( BoidDriftTolerance(), &failure ) ) << failure;
+      EXPECT_EQ( r.firstDivergentStep, 0 );
+      EXPECT_FALSE( r.check( BoidDriftTolerance::exact() ) );
+      EXPECT_GT( r.growthPerStep, 0.0f ); // chaotic: the one-ulp differences grow
+   }
+
+   TEST( BoidDriftHarness, changed_dynamics_fail )
+   {
+      // "Fast paths" that quietly change the model: a tenth less alignment steering shows up in
+      // the trajectories at once, a slower top speed in the collective metrics
+      const BoidScenario s = makeScenario( 400, 2 );
+      auto scaled = []( float BoidSwarmParams::*field, float factor ) -> BoidDriftStepper
+      {
+         return [field, factor]( const BoidGPU* in, BoidGPU* out, uint32_t, const BoidSwarmParams& params, const BoidStepGlobals& globals )
+         {
+            BoidSwarmParams p = params;
+            p.*field *= factor;
+            BoidCpuKernel::step( in, out, p, globals, BoidThreadPool::shared() );
+         };
+      };
+      const BoidDriftStepper reference = BoidDriftHarness::cpuStepper( BoidThreadPool::shared() );
+
+      std::string failure;
+      const BoidDriftReport alignment = BoidDriftHarness::run( s, 40, reference, scaled( &BoidSwarmParams::aliWeight, 0.9f ), BoidThreadPool::shared() );
+      EXPECT_FALSE( alignment.check( BoidDriftTolerance(), &failure ) );
+      EXPECT_NE( failure.find( "error" ), std::string::npos ) << failure;
+
+      const BoidDriftReport speed = BoidDriftHarness::run( s, 150, reference, scaled( &BoidSwarmParams::maxSpeed, 0.9f ), BoidThreadPool::shared() );
+      std::cout << "[ BoidDrift ] 0.9 x max speed: " << speed.summary() << std::endl;
+      BoidDriftTolerance approximate;
+      approximate.trajectorySteps = 0;
+      approximate.growthPerStep = 1.0f;
+      EXPECT_FALSE( speed.check( approximate, &failure ) );
+      EXPECT_NE( failure.find( "speed" ), std::string::npos ) << failure;
+   }
+
+   TEST( BoidDriftHarness, fits_exponential_growth )
+   {
+      std::vector< BoidDriftSample > samples( 60 );
+      for( int i = 0; i < 60; ++i )
+      {
+         samples[i].step = i;
+         // Zero for 5 steps, then e^(0.2 t) until it saturates at step 40
+         samples[i].posRms = i < 5 ? 0.0f : 1e-7f * std::exp( 0.2f * static_cast< float >( std::min( i, 40 ) - 5 ) );
+      }
+      EXPECT_NEAR( BoidDriftHarness::fitGrowth( samples ), 0.2f, 1e-3f );
+
+      BoidDriftReport r;
+      r.samples = samples;
+      r.growthPerStep = BoidDriftHarness::fitGrowth( samples );
+      BoidDriftTolerance tol;
+      tol.growthPerStep = 0.1f;
+      std::string failure;
+      EXPECT_FALSE( r.check( tol, &failure ) );
+      EXPECT_NE( failure.find( "growth" ), std::string::npos ) << failure;
+   }
+}
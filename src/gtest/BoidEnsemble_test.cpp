@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "BoidEnsemble.h"
+#include "BoidCpuKernel.h"
+#include "BoidRng.h"
+#include "BoidThreadPool.h"
+#include <cstring>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   std::vector< BoidGPU > seedEnsemble( const std::vector< BoidSwarmParams >& instances, BoidThreadPool& pool )
+   {
+      std::vector< BoidGPU > state( BoidEnsemble::getTotalEntities( instances ) );
+      for( size_t i = 0; i < instances.size(); ++i )
+         BoidRng::initSwarm( state.data() + instances[i].base, instances[i].numBoids, instances[i].numPredators,
+                             100 + i, BoidSpawnParams(), pool );
+      return state;
+   }
+
+   void stepEnsemble( std::vector< BoidGPU >& state, const std::vector< BoidSwarmParams >& instances, int steps, BoidThreadPool& pool )
+   {
+      std::vector< BoidGPU > next( state.size() );
+      for( int s = 0; s < steps; ++s )
+      {
+         BoidStepGlobals globals;
+         globals.frame = s;
+         BoidCpuKernel::stepBatch( state.data(), next.data(), instances.data(), static_cast< int >( instances.size() ), globals, pool, 64 );
+         state.swap( next );
+      }
+   }
+
+   TEST( BoidEnsemble, build_lays_out_and_sweeps )
+   {
+      BoidSwarmParams base;
+      base.numBoids = 100;
+      base.numPredators = 2;
+      auto instances = BoidEnsemble::build( base, 5, BoidSweepParam::Alignment, 1.0f, 3.0f );
+      ASSERT_EQ( instances.size(), 5u );
+      for( int i = 0; i < 5; ++i )
+      {
+         EXPECT_EQ( instances[i].base, i * 102 );
+         EXPECT_FLOAT_EQ( instances[i].aliWeight, 1.0f + 0.5f * i );
+         EXPECT_FLOAT_EQ( instances[i].cohWeight, base.cohWeight );
+      }
+      EXPECT_EQ( BoidEnsemble::getTotalEntities( instances ), 510 );
+      EXPECT_EQ( BoidEnsemble::getMaxEntities( instances ), 102 );
+   }
+
+   TEST( BoidEnsemble, batch_matches_individual_swarms )
+   {
+      BoidSwarmParams base;
+      base.numBoids = 300;
+      base.numPredators = 1;
+      auto instances = BoidEnsemble::build( base, 3, BoidSweepParam::Cohesion, 0.5f, 2.5f );
+      BoidThreadPool pool( 3 );
+      std::vector< BoidGPU > batched = seedEnsemble( instances, pool );
+      std::vector< BoidGPU > initial = batched;
+      stepEnsemble( batched, instances, 20, pool );
+
+      for( const auto& p : instances )
+      {
+         const size_t count = p.numBoids + p.numPredators;
+         std::vector< BoidGPU > a( initial.begin() + p.base, initial.begin() + p.base + count ), b( count );
+         BoidSwarmParams alone = p;
+         alone.base = 0;
+         for( int s = 0; s < 20; ++s )
+         {
+            BoidStepGlobals globals;
+            globals.frame = s;
+            BoidCpuKernel::step( a.data(), b.data(), alone, globals, pool );
+            a.swap( b );
+         }
+         EXPECT_EQ( 0, std::memcmp( a.data(), batched.data() + p.base, count * sizeof( BoidGPU ) ) );
+      }
+   }
+
+   TEST( BoidEnsemble, instances_do_not_interact )
+   {
+      BoidSwarmParams base;
+      base.numBoids = 200;
+      auto instances = BoidEnsemble::build( base, 3, BoidSweepParam::Separation, 1.0f, 2.0f );
+      BoidThreadPool pool( 2 );
+      std::vector< BoidGPU > a = seedEnsemble( instances, pool ), b = a;
+
+      // Scramble the middle instance of one copy; its neighbours must not notice
+      for( int i = 0; i < instances[1].numBoids + instances[1].numPredators; ++i )
+         b[instances[1].base + i].px += 5.0f;
+      stepEnsemble( a, instances, 15, pool );
+      stepEnsemble( b, instances, 15, pool );
+
+      for( int k : { 0, 2 } )
+      {
+         const size_t count = instances[k].numBoids + instances[k].numPredators;
+         EXPECT_EQ( 0, std::memcmp( a.data() + instances[k].base, b.data() + instances[k].base, count * sizeof( BoidGPU ) ) );
+      }
+
+      auto metrics = BoidEnsemble::measure( a.data(), instances );
+      ASSERT_EQ( metrics.size(), 3u );
+      for( const auto& m : metrics )
+      {
+         EXPECT_EQ( m.numBoids, 200 );
+         EXPECT_GE( m.polarization, 0.0f );
+         EXPECT_LE( m.polarization, 1.0001f );
+         EXPECT_GT( m.meanSpeed, 0.0f );
+      }
+   }
+}
@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include "BoidEventStream.h"
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   BoidEvent makeEvent( BoidEventType type, uint32_t frame, uint32_t entity )
+   {
+      BoidEvent e = {};
+      e.type = static_cast< uint32_t >( type );
+      e.frame = frame;
+      e.entity = entity;
+      e.other = -1;
+      return e;
+   }
+
+   TEST( BoidEventStream, counts_batches_types_and_drops )
+   {
+      BoidEventStream stream( 64 );
+      std::vector< BoidEvent > batch = { makeEvent( BoidEventType::Eat, 1, 4 ), makeEvent( BoidEventType::Respawn, 1, 4 ),
+                                         makeEvent( BoidEventType::Retarget, 1, 100 ) };
+      stream.append( batch.data(), 3, 0 );
+      stream.append( batch.data(), 2, 5 );
+      stream.append( nullptr, 0, 0 );
+
+      const BoidEventStats& s = stream.getStats();
+      EXPECT_EQ( s.total, 5u );
+      EXPECT_EQ( s.byType[0], 2u );
+      EXPECT_EQ( s.byType[1], 2u );
+      EXPECT_EQ( s.byType[2], 1u );
+      EXPECT_EQ( s.dropped, 5u );
+      EXPECT_EQ( s.batches, 3u );
+      EXPECT_EQ( s.lastBatch, 0u );
+      EXPECT_EQ( s.peakBatch, 7u ) << "a batch's size includes what it dropped";
+   }
+
+   TEST( BoidEventStream, cursors_read_in_order_and_report_what_aged_out )
+   {
+      BoidEventStream stream( 8 );
+      std::vector< BoidEvent > batch;
+      for( uint32_t i = 0; i < 5; ++i )
+         batch.push_back( makeEvent( BoidEventType::Eat, i, i ) );
+
+      uint64_t cursor = 0;
+      std::vector< BoidEvent > out;
+      stream.append( batch.data(), 5, 0 );
+      EXPECT_EQ( stream.read( cursor, out, 3 ), 0u );
+      ASSERT_EQ( out.size(), 3u );
+      EXPECT_EQ( out[2].entity, 2u );
+      EXPECT_EQ( cursor, 3u );
+
+      // Ten more pass through a ring of eight: the reader at 3 lost the events up to 7
+      stream.append( batch.data(), 5, 0 );
+      stream.append( batch.data(), 5, 0 );
+      EXPECT_EQ( stream.getTail(), 7u );
+      out.clear();
+      EXPECT_EQ( stream.read( cursor, out ), 4u );
+      EXPECT_EQ( out.size(), 8u );
+      EXPECT_EQ( cursor, stream.getHead() );
+      EXPECT_EQ( out.front().entity, 2u ); // sequence 7 is entity 7 % 5
+      EXPECT_EQ( out.back().entity, 4u );
+
+      // clear() keeps the sequence numbers, so the cursor just has nothing new
+      stream.clear();
+      out.clear();
+      EXPECT_EQ( stream.read( cursor, out ), 0u );
+      EXPECT_TRUE( out.empty() );
+      EXPECT_EQ( stream.getStats().total, 0u );
+   }
+}
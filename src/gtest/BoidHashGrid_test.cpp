@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+#include "BoidHashGrid.h"
+#include "BoidCellGrid.h"
+#include "BoidNeighborList.h"
+#include "BoidRng.h"
+#include "BoidScenario.h"
+#include "BoidThreadPool.h"
+#include <cstring>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   // Two tight clusters far apart, as in a large mostly empty ocean
+   std::vector< BoidGPU > makeClusters( uint32_t perCluster, float separation )
+   {
+      std::vector< BoidGPU > boids( 2 * perCluster );
+      BoidSpawnParams spawn;
+      spawn.boidRadius = 12.0f;
+      BoidRng::initSwarm( boids.data(), 2 * perCluster, 0, 11, spawn, BoidThreadPool::shared() );
+      for( uint32_t i = perCluster; i < 2 * perCluster; ++i )
+      {
+         boids[i].px += separation;
+         boids[i].pz -= separation;
+      }
+      return boids;
+   }
+
+   TEST( BoidHashGrid, finds_every_boid_in_its_cell )
+   {
+      const std::vector< BoidGPU > boids = makeClusters( 500, 3000.0f );
+      BoidHashGrid grid;
+      grid.build( boids.data(), 1000, 4.0f, BoidThreadPool::shared() );
+      ASSERT_GT( grid.getNumOccupied(), 0u );
+      EXPECT_LE( grid.getLoadFactor(), 0.5f );
+      EXPECT_GE( grid.getMaxProbe(), 1u );
+
+      uint32_t listed = 0;
+      for( uint32_t i = 0; i < 1000; ++i )
+      {
+         int cx, cy, cz;
+         grid.cellCoords( boids[i].px, boids[i].py, boids[i].pz, cx, cy, cz );
+         const uint32_t c = grid.findCell( cx, cy, cz );
+         ASSERT_NE( c, BoidHashGrid::NO_CELL );
+         bool found = false;
+         for( uint32_t k = grid.cellBegin( c ); k < grid.cellEnd( c ); ++k )
+         {
+            found = found || grid.items()[k] == i;
+            if( k > grid.cellBegin( c ) )
+            {
+               ASSERT_LT( grid.items()[k - 1], grid.items()[k] ); // ascending, as in BoidCellGrid
+            }
+         }
+         EXPECT_TRUE( found ) << "boid " << i;
+      }
+      for( uint32_t c = 0; c < grid.getNumOccupied(); ++c )
+         listed += grid.cellEnd( c ) - grid.cellBegin( c );
+      EXPECT_EQ( listed, 1000u );
+      EXPECT_EQ( grid.findCell( 100000, 0, 0 ), BoidHashGrid::NO_CELL );
+   }
+
+   TEST( BoidHashGrid, memory_follows_occupied_cells_not_volume )
+   {
+      BoidHashGrid hashed;
+      BoidCellGrid dense;
+      const std::vector< BoidGPU > near = makeClusters( 1000, 30.0f );
+      hashed.build( near.data(), 2000, 4.0f, BoidThreadPool::shared() );
+      const size_t nearBytes = hashed.getBytes();
+      dense.build( near.data(), 2000, 4.0f, BoidThreadPool::shared() );
+      const size_t denseNearBytes = dense.getBytes();
+
+      // Same clusters 100x further apart: the box a dense grid covers grows by orders of magnitude
+      const std::vector< BoidGPU > far = makeClusters( 1000, 3000.0f );
+      hashed.build( far.data(), 2000, 4.0f, BoidThreadPool::shared() );
+      dense.build( far.data(), 2000, 4.0f, BoidThreadPool::shared() );
+      EXPECT_LE( hashed.getBytes(), 2 * nearBytes );
+      EXPECT_GT( dense.getBytes(), 50 * denseNearBytes );
+      EXPECT_FLOAT_EQ( hashed.getCellSize(), 4.0f );
+
+      // A swarm that collapses into a few cells gives the table back
+      std::vector< BoidGPU > packed( 2000, near[0] );
+      hashed.build( packed.data(), 2000, 4.0f, BoidThreadPool::shared() );
+      hashed.build( packed.data(), 2000, 4.0f, BoidThreadPool::shared() );
+      EXPECT_EQ( hashed.getNumOccupied(), 1u );
+      EXPECT_LT( hashed.getNumSlots(), 1024u );
+   }
+
+   TEST( BoidHashGrid, lists_and_steps_match_the_dense_grid )
+   {
+      const std::vector< BoidGPU > boids = makeClusters( 400, 2500.0f );
+      BoidSwarmParams params;
+      params.numBoids = 800;
+      params.numPredators = 0;
+      BoidNeighborList dense, hashed;
+      hashed.setHashedGrid( true );
+      ASSERT_TRUE( dense.update( boids.data(), params, BoidThreadPool::shared() ) );
+      ASSERT_TRUE( hashed.update( boids.data(), params, BoidThreadPool::shared() ) );
+      for( uint32_t i = 0; i < 800; ++i )
+         ASSERT_EQ( std::vector< uint32_t >( hashed.begin( i ), hashed.begin( i ) + hashed.count( i ) ),
+                    std::vector< uint32_t >( dense.begin( i ), dense.begin( i ) + dense.count( i ) ) ) << "boid " << i;
+      EXPECT_TRUE( hashed.getStats().hashedGrid );
+      EXPECT_LT( hashed.getStats().gridBytes, dense.getStats().gridBytes );
+      EXPECT_GT( hashed.getStats().occupiedCells, 0u );
+      hashed.setHashedGrid( false ); // switching grids rebuilds
+      EXPECT_TRUE( hashed.update( boids.data(), params, BoidThreadPool::shared() ) );
+
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.numBoids = 500;
+      s.params.numPredators = 2;
+      s.steps = 100;
+      s.neighborSkin = 1.0f;
+      std::vector< BoidGPU > viaDense, viaHashed;
+      s.runCpu( BoidThreadPool::shared(), &viaDense );
+      s.hashedGrid = true;
+      s.runCpu( BoidThreadPool::shared(), &viaHashed );
+      ASSERT_EQ( viaDense.size(), viaHashed.size() );
+      EXPECT_EQ( 0, std::memcmp( viaDense.data(), viaHashed.data(), viaDense.size() * sizeof( BoidGPU ) ) );
+   }
+}
@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+#include "BoidHeadless.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace Aftr;
+namespace
+{
+   TEST( BoidHeadless, options_parse_from_command_line )
+   {
+      BoidHeadlessOptions o;
+      ASSERT_TRUE( BoidHeadlessOptions::parse( { "./BoidSwarm", "--unrelated" }, o ) );
+      EXPECT_FALSE( o.enabled );
+
+      ASSERT_TRUE( BoidHeadlessOptions::parse( { "./BoidSwarm", "--headless", "--frames=120", "--size=640x360",
+                                                 "--dump=frames", "--dump-every=10" }, o ) );
+      EXPECT_TRUE( o.enabled );
+      EXPECT_EQ( o.frames, 120 );
+      EXPECT_EQ( o.width, 640 );
+      EXPECT_EQ( o.height, 360 );
+      EXPECT_EQ( o.dumpDir, "frames" );
+      EXPECT_EQ( o.dumpEvery, 10 );
+
+      std::string error;
+      BoidHeadlessOptions bad;
+      EXPECT_FALSE( BoidHeadlessOptions::parse( { "--headless", "--size=640" }, bad, &error ) );
+      EXPECT_NE( error.find( "--size" ), std::string::npos );
+      EXPECT_FALSE( BoidHeadlessOptions::parse( { "--frames=0" }, bad ) );
+      EXPECT_FALSE( BoidHeadlessOptions::parse( { "--dump=" }, bad ) );
+   }
+
+   TEST( BoidHeadless, encoder_writes_every_frame_as_tga )
+   {
+      const std::string dir = ( std::filesystem::temp_directory_path() / "boid_headless_test" ).string();
+      std::filesystem::remove_all( dir );
+      const int w = 5, h = 3, frames = 20;
+      {
+         BoidFrameEncoder encoder( 2 ); // the writer falls behind, submit() has to throttle
+         ASSERT_TRUE( encoder.start( dir ) );
+         for( int f = 0; f < frames; ++f )
+         {
+            std::vector< uint8_t > px = encoder.acquireBuffer();
+            px.assign( w * h * 4, static_cast< uint8_t >( f ) );
+            encoder.submit( f, w, h, std::move( px ) );
+         }
+         encoder.finish();
+         EXPECT_EQ( encoder.getFramesWritten(), static_cast< uint64_t >( frames ) );
+         EXPECT_EQ( encoder.getErrors(), 0u );
+         EXPECT_EQ( encoder.getBytesWritten(), static_cast< uint64_t >( frames * ( 18 + w * h * 4 ) ) );
+      }
+
+      std::ifstream in( BoidFrameEncoder::framePath( dir, 7 ), std::ios::binary );
+      std::vector< uint8_t > file( ( std::istreambuf_iterator< char >( in ) ), std::istreambuf_iterator< char >() );
+      ASSERT_EQ( file.size(), 18u + w * h * 4 );
+      EXPECT_EQ( file[2], 2 );                  // uncompressed true-color
+      EXPECT_EQ( file[12] | file[13] << 8, w );
+      EXPECT_EQ( file[14] | file[15] << 8, h );
+      EXPECT_EQ( file[16], 32 );
+      EXPECT_EQ( file[17], 8 );                 // 8 alpha bits, bottom-left origin
+      EXPECT_EQ( file[18], 7 );
+      EXPECT_EQ( file.back(), 7 );
+      std::filesystem::remove_all( dir );
+   }
+}
@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+#include "BoidNeighborList.h"
+#include "BoidCpuKernel.h"
+#include "BoidScenario.h"
+#include "BoidThreadPool.h"
+#include <cstring>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   TEST( BoidNeighborList, lists_match_brute_force )
+   {
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.numBoids = 600;
+      s.params.numPredators = 0;
+      std::vector< BoidGPU > boids( 600 );
+      BoidRng::initSwarm( boids.data(), 600, 0, 9, s.spawn, BoidThreadPool::shared() );
+
+      BoidNeighborList list;
+      list.setSkin( 0.75f );
+      ASSERT_TRUE( list.update( boids.data(), s.params, BoidThreadPool::shared() ) );
+      const float r = s.params.neiRadius + 0.75f;
+      EXPECT_FLOAT_EQ( list.getListRadius(), r );
+      for( uint32_t i = 0; i < 600; ++i )
+      {
+         std::vector< uint32_t > expected;
+         for( uint32_t j = 0; j < 600; ++j )
+         {
+            float dx = boids[i].px - boids[j].px, dy = boids[i].py - boids[j].py, dz = boids[i].pz - boids[j].pz;
+            if( j != i && dx * dx + dy * dy + dz * dz < r * r )
+               expected.push_back( j );
+         }
+         ASSERT_EQ( std::vector< uint32_t >( list.begin( i ), list.begin( i ) + list.count( i ) ), expected ) << "boid " << i;
+      }
+   }
+
+   TEST( BoidNeighborList, rebuilds_only_past_half_skin )
+   {
+      BoidSwarmParams params;
+      params.numBoids = 200;
+      params.numPredators = 0;
+      std::vector< BoidGPU > boids( 200 );
+      BoidRng::initSwarm( boids.data(), 200, 0, 3, BoidSpawnParams(), BoidThreadPool::shared() );
+
+      BoidNeighborList list;
+      list.setSkin( 1.0f );
+      EXPECT_TRUE( list.update( boids.data(), params, BoidThreadPool::shared() ) );
+      boids[17].px += 0.49f;
+      EXPECT_FALSE( list.update( boids.data(), params, BoidThreadPool::shared() ) );
+      boids[17].px += 0.02f;
+      EXPECT_TRUE( list.update( boids.data(), params, BoidThreadPool::shared() ) );
+      params.neiRadius += 1.0f; // a new radius always rebuilds
+      EXPECT_TRUE( list.update( boids.data(), params, BoidThreadPool::shared() ) );
+      EXPECT_EQ( list.getStats().steps, 4u );
+      EXPECT_EQ( list.getStats().rebuilds, 3u );
+   }
+
+   TEST( BoidNeighborList, stepping_matches_all_pairs )
+   {
+      // Predators eat boids, whose respawn jumps must trigger rebuilds too
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.numBoids = 500;
+      s.params.numPredators = 3;
+      s.steps = 150;
+      std::vector< BoidGPU > allPairs, listed;
+      s.runCpu( BoidThreadPool::shared(), &allPairs );
+      s.neighborSkin = 1.0f;
+      BoidScenarioTiming t = s.runCpu( BoidThreadPool::shared(), &listed );
+
+      ASSERT_EQ( allPairs.size(), listed.size() );
+      EXPECT_EQ( 0, std::memcmp( allPairs.data(), listed.data(), allPairs.size() * sizeof( BoidGPU ) ) );
+      EXPECT_GT( t.neighborRebuilds, 1u );
+      EXPECT_LT( t.neighborRebuilds, static_cast< uint64_t >( s.steps ) );
+   }
+}
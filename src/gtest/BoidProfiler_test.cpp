@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "BoidProfiler.h"
+#include "BoidThreadPool.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace Aftr;
+namespace
+{
+   std::string waitAndRead( BoidProfiler& profiler, const std::string& path )
+   {
+      while( profiler.isWriting() )
+         std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      std::ifstream in( path );
+      std::stringstream ss;
+      ss << in.rdbuf();
+      return ss.str();
+   }
+
+   size_t countOf( const std::string& s, const std::string& what )
+   {
+      size_t n = 0;
+      for( size_t at = s.find( what ); at != std::string::npos; at = s.find( what, at + 1 ) )
+         ++n;
+      return n;
+   }
+
+   TEST( BoidProfiler, zones_outside_a_capture_are_dropped )
+   {
+      BoidProfiler& profiler = BoidProfiler::get();
+      ASSERT_FALSE( BoidProfiler::isCapturing() );
+      {
+         BOID_PROFILE_ZONE( "beforeCapture" );
+      }
+
+      const std::string path = "boid_profiler_test_a.json";
+      ASSERT_TRUE( profiler.beginCapture( 1, path ) );
+      EXPECT_FALSE( profiler.beginCapture( 1, path ) ); // one capture at a time
+      {
+         BOID_PROFILE_ZONE( "duringCapture" );
+      }
+      profiler.endFrame();
+      EXPECT_FALSE( BoidProfiler::isCapturing() );
+      {
+         BOID_PROFILE_ZONE( "afterCapture" );
+      }
+
+      std::string json = waitAndRead( profiler, path );
+      EXPECT_EQ( countOf( json, "\"duringCapture\"" ), 1u );
+      EXPECT_EQ( countOf( json, "beforeCapture" ), 0u );
+      EXPECT_EQ( countOf( json, "afterCapture" ), 0u );
+      std::remove( path.c_str() );
+   }
+
+   TEST( BoidProfiler, merges_threads_and_gpu_zones )
+   {
+      BoidProfiler& profiler = BoidProfiler::get();
+      BoidThreadPool pool( 3 );
+      BoidProfiler::setThreadName( "Test Main" );
+
+      const std::string path = "boid_profiler_test_b.json";
+      const int frames = 3;
+      const uint32_t chunks = 5000; // more than one buffer chunk on a single thread
+      ASSERT_TRUE( profiler.beginCapture( frames, path ) );
+      for( int f = 0; f < frames; ++f )
+      {
+         BOID_PROFILE_ZONE( "frame" );
+         pool.parallelFor( chunks, 1, []( uint32_t, uint32_t ) { BOID_PROFILE_ZONE( "chunk" ); } );
+         int64_t now = BoidProfiler::nowNs();
+         profiler.addGpuZone( "gpuStep", now - 1000, now );
+         if( f + 1 < frames )
+            profiler.endFrame();
+      }
+      profiler.endFrame();
+      EXPECT_EQ( profiler.getLastEventCount(), static_cast< size_t >( frames * ( 2 + chunks ) ) );
+
+      std::string json = waitAndRead( profiler, path );
+      EXPECT_EQ( countOf( json, "\"frame\"" ), static_cast< size_t >( frames ) );
+      EXPECT_EQ( countOf( json, "\"chunk\"" ), static_cast< size_t >( frames ) * chunks );
+      EXPECT_EQ( countOf( json, "\"gpuStep\"" ), static_cast< size_t >( frames ) );
+      EXPECT_NE( json.find( "\"name\":\"Test Main\"" ), std::string::npos );
+      EXPECT_NE( json.find( "\"name\":\"GPU\"" ), std::string::npos );
+      EXPECT_EQ( json.substr( json.size() - 4 ), "\n]}\n" );
+      std::remove( path.c_str() );
+   }
+}
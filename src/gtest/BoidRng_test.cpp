@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include "BoidRng.h"
+#include "BoidThreadPool.h"
+#include <cstring>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   TEST( BoidRng, philox_known_answers )
+   {
+      // Random123 known-answer vectors for philox4x32-10
+      uint32_t out[4];
+      const uint32_t zeroCtr[4] = { 0, 0, 0, 0 };
+      const uint32_t zeroKey[2] = { 0, 0 };
+      BoidRng::philox4x32( zeroCtr, zeroKey, out );
+      EXPECT_EQ( out[0], 0x6627e8d5u );
+      EXPECT_EQ( out[1], 0xe169c58du );
+      EXPECT_EQ( out[2], 0xbc57ac4cu );
+      EXPECT_EQ( out[3], 0x9b00dbd8u );
+
+      const uint32_t onesCtr[4] = { 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu };
+      const uint32_t onesKey[2] = { 0xffffffffu, 0xffffffffu };
+      BoidRng::philox4x32( onesCtr, onesKey, out );
+      EXPECT_EQ( out[0], 0x408f276du );
+      EXPECT_EQ( out[1], 0x41c83b0eu );
+      EXPECT_EQ( out[2], 0xa20bc7c6u );
+      EXPECT_EQ( out[3], 0x6d5451fdu );
+   }
+
+   TEST( BoidRng, swarm_is_independent_of_thread_count )
+   {
+      const int n = 20000, np = 3;
+      BoidSpawnParams spawn;
+      std::vector< BoidGPU > a( n + np ), b( n + np );
+      BoidThreadPool one( 1 ), many( 4 );
+      BoidRng::initSwarm( a.data(), n, np, 42, spawn, one );
+      BoidRng::initSwarm( b.data(), n, np, 42, spawn, many );
+      EXPECT_EQ( 0, std::memcmp( a.data(), b.data(), a.size() * sizeof( BoidGPU ) ) );
+
+      // Entities depend only on (index, seed): growing the swarm keeps the existing boids
+      std::vector< BoidGPU > c( n + 100 + np );
+      BoidRng::initSwarm( c.data(), n + 100, np, 42, spawn, many );
+      EXPECT_EQ( 0, std::memcmp( a.data(), c.data(), n * sizeof( BoidGPU ) ) );
+
+      BoidRng::initSwarm( c.data(), n, np, 43, spawn, many );
+      EXPECT_NE( 0, std::memcmp( a.data(), c.data(), n * sizeof( BoidGPU ) ) );
+   }
+
+   TEST( BoidRng, spawns_inside_the_spawn_balls )
+   {
+      const int n = 5000, np = 5;
+      BoidSpawnParams spawn;
+      std::vector< BoidGPU > s( n + np );
+      BoidRng::initSwarm( s.data(), n, np, 7, spawn, BoidThreadPool::shared() );
+      for( int i = 0; i < n + np; ++i )
+      {
+         const bool pred = i >= n;
+         const float r = pred ? spawn.predatorRadius : spawn.boidRadius;
+         const float v = pred ? spawn.predatorSpeed : spawn.boidSpeed;
+         EXPECT_EQ( s[i].type, pred ? 1.0f : 0.0f );
+         EXPECT_LE( s[i].px * s[i].px + s[i].py * s[i].py + s[i].pz * s[i].pz, r * r * 1.0001f );
+         float speedSq = s[i].vx * s[i].vx + s[i].vy * s[i].vy + s[i].vz * s[i].vz;
+         EXPECT_LE( speedSq, v * v * 1.0001f );
+         if( !pred )
+         {
+            EXPECT_GT( speedSq, 0.0f );
+         }
+      }
+   }
+}
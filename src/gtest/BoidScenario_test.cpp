@@ -0,0 +1,191 @@
+#include "gtest/gtest.h"
+#include "BoidScenario.h"
+#include "BoidThreadPool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#ifndef BOID_SCENARIO_DIR
+   #define BOID_SCENARIO_DIR "./scenarios/"
+#endif
+
+using namespace Aftr;
+namespace
+{
+   TEST( BoidScenario, parses_and_round_trips )
+   {
+      BoidScenario s;
+      std::string error;
+      ASSERT_TRUE( BoidScenario::parse( "# comment\n NAME = tank \nnumBoids=300\nnumpredators=2\nseed=42\nsteps=10\n"
+                                        "CohesionWeight=0.75\nspawnBoidRadius=6.5\nobstacle=1, 2, 3, 4\nhashedGrid=1\n", s, &error ) ) << error;
+      EXPECT_EQ( s.name, "tank" );
+      EXPECT_EQ( s.params.numBoids, 300 );
+      EXPECT_EQ( s.params.numPredators, 2 );
+      EXPECT_EQ( s.seed, 42u );
+      EXPECT_EQ( s.steps, 10 );
+      EXPECT_TRUE( s.hashedGrid );
+      EXPECT_FLOAT_EQ( s.params.cohWeight, 0.75f );
+      EXPECT_FLOAT_EQ( s.spawn.boidRadius, 6.5f );
+      EXPECT_FLOAT_EQ( s.params.aliWeight, BoidSwarmParams().aliWeight ); // unspecified keeps the default
+      ASSERT_EQ( s.obstacles.size(), 1u );
+      EXPECT_FLOAT_EQ( s.obstacles[0][3], 4.0f );
+
+      BoidScenario back;
+      ASSERT_TRUE( BoidScenario::parse( s.toText(), back, &error ) ) << error;
+      EXPECT_EQ( back.toText(), s.toText() );
+
+      BoidStepGlobals g = s.getStepGlobals( 7 );
+      EXPECT_EQ( g.frame, 7 );
+      EXPECT_EQ( g.numObstacles, 1 );
+      EXPECT_EQ( s.getStepGlobals( 7, false ).numObstacles, 0 );
+
+      // Seeds keep all 64 bits (the GUI seed is as wide)
+      ASSERT_TRUE( BoidScenario::parse( "seed=5000000000\n", s, &error ) ) << error;
+      EXPECT_EQ( s.seed, 5000000000ull );
+   }
+
+   TEST( BoidScenario, rejects_bad_lines )
+   {
+      BoidScenario s;
+      std::string error;
+      EXPECT_FALSE( BoidScenario::parse( "numBoids=10\nflockiness=3\n", s, &error ) );
+      EXPECT_NE( error.find( "line 2" ), std::string::npos );
+      EXPECT_FALSE( BoidScenario::parse( "numBoids=-1\n", s ) );
+      EXPECT_FALSE( BoidScenario::parse( "obstacle=1,2,3\n", s ) );
+      EXPECT_FALSE( BoidScenario::parse( "maxSpeed\n", s ) );
+      std::string six;
+      for( int i = 0; i < BoidStepGlobals::MAX_OBSTACLES + 1; ++i )
+         six += "obstacle=0,0,0,1\n";
+      EXPECT_FALSE( BoidScenario::parse( six, s ) );
+   }
+
+   TEST( BoidScenario, runs_are_reproducible )
+   {
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.numBoids = 200;
+      s.steps = 20;
+      BoidThreadPool pool( 4 );
+      std::vector< BoidGPU > a, b;
+      s.runCpu( pool, &a );
+      s.runCpu( BoidThreadPool::shared(), &b );
+      ASSERT_EQ( a.size(), 201u );
+      EXPECT_EQ( 0, std::memcmp( a.data(), b.data(), a.size() * sizeof( BoidGPU ) ) );
+   }
+
+   // ============================================================
+   // Performance regression suite
+   // ============================================================
+   //
+   // Every scenario in the catalog is run headless on the CPU kernel, interleaved with a fixed
+   // reference workload (the all-pairs kernel on a 1000 boid tank) timed in the same run. The
+   // best ms/step of each over a few repetitions gives the scenario's cost relative to the
+   // reference, which cancels out most of the machine's speed, so the baselines are versioned:
+   // scenarios/perf_baselines.txt (BOID_PERF_BASELINES overrides the path) holds one ratio per
+   // scenario from a Release build, and BOID_PERF_UPDATE=1 re-records them after an intended
+   // change. A scenario without a baseline fails. BOID_PERF_TOLERANCE is the allowed slowdown
+   // (default 0.5 = 50%, loose enough for machines that scale differently). Every scenario must
+   // step without heap allocations after its first step either way.
+
+   std::string baselinePath()
+   {
+      const char* env = std::getenv( "BOID_PERF_BASELINES" );
+      return env ? env : BOID_SCENARIO_DIR "perf_baselines.txt";
+   }
+
+   std::map< std::string, double > loadBaselines()
+   {
+      std::map< std::string, double > out;
+      std::ifstream in( baselinePath() );
+      std::string name;
+      double ratio = 0.0;
+      while( in >> name )
+      {
+         if( name[0] == '#' )
+            std::getline( in, name );
+         else if( in >> ratio )
+            out[name] = ratio;
+      }
+      return out;
+   }
+
+   void storeBaseline( const std::string& scenario, double ratio )
+   {
+      std::map< std::string, double > all = loadBaselines();
+      all[scenario] = ratio;
+      std::ofstream out( baselinePath() );
+      out << "# scenario ms/step relative to the all-pairs reference (1000 boids), best of several runs, Release build\n";
+      for( const auto& [name, r] : all )
+         out << name << " " << r << "\n";
+   }
+
+   /// The reference workload: the classic tank on the all-pairs kernel, a few steps
+   BoidScenario makeReference()
+   {
+      BoidScenario r = BoidScenario::makeDefault();
+      r.params.numBoids = 1000;
+      r.steps = 10;
+      r.neighborSkin = 0.0f;
+      return r;
+   }
+
+   class BoidPerf : public ::testing::TestWithParam< std::string > {};
+
+   TEST_P( BoidPerf, within_baseline )
+   {
+      BoidScenario s;
+      std::string error;
+      ASSERT_TRUE( BoidScenario::load( GetParam(), s, &error ) ) << error;
+      const BoidScenario reference = makeReference();
+
+      constexpr int REPETITIONS = 3;
+      double best = 1e30, referenceBest = 1e30;
+      uint64_t allocations = 0;
+      for( int r = 0; r < REPETITIONS; ++r )
+      {
+         BoidScenarioTiming timing = s.runCpu( BoidThreadPool::shared() );
+         best = std::min( best, timing.msPerStep );
+         allocations = timing.allocations;
+         referenceBest = std::min( referenceBest, reference.runCpu( BoidThreadPool::shared() ).msPerStep );
+      }
+      const double ratio = best / referenceBest;
+      RecordProperty( "msPerStep", std::to_string( best ) );
+      RecordProperty( "referenceMsPerStep", std::to_string( referenceBest ) );
+      RecordProperty( "allocations", std::to_string( allocations ) );
+
+      const char* tolEnv = std::getenv( "BOID_PERF_TOLERANCE" );
+      const double tolerance = tolEnv ? std::atof( tolEnv ) : 0.5;
+      const char* updateEnv = std::getenv( "BOID_PERF_UPDATE" );
+      const bool update = updateEnv && std::string( updateEnv ) == "1";
+
+      EXPECT_EQ( allocations, 0u ) << s.name << " touched the heap after its first step";
+
+      if( update )
+      {
+         storeBaseline( s.name, ratio );
+         std::cout << "[ BoidPerf ] " << s.name << ": " << ratio << "x reference recorded as baseline" << std::endl;
+         return;
+      }
+      std::map< std::string, double > baselines = loadBaselines();
+      auto it = baselines.find( s.name );
+      ASSERT_NE( it, baselines.end() ) << "no baseline for " << s.name << " in " << baselinePath() << " (" << ratio
+                                       << "x reference); record one with BOID_PERF_UPDATE=1";
+      std::cout << "[ BoidPerf ] " << s.name << ": " << best << " ms/step, " << ratio << "x reference, baseline " << it->second
+                << "x (" << ( ratio / it->second - 1.0 ) * 100.0 << "%), " << allocations << " allocations after warmup" << std::endl;
+      EXPECT_LE( ratio, it->second * ( 1.0 + tolerance ) ) << s.name << " regressed beyond " << tolerance * 100.0 << "%";
+   }
+
+   std::string scenarioTestName( const ::testing::TestParamInfo< std::string >& info )
+   {
+      std::string stem = std::filesystem::path( info.param ).stem().string();
+      std::replace_if( stem.begin(), stem.end(), []( char c ) { return !std::isalnum( static_cast< unsigned char >( c ) ); }, '_' );
+      return stem;
+   }
+
+   INSTANTIATE_TEST_SUITE_P( Catalog, BoidPerf, ::testing::ValuesIn( BoidScenario::listCatalog( BOID_SCENARIO_DIR ) ), scenarioTestName );
+   GTEST_ALLOW_UNINSTANTIATED_PARAMETERIZED_TEST( BoidPerf );
+}
@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+#include "BoidSimThread.h"
+#include "BoidRng.h"
+#include "BoidScenario.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   TEST( BoidSimThread, triple_buffer_hands_over_the_newest_value )
+   {
+      BoidTripleBuffer< int > b;
+      EXPECT_FALSE( b.update() );
+      b.getWriteBuffer() = 1;
+      EXPECT_FALSE( b.publish() );
+      b.getWriteBuffer() = 2;
+      EXPECT_TRUE( b.publish() ); // 1 was never taken
+      EXPECT_TRUE( b.update() );
+      EXPECT_EQ( b.getReadBuffer(), 2 );
+      EXPECT_FALSE( b.update() );
+      EXPECT_EQ( b.getReadBuffer(), 2 );
+
+      // Across threads the reader only ever moves forward and ends on the last value
+      BoidTripleBuffer< std::vector< int > > v;
+      const int count = 20000;
+      std::thread writer( [&v]()
+      {
+         for( int i = 1; i <= count; ++i )
+         {
+            v.getWriteBuffer().assign( 16, i );
+            v.publish();
+         }
+      } );
+      int seen = 0;
+      while( seen < count )
+      {
+         if( !v.update() )
+         {
+            std::this_thread::yield();
+            continue;
+         }
+         const std::vector< int >& r = v.getReadBuffer();
+         ASSERT_EQ( r.size(), 16u );
+         ASSERT_GT( r.front(), seen );
+         ASSERT_EQ( r.front(), r.back() ); // never half written
+         seen = r.front();
+      }
+      writer.join();
+      EXPECT_EQ( seen, count );
+   }
+
+   TEST( BoidSimThread, publishes_the_steps_of_the_cpu_swarm )
+   {
+      BoidScenario s = BoidScenario::makeDefault();
+      s.params.numBoids = 300;
+      s.params.numPredators = 1;
+      const uint32_t total = 301;
+      std::vector< BoidGPU > start( total );
+      BoidRng::initSwarm( start.data(), 300, 1, 5, s.spawn, BoidThreadPool::shared() );
+
+      BoidSimControl control;
+      control.params = s.params;
+      control.globals = s.getStepGlobals( 0, true );
+      control.stepsPerSecond = 0.0f; // as fast as possible
+      BoidSimThread sim;
+      sim.start( start.data(), total, 100, control, 2 );
+      EXPECT_TRUE( sim.isRunning() );
+      EXPECT_EQ( sim.getLatest().steps, 0u );
+      EXPECT_EQ( sim.getLatest().frame, 100 );
+
+      const BoidSimFrame* f = nullptr;
+      while( !f || f->steps < 25 )
+      {
+         if( const BoidSimFrame* next = sim.acquire() )
+            f = next;
+         else
+            std::this_thread::yield();
+      }
+      const uint64_t steps = f->steps;
+      EXPECT_EQ( f->frame, 100 + static_cast< int >( steps ) );
+      EXPECT_EQ( f->paramVersion, sim.getPosted().version );
+
+      // The handed over state is exactly the one the same steps give on this thread
+      BoidCpuSwarm reference;
+      reference.load( start.data(), total );
+      BoidThreadPool pool( 1 );
+      for( uint64_t i = 0; i < steps; ++i )
+         reference.step( s.params, s.getStepGlobals( 100 + static_cast< int >( i ), true ), pool, false, 1.0f );
+      ASSERT_EQ( f->state.size(), total );
+      EXPECT_EQ( 0, std::memcmp( f->state.data(), reference.getState(), total * sizeof( BoidGPU ) ) );
+
+      sim.stop();
+      EXPECT_FALSE( sim.isRunning() );
+      EXPECT_EQ( &sim.getLatest(), f ); // what was drawn last stays
+   }
+
+   TEST( BoidSimThread, pauses_and_versions_posted_parameters )
+   {
+      BoidScenario s = BoidScenario::makeDefault();
+      std::vector< BoidGPU > start( 64 );
+      BoidRng::initSwarm( start.data(), 63, 1, 9, s.spawn, BoidThreadPool::shared() );
+      BoidSimControl control;
+      control.params = s.params;
+      control.params.numBoids = 63;
+      control.params.numPredators = 1;
+      control.globals = s.getStepGlobals( 0, false );
+      control.paused = true;
+
+      BoidSimThread sim;
+      sim.start( start.data(), 64, 0, control, 1 );
+      const uint64_t first = sim.getPosted().version;
+      EXPECT_TRUE( control.sameSettings( sim.getPosted() ) );
+      std::this_thread::sleep_for( std::chrono::milliseconds( 30 ) );
+      EXPECT_EQ( sim.acquire(), nullptr ); // paused from the start
+
+      control.paused = false;
+      control.stepsPerSecond = 500.0f;
+      EXPECT_FALSE( control.sameSettings( sim.getPosted() ) );
+      sim.post( control );
+      EXPECT_EQ( sim.getPosted().version, first + 1 );
+      const BoidSimFrame* f = nullptr;
+      while( !f )
+      {
+         f = sim.acquire();
+         std::this_thread::yield();
+      }
+      EXPECT_EQ( f->paramVersion, first + 1 );
+      sim.stop();
+      sim.countRenderFrame();
+      EXPECT_GE( sim.getStats().steps, f->steps );
+      EXPECT_EQ( sim.getStats().paramVersion, first + 1 );
+      EXPECT_EQ( sim.getStats().picked, 1u );
+      EXPECT_FALSE( sim.getStats().running );
+   }
+}
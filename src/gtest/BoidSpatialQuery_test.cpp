@@ -0,0 +1,239 @@
+#include "gtest/gtest.h"
+#include "BoidSpatialQuery.h"
+#include "BoidThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <thread>
+
+using namespace Aftr;
+namespace
+{
+   // 'n' boids spread through a sphere of 'radius', drifting by 'step' per frame
+   BoidSnapshot makeSwarm( int n, float radius, unsigned int seed, uint64_t frame = 1 )
+   {
+      std::mt19937 rng( seed );
+      std::uniform_real_distribution< float > u( -1.0f, 1.0f );
+      BoidSnapshot snap;
+      snap.numBoids = n;
+      snap.frame = frame;
+      snap.boids.resize( n );
+      for( int i = 0; i < n; ++i )
+         snap.boids[i] = { radius * u( rng ), radius * u( rng ), radius * u( rng ), 0.0f, u( rng ), u( rng ), u( rng ), 0.0f };
+      return snap;
+   }
+
+   BoidSnapshot advance( BoidSnapshot s, float step )
+   {
+      for( BoidGPU& b : s.boids )
+      {
+         b.px += b.vx * step;
+         b.py += b.vy * step;
+         b.pz += b.vz * step;
+      }
+      ++s.frame;
+      return s;
+   }
+
+   std::vector< BoidQuery > makeQueries( int n, float radius, unsigned int seed )
+   {
+      std::mt19937 rng( seed );
+      std::uniform_real_distribution< float > u( -1.2f, 1.2f ); // some outside the swarm
+      std::vector< BoidQuery > q( n );
+      for( BoidQuery& p : q )
+         p = { radius * u( rng ), radius * u( rng ), radius * u( rng ) };
+      return q;
+   }
+
+   float distSq( const BoidSpatialIndex& index, const BoidQuery& q, uint32_t i )
+   {
+      const BoidGPU& b = index.getSnapshot().boids[i];
+      return ( b.px - q.x ) * ( b.px - q.x ) + ( b.py - q.y ) * ( b.py - q.y ) + ( b.pz - q.z ) * ( b.pz - q.z );
+   }
+
+   void expectSameAsScan( const BoidSpatialIndex& index, const std::vector< BoidQuery >& queries )
+   {
+      std::vector< uint32_t > grid, scan;
+      for( const BoidQuery& q : queries )
+      {
+         grid.clear();
+         scan.clear();
+         index.queryRadius( q, 3.0f, grid );
+         index.scanRadius( q, 3.0f, scan );
+         std::sort( grid.begin(), grid.end() );
+         EXPECT_EQ( grid, scan );
+
+         // Same distances (ties may pick different entities)
+         grid.clear();
+         scan.clear();
+         index.queryNearest( q, 10, grid );
+         index.scanNearest( q, 10, scan );
+         ASSERT_EQ( grid.size(), scan.size() );
+         for( size_t j = 0; j < grid.size(); ++j )
+            EXPECT_FLOAT_EQ( distSq( index, q, grid[j] ), distSq( index, q, scan[j] ) );
+      }
+   }
+
+   TEST( BoidSpatialQuery, radius_and_nearest_match_linear_scan )
+   {
+      BoidThreadPool pool( 4 );
+      BoidSpatialIndex index;
+      index.build( makeSwarm( 3000, 20.0f, 1 ), 2.5f, pool );
+      expectSameAsScan( index, makeQueries( 200, 20.0f, 2 ) );
+
+      // The querying boid itself is skipped
+      std::vector< uint32_t > hits;
+      const BoidGPU& b = index.getSnapshot().boids[42];
+      index.queryNearest( BoidQuery{ b.px, b.py, b.pz, 42 }, 1, hits );
+      ASSERT_EQ( hits.size(), 1u );
+      EXPECT_NE( hits[0], 42u );
+   }
+
+   TEST( BoidSpatialQuery, incremental_rebuild_stays_exact )
+   {
+      BoidThreadPool pool( 4 );
+      BoidSnapshot frame = makeSwarm( 4000, 20.0f, 3 );
+      BoidSpatialIndex a, b;
+      a.build( BoidSnapshot( frame ), 2.0f, pool );
+      EXPECT_FALSE( a.wasIncremental() );
+
+      // Small moves: only the boids that changed cell are re-sorted
+      for( int f = 0; f < 6; ++f )
+      {
+         BoidSpatialIndex& prev = ( f % 2 ) ? b : a;
+         BoidSpatialIndex& next = ( f % 2 ) ? a : b;
+         frame = advance( frame, 0.2f );
+         next.build( BoidSnapshot( frame ), 2.0f, pool, &prev );
+         EXPECT_TRUE( next.wasIncremental() );
+         EXPECT_LT( next.getMovers(), 4000u / 4 );
+         expectSameAsScan( next, makeQueries( 50, 20.0f, 10 + f ) );
+      }
+
+      // Leaving the grid forces a full build
+      BoidSpatialIndex far;
+      far.build( advance( frame, 30.0f ), 2.0f, pool, &a );
+      EXPECT_FALSE( far.wasIncremental() );
+      expectSameAsScan( far, makeQueries( 50, 40.0f, 20 ) );
+   }
+
+   TEST( BoidSpatialQuery, batches_and_concurrent_readers )
+   {
+      BoidThreadPool pool( 4 );
+      BoidSpatialQueryService service;
+      service.cellSize = 2.0f;
+      BoidSnapshot frame = makeSwarm( 5000, 20.0f, 4 );
+      service.update( BoidSnapshot( frame ), pool );
+      const std::vector< BoidQuery > queries = makeQueries( 300, 20.0f, 5 );
+
+      BoidQueryResults results;
+      service.nearest( queries, 8, results, pool );
+      ASSERT_EQ( results.offsets.size(), queries.size() + 1 );
+      std::shared_ptr< const BoidSpatialIndex > index = service.acquire();
+      for( size_t q = 0; q < queries.size(); ++q )
+      {
+         ASSERT_EQ( results.count( q ), 8u );
+         std::vector< uint32_t > one;
+         index->queryNearest( queries[q], 8, one );
+         EXPECT_TRUE( std::equal( one.begin(), one.end(), results.indices.begin() + results.offsets[q] ) );
+      }
+      service.radius( queries, 2.5f, results, pool );
+      EXPECT_EQ( results.indices.size(), results.distSq.size() );
+
+      // Readers keep querying their index while newer frames are swapped in
+      std::atomic< bool > stop{ false };
+      std::atomic< int > mismatches{ 0 };
+      std::vector< std::thread > readers;
+      for( int t = 0; t < 3; ++t )
+         readers.emplace_back( [&]()
+         {
+            std::vector< uint32_t > a, b;
+            while( !stop.load() )
+            {
+               std::shared_ptr< const BoidSpatialIndex > held = service.acquire();
+               for( const BoidQuery& q : queries )
+               {
+                  a.clear();
+                  b.clear();
+                  held->queryRadius( q, 2.0f, a );
+                  held->scanRadius( q, 2.0f, b );
+                  if( a.size() != b.size() )
+                     ++mismatches;
+               }
+            }
+         } );
+      for( int f = 0; f < 20; ++f )
+      {
+         frame = advance( frame, 0.2f );
+         service.update( BoidSnapshot( frame ), pool );
+      }
+      stop = true;
+      for( std::thread& t : readers )
+         t.join();
+      EXPECT_EQ( mismatches.load(), 0 );
+      BoidSpatialQueryStats stats = service.getStats();
+      EXPECT_EQ( stats.builds, 21u );
+      EXPECT_GT( stats.incrementalBuilds, 0u );
+      EXPECT_EQ( stats.frame, frame.frame );
+   }
+
+   TEST( BoidSpatialQuery, picks_the_first_boid_along_a_screen_ray )
+   {
+      // Camera at z = 60 looking down -z, 60 degree perspective (column-major)
+      const float f = 1.0f / std::tan( 0.5f * 60.0f * 3.14159265f / 180.0f );
+      const float n = 0.1f, fa = 1000.0f;
+      const float proj[16] = { f, 0, 0, 0, 0, f, 0, 0, 0, 0, ( fa + n ) / ( n - fa ), -1, 0, 0, 2 * fa * n / ( n - fa ), 0 };
+      const float view[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, -60, 1 };
+      float o[3], d[3];
+      ASSERT_TRUE( BoidSpatialIndex::screenRay( view, proj, 0.0f, 0.0f, o, d ) );
+      EXPECT_NEAR( o[2], 60.0f - n, 1e-3f );
+      EXPECT_NEAR( d[2], -1.0f, 1e-5f );
+
+      BoidThreadPool pool( 2 );
+      BoidSnapshot snap = makeSwarm( 2000, 20.0f, 6 );
+      snap.boids[7] = { 0.1f, 0.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };   // on the ray, nearest the camera
+      snap.boids[8] = { 0.0f, 0.1f, -15.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; // on the ray, behind it
+      for( BoidGPU& b : snap.boids )
+         if( &b != &snap.boids[7] && &b != &snap.boids[8] && b.pz > 4.0f && std::hypot( b.px, b.py ) < 1.0f )
+            b.px += 5.0f; // nothing else in front of boid 7
+      BoidSpatialIndex index;
+      index.build( std::move( snap ), 2.0f, pool );
+      EXPECT_EQ( index.pickRay( o, d, 0.5f, 1000.0f ), 7u );
+      ASSERT_TRUE( BoidSpatialIndex::screenRay( view, proj, 0.9f, 0.9f, o, d ) );
+      EXPECT_EQ( index.pickRay( o, d, 0.5f, 1000.0f ), BoidSpatialIndex::NONE ); // misses the swarm
+   }
+
+   // Micro-benchmarks against the linear scan; part of the perf suite (filter *BoidPerf*)
+   TEST( BoidPerfSpatialQuery, index_beats_linear_scan )
+   {
+      BoidThreadPool pool( 1 );
+      BoidSnapshot frame = makeSwarm( 20000, 25.0f, 7 );
+      const std::vector< BoidQuery > queries = makeQueries( 500, 25.0f, 8 );
+      BoidSpatialIndex a, b;
+      auto ms = []( auto&& fn )
+      {
+         auto t0 = std::chrono::steady_clock::now();
+         fn();
+         return std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now() - t0 ).count();
+      };
+
+      BoidSnapshot copies[4] = { frame, frame, advance( frame, 0.1f ), advance( frame, 0.1f ) };
+      a.build( std::move( copies[0] ), 4.0f, pool ); // warm: storage allocated once
+      b.build( std::move( copies[2] ), 4.0f, pool, &a );
+      const double fullMs = ms( [&]() { a.build( std::move( copies[1] ), 4.0f, pool ); } );
+      const double incMs = ms( [&]() { b.build( std::move( copies[3] ), 4.0f, pool, &a ); } );
+      std::vector< uint32_t > out;
+      const double radiusMs = ms( [&]() { for( const BoidQuery& q : queries ) b.queryRadius( q, 5.0f, out ); } );
+      const double radiusScanMs = ms( [&]() { for( const BoidQuery& q : queries ) b.scanRadius( q, 5.0f, out ); } );
+      const double knnMs = ms( [&]() { for( const BoidQuery& q : queries ) b.queryNearest( q, 16, out ); } );
+      const double knnScanMs = ms( [&]() { for( const BoidQuery& q : queries ) b.scanNearest( q, 16, out ); } );
+
+      std::cout << "[ BoidPerf ] spatial index, 20000 boids, 500 queries: build " << fullMs << " ms (incremental " << incMs
+                << " ms, " << b.getMovers() << " movers), radius " << radiusMs << " ms vs scan " << radiusScanMs
+                << " ms, 16-NN " << knnMs << " ms vs scan " << knnScanMs << " ms" << std::endl;
+      EXPECT_TRUE( b.wasIncremental() );
+      EXPECT_LT( radiusMs, radiusScanMs );
+      EXPECT_LT( knnMs, knnScanMs );
+   }
+}
@@ -0,0 +1,29 @@
+#include "gtest/gtest.h"
+#include "BoidSwarmMetrics.h"
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   TEST( BoidSteeringError, relative_to_exact_steering )
+   {
+      std::vector< BoidGPU > before( 4, BoidGPU{} ), exact = before, approx = before;
+      for( int i = 0; i < 4; ++i )
+         exact[i].vx = 2.0f; // every boid steers by |dv| = 2
+      approx = exact;
+
+      BoidSteeringError same = BoidSteeringError::compute( before.data(), approx.data(), exact.data(), 4 );
+      EXPECT_EQ( same.rms, 0.0f );
+      EXPECT_EQ( same.max, 0.0f );
+
+      // One boid off by 1 (half its steering): max = 1/2, rms = sqrt(1/4)/2
+      approx[3].vy = 1.0f;
+      BoidSteeringError off = BoidSteeringError::compute( before.data(), approx.data(), exact.data(), 4 );
+      EXPECT_FLOAT_EQ( off.max, 0.5f );
+      EXPECT_FLOAT_EQ( off.rms, 0.25f );
+
+      // No steering at all: nothing to compare against
+      BoidSteeringError idle = BoidSteeringError::compute( before.data(), approx.data(), before.data(), 4 );
+      EXPECT_EQ( idle.rms, 0.0f );
+   }
+}
@@ -0,0 +1,204 @@
+#include "gtest/gtest.h"
+#include "BoidSweep.h"
+#include "BoidSwarmMetrics.h"
+#include "BoidThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Aftr;
+namespace
+{
+   std::string readFile( const std::string& path )
+   {
+      std::ifstream in( path, std::ios::binary );
+      std::stringstream ss;
+      ss << in.rdbuf();
+      return ss.str();
+   }
+
+   /// Rows without the two timing columns, which differ from run to run
+   std::vector< std::string > withoutTimings( const std::string& csv )
+   {
+      std::vector< std::string > rows;
+      std::istringstream in( csv );
+      std::string line;
+      while( std::getline( in, line ) )
+      {
+         size_t cut = line.size();
+         for( int k = 0; k < 2; ++k )
+            cut = line.rfind( ',', cut - 1 );
+         rows.push_back( line.substr( 0, cut ) );
+      }
+      std::sort( rows.begin() + 1, rows.end() ); // jobs finish in any order
+      return rows;
+   }
+
+   TEST( BoidSweep, grid_expands_the_cartesian_product )
+   {
+      BoidSweep s;
+      std::string error;
+      ASSERT_TRUE( BoidSweep::parse( "numBoids=64\nreplicas=2\naxis=cohesionWeight:0..1:3\naxis=numPredators:0,2\n", s, "", &error ) ) << error;
+      EXPECT_EQ( s.getNumJobs(), 12 );
+
+      std::vector< BoidSweepJob > jobs;
+      ASSERT_TRUE( s.expand( jobs, &error ) ) << error;
+      ASSERT_EQ( jobs.size(), 12u );
+      // Replicas innermost, then the last axis
+      EXPECT_EQ( jobs[1].point, 0 );
+      EXPECT_EQ( jobs[1].scenario.seed, s.base.seed + 1 );
+      EXPECT_EQ( jobs[2].scenario.params.numPredators, 2 );
+      EXPECT_FLOAT_EQ( jobs[2].scenario.params.cohWeight, 0.0f );
+      EXPECT_FLOAT_EQ( jobs[4].scenario.params.cohWeight, 0.5f );
+      EXPECT_FLOAT_EQ( jobs[11].scenario.params.cohWeight, 1.0f );
+      EXPECT_EQ( jobs[11].scenario.params.numBoids, 64 );
+      EXPECT_EQ( s.getHeader(), "job,replica,seed,spec,cohesionWeight,numPredators,step,polarization,meanSpeed,gyrationRadius,"
+                                "centroidX,centroidY,centroidZ,stepMs,jobMs" );
+   }
+
+   TEST( BoidSweep, random_samples_are_reproducible_and_in_range )
+   {
+      BoidSweep s;
+      std::string error;
+      ASSERT_TRUE( BoidSweep::parse( "mode=random\nsamples=50\nsampleSeed=9\naxis=maxSpeed:2..4\naxis=numBoids:32,48\n", s, "", &error ) ) << error;
+      std::vector< BoidSweepJob > a, b;
+      ASSERT_TRUE( s.expand( a ) );
+      ASSERT_TRUE( s.expand( b ) );
+      ASSERT_EQ( a.size(), 50u );
+      int distinct = 0;
+      for( size_t j = 0; j < a.size(); ++j )
+      {
+         EXPECT_EQ( a[j].values, b[j].values );
+         EXPECT_GE( a[j].scenario.params.maxSpeed, 2.0f );
+         EXPECT_LE( a[j].scenario.params.maxSpeed, 4.0f );
+         EXPECT_TRUE( a[j].scenario.params.numBoids == 32 || a[j].scenario.params.numBoids == 48 );
+         distinct += j > 0 && a[j].values[0] != a[j - 1].values[0];
+      }
+      EXPECT_GT( distinct, 40 );
+
+      s.sampleSeed = 10;
+      ASSERT_TRUE( s.expand( b ) );
+      EXPECT_NE( a[0].values, b[0].values );
+   }
+
+   // A job is BoidScenario::runCpu with samples: its last row describes the state a plain run
+   // of the same scenario ends in, neighbor list keys included
+   TEST( BoidSweep, jobs_step_like_a_scenario_run )
+   {
+      BoidSweep s;
+      std::string error;
+      ASSERT_TRUE( BoidSweep::parse( "numBoids=150\nsteps=25\nsampleInterval=10\nneighborSkin=1\nhashedGrid=1\n"
+                                     "axis=cohesionWeight:0.5,1.5\n", s, "", &error ) ) << error;
+      std::vector< BoidSweepJob > jobs;
+      ASSERT_TRUE( s.expand( jobs, &error ) ) << error;
+      BoidThreadPool pool( 2 );
+      for( const BoidSweepJob& job : jobs )
+      {
+         std::vector< std::string > rows;
+         std::istringstream in( s.runJob( job, pool ) );
+         for( std::string line; std::getline( in, line ); )
+            rows.push_back( line );
+         ASSERT_EQ( rows.size(), 4u ) << "steps 0, 10, 20 and 25";
+
+         std::vector< BoidGPU > final;
+         job.scenario.runCpu( pool, &final );
+         const BoidSwarmMetrics m = BoidSwarmMetrics::compute( final.data(), job.scenario.params.numBoids );
+         float step = 0.0f, polarization = 0.0f, gyration = 0.0f;
+         ASSERT_EQ( std::sscanf( rows.back().c_str(), "%*[^,],%*[^,],%*[^,],%*[^,],%*[^,],%f,%f,%*f,%f", &step, &polarization, &gyration ), 3 );
+         EXPECT_EQ( step, 25.0f );
+         EXPECT_EQ( polarization, m.polarization );
+         EXPECT_EQ( gyration, m.gyrationRadius );
+      }
+   }
+
+   TEST( BoidSweep, rejects_bad_specs )
+   {
+      BoidSweep s;
+      std::string error;
+      EXPECT_FALSE( BoidSweep::parse( "mode=lattice\n", s, "", &error ) );
+      EXPECT_NE( error.find( "line 1" ), std::string::npos ) << error;
+      EXPECT_FALSE( BoidSweep::parse( "axis=cohesionWeight:0..1\n", s, "", &error ) ); // grid needs a count
+      EXPECT_FALSE( BoidSweep::parse( "axis=cohesionWeight\n", s, "", &error ) );
+      EXPECT_FALSE( BoidSweep::parse( "axis=numBoids:1,,2\n", s, "", &error ) );
+      EXPECT_FALSE( BoidSweep::parse( "\nnoSuchKey=1\n", s, "", &error ) );
+      EXPECT_NE( error.find( "line 2" ), std::string::npos ) << error;
+
+      // Values are checked by the scenario when the jobs are expanded
+      ASSERT_TRUE( BoidSweep::parse( "axis=numBoids:64,-3\n", s, "", &error ) ) << error;
+      std::vector< BoidSweepJob > jobs;
+      EXPECT_FALSE( s.expand( jobs, &error ) );
+
+      BoidSweepOptions options;
+      EXPECT_TRUE( BoidSweepOptions::parse( { "app", "--sweep=a.boidsweep", "--sweep-jobs=3", "--sweep-resume" }, options, &error ) );
+      EXPECT_EQ( options.specPath, "a.boidsweep" );
+      EXPECT_EQ( options.jobs, 3 );
+      EXPECT_TRUE( options.resume );
+      EXPECT_FALSE( BoidSweepOptions::parse( { "--sweep-threads=0" }, options, &error ) );
+   }
+
+   TEST( BoidSweep, resumes_an_interrupted_sweep )
+   {
+      BoidSweep s;
+      std::string error;
+      ASSERT_TRUE( BoidSweep::parse( "numBoids=48\nnumPredators=1\nsteps=12\nsampleInterval=5\nreplicas=2\n"
+                                     "axis=separationWeight:1,2\n", s, "", &error ) ) << error;
+
+      BoidSweepOptions options;
+      options.outPath = ( std::filesystem::temp_directory_path() / "boid_sweep_test.csv" ).string();
+      options.jobs = 2;
+      BoidSweepReport report;
+      ASSERT_TRUE( s.run( options, &report, nullptr, &error ) ) << error;
+      EXPECT_EQ( report.jobsRun, 4 );
+      const std::string full = readFile( options.outPath );
+      // Header + steps 0, 5, 10 and 12 per job
+      EXPECT_EQ( withoutTimings( full ).size(), 1u + 4 * 4 );
+
+      // Cut the file in the middle of the third job's rows, as a kill during its write would
+      size_t cut = 0;
+      for( int line = 0; line < 1 + 2 * 4 + 2; ++line )
+         cut = full.find( '\n', cut ) + 1;
+      {
+         std::ofstream out( options.outPath, std::ios::binary | std::ios::trunc );
+         out << full.substr( 0, cut + 7 );
+      }
+
+      options.resume = true;
+      ASSERT_TRUE( s.run( options, &report, nullptr, &error ) ) << error;
+      EXPECT_EQ( report.jobsResumed, 2 );
+      EXPECT_EQ( report.jobsRun, 2 );
+      EXPECT_EQ( withoutTimings( readFile( options.outPath ) ), withoutTimings( full ) );
+
+      // Editing one axis value reruns only the jobs it moved; the rest are kept
+      s.axes[0].values[1] = "3";
+      ASSERT_TRUE( s.run( options, &report, nullptr, &error ) ) << error;
+      EXPECT_EQ( report.jobsResumed, 2 );
+      EXPECT_EQ( report.jobsRun, 2 );
+      const std::vector< std::string > edited = withoutTimings( readFile( options.outPath ) );
+      EXPECT_EQ( edited.size(), 1u + 4 * 4 );
+      std::vector< int > perValue( 4, 0 );
+      for( size_t i = 1; i < edited.size(); ++i )
+      {
+         // job,replica,seed,spec,separationWeight,...
+         size_t c = 0;
+         for( int k = 0; k < 4; ++k )
+            c = edited[i].find( ',', c ) + 1;
+         ++perValue.at( std::stoi( edited[i].substr( c, edited[i].find( ',', c ) - c ) ) );
+      }
+      EXPECT_EQ( perValue, std::vector< int >( { 0, 8, 0, 8 } ) );
+
+      // So does a base scenario key, which no column shows
+      s.base.params.cohWeight *= 2.0f;
+      ASSERT_TRUE( s.run( options, &report, nullptr, &error ) ) << error;
+      EXPECT_EQ( report.jobsResumed, 0 );
+      EXPECT_EQ( report.jobsRun, 4 );
+
+      // A different sweep refuses to resume into the file
+      s.axes[0].key = "alignmentWeight";
+      EXPECT_FALSE( s.run( options, &report, nullptr, &error ) );
+      std::remove( options.outPath.c_str() );
+   }
+}
@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include "BoidTuning.h"
+#include "BoidBackend.h"
+#include <cstdio>
+#include <filesystem>
+
+using namespace Aftr;
+namespace
+{
+   TEST( BoidTuning, size_buckets_are_powers_of_two )
+   {
+      EXPECT_EQ( BoidTuningKey::getSizeBucket( 1 ), 0 );
+      EXPECT_EQ( BoidTuningKey::getSizeBucket( 1000 ), 9 );
+      EXPECT_EQ( BoidTuningKey::getSizeBucket( 1023 ), 9 );
+      EXPECT_EQ( BoidTuningKey::getSizeBucket( 1024 ), 10 );
+      EXPECT_EQ( BoidTuningKey::getSizeBucket( 20010 ), 14 );
+   }
+
+   TEST( BoidTuning, candidates_cover_the_grid )
+   {
+      // Workgroup sizes x (all pairs + three list cell scales); chunk sizes on the threaded CPU
+      EXPECT_EQ( BoidTuningCache::getCandidates( BoidBackendType::GpuCompute ).size(), 16u );
+      EXPECT_EQ( BoidTuningCache::getCandidates( BoidBackendType::CpuThreaded ).size(), 12u );
+      EXPECT_EQ( BoidTuningCache::getCandidates( BoidBackendType::CpuScalar ).size(), 4u );
+      for( const BoidTuningConfig& c : BoidTuningCache::getCandidates( BoidBackendType::GpuCompute ) )
+         EXPECT_GE( c.cellScale, 1.0f );
+   }
+
+   TEST( BoidTuning, cache_round_trips_through_file )
+   {
+      BoidTuningKey gpuKey{ "llvmpipe (LLVM 15.0.7, 256 bits) | 4.5 (Core Profile) Mesa 23.2.1 | 8 threads", "gpu", 10 };
+      BoidTuningKey cpuKey = gpuKey;
+      cpuKey.backend = "cpu";
+      BoidTuningConfig a;
+      a.workgroupSize = 64;
+      a.neighborLists = true;
+      a.cellScale = 1.5f;
+      a.msPerStep = 3.25f;
+      BoidTuningConfig b;
+      b.cpuGrain = 1024;
+      b.msPerStep = 7.5f;
+
+      BoidTuningCache cache;
+      cache.store( gpuKey, BoidTuningConfig() );
+      cache.store( gpuKey, a ); // replaces
+      cache.store( cpuKey, b );
+      EXPECT_EQ( cache.size(), 2u );
+
+      const std::string path = ( std::filesystem::temp_directory_path() / "boid_tuning_test.cache" ).string();
+      ASSERT_TRUE( cache.save( path ) );
+      BoidTuningCache loaded;
+      ASSERT_TRUE( loaded.load( path ) );
+      std::remove( path.c_str() );
+
+      BoidTuningConfig out;
+      ASSERT_TRUE( loaded.find( gpuKey, out ) );
+      EXPECT_TRUE( out == a );
+      EXPECT_FLOAT_EQ( out.msPerStep, 3.25f );
+      ASSERT_TRUE( loaded.find( cpuKey, out ) );
+      EXPECT_TRUE( out == b );
+
+      // A different bucket or device is a different key and must be re-tuned
+      BoidTuningKey other = gpuKey;
+      other.sizeBucket = 11;
+      EXPECT_FALSE( loaded.find( other, out ) );
+      other = gpuKey;
+      other.device = "NVIDIA GeForce RTX 3080/PCIe/SSE2 | 4.6.0 NVIDIA 535.104.05 | 8 threads";
+      EXPECT_FALSE( loaded.find( other, out ) );
+   }
+
+   TEST( BoidTuning, rejects_malformed_lines )
+   {
+      BoidTuningKey key;
+      BoidTuningConfig c;
+      EXPECT_FALSE( BoidTuningCache::parseLine( "# comment", key, c ) );
+      EXPECT_FALSE( BoidTuningCache::parseLine( "gpu\t10\t256\t0\t1\t256\t2.5", key, c ) );       // no device
+      EXPECT_FALSE( BoidTuningCache::parseLine( "vulkan\t10\t256\t0\t1\t256\t2.5\tdev", key, c ) ); // unknown backend
+      EXPECT_FALSE( BoidTuningCache::parseLine( "gpu\t10\t256\t1\t0.5\t256\t2.5\tdev", key, c ) ); // cells below one list radius
+      EXPECT_TRUE( BoidTuningCache::parseLine( "scalar\t12\t256\t1\t2\t256\t9.5\tsome device", key, c ) );
+      EXPECT_EQ( key.backend, "scalar" );
+      EXPECT_EQ( key.device, "some device" );
+      EXPECT_TRUE( c.neighborLists );
+   }
+}
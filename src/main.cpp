@@ -6,7 +6,12 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdlib>
 #include "GLViewBoidSwarm.h" //GLView subclass instantiated to drive this simulation
+#include "BoidHeadless.h"
+#include "BoidDomain.h"
+#include "BoidScenario.h"
+#include "BoidSweep.h"
 
 /**
    This creates a GLView subclass instance and begins the GLView's main loop.
@@ -14,12 +19,76 @@
    request causes the entire GLView to be destroyed (since its exits scope) and
    begin again (simStatus == -1). This loop exits when a request to exit the 
    application is received (simStatus == 0 ).
+
+   With --headless the view runs a fixed number of frames into an offscreen framebuffer
+   instead (see BoidHeadlessOptions) and the process exits with its status. With
+   --domain-ranks=N no view is created at all: the swarm is stepped by N processes that each
+   own a slab of it (see BoidDomainRank), checked against a single-process run, and the program exits.
+   --sweep=FILE likewise runs a batch of headless CPU jobs over a parameter grid (see BoidSweep).
 */
 int main( int argc, char* argv[] )
 {
    std::vector< std::string > args{ argv, argv + argc }; ///< Command line arguments passed via argc and argv, reserved to size of argc
    int simStatus = 0;
 
+   Aftr::BoidHeadlessOptions headless;
+   Aftr::BoidDomainOptions domain;
+   Aftr::BoidSweepOptions sweep;
+   std::string error;
+   if( !Aftr::BoidDomainOptions::parse( args, domain, &error ) )
+   {
+      std::cout << error << std::endl;
+      return 1;
+   }
+   if( domain.ranks > 0 )
+   {
+      Aftr::BoidScenario scenario = Aftr::BoidScenario::makeDefault();
+      if( !domain.scenarioPath.empty() && !Aftr::BoidScenario::load( domain.scenarioPath, scenario, &error ) )
+      {
+         std::cout << error << std::endl;
+         return 1;
+      }
+      return Aftr::BoidDomainRank::runProcesses( scenario, domain.ranks, domain.steps, domain.socketDir );
+   }
+
+   if( !Aftr::BoidSweepOptions::parse( args, sweep, &error ) )
+   {
+      std::cout << error << std::endl;
+      return 1;
+   }
+   if( !sweep.specPath.empty() )
+   {
+      Aftr::BoidSweep spec;
+      Aftr::BoidSweepReport report;
+      if( !Aftr::BoidSweep::load( sweep.specPath, spec, &error ) || !spec.run( sweep, &report, &std::cout, &error ) )
+      {
+         std::cout << error << std::endl;
+         return 1;
+      }
+      std::cout << "Sweep done: " << report.jobsRun << " jobs run, " << report.jobsResumed << " resumed, "
+                << report.totalMs / 1000.0 << " s -> " << sweep.outPath << std::endl;
+      return 0;
+   }
+
+   if( !Aftr::BoidHeadlessOptions::parse( args, headless, &error ) )
+   {
+      std::cout << error << std::endl;
+      return 1;
+   }
+   if( headless.enabled )
+   {
+      // No window system needed: SDL's offscreen driver gives an EGL context (Mesa's llvmpipe
+      // without a GPU). An explicit SDL_VIDEODRIVER still wins
+#ifdef _WIN32
+      if( !std::getenv( "SDL_VIDEODRIVER" ) )
+         _putenv_s( "SDL_VIDEODRIVER", "offscreen" );
+#else
+      setenv( "SDL_VIDEODRIVER", "offscreen", 0 );
+#endif
+      std::unique_ptr< Aftr::GLViewBoidSwarm > glView( Aftr::GLViewBoidSwarm::New( args ) );
+      return glView->runHeadless( headless );
+   }
+
    do
    {
       std::unique_ptr< Aftr::GLViewBoidSwarm > glView( Aftr::GLViewBoidSwarm::New( args ) );